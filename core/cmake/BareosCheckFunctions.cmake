@@ -38,6 +38,7 @@ CHECK_FUNCTION_EXISTS(extattr_namespace_to_string HAVE_EXTATTR_NAMESPACE_TO_STRI
 CHECK_FUNCTION_EXISTS(extattr_set_file HAVE_EXTATTR_SET_FILE)
 CHECK_FUNCTION_EXISTS(extattr_set_link HAVE_EXTATTR_SET_LINK)
 CHECK_FUNCTION_EXISTS(extattr_string_to_namespace HAVE_EXTATTR_STRING_TO_NAMESPACE)
+CHECK_FUNCTION_EXISTS(fallocate HAVE_FALLOCATE)
 CHECK_FUNCTION_EXISTS(fchownat HAVE_FCHOWNAT)
 CHECK_FUNCTION_EXISTS(fdatasync HAVE_FDATASYNC)
 CHECK_FUNCTION_EXISTS(fseeko HAVE_FSEEKO)
@@ -105,6 +106,7 @@ CHECK_FUNCTION_EXISTS(strerror_r HAVE_STRERROR_R)
 CHECK_FUNCTION_EXISTS(strftime HAVE_STRFTIME)
 CHECK_FUNCTION_EXISTS(strncmp HAVE_STRNCMP)
 CHECK_FUNCTION_EXISTS(strncpy HAVE_STRNCPY)
+CHECK_FUNCTION_EXISTS(sync_file_range HAVE_SYNC_FILE_RANGE)
 CHECK_FUNCTION_EXISTS(tcgetattr HAVE_TCGETATTR)
 CHECK_FUNCTION_EXISTS(unlinkat HAVE_UNLINKAT)
 CHECK_FUNCTION_EXISTS(utimes HAVE_UTIMES)
@@ -81,6 +81,8 @@ class BareosDbQueryEnum {
     SQL_QUERY_bvfs_ls_sub_dirs_5 = 74,
     SQL_QUERY_list_volumes_select_0 = 75,
     SQL_QUERY_list_volumes_select_long_0 = 76,
-    SQL_QUERY_NUMBER = 77
+    SQL_QUERY_delete_jobs_from_table_2 = 77,
+    SQL_QUERY_verify_batch_latest_files_1 = 78,
+    SQL_QUERY_NUMBER = 79
   } SQL_QUERY_ENUM;
 };
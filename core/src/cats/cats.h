@@ -710,6 +710,7 @@ class BareosDb
   bool CreateStorageRecord(JobControlRecord* jcr, StorageDbRecord* sr);
   bool CreateMediatypeRecord(JobControlRecord* jcr, MediaTypeDbRecord* mr);
   bool WriteBatchFileRecords(JobControlRecord* jcr);
+  bool CreateVerifyBatchRecord(JobControlRecord* jcr, AttributesDbRecord* ar);
   bool CreateAttributesRecord(JobControlRecord* jcr, AttributesDbRecord* ar);
   bool CreateRestoreObjectRecord(JobControlRecord* jcr,
                                  RestoreObjectDbRecord* ar);
@@ -804,6 +805,14 @@ class BareosDb
                    bool use_delta,
                    DB_RESULT_HANDLER* ResultHandler,
                    void* ctx);
+  bool GetFileIndexList(JobControlRecord* jcr,
+                        char* jobids,
+                        DB_RESULT_HANDLER* ResultHandler,
+                        void* ctx);
+  bool GetVerifyBatchFileRecords(JobControlRecord* jcr,
+                                 JobDbRecord* jr,
+                                 DB_RESULT_HANDLER* ResultHandler,
+                                 void* ctx);
   bool GetBaseJobid(JobControlRecord* jcr, JobDbRecord* jr, JobId_t* jobid);
   bool AccurateGetJobids(JobControlRecord* jcr,
                          JobDbRecord* jr,
@@ -966,6 +975,9 @@ class BareosDb
                              char* digest,
                              int type);
   bool MarkFileRecord(JobControlRecord* jcr, FileId_t FileId, JobId_t JobId);
+  bool MarkFileRecords(JobControlRecord* jcr,
+                       const char* FileIds,
+                       JobId_t JobId);
   void MakeInchangerUnique(JobControlRecord* jcr, MediaDbRecord* mr);
   int UpdateStats(JobControlRecord* jcr, utime_t age);
 
@@ -926,6 +926,36 @@ bool BareosDb::CreateBatchFileAttributesRecord(JobControlRecord* jcr,
   return jcr->db_batch->SqlBatchInsert(jcr, ar);
 }
 
+/**
+ * Add the attributes of a file received by a Verify Job to the batch table.
+ * Unlike CreateBatchFileAttributesRecord() the batch table is never written
+ * to the File table, GetVerifyBatchFileRecords() compares it to the catalog
+ * and empties it.
+ *
+ * Returns: false on failure
+ *          true on success
+ */
+bool BareosDb::CreateVerifyBatchRecord(JobControlRecord* jcr,
+                                       AttributesDbRecord* ar)
+{
+  Dmsg1(dbglevel, "Fname=%s\n", ar->fname);
+
+  if (!jcr->batch_started) {
+    if (!OpenBatchConnection(jcr)) { return false; /* error already printed */ }
+    if (!jcr->db_batch->SqlBatchStart(jcr)) {
+      Mmsg1(errmsg, "Can't start batch mode: ERR=%s",
+            jcr->db_batch->strerror());
+      Jmsg(jcr, M_FATAL, 0, "%s", errmsg);
+      return false;
+    }
+    jcr->batch_started = true;
+  }
+
+  jcr->db_batch->SplitPathAndFile(jcr, ar->fname);
+
+  return jcr->db_batch->SqlBatchInsert(jcr, ar);
+}
+
 /**
  * Create File record in BareosDb
  *
@@ -1023,7 +1053,8 @@ bool BareosDb::CreateAttributesRecord(JobControlRecord* jcr,
    * Make sure we have an acceptable attributes record.
    */
   if (!(ar->Stream == STREAM_UNIX_ATTRIBUTES ||
-        ar->Stream == STREAM_UNIX_ATTRIBUTES_EX)) {
+        ar->Stream == STREAM_UNIX_ATTRIBUTES_EX ||
+        ar->Stream == STREAM_UNIX_ATTRIBUTES_BINARY)) {
     Mmsg1(errmsg, _("Attempt to put non-attributes into catalog. Stream=%d\n"),
           ar->Stream);
     Jmsg(jcr, M_FATAL, 0, "%s", errmsg);
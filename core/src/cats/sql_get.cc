@@ -1294,6 +1294,118 @@ bool BareosDb::GetFileList(JobControlRecord* jcr,
   return BigSqlQuery(query.c_str(), ResultHandler, ctx);
 }
 
+/**
+ * Get the JobId, FileIndex and DeltaSeq of the most recent version of every
+ * file in the given jobids sorted by JobId and FileIndex, which is the order
+ * the bootstrap code wants them in. No other file attributes are fetched.
+ */
+bool BareosDb::GetFileIndexList(JobControlRecord* jcr,
+                                char* jobids,
+                                DB_RESULT_HANDLER* ResultHandler,
+                                void* ctx)
+{
+  PoolMem query(PM_MESSAGE);
+  PoolMem query2(PM_MESSAGE);
+
+  if (!*jobids) {
+    DbLock(this);
+    Mmsg(errmsg, _("ERR=JobIds are empty\n"));
+    DbUnlock(this);
+    return false;
+  }
+
+  FillQuery(query2, SQL_QUERY_select_recent_version_with_basejob, jobids,
+            jobids, jobids, jobids);
+
+  Mmsg(query,
+       "SELECT T1.JobId, T1.FileIndex, T1.DeltaSeq "
+       "FROM ( %s ) AS T1 "
+       "WHERE FileIndex > 0 "
+       "ORDER BY T1.JobId, T1.FileIndex ASC",
+       query2.c_str());
+
+  Dmsg1(100, "q=%s\n", query.c_str());
+
+  return BigSqlQuery(query.c_str(), ResultHandler, ctx);
+}
+
+/**
+ * Compare the files added by CreateVerifyBatchRecord() to the catalog in
+ * one query. The catalog records are selected like GetFileRecord() does for
+ * the level of the Verify Job.
+ *
+ * ResultHandler is called with FileIndex, FileId, LStat and MD5 of every
+ * catalog record found, ordered by FileIndex. For DiskToCatalog only the
+ * latest backed up version of a file is selected, like GetFileRecord() does.
+ * Files without a record are new files and are not returned.
+ *
+ * The batch table is empty afterwards.
+ *
+ * Returns: false on failure
+ *          true on success
+ */
+bool BareosDb::GetVerifyBatchFileRecords(JobControlRecord* jcr,
+                                         JobDbRecord* jr,
+                                         DB_RESULT_HANDLER* ResultHandler,
+                                         void* ctx)
+{
+  bool retval = false;
+  PoolMem query(PM_MESSAGE);
+  char ed1[50];
+
+  if (!jcr->batch_started) { return true; /* no files */ }
+
+  if (!jcr->db_batch->SqlBatchEnd(jcr, NULL)) {
+    Mmsg1(errmsg, "Batch end %s\n", jcr->db_batch->strerror());
+    goto bail_out;
+  }
+
+  /* clang-format off */
+  switch (jcr->getJobLevel()) {
+    case L_VERIFY_DISK_TO_CATALOG:
+      FillQuery(query, SQL_QUERY_verify_batch_latest_files_1,
+                edit_int64(jr->ClientId, ed1));
+      break;
+    case L_VERIFY_VOLUME_TO_CATALOG:
+      Mmsg(query,
+           "SELECT batch.FileIndex, File.FileId, File.LStat, File.MD5 "
+           "FROM batch "
+           "JOIN Path ON (Path.Path = batch.Path) "
+           "JOIN File ON (File.PathId = Path.PathId AND File.Name = batch.Name "
+                         "AND File.FileIndex = batch.FileIndex) "
+           "WHERE File.JobId=%s "
+           "ORDER BY batch.FileIndex, File.FileId",
+           edit_int64(jr->JobId, ed1));
+      break;
+    default:
+      Mmsg(query,
+           "SELECT batch.FileIndex, File.FileId, File.LStat, File.MD5 "
+           "FROM batch "
+           "JOIN Path ON (Path.Path = batch.Path) "
+           "JOIN File ON (File.PathId = Path.PathId AND File.Name = batch.Name) "
+           "WHERE File.JobId=%s "
+           "ORDER BY batch.FileIndex, File.FileId",
+           edit_int64(jr->JobId, ed1));
+      break;
+  }
+  /* clang-format on */
+
+  Dmsg1(100, "q=%s\n", query.c_str());
+
+  if (!jcr->db_batch->SqlQuery(query.c_str(), ResultHandler, ctx)) {
+    Mmsg1(errmsg, "%s", jcr->db_batch->strerror());
+    goto bail_out;
+  }
+  retval = true;
+
+bail_out:
+  jcr->db_batch->SqlQuery("DROP TABLE batch");
+  jcr->batch_started = false;
+  jcr->db_batch->changes = 0;
+
+  return retval;
+}
+
 /**
  * This procedure gets the base jobid list used by jobids,
  */
@@ -88,6 +88,25 @@ bool BareosDb::MarkFileRecord(JobControlRecord* jcr,
   return retval;
 }
 
+/**
+ * Mark a comma separated list of File records like MarkFileRecord()
+ */
+bool BareosDb::MarkFileRecords(JobControlRecord* jcr,
+                               const char* FileIds,
+                               JobId_t JobId)
+{
+  bool retval;
+  char ed1[50];
+
+  DbLock(this);
+  Mmsg(cmd, "UPDATE File SET MarkId=%s WHERE FileId IN (%s)",
+       edit_int64(JobId, ed1), FileIds);
+  retval = UPDATE_DB(jcr, cmd);
+  DbUnlock(this);
+
+  return retval;
+}
+
 /**
  * Update the Job record at start of Job
  *
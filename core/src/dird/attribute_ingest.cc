@@ -0,0 +1,340 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Parallel ingestion of file attributes sent by the Storage daemon.
+ *
+ * The message thread of a job does not parse and store the attributes it
+ * receives itself but queues them. A pool of worker threads parses the
+ * attributes and stores them in the catalog. The attributes of one job are
+ * processed by only one worker at a time and in the order they were
+ * received, as an attribute record is completed by the digest record that
+ * follows it.
+ *
+ * The queue is limited in size. When it is full the message thread waits
+ * and stops reading from the Storage daemon, so the Storage daemon is slowed
+ * down by the network connection until the catalog catches up.
+ *
+ * A reload of the configuration changes the number of workers. Surplus
+ * workers exit when they are idle, the last worker only after all queued
+ * attributes are stored.
+ */
+
+#include "include/bareos.h"
+#include "dird.h"
+#include "dird/dird_globals.h"
+#include "dird/attribute_ingest.h"
+#include "dird/catreq.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace directordaemon {
+
+static const int debuglevel = 200;
+
+/* Number of messages a worker processes for a job before the next job */
+static const size_t ingest_batch_size = 500;
+
+struct ingest_job {
+  JobControlRecord* jcr;
+  std::deque<std::string> messages; /* attribute messages in order */
+};
+
+static bool quit = false;
+static bool ingest_initialized = false;
+static uint32_t wanted_workers = 0;
+static std::vector<pthread_t> worker_tids;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t space_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Jobs with queued attributes, a job is either on the ready list or taken
+ * by a worker.
+ */
+static std::map<JobControlRecord*, ingest_job*> jobs;
+static std::deque<ingest_job*> ready;
+static uint64_t queued_bytes = 0;
+static uint64_t max_queued_bytes = 0;
+static attribute_ingest_stats_t ingest_stats;
+
+extern "C" void* attribute_ingest_thread(void* arg)
+{
+  ingest_job* job;
+  JobControlRecord* jcr;
+  std::vector<std::string> batch;
+  uint64_t bytes;
+  bool finished;
+
+  Dmsg0(debuglevel, "Starting attribute ingest worker\n");
+
+  while (1) {
+    P(mutex);
+    while (ready.empty() && !quit && worker_tids.size() <= wanted_workers) {
+      pthread_cond_wait(&work_cond, &mutex);
+    }
+
+    /*
+     * Fewer workers are wanted after a reload. The last worker stays until
+     * the queue is empty, the remaining workers are joined on shutdown.
+     */
+    if (!quit && worker_tids.size() > wanted_workers &&
+        (worker_tids.size() > 1 || ready.empty())) {
+      for (auto it = worker_tids.begin(); it != worker_tids.end(); ++it) {
+        if (pthread_equal(*it, pthread_self())) {
+          worker_tids.erase(it);
+          break;
+        }
+      }
+      pthread_detach(pthread_self());
+      V(mutex);
+      break;
+    }
+
+    if (ready.empty()) {
+      V(mutex);
+      break;
+    }
+
+    job = ready.front();
+    ready.pop_front();
+    while (!job->messages.empty() && batch.size() < ingest_batch_size) {
+      batch.push_back(std::move(job->messages.front()));
+      job->messages.pop_front();
+    }
+    V(mutex);
+
+    jcr = job->jcr;
+    SetJcrInTsd(jcr);
+    bytes = 0;
+    for (std::string& msg : batch) {
+      bytes += msg.size();
+      if (!jcr->IsJobCanceled()) {
+        UpdateAttribute(jcr, &msg[0], msg.size());
+      }
+    }
+    SetJcrInTsd(INVALID_JCR);
+
+    P(mutex);
+    queued_bytes -= bytes;
+    ingest_stats.messages += batch.size();
+    ingest_stats.bytes += bytes;
+    pthread_cond_broadcast(&space_cond);
+
+    finished = job->messages.empty();
+    if (finished) {
+      jobs.erase(jcr);
+      pthread_cond_broadcast(&done_cond);
+    } else {
+      ready.push_back(job);
+      pthread_cond_signal(&work_cond);
+    }
+    V(mutex);
+
+    batch.clear();
+    if (finished) {
+      delete job;
+      FreeJcr(jcr);
+    }
+  }
+
+  Dmsg0(debuglevel, "Finished attribute ingest worker\n");
+
+  return NULL;
+}
+
+/**
+ * Queue an attribute message of the Storage daemon. Waits while the queue is
+ * full.
+ *
+ * Returns: true if the message is handled by the workers
+ *          false if the caller has to store it itself
+ */
+bool AttributeIngestEnqueue(JobControlRecord* jcr,
+                            const char* msg,
+                            int32_t message_length)
+{
+  ingest_job* job;
+  bool stalled = false;
+
+  if (!ingest_initialized) { return false; }
+
+  P(mutex);
+  while (queued_bytes > 0 && queued_bytes + message_length > max_queued_bytes &&
+         !quit && !jcr->IsJobCanceled()) {
+    if (!stalled) {
+      ingest_stats.stalls++;
+      stalled = true;
+    }
+    pthread_cond_wait(&space_cond, &mutex);
+  }
+
+  if (quit) {
+    V(mutex);
+    return false;
+  }
+
+  auto it = jobs.find(jcr);
+  if (it == jobs.end()) {
+    /*
+     * Without workers only a job that still has queued attributes has to
+     * queue its next ones, so they are stored in order.
+     */
+    if (!wanted_workers) {
+      V(mutex);
+      return false;
+    }
+
+    job = new ingest_job;
+    job->jcr = jcr;
+    jcr->IncUseCount(); /* released by the worker when the queue is empty */
+    jobs[jcr] = job;
+    ready.push_back(job);
+    pthread_cond_signal(&work_cond);
+  } else {
+    job = it->second;
+  }
+
+  job->messages.emplace_back(msg, message_length);
+  queued_bytes += message_length;
+  V(mutex);
+
+  return true;
+}
+
+/**
+ * Wait until all attributes queued for a job are stored in the catalog.
+ */
+void FlushAttributeIngest(JobControlRecord* jcr)
+{
+  if (!ingest_initialized) { return; }
+
+  P(mutex);
+  while (jobs.find(jcr) != jobs.end()) {
+    Dmsg1(debuglevel, "JobId=%d waiting for attribute ingestion\n",
+          jcr->JobId);
+    pthread_cond_wait(&done_cond, &mutex);
+  }
+  V(mutex);
+}
+
+/**
+ * Get the counters of the workers.
+ *
+ * Returns: false if the workers are not running.
+ */
+bool GetAttributeIngestStatistics(attribute_ingest_stats_t& stats)
+{
+  if (!ingest_initialized) { return false; }
+
+  P(mutex);
+  stats = ingest_stats;
+  stats.workers = worker_tids.size();
+  stats.jobs = jobs.size();
+  stats.queued = queued_bytes;
+  V(mutex);
+
+  return true;
+}
+
+/*
+ * Start workers until the wanted number is running, called with the mutex
+ * held.
+ */
+static int CreateWorkers()
+{
+  int status;
+  pthread_t tid;
+
+  while (worker_tids.size() < wanted_workers) {
+    if ((status = pthread_create(&tid, NULL, attribute_ingest_thread, NULL)) !=
+        0) {
+      if (worker_tids.empty()) { return status; }
+      break;
+    }
+    worker_tids.push_back(tid);
+  }
+
+  return 0;
+}
+
+int StartAttributeIngestWorkers(void)
+{
+  int status;
+
+  P(mutex);
+  quit = false;
+  max_queued_bytes = me->attribute_ingest_queue_size;
+  wanted_workers = me->attribute_ingest_workers;
+  status = CreateWorkers();
+  V(mutex);
+
+  if (status != 0) { return status; }
+
+  ingest_initialized = true;
+
+  return 0;
+}
+
+/**
+ * Called after a reload of the configuration. Starts additional workers or
+ * lets the surplus workers exit and uses the new queue size.
+ */
+void ReloadAttributeIngestWorkers()
+{
+  if (!ingest_initialized) { return; }
+
+  P(mutex);
+  max_queued_bytes = me->attribute_ingest_queue_size;
+  wanted_workers = me->attribute_ingest_workers;
+  if (CreateWorkers() != 0) {
+    Emsg0(M_ERROR, 0, _("Cannot start attribute ingest workers\n"));
+  }
+  pthread_cond_broadcast(&work_cond);
+  pthread_cond_broadcast(&space_cond);
+  V(mutex);
+}
+
+/**
+ * Stop the workers after they processed all queued attributes.
+ */
+void StopAttributeIngestWorkers()
+{
+  if (!ingest_initialized) { return; }
+
+  P(mutex);
+  quit = true;
+  pthread_cond_broadcast(&work_cond);
+  pthread_cond_broadcast(&space_cond);
+  V(mutex);
+
+  for (pthread_t tid : worker_tids) {
+    if (!pthread_equal(tid, pthread_self())) { pthread_join(tid, NULL); }
+  }
+  worker_tids.clear();
+  ingest_initialized = false;
+}
+
+} /* namespace directordaemon */
@@ -0,0 +1,53 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Parallel ingestion of file attributes sent by the Storage daemon.
+ */
+
+#ifndef BAREOS_DIRD_ATTRIBUTE_INGEST_H_
+#define BAREOS_DIRD_ATTRIBUTE_INGEST_H_
+
+namespace directordaemon {
+
+/**
+ * Counters of the attribute ingestion workers
+ */
+struct attribute_ingest_stats_t {
+  uint32_t workers;  /* number of worker threads */
+  uint32_t jobs;     /* jobs with queued attributes */
+  uint64_t queued;   /* bytes of attributes waiting to be stored */
+  uint64_t messages; /* attribute messages processed */
+  uint64_t bytes;    /* bytes of attribute messages processed */
+  uint64_t stalls;   /* times a job had to wait for free queue space */
+};
+
+int StartAttributeIngestWorkers(void);
+void StopAttributeIngestWorkers();
+void ReloadAttributeIngestWorkers();
+bool AttributeIngestEnqueue(JobControlRecord* jcr,
+                            const char* msg,
+                            int32_t message_length);
+void FlushAttributeIngest(JobControlRecord* jcr);
+bool GetAttributeIngestStatistics(attribute_ingest_stats_t& stats);
+
+} /* namespace directordaemon */
+#endif  // BAREOS_DIRD_ATTRIBUTE_INGEST_H_
@@ -30,6 +30,7 @@
 
 #include "include/bareos.h"
 #include "dird.h"
+#include "dird/dird_globals.h"
 #include "dird/next_vol.h"
 #include "dird/ua_server.h"
 #include "dird/ua_prune.h"
@@ -59,6 +60,10 @@ void DoAutoprune(JobControlRecord* jcr)
   client = jcr->res.client;
   pool = jcr->res.pool;
 
+  if (me->autoprune_time_limit) {
+    ua->prune_deadline = time(NULL) + me->autoprune_time_limit;
+  }
+
   if (job->PruneJobs || client->AutoPrune) {
     PruneJobs(ua, client, pool, jcr->getJobType());
     pruned = true;
@@ -55,7 +55,7 @@
 namespace directordaemon {
 
 /* Commands sent to File daemon */
-static char backupcmd[] = "backup FileIndex=%ld\n";
+static char backupcmd[] = "backup FileIndex=%ld BinaryAttributes=%d\n";
 static char storaddrcmd[] = "storage address=%s port=%d ssl=%d\n";
 static char passiveclientcmd[] = "passive client address=%s port=%d ssl=%d\n";
 
@@ -290,7 +290,7 @@ static bool IsChecksumNeededByFileset(JobControlRecord* jcr)
 
 /*
  * Send current file list to FD
- *    DIR -> FD : accurate files=xxxx
+ *    DIR -> FD : accurate files=xxxx [prunedirs=1]
  *    DIR -> FD : /path/to/file\0Lstat\0MD5\0Delta
  *    DIR -> FD : /path/to/dir/\0Lstat\0MD5\0Delta
  *    ...
@@ -348,7 +348,11 @@ bool SendAccurateCurrentFiles(JobControlRecord* jcr)
   Mmsg(buf, "SELECT sum(JobFiles) FROM Job WHERE JobId IN (%s)", jobids.list);
   jcr->db->SqlQuery(buf.c_str(), DbListHandler, &nb);
   Dmsg2(200, "jobids=%s nb=%s\n", jobids.list, nb.list);
-  jcr->file_bsock->fsend("accurate files=%s\n", nb.list);
+  if (jcr->res.job->accurate_dir_pruning && !jcr->is_JobLevel(L_FULL)) {
+    jcr->file_bsock->fsend("accurate files=%s prunedirs=1\n", nb.list);
+  } else {
+    jcr->file_bsock->fsend("accurate files=%s\n", nb.list);
+  }
 
   if (jcr->HasBase) {
     jcr->nb_base_files = str_to_int64(nb.list);
@@ -622,7 +626,7 @@ bool DoNativeBackup(JobControlRecord* jcr)
   /*
    * Send backup command
    */
-  fd->fsend(backupcmd, jcr->JobFiles);
+  fd->fsend(backupcmd, jcr->JobFiles, jcr->binary_attributes);
   Dmsg1(100, ">filed: %s", fd->msg);
   if (!response(jcr, fd, OKbackup, "Backup", DISPLAY_ERROR)) { goto bail_out; }
 
@@ -630,6 +630,45 @@ void AddFindex(RestoreBootstrapRecord* bsr, uint32_t JobId, int32_t findex)
   return;
 }
 
+/**
+ * Add a FileIndex to the list of BootStrap records when the FileIndexes
+ * are added in JobId and FileIndex order. Sorted input is appended to the
+ * last range in constant time, anything else is handed to AddFindex().
+ */
+void AppendFindex(bsr_append_ctx* ctx, uint32_t JobId, int32_t findex)
+{
+  RestoreBootstrapRecordFileIndex* fi;
+
+  if (findex == 0) { return; /* probably a dummy directory */ }
+
+  if (ctx->bsr && ctx->bsr->JobId == JobId && findex >= ctx->fi->findex) {
+    if (findex <= ctx->fi->findex2) { return; /* duplicate */ }
+
+    if (!ctx->fi->next) {
+      if (findex == ctx->fi->findex2 + 1) { /* extend up */
+        ctx->fi->findex2 = findex;
+      } else {
+        fi = new_findex();
+        fi->findex = findex;
+        fi->findex2 = findex;
+        ctx->fi->next = fi;
+        ctx->fi = fi;
+      }
+      return;
+    }
+  }
+
+  /*
+   * New JobId or not in order, do a normal insert and remember the
+   * last range of the JobId for the next call.
+   */
+  AddFindex(ctx->root, JobId, findex);
+  for (ctx->bsr = ctx->root; ctx->bsr; ctx->bsr = ctx->bsr->next) {
+    if (ctx->bsr->JobId == JobId) { break; }
+  }
+  for (ctx->fi = ctx->bsr->fi; ctx->fi->next; ctx->fi = ctx->fi->next) {}
+}
+
 /**
  * Add all possible  FileIndexes to the list of BootStrap records.
  * Here we are only dealing with JobId's and the FileIndexes
@@ -67,6 +67,16 @@ struct RestoreBootstrapRecord {
 
 class UaContext;
 
+/**
+ * Context to add FileIndexes sorted by JobId and FileIndex to a bsr chain
+ * without walking the chain for every FileIndex.
+ */
+struct bsr_append_ctx {
+  RestoreBootstrapRecord* root;        /**< First bsr in the chain */
+  RestoreBootstrapRecord* bsr;         /**< Bsr of the last JobId added */
+  RestoreBootstrapRecordFileIndex* fi; /**< Last FileIndex range added */
+};
+
 /**
  * Open bootstrap file.
  */
@@ -86,6 +96,7 @@ void DisplayBsrInfo(UaContext* ua, RestoreContext& rx);
 uint32_t WriteBsr(UaContext* ua, RestoreContext& rx, PoolMem* buffer);
 void AddFindex(RestoreBootstrapRecord* bsr, uint32_t JobId, int32_t findex);
 void AddFindexAll(RestoreBootstrapRecord* bsr, uint32_t JobId);
+void AppendFindex(bsr_append_ctx* ctx, uint32_t JobId, int32_t findex);
 RestoreBootstrapRecordFileIndex* new_findex();
 void MakeUniqueRestoreFilename(UaContext* ua, POOLMEM*& fname);
 void PrintBsr(UaContext* ua, RestoreContext& rx);
@@ -0,0 +1,408 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Catalog log writer thread.
+ *
+ * Job messages sent to a catalog destination are not inserted into the Log
+ * table by the thread that raised them but are put on a bounded queue. A
+ * writer thread stores them with one multi row INSERT per catalog and batch.
+ * When the queue is full messages are dropped and counted, the number of
+ * dropped messages is reported in the job log when the job ends.
+ */
+
+#include "include/bareos.h"
+#include "dird.h"
+#include "dird/dird_globals.h"
+#include "dird/catalog_log.h"
+#include "dird/ua_server.h"
+#include "cats/sql_pooling.h"
+#include "lib/edit.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace directordaemon {
+
+static const int debuglevel = 200;
+
+/* Number of messages the writer takes from the queue at once */
+static const size_t log_batch_size = 1000;
+
+/* Maximum number of rows in one INSERT statement */
+static const size_t log_insert_rows = 100;
+
+/* Maximum time a job waits at its end for its messages to be stored */
+static const int log_flush_timeout = 60;
+
+struct log_item {
+  std::string catalog; /* name of the catalog of the job */
+  JobId_t JobId;
+  utime_t mtime;
+  std::string text;
+  uint64_t seq; /* position in the queue */
+};
+
+static bool quit = false;
+static bool reconnect = false; /* the catalogs changed by a reload */
+static bool log_writer_initialized = false;
+static pthread_t log_writer_tid;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static std::deque<log_item> log_queue;
+static uint32_t max_queue_size = 0;
+static uint64_t next_seq = 1; /* sequence number of the next message */
+static uint64_t done_seq = 0; /* all messages up to here are processed */
+static std::map<JobId_t, uint32_t> dropped_per_job;
+static catalog_log_stats_t log_stats;
+
+/*
+ * Database connections of the writer, one per catalog.
+ */
+static std::map<std::string, BareosDb*> connections;
+
+static BareosDb* GetCatalogConnection(JobControlRecord* jcr,
+                                      const std::string& name)
+{
+  BareosDb* db = NULL;
+  CatalogResource* catalog;
+
+  auto it = connections.find(name);
+  if (it != connections.end()) { return it->second; }
+
+  LockRes(my_config);
+  catalog =
+      (CatalogResource*)my_config->GetResWithName(R_CATALOG, name.c_str());
+  if (catalog) {
+    db = DbSqlGetPooledConnection(
+        jcr, catalog->db_driver, catalog->db_name, catalog->db_user,
+        catalog->db_password.value, catalog->db_address, catalog->db_port,
+        catalog->db_socket, catalog->mult_db_connections,
+        catalog->disable_batch_insert, catalog->try_reconnect,
+        catalog->exit_on_fatal);
+  }
+  UnlockRes(my_config);
+
+  if (!db) {
+    Emsg1(M_ERROR, 0, _("Could not open catalog \"%s\" to store job logs.\n"),
+          name.c_str());
+    return NULL;
+  }
+
+  connections[name] = db;
+  return db;
+}
+
+static void CloseCatalogConnections(JobControlRecord* jcr)
+{
+  for (auto& connection : connections) {
+    DbSqlClosePooledConnection(jcr, connection.second);
+  }
+  connections.clear();
+}
+
+/**
+ * Store a number of messages of the same catalog with one INSERT.
+ */
+static uint32_t InsertLogRows(JobControlRecord* jcr,
+                              std::vector<log_item>::iterator first,
+                              std::vector<log_item>::iterator last)
+{
+  BareosDb* db;
+  uint32_t rows = last - first;
+  char ed1[50];
+  char dt[MAX_TIME_LENGTH];
+  PoolMem query(PM_MESSAGE), row(PM_MESSAGE), esc_msg(PM_MESSAGE);
+
+  if (!(db = GetCatalogConnection(jcr, first->catalog))) { return 0; }
+
+  PmStrcpy(query, "INSERT INTO Log (JobId, Time, LogText) VALUES ");
+  for (auto it = first; it != last; ++it) {
+    esc_msg.check_size(it->text.size() * 2 + 1);
+    db->EscapeString(jcr, esc_msg.c_str(), (char*)it->text.c_str(),
+                     it->text.size());
+    bstrutime(dt, sizeof(dt), it->mtime);
+    Mmsg(row, "%s(%s,'%s','%s')", (it == first) ? "" : ",",
+         edit_int64(it->JobId, ed1), dt, esc_msg.c_str());
+    PmStrcat(query, row.c_str());
+  }
+
+  if (!db->SqlQuery(query.c_str())) {
+    Emsg2(M_ERROR, 0, _("Unable to store %d job log messages: ERR=%s"), rows,
+          db->strerror());
+    return 0;
+  }
+
+  return rows;
+}
+
+/**
+ * Write one batch taken from the queue, consecutive messages of the same
+ * catalog are stored together.
+ */
+static void WriteLogBatch(JobControlRecord* jcr, std::vector<log_item>& batch)
+{
+  uint32_t written = 0, failed = 0, inserts = 0;
+  auto first = batch.begin();
+
+  while (first != batch.end()) {
+    auto last = first + 1;
+    uint32_t rows;
+
+    while (last != batch.end() && last - first < (long)log_insert_rows &&
+           last->catalog == first->catalog) {
+      ++last;
+    }
+
+    rows = InsertLogRows(jcr, first, last);
+    written += rows;
+    failed += (last - first) - rows;
+    inserts++;
+    first = last;
+  }
+
+  P(mutex);
+  log_stats.written += written;
+  log_stats.failed += failed;
+  log_stats.batches += inserts;
+  done_seq = batch.back().seq;
+  pthread_cond_broadcast(&done_cond);
+  V(mutex);
+
+  Dmsg2(debuglevel, "Catalog log writer stored %d messages with %d inserts\n",
+        written, inserts);
+}
+
+extern "C" void* catalog_log_thread(void* arg)
+{
+  JobControlRecord* jcr;
+  std::vector<log_item> batch;
+
+  Dmsg0(debuglevel, "Starting catalog log writer thread\n");
+
+  jcr = new_control_jcr("*CatalogLogWriter*", JT_SYSTEM);
+
+  while (1) {
+    bool refresh;
+
+    P(mutex);
+    while (log_queue.empty() && !quit) {
+      pthread_cond_wait(&work_cond, &mutex);
+    }
+
+    if (log_queue.empty()) {
+      V(mutex);
+      break;
+    }
+
+    while (!log_queue.empty() && batch.size() < log_batch_size) {
+      batch.push_back(std::move(log_queue.front()));
+      log_queue.pop_front();
+    }
+    refresh = reconnect;
+    reconnect = false;
+    V(mutex);
+
+    /*
+     * Connect again with the catalog definitions of the new configuration.
+     */
+    if (refresh) { CloseCatalogConnections(jcr); }
+
+    WriteLogBatch(jcr, batch);
+    batch.clear();
+  }
+
+  CloseCatalogConnections(jcr);
+  FreeJcr(jcr);
+
+  Dmsg0(debuglevel, "Finished catalog log writer thread\n");
+
+  return NULL;
+}
+
+/**
+ * Queue a message for the Log table.
+ *
+ * Returns: true if the message is handled by the writer (even if dropped)
+ *          false if the caller has to insert it itself
+ */
+bool CatalogLogEnqueue(JobControlRecord* jcr, utime_t mtime, const char* msg)
+{
+  if (!log_writer_initialized || !jcr->res.catalog) { return false; }
+
+  P(mutex);
+  if (quit) {
+    V(mutex);
+    return false;
+  }
+
+  if (log_queue.size() >= max_queue_size) {
+    log_stats.dropped++;
+    if (jcr->JobId) { dropped_per_job[jcr->JobId]++; }
+    V(mutex);
+    return true;
+  }
+
+  log_queue.push_back(
+      log_item{jcr->res.catalog->name(), jcr->JobId, mtime, msg, next_seq++});
+  pthread_cond_signal(&work_cond);
+  V(mutex);
+
+  return true;
+}
+
+/**
+ * Wait until all messages queued so far are stored in the catalog and report
+ * the messages of this job that had to be dropped.
+ */
+void FlushCatalogLog(JobControlRecord* jcr)
+{
+  uint32_t dropped = 0;
+  uint64_t target;
+  struct timeval tv;
+  struct timezone tz;
+  struct timespec timeout;
+
+  if (!log_writer_initialized) { return; }
+
+  P(mutex);
+  auto it = dropped_per_job.find(jcr->JobId);
+  if (it != dropped_per_job.end()) {
+    dropped = it->second;
+    dropped_per_job.erase(it);
+  }
+  V(mutex);
+
+  if (dropped) {
+    Jmsg(jcr, M_WARNING, 0,
+         _("%d job messages were not stored in the catalog because the "
+           "catalog log queue was full.\n"),
+         dropped);
+  }
+
+  gettimeofday(&tv, &tz);
+  timeout.tv_nsec = tv.tv_usec * 1000;
+  timeout.tv_sec = tv.tv_sec + log_flush_timeout;
+
+  P(mutex);
+  target = next_seq - 1;
+  while (done_seq < target && !quit) {
+    if (pthread_cond_timedwait(&done_cond, &mutex, &timeout) == ETIMEDOUT) {
+      Dmsg1(debuglevel, "JobId=%d timed out waiting for catalog log flush\n",
+            jcr->JobId);
+      break;
+    }
+  }
+  V(mutex);
+}
+
+/**
+ * Forget the dropped messages of a job that ends, messages dropped after
+ * FlushCatalogLog() cannot be reported in the job log anymore.
+ */
+void ForgetCatalogLogJob(JobControlRecord* jcr)
+{
+  if (!log_writer_initialized || !jcr->JobId) { return; }
+
+  P(mutex);
+  auto it = dropped_per_job.find(jcr->JobId);
+  if (it != dropped_per_job.end()) {
+    Dmsg2(debuglevel, "JobId=%d dropped %d messages after its end\n",
+          jcr->JobId, it->second);
+    dropped_per_job.erase(it);
+  }
+  V(mutex);
+}
+
+/**
+ * Called after a reload of the configuration. The writer opens new
+ * connections for the next messages and uses the new queue size. Switching
+ * to synchronous inserts with a queue size of 0 needs a restart.
+ */
+void ReloadCatalogLogWriter()
+{
+  if (!log_writer_initialized) { return; }
+
+  P(mutex);
+  if (me->catalog_log_queue) { max_queue_size = me->catalog_log_queue; }
+  reconnect = true;
+  V(mutex);
+}
+
+/**
+ * Get the counters of the writer.
+ *
+ * Returns: false if the writer is not running.
+ */
+bool GetCatalogLogStatistics(catalog_log_stats_t& stats)
+{
+  if (!log_writer_initialized) { return false; }
+
+  P(mutex);
+  stats = log_stats;
+  stats.queued = log_queue.size();
+  V(mutex);
+
+  return true;
+}
+
+int StartCatalogLogWriter(void)
+{
+  int status;
+
+  if (!me->catalog_log_queue) { return 0; }
+
+  quit = false;
+  max_queue_size = me->catalog_log_queue;
+
+  if ((status = pthread_create(&log_writer_tid, NULL, catalog_log_thread,
+                               NULL)) != 0) {
+    return status;
+  }
+
+  log_writer_initialized = true;
+
+  return 0;
+}
+
+/**
+ * Stop the writer after it stored all queued messages.
+ */
+void StopCatalogLogWriter()
+{
+  if (!log_writer_initialized) { return; }
+
+  P(mutex);
+  quit = true;
+  pthread_cond_broadcast(&work_cond);
+  V(mutex);
+
+  if (!pthread_equal(log_writer_tid, pthread_self())) {
+    pthread_join(log_writer_tid, NULL);
+  }
+  log_writer_initialized = false;
+}
+
+} /* namespace directordaemon */
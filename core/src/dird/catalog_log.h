@@ -0,0 +1,47 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#ifndef BAREOS_DIRD_CATALOG_LOG_H_
+#define BAREOS_DIRD_CATALOG_LOG_H_
+
+namespace directordaemon {
+
+/**
+ * Counters of the catalog log writer
+ */
+struct catalog_log_stats_t {
+  uint32_t queued;  /* messages waiting to be written */
+  uint64_t written; /* messages stored in the Log table */
+  uint64_t dropped; /* messages dropped because the queue was full */
+  uint64_t failed;  /* messages lost because of a database error */
+  uint64_t batches; /* INSERT statements executed */
+};
+
+int StartCatalogLogWriter(void);
+void StopCatalogLogWriter();
+bool CatalogLogEnqueue(JobControlRecord* jcr, utime_t mtime, const char* msg);
+void FlushCatalogLog(JobControlRecord* jcr);
+void ForgetCatalogLogJob(JobControlRecord* jcr);
+void ReloadCatalogLogWriter();
+bool GetCatalogLogStatistics(catalog_log_stats_t& stats);
+
+} /* namespace directordaemon */
+#endif  // BAREOS_DIRD_CATALOG_LOG_H_
@@ -36,6 +36,7 @@
 
 #include "include/bareos.h"
 #include "dird.h"
+#include "dird/attribute_ingest.h"
 #include "dird/next_vol.h"
 #include "dird/sd_cmds.h"
 #include "findlib/find.h"
@@ -389,14 +390,43 @@ void CatalogRequest(JobControlRecord* jcr, BareosSocket* bs)
   return;
 }
 
+/**
+ * Fill the attributes record from a STREAM_UNIX_ATTRIBUTES_BINARY record,
+ *  the filename is used in place and the stat packet is encoded into
+ *  encoded_stat as the catalog keeps the base64 encoded form.
+ */
+static bool ParseBinaryAttributes(JobControlRecord* jcr,
+                                  AttributesDbRecord* ar,
+                                  char* rec,
+                                  int32_t reclen,
+                                  char* encoded_stat,
+                                  char** fname)
+{
+  BinaryAttributes attribs;
+
+  if (!DecodeAttributesBinary(rec, reclen, &attribs)) {
+    Jmsg(jcr, M_ERROR, 0, _("Malformed binary attributes record.\n"));
+    return false;
+  }
+
+  ar->FileType = attribs.type;
+  ar->DeltaSeq = ar->FileType == FT_REG ? attribs.delta_seq : 0;
+  EncodeStat(encoded_stat, &attribs.statp, sizeof(attribs.statp),
+             attribs.LinkFI, attribs.data_stream);
+  *fname = attribs.fname;
+
+  return true;
+}
+
 /**
  * Note, we receive the whole attribute record, but we select out only the stat
  * packet, VolSessionId, VolSessionTime, FileIndex, file type, and file name to
  * store in the catalog.
+ *
+ * The attributes of a job must be passed in the order they were received.
+ * Normally this is called by the attribute ingest workers.
  */
-static void UpdateAttribute(JobControlRecord* jcr,
-                            char* msg,
-                            int32_t message_length)
+void UpdateAttribute(JobControlRecord* jcr, char* msg, int32_t message_length)
 {
   unser_declare;
   uint32_t VolSessionId, VolSessionTime;
@@ -454,6 +484,10 @@ static void UpdateAttribute(JobControlRecord* jcr,
    *   Encoded extended-attributes (for Win32)
    *   Delta sequence number (32 bit int)
    *
+   * Binary File Attributes
+   *   The same fields as varints and length prefixed strings, see
+   *   EncodeAttributesBinary()
+   *
    * Restore Object
    *   File_index
    *   File_type
@@ -478,6 +512,7 @@ static void UpdateAttribute(JobControlRecord* jcr,
   switch (Stream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
       if (jcr->cached_attribute) {
         Dmsg2(400, "Cached attr. Stream=%d fname=%s\n", ar->Stream, ar->fname);
         if (!jcr->db->CreateAttributesRecord(jcr, ar)) {
@@ -490,27 +525,38 @@ static void UpdateAttribute(JobControlRecord* jcr,
       /*
        * Any cached attr is flushed so we can reuse jcr->attr and jcr->ar
        */
-      jcr->attr = CheckPoolMemorySize(jcr->attr, message_length);
+      jcr->attr = CheckPoolMemorySize(jcr->attr,
+                                      message_length + MAX_ENCODED_STAT_LENGTH);
       memcpy(jcr->attr, msg, message_length);
       p = jcr->attr - msg + p; /* point p into jcr->attr */
-      SkipNonspaces(&p);       /* skip FileIndex */
-      SkipSpaces(&p);
-      ar->FileType = str_to_int32(p);
-      SkipNonspaces(&p); /* skip FileType */
-      SkipSpaces(&p);
-      fname = p;
-      len = strlen(fname); /* length before attributes */
-      attr = &fname[len + 1];
-      ar->DeltaSeq = 0;
-      if (ar->FileType == FT_REG) {
-        p = attr + strlen(attr) + 1; /* point to link */
-        p = p + strlen(p) + 1;       /* point to extended attributes */
-        p = p + strlen(p) + 1;       /* point to delta sequence */
-        /*
-         * Older FDs don't have a delta sequence, so check if it is there
-         */
-        if (p - jcr->attr < message_length) {
-          ar->DeltaSeq = str_to_int32(p); /* delta_seq */
+      if (Stream == STREAM_UNIX_ATTRIBUTES_BINARY) {
+        if (!ParseBinaryAttributes(jcr, ar, p,
+                                   MIN((int32_t)reclen,
+                                       message_length - (p - jcr->attr)),
+                                   jcr->attr + message_length, &fname)) {
+          break;
+        }
+        attr = jcr->attr + message_length;
+      } else {
+        SkipNonspaces(&p); /* skip FileIndex */
+        SkipSpaces(&p);
+        ar->FileType = str_to_int32(p);
+        SkipNonspaces(&p); /* skip FileType */
+        SkipSpaces(&p);
+        fname = p;
+        len = strlen(fname); /* length before attributes */
+        attr = &fname[len + 1];
+        ar->DeltaSeq = 0;
+        if (ar->FileType == FT_REG) {
+          p = attr + strlen(attr) + 1; /* point to link */
+          p = p + strlen(p) + 1;       /* point to extended attributes */
+          p = p + strlen(p) + 1;       /* point to delta sequence */
+          /*
+           * Older FDs don't have a delta sequence, so check if it is there
+           */
+          if (p - jcr->attr < message_length) {
+            ar->DeltaSeq = str_to_int32(p); /* delta_seq */
+          }
         }
       }
 
@@ -633,6 +679,10 @@ static void UpdateAttribute(JobControlRecord* jcr,
               len = CRYPTO_DIGEST_SHA512_SIZE;
               type = CRYPTO_DIGEST_SHA512;
               break;
+            case STREAM_XXH64_DIGEST:
+              len = CRYPTO_DIGEST_XXH64_SIZE;
+              type = CRYPTO_DIGEST_XXH64;
+              break;
             default:
               /*
                * Never reached ...
@@ -694,7 +744,9 @@ void CatalogUpdate(JobControlRecord* jcr, BareosSocket* bs)
     goto bail_out;
   }
 
-  UpdateAttribute(jcr, bs->msg, bs->message_length);
+  if (!AttributeIngestEnqueue(jcr, bs->msg, bs->message_length)) {
+    UpdateAttribute(jcr, bs->msg, bs->message_length);
+  }
 
 bail_out:
   if (jcr->IsJobCanceled()) { CancelStorageDaemonJob(jcr); }
@@ -757,11 +809,20 @@ bool DespoolAttributesFromFile(JobControlRecord* jcr, const char* file)
     }
 
     if (!jcr->IsJobCanceled()) {
-      UpdateAttribute(jcr, msg, message_length);
+      if (!AttributeIngestEnqueue(jcr, msg, message_length)) {
+        UpdateAttribute(jcr, msg, message_length);
+      }
       if (jcr->IsJobCanceled()) { goto bail_out; }
     }
   }
 
+  /*
+   * Only report success when the queued attributes are stored, a failing
+   * catalog update cancels the job.
+   */
+  FlushAttributeIngest(jcr);
+  if (jcr->IsJobCanceled()) { goto bail_out; }
+
   retval = true;
 
 bail_out:
@@ -27,6 +27,7 @@ namespace directordaemon {
 void CatalogRequest(JobControlRecord* jcr, BareosSocket* bs);
 void CatalogUpdate(JobControlRecord* jcr, BareosSocket* bs);
 bool DespoolAttributesFromFile(JobControlRecord* jcr, const char* file);
+void UpdateAttribute(JobControlRecord* jcr, char* msg, int32_t message_length);
 
 } /* namespace directordaemon */
 
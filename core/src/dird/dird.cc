@@ -34,6 +34,8 @@
 #include "dird/job.h"
 #include "dird/scheduler.h"
 #include "dird/socket_server.h"
+#include "dird/attribute_ingest.h"
+#include "dird/catalog_log.h"
 #include "dird/stats.h"
 #include "dird/ua_db.h"
 #include "lib/daemon.h"
@@ -167,6 +169,8 @@ static bool DirDbLogInsert(JobControlRecord* jcr, utime_t mtime, char* msg)
   PoolMem query(PM_MESSAGE), esc_msg(PM_MESSAGE);
 
   if (!jcr || !jcr->db || !jcr->db->IsConnected()) { return false; }
+  if (CatalogLogEnqueue(jcr, mtime, msg)) { return true; }
+
   length = strlen(msg);
   esc_msg.check_size(length * 2 + 1);
   jcr->db->EscapeString(jcr, esc_msg.c_str(), msg, length);
@@ -435,6 +439,8 @@ int main(int argc, char* argv[])
   //   InitDeviceResources();
 
   StartStatisticsThread();
+  StartCatalogLogWriter();
+  StartAttributeIngestWorkers();
 
   Dmsg0(200, "wait for next job\n");
   /* Main loop -- call scheduler to get next job to run */
@@ -477,6 +483,8 @@ static
 
   DestroyConfigureUsageString();
   StopStatisticsThread();
+  StopAttributeIngestWorkers();
+  StopCatalogLogWriter();
   StopWatchdog();
   DbSqlPoolDestroy();
   DbFlushBackends();
@@ -616,6 +624,8 @@ bool DoReloadConfig()
     resource_table_reference* new_table = NULL;
 
     InvalidateSchedules();
+    ReloadCatalogLogWriter();
+    ReloadAttributeIngestWorkers();
     foreach_jcr (jcr) {
       if (jcr->getJobType() != JT_SYSTEM) {
         if (!new_table) {
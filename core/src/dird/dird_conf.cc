@@ -154,6 +154,14 @@ static ResourceItem dir_items[] = {
   { "SecureEraseCommand", CFG_TYPE_STR, ITEM(res_dir.secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
      "Specify command that will be called when bareos unlinks files." },
   { "LogTimestampFormat", CFG_TYPE_STR, ITEM(res_dir.log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL },
+  { "AutoPruneTimeLimit", CFG_TYPE_TIME, ITEM(res_dir.autoprune_time_limit), 0, CFG_ITEM_DEFAULT, "0", "19.2.0-",
+     "Time after which an automatic prune run stops deleting Jobs from the catalog. The remaining Jobs are pruned by the next run. 0 means no limit." },
+  { "CatalogLogQueueSize", CFG_TYPE_PINT32, ITEM(res_dir.catalog_log_queue), 0, CFG_ITEM_DEFAULT, "10000", "19.2.0-",
+     "Number of job messages that can be queued for the background writer of the catalog Log table. Messages are dropped and reported at the end of the job when the queue is full. 0 stores each message synchronously." },
+  { "AttributeIngestWorkers", CFG_TYPE_PINT32, ITEM(res_dir.attribute_ingest_workers), 0, CFG_ITEM_DEFAULT, "4", "19.2.0-",
+     "Number of threads that parse the file attributes sent by the Storage daemons and store them in the catalog. The attributes of one job are processed in order by one thread at a time. 0 processes them on the message thread of each job." },
+  { "AttributeIngestQueueSize", CFG_TYPE_SIZE32, ITEM(res_dir.attribute_ingest_queue_size), 0, CFG_ITEM_DEFAULT, "67108864", "19.2.0-",
+     "Maximum size of the file attributes of all jobs waiting for the attribute ingest workers. When it is reached, the Director stops reading attributes from the Storage daemons until the catalog catches up." },
    TLS_COMMON_CONFIG(res_dir),
    TLS_CERT_CONFIG(res_dir),
   { NULL, 0, { 0 }, 0, 0, NULL, NULL, NULL }
@@ -267,6 +275,9 @@ static ResourceItem cli_items[] = {
   { "NdmpLogLevel", CFG_TYPE_PINT32, ITEM(res_client.ndmp_loglevel), 0, CFG_ITEM_DEFAULT, "4", NULL, NULL },
   { "NdmpBlockSize", CFG_TYPE_SIZE32, ITEM(res_client.ndmp_blocksize), 0, CFG_ITEM_DEFAULT, "64512", NULL, NULL },
   { "NdmpUseLmdb", CFG_TYPE_BOOL, ITEM(res_client.ndmp_use_lmdb), 0, CFG_ITEM_DEFAULT, "true", NULL, NULL },
+  { "NdmpFileHistoryWorkers", CFG_TYPE_PINT32, ITEM(res_client.ndmp_fhdb_workers), 0, CFG_ITEM_DEFAULT, "4", "19.2.0-",
+     "Number of threads that calculate the paths of the NDMP file history kept in LMDB (see NdmpUseLmdb) "
+     "while the catalog records are inserted." },
    TLS_COMMON_CONFIG(res_client),
    TLS_CERT_CONFIG(res_client),
   { NULL, 0, { 0 }, 0, 0, NULL, NULL, NULL }
@@ -422,6 +433,8 @@ ResourceItem job_items[] = {
   { "Enabled", CFG_TYPE_BOOL, ITEM(res_job.enabled), 0, CFG_ITEM_DEFAULT, "true", NULL,
      "En- or disable this resource." },
   { "SpoolAttributes", CFG_TYPE_BOOL, ITEM(res_job.SpoolAttributes), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
+  { "BinaryAttributes", CFG_TYPE_BOOL, ITEM(res_job.BinaryAttributes), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+     "Let File and Storage Daemon exchange file attributes as binary records when both support it. Volumes written this way can only be restored by daemons of version 19.2.0 or newer." },
   { "SpoolData", CFG_TYPE_BOOL, ITEM(res_job.spool_data), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
   { "SpoolSize", CFG_TYPE_SIZE64, ITEM(res_job.spool_size), 0, 0, NULL, NULL, NULL },
   { "RerunFailedLevels", CFG_TYPE_BOOL, ITEM(res_job.rerun_failed_levels), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
@@ -442,6 +455,10 @@ ResourceItem job_items[] = {
   { "RunScript", CFG_TYPE_RUNSCRIPT, ITEM(res_job.RunScripts), 0, CFG_ITEM_NO_EQUALS, NULL, NULL, NULL },
   { "SelectionType", CFG_TYPE_MIGTYPE, ITEM(res_job.selection_type), 0, 0, NULL, NULL, NULL },
   { "Accurate", CFG_TYPE_BOOL, ITEM(res_job.accurate), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
+  { "AccurateDirectoryPruning", CFG_TYPE_BOOL, ITEM(res_job.accurate_dir_pruning), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+     "In accurate Incremental and Differential jobs skip the whole tree of a directory whose modification and change time did not change. "
+     "Only safe on filesystems with recursive change times, that update the times of a directory for every change in the tree below it. "
+     "On other filesystems, e.g. ext4 or XFS, the times of a directory only change with its own entries and changed files further down are not backed up." },
   { "AllowDuplicateJobs", CFG_TYPE_BOOL, ITEM(res_job.AllowDuplicateJobs), 0, CFG_ITEM_DEFAULT, "true", NULL, NULL },
   { "AllowHigherDuplicates", CFG_TYPE_BOOL, ITEM(res_job.AllowHigherDuplicates), 0, CFG_ITEM_DEFAULT, "true", NULL, NULL },
   { "CancelLowerLevelDuplicates", CFG_TYPE_BOOL, ITEM(res_job.CancelLowerLevelDuplicates), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
@@ -2080,6 +2097,10 @@ bool FilesetResource::PrintConfig(PoolMem& buff,
                     p++;
                     break;
 #endif
+                  case '4':
+                    IndentConfigItem(cfg_str, 3, "Signature = XXH64\n");
+                    p++;
+                    break;
                   default:
                     IndentConfigItem(cfg_str, 3, "Signature = SHA1\n");
                     break;
@@ -129,6 +129,10 @@ class DirectorResource : public TlsResource {
   utime_t SDConnectTimeout;       /* Timeout for connect in seconds */
   utime_t heartbeat_interval;     /* Interval to send heartbeats */
   utime_t stats_retention;        /* Statistics retention period in seconds */
+  utime_t autoprune_time_limit;   /* Max time spent in one autoprune run */
+  uint32_t catalog_log_queue;      /* Max messages queued for the Log table */
+  uint32_t attribute_ingest_workers;    /* Threads storing file attributes */
+  uint32_t attribute_ingest_queue_size; /* Max bytes of queued attributes */
   bool optimize_for_size;         /* Optimize daemon for minimum memory size */
   bool optimize_for_speed; /* Optimize daemon for speed which may need more
                               memory */
@@ -275,6 +279,7 @@ class ClientResource : public TlsResource {
   uint32_t AuthType;            /* Authentication Type to use for protocol */
   uint32_t ndmp_loglevel;       /* NDMP Protocol specific loglevel to use */
   uint32_t ndmp_blocksize;      /* NDMP Protocol specific blocksize to use */
+  uint32_t ndmp_fhdb_workers;   /* NDMP file history path threads */
   uint32_t FDport;              /* Where File daemon listens */
   uint64_t SoftQuota;           /* Soft Quota permitted in bytes */
   uint64_t HardQuota;           /* Maximum permitted quota in bytes */
@@ -474,12 +479,14 @@ class JobResource : public BareosResource {
   bool PruneFiles;               /**< Force pruning of Files */
   bool PruneVolumes;             /**< Force pruning of Volumes */
   bool SpoolAttributes;          /**< Set to spool attributes in SD */
+  bool BinaryAttributes;         /**< Send attributes as binary records */
   bool spool_data;               /**< Set to spool data in SD */
   bool rerun_failed_levels;      /**< Upgrade to rerun failed levels */
   bool PreferMountedVolumes;     /**< Prefer vols mounted rather than new one */
   bool write_part_after_job;     /**< Set to write part after job in SD */
   bool enabled;                  /**< Set if job enabled */
   bool accurate;                 /**< Set if it is an accurate backup job */
+  bool accurate_dir_pruning;     /**< Skip trees of unchanged directories */
   bool AllowDuplicateJobs;       /**< Allow duplicate jobs */
   bool AllowHigherDuplicates;    /**< Permit Higher Level */
   bool CancelLowerLevelDuplicates; /**< Cancel lower level backup jobs */
@@ -125,6 +125,7 @@ static struct s_fs_opt FS_options[] = {
     {"sha1", INC_KW_DIGEST, "S"},
     {"sha256", INC_KW_DIGEST, "S2"},
     {"sha512", INC_KW_DIGEST, "S3"},
+    {"xxh64", INC_KW_DIGEST, "S4"},
     {"gzip", INC_KW_COMPRESSION, "Z6"},
     {"gzip1", INC_KW_COMPRESSION, "Z1"},
     {"gzip2", INC_KW_COMPRESSION, "Z2"},
@@ -41,6 +41,7 @@
 #include "dird/migration.h"
 #include "dird/restore.h"
 #include "dird/sd_cmds.h"
+#include "dird/catalog_log.h"
 #include "dird/stats.h"
 #include "dird/storage.h"
 #include "dird/ua_cmds.h"
@@ -673,6 +674,11 @@ static void* job_thread(void* arg)
    */
   if (jcr->msg_queue && jcr->msg_queue->size() > 0) { DequeueMessages(jcr); }
 
+  /*
+   * Make sure the job log is complete in the catalog
+   */
+  FlushCatalogLog(jcr);
+
   GeneratePluginEvent(jcr, bDirEventJobEnd);
   Dmsg1(50, "======== End Job stat=%c ==========\n", jcr->JobStatus);
   Dsm_check(100);
@@ -1573,6 +1579,7 @@ void DirdFreeJcr(JobControlRecord* jcr)
   }
 
   DirdFreeJcrPointers(jcr);
+  ForgetCatalogLogJob(jcr);
 
   if (jcr->term_wait_inited) {
     pthread_cond_destroy(&jcr->term_wait);
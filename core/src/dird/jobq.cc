@@ -37,6 +37,14 @@
  * allocated and they can immediately be run, and the
  * running queue where jobs are placed when they are
  * running.
+ *
+ * The waiting_jobs queue is kept sorted by priority. Each waiting
+ * job remembers the resource (client, storage or job) it could not
+ * get, and the wait queue scan only looks at it again when a job
+ * has released that resource. Workers wait on the work condition
+ * until a job is queued or finishes instead of polling, with a full
+ * rescan every JOBQ_RESCAN_INTERVAL seconds to catch resources that
+ * got freed elsewhere.
  */
 
 #include "include/bareos.h"
@@ -49,12 +57,17 @@ namespace directordaemon {
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Seconds between full scans of the wait queue */
+static const int JOBQ_RESCAN_INTERVAL = 10;
+
 /* Forward referenced functions */
 extern "C" void* jobq_server(void* arg);
 extern "C" void* sched_wait(void* arg);
 
 static int StartServer(jobq_t* jq);
-static bool AcquireResources(JobControlRecord* jcr);
+static bool AcquireResources(JobControlRecord* jcr,
+                             jobq_t* jq,
+                             jobq_item_t* je);
 static bool RescheduleJob(JobControlRecord* jcr, jobq_t* jq, jobq_item_t* je);
 static bool IncClientConcurrency(JobControlRecord* jcr);
 static void DecClientConcurrency(JobControlRecord* jcr);
@@ -112,6 +125,10 @@ int JobqInit(jobq_t* jq, int max_workers, void* (*engine)(void* arg))
   jq->waiting_jobs = New(dlist(item, &item->link));
   jq->running_jobs = New(dlist(item, &item->link));
   jq->ready_jobs = New(dlist(item, &item->link));
+  jq->last_waiting = new std::map<int32_t, jobq_item_t*>;
+  jq->released = new std::set<BareosResource*>;
+  jq->wait_stats = new std::map<std::string, jobq_wait_stat_t>;
+  jq->rescan = false;
 
   return 0;
 }
@@ -152,9 +169,140 @@ int JobqDestroy(jobq_t* jq)
   delete jq->waiting_jobs;
   delete jq->running_jobs;
   delete jq->ready_jobs;
+  delete jq->last_waiting;
+  delete jq->released;
+  delete jq->wait_stats;
   return (status != 0 ? status : (status1 != 0 ? status1 : status2));
 }
 
+/**
+ * Insert a job into the wait queue behind all jobs of the same or a
+ * better (lower) priority. Must be called with the queue locked.
+ */
+static void InsertWaitingJob(jobq_t* jq, jobq_item_t* item)
+{
+  std::map<int32_t, jobq_item_t*>::iterator it;
+
+  it = jq->last_waiting->find(item->priority);
+  if (it != jq->last_waiting->end()) {
+    jq->waiting_jobs->InsertAfter(item, it->second);
+    it->second = item;
+    return;
+  }
+
+  it = jq->last_waiting->lower_bound(item->priority);
+  if (it == jq->last_waiting->begin()) {
+    jq->waiting_jobs->prepend(item);
+  } else {
+    jq->waiting_jobs->InsertAfter(item, std::prev(it)->second);
+  }
+  (*jq->last_waiting)[item->priority] = item;
+}
+
+/**
+ * Remove a job from the wait queue. Must be called with the queue locked.
+ */
+static void RemoveWaitingJob(jobq_t* jq, jobq_item_t* item)
+{
+  std::map<int32_t, jobq_item_t*>::iterator it;
+
+  it = jq->last_waiting->find(item->priority);
+  if (it != jq->last_waiting->end() && it->second == item) {
+    jobq_item_t* prev = (jobq_item_t*)jq->waiting_jobs->prev(item);
+
+    if (prev && prev->priority == item->priority) {
+      it->second = prev;
+    } else {
+      jq->last_waiting->erase(it);
+    }
+  }
+  jq->waiting_jobs->remove(item);
+}
+
+/**
+ * Name under which the wait time for a resource is accounted.
+ */
+static std::string WaitStatName(jobq_item_t* je)
+{
+  std::string name;
+
+  switch (je->blocked_status) {
+    case JS_WaitStoreRes:
+      name = "Storage";
+      break;
+    case JS_WaitClientRes:
+      name = "Client";
+      break;
+    default:
+      name = "Job";
+      break;
+  }
+  name += " \"";
+  name += je->blocked_on->name();
+  name += "\"";
+
+  return name;
+}
+
+/**
+ * Account the time a job waited for the resource it was blocked on.
+ * Must be called with the queue locked.
+ */
+static void AccountWaitTime(jobq_t* jq, jobq_item_t* je, time_t now)
+{
+  utime_t waited;
+  jobq_wait_stat_t* stat;
+
+  if (!je->blocked_on) { return; }
+
+  waited = now - je->wait_start;
+  stat = &(*jq->wait_stats)[WaitStatName(je)];
+  stat->jobs++;
+  stat->total += waited;
+  if (waited > stat->max) { stat->max = waited; }
+
+  je->blocked_on = NULL;
+  je->blocked_status = 0;
+  je->wait_start = 0;
+}
+
+/**
+ * Remember that a job gave back its resources so jobs waiting for them
+ * get looked at again. Must be called with the queue locked.
+ */
+static void ReleaseResources(jobq_t* jq, JobControlRecord* jcr)
+{
+  DecReadStore(jcr);
+  DecWriteStore(jcr);
+  DecClientConcurrency(jcr);
+  DecJobConcurrency(jcr);
+  jcr->acquired_resource_locks = false;
+
+  if (jcr->res.read_storage) { jq->released->insert(jcr->res.read_storage); }
+  if (jcr->res.write_storage) { jq->released->insert(jcr->res.write_storage); }
+  if (jcr->res.client) { jq->released->insert(jcr->res.client); }
+  if (jcr->res.job) { jq->released->insert(jcr->res.job); }
+}
+
+/**
+ * Return a copy of the per resource wait statistics including the number
+ * of jobs currently waiting for each resource.
+ */
+void JobqGetWaitStatistics(jobq_t* jq,
+                           std::map<std::string, jobq_wait_stat_t>& stats)
+{
+  jobq_item_t* je;
+
+  if (jq->valid != JOBQ_VALID) { return; }
+
+  P(jq->mutex);
+  stats = *jq->wait_stats;
+  foreach_dlist (je, jq->waiting_jobs) {
+    if (je->blocked_on) { stats[WaitStatName(je)].waiting++; }
+  }
+  V(jq->mutex);
+}
+
 struct wait_pkt {
   JobControlRecord* jcr;
   jobq_t* jq;
@@ -213,8 +361,7 @@ extern "C" void* sched_wait(void* arg)
 int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
 {
   int status;
-  jobq_item_t *item, *li;
-  bool inserted = false;
+  jobq_item_t* item;
   time_t wtime = jcr->sched_time - time(NULL);
   pthread_t id;
   wait_pkt* sched_pkt;
@@ -263,6 +410,10 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
     return ENOMEM;
   }
   item->jcr = jcr;
+  item->priority = jcr->JobPriority;
+  item->blocked_on = NULL;
+  item->blocked_status = 0;
+  item->wait_start = 0;
 
   /*
    * While waiting in a queue this job is not attached to a thread
@@ -278,31 +429,16 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
     /*
      * Add this job to the wait queue in priority sorted order
      */
-    foreach_dlist (li, jq->waiting_jobs) {
-      Dmsg2(2300, "waiting item jobid=%d priority=%d\n", li->jcr->JobId,
-            li->jcr->JobPriority);
-      if (li->jcr->JobPriority > jcr->JobPriority) {
-        jq->waiting_jobs->InsertBefore(item, li);
-        Dmsg2(2300, "InsertBefore jobid=%d before waiting job=%d\n",
-              li->jcr->JobId, jcr->JobId);
-        inserted = true;
-        break;
-      }
-    }
-
-    /*
-     * If not jobs in wait queue, append it
-     */
-    if (!inserted) {
-      jq->waiting_jobs->append(item);
-      Dmsg1(2300, "Appended item jobid=%d to waiting queue\n", jcr->JobId);
-    }
+    InsertWaitingJob(jq, item);
+    Dmsg2(2300, "Inserted item jobid=%d priority=%d to waiting queue\n",
+          jcr->JobId, item->priority);
   }
 
   /*
    * Ensure that at least one server looks at the queue.
    */
   status = StartServer(jq);
+  pthread_cond_broadcast(&jq->work);
 
   V(jq->mutex);
   Dmsg0(2300, "Return JobqAdd\n");
@@ -344,12 +480,13 @@ int JobqRemove(jobq_t* jq, JobControlRecord* jcr)
   /*
    * Move item to be the first on the list
    */
-  jq->waiting_jobs->remove(item);
+  RemoveWaitingJob(jq, item);
   jq->ready_jobs->prepend(item);
   Dmsg2(2300, "JobqRemove jobid=%d jcr=0x%x moved to ready queue\n", jcr->JobId,
         jcr);
 
   status = StartServer(jq);
+  pthread_cond_broadcast(&jq->work);
 
   V(jq->mutex);
   Dmsg0(2300, "Return JobqRemove\n");
@@ -490,13 +627,7 @@ extern "C" void* jobq_server(void* arg)
        * been acquired for jobs canceled before they were put into the ready
        * queue.
        */
-      if (jcr->acquired_resource_locks) {
-        DecReadStore(jcr);
-        DecWriteStore(jcr);
-        DecClientConcurrency(jcr);
-        DecJobConcurrency(jcr);
-        jcr->acquired_resource_locks = false;
-      }
+      if (jcr->acquired_resource_locks) { ReleaseResources(jq, jcr); }
 
       if (RescheduleJob(jcr, jq, je)) { continue; /* go look for more work */ }
 
@@ -519,6 +650,7 @@ extern "C" void* jobq_server(void* arg)
     if (!jq->waiting_jobs->empty() && !jq->quit) {
       int Priority;
       bool running_allow_mix = false;
+      time_t now = time(NULL);
       je = (jobq_item_t*)jq->waiting_jobs->first();
       jobq_item_t* re = (jobq_item_t*)jq->running_jobs->first();
       if (re) {
@@ -547,6 +679,7 @@ extern "C" void* jobq_server(void* arg)
        * Walk down the list of waiting jobs and attempt to acquire the resources
        * it needs.
        */
+      bool full_pass = true;
       for (; je;) {
         /*
          * je is current job item on the queue, jn is the next one
@@ -565,10 +698,21 @@ extern "C" void* jobq_server(void* arg)
               (jcr->JobPriority < Priority &&
                jcr->res.job->allow_mixed_priority && running_allow_mix))) {
           jcr->setJobStatus(JS_WaitPriority);
+          full_pass = false;
           break;
         }
 
-        if (!AcquireResources(jcr)) {
+        /*
+         * Skip jobs waiting for a resource nobody released since we last
+         * looked at them, they cannot get it now either.
+         */
+        if (!jq->rescan && je->blocked_on && !JobCanceled(jcr) &&
+            jq->released->find(je->blocked_on) == jq->released->end()) {
+          je = jn; /* point to next waiting job */
+          continue;
+        }
+
+        if (!AcquireResources(jcr, jq, je)) {
           /*
            * If resource conflict, job is canceled
            */
@@ -583,13 +727,28 @@ extern "C" void* jobq_server(void* arg)
          * to the ready queue.  Note, we may also get here if the
          * job was canceled.  Once it is "run", it will quickly Terminate.
          */
-        jq->waiting_jobs->remove(je);
+        AccountWaitTime(jq, je, now);
+        RemoveWaitingJob(jq, je);
         jq->ready_jobs->append(je);
         Dmsg1(2300, "moved JobId=%d from wait to ready queue\n",
               je->jcr->JobId);
         je = jn; /* Point to next waiting job */
       }          /* end for loop */
-    }            /* end if */
+
+      /*
+       * Only forget the released resources when every waiting job had a
+       * chance to look at them, the jobs behind a priority break did not.
+       */
+      if (full_pass) {
+        jq->released->clear();
+        jq->rescan = false;
+      }
+
+      /*
+       * Wake up idle workers to pick up the jobs that became ready.
+       */
+      if (!jq->ready_jobs->empty()) { pthread_cond_broadcast(&jq->work); }
+    } /* end if */
 
     Dmsg0(2300, "Done checking wait queue.\n");
 
@@ -624,19 +783,23 @@ extern "C" void* jobq_server(void* arg)
     }
 
     work = !jq->ready_jobs->empty() || !jq->waiting_jobs->empty();
-    if (work) {
+    if (work && jq->ready_jobs->empty()) {
       /*
-       * If a job is waiting on a Resource, don't consume all
-       * the CPU time looping looking for work, and even more
-       * important, release the lock so that a job that has
-       * terminated can give us the resource.
+       * All waiting jobs are blocked on a Resource. Don't consume all
+       * the CPU time looping looking for work but sleep until a job
+       * is added or a terminating job gives back its resources. The
+       * wait releases the lock so that a job that has terminated can
+       * give us the resource.
        */
-      V(jq->mutex);
-      Bmicrosleep(2, 0); /* pause for 2 seconds */
-      P(jq->mutex);
+      gettimeofday(&tv, &tz);
+      timeout.tv_nsec = tv.tv_usec * 1000;
+      timeout.tv_sec = tv.tv_sec + JOBQ_RESCAN_INTERVAL;
+
+      status = pthread_cond_timedwait(&jq->work, &jq->mutex, &timeout);
+      if (status == ETIMEDOUT) { jq->rescan = true; }
 
       /*
-       * Recompute work as something may have changed in last 2 secs
+       * Recompute work as something may have changed while waiting
        */
       work = !jq->ready_jobs->empty() || !jq->waiting_jobs->empty();
     }
@@ -778,8 +941,13 @@ static bool RescheduleJob(JobControlRecord* jcr, jobq_t* jq, jobq_item_t* je)
  *  Returns: true  if successful
  *           false if resource failure
  */
-static bool AcquireResources(JobControlRecord* jcr)
+static bool AcquireResources(JobControlRecord* jcr,
+                             jobq_t* jq,
+                             jobq_item_t* je)
 {
+  BareosResource* blocked_on = NULL;
+  int32_t blocked_status = 0;
+
   /*
    * Set that we didn't acquire any resourse locks yet.
    */
@@ -818,18 +986,18 @@ static bool AcquireResources(JobControlRecord* jcr)
 
   if (jcr->res.read_storage) {
     if (!IncReadStore(jcr)) {
-      jcr->setJobStatus(JS_WaitStoreRes);
-
-      return false;
+      blocked_on = jcr->res.read_storage;
+      blocked_status = JS_WaitStoreRes;
+      goto bail_out;
     }
   }
 
   if (jcr->res.write_storage) {
     if (!IncWriteStore(jcr)) {
       DecReadStore(jcr);
-      jcr->setJobStatus(JS_WaitStoreRes);
-
-      return false;
+      blocked_on = jcr->res.write_storage;
+      blocked_status = JS_WaitStoreRes;
+      goto bail_out;
     }
   }
 
@@ -839,9 +1007,9 @@ static bool AcquireResources(JobControlRecord* jcr)
      */
     DecWriteStore(jcr);
     DecReadStore(jcr);
-    jcr->setJobStatus(JS_WaitClientRes);
-
-    return false;
+    blocked_on = jcr->res.client;
+    blocked_status = JS_WaitClientRes;
+    goto bail_out;
   }
 
   if (!IncJobConcurrency(jcr)) {
@@ -851,14 +1019,32 @@ static bool AcquireResources(JobControlRecord* jcr)
     DecWriteStore(jcr);
     DecReadStore(jcr);
     DecClientConcurrency(jcr);
-    jcr->setJobStatus(JS_WaitJobRes);
-
-    return false;
+    blocked_on = jcr->res.job;
+    blocked_status = JS_WaitJobRes;
+    goto bail_out;
   }
 
   jcr->acquired_resource_locks = true;
 
   return true;
+
+bail_out:
+  jcr->setJobStatus(blocked_status);
+
+  /*
+   * When the job now waits for another resource account the time spent
+   * waiting so far to the resource it was blocked on before.
+   */
+  if (je->blocked_on != blocked_on) {
+    time_t now = time(NULL);
+
+    AccountWaitTime(jq, je, now);
+    je->blocked_on = blocked_on;
+    je->blocked_status = blocked_status;
+    je->wait_start = now;
+  }
+
+  return false;
 }
 
 static bool IncClientConcurrency(JobControlRecord* jcr)
@@ -33,6 +33,12 @@
 #ifndef BAREOS_DIRD_JOBQ_H_
 #define BAREOS_DIRD_JOBQ_H_ 1
 
+#include <map>
+#include <set>
+#include <string>
+
+class BareosResource;
+
 namespace directordaemon {
 
 /**
@@ -41,18 +47,39 @@ namespace directordaemon {
 struct jobq_item_t {
   dlink link;
   JobControlRecord* jcr;
+  int32_t priority;           /* priority the job was queued with */
+  BareosResource* blocked_on; /* resource the job is waiting for */
+  int32_t blocked_status;     /* JS_Wait*Res status for blocked_on */
+  time_t wait_start;          /* when the job started waiting on blocked_on */
+};
+
+/**
+ * Accumulated time jobs spent in the wait queue because of one resource
+ */
+struct jobq_wait_stat_t {
+  uint32_t jobs;    /* number of jobs that had to wait */
+  utime_t total;    /* total wait time in seconds */
+  utime_t max;      /* longest single wait in seconds */
+  uint32_t waiting; /* number of jobs waiting right now */
 };
 
 /**
  * Structure describing a work queue
  */
 struct jobq_t {
-  pthread_mutex_t mutex;      /* queue access control */
-  pthread_cond_t work;        /* wait for work */
-  pthread_attr_t attr;        /* create detached threads */
-  dlist* waiting_jobs;        /* list of jobs waiting */
-  dlist* running_jobs;        /* jobs running */
-  dlist* ready_jobs;          /* jobs ready to run */
+  pthread_mutex_t mutex; /* queue access control */
+  pthread_cond_t work;   /* wait for work */
+  pthread_attr_t attr;   /* create detached threads */
+  dlist* waiting_jobs;   /* list of jobs waiting */
+  dlist* running_jobs;   /* jobs running */
+  dlist* ready_jobs;     /* jobs ready to run */
+  std::map<int32_t, jobq_item_t*>*
+      last_waiting; /* last waiting job of each priority */
+  std::set<BareosResource*>*
+      released; /* resources released since the last wait queue scan */
+  std::map<std::string, jobq_wait_stat_t>*
+      wait_stats;             /* wait time per resource */
+  bool rescan;                /* look at all waiting jobs on next scan */
   int valid;                  /* queue initialized */
   bool quit;                  /* jobq should quit */
   int max_workers;            /* max threads */
@@ -69,6 +96,11 @@ extern int JobqInit(jobq_t* wq,
 extern int JobqDestroy(jobq_t* wq);
 extern int JobqAdd(jobq_t* wq, JobControlRecord* jcr);
 extern int JobqRemove(jobq_t* wq, JobControlRecord* jcr);
+extern void JobqGetWaitStatistics(
+    jobq_t* jq,
+    std::map<std::string, jobq_wait_stat_t>& stats);
+
+extern jobq_t job_queue; /* the Director's job queue, see job.cc */
 
 bool IncReadStore(JobControlRecord* jcr);
 void DecReadStore(JobControlRecord* jcr);
@@ -37,6 +37,7 @@
  */
 #include "include/bareos.h"
 #include "dird.h"
+#include "dird/attribute_ingest.h"
 #include "dird/getmsg.h"
 #include "dird/job.h"
 #include "dird/msgchan.h"
@@ -214,6 +215,12 @@ bool StartStorageDaemonJob(JobControlRecord* jcr,
       BfreeAndNull(jcr->sd_auth_key);
       jcr->sd_auth_key = bstrdup(auth_key);
       Dmsg1(150, "sd_auth_key=%s\n", jcr->sd_auth_key);
+
+      /*
+       * Older Storage daemons don't know the binary attributes stream.
+       */
+      jcr->binary_attributes = jcr->res.job && jcr->res.job->BinaryAttributes &&
+                               strstr(sd->msg, " BinaryAttributes=1") != NULL;
     }
   } else {
     Jmsg(jcr, M_FATAL, 0, _("<stored: bad response to Job command: %s\n"),
@@ -377,6 +384,7 @@ extern "C" void MsgThreadCleanup(void* arg)
 {
   JobControlRecord* jcr = (JobControlRecord*)arg;
 
+  FlushAttributeIngest(jcr);    /* Store all queued attributes */
   jcr->db->EndTransaction(jcr); /* Terminate any open transaction */
   jcr->lock();
   jcr->sd_msg_thread_done = true;
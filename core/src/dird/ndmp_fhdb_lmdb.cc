@@ -36,6 +36,11 @@
 #include "ndmp_dma_priv.h"
 #include "lmdb/lmdb.h"
 
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace directordaemon {
 
 /*
@@ -50,6 +55,7 @@ struct fhdb_payload {
 
 struct fhdb_state {
   uint64_t root_node;
+  uint32_t workers; /* Threads calculating paths in NdmpFhdbLmdbProcessDb() */
   POOLMEM* pay_load;
   POOLMEM* lmdb_name;
   POOLMEM* path;
@@ -67,6 +73,13 @@ static int debuglevel = 100;
 #define AVG_NR_BYTES_PER_ENTRY 256
 #define B_PAGE_SIZE 4096
 
+/*
+ * Directory paths each worker keeps before starting over, and the number of
+ * calculated files queued for the catalog.
+ */
+#define MAX_CACHED_PATHS 250000
+#define MAX_QUEUED_FILES 10000
+
 extern "C" int bndmp_fhdb_lmdb_add_dir(struct ndmlog* ixlog,
                                        int tagc,
                                        char* raw_name,
@@ -496,9 +509,11 @@ void NdmpFhdbLmdbRegister(struct ndmlog* ixlog)
     }
 
     /*
-     * Explicitly set the number of readers to 1.
+     * One reader for each worker and one for the range calculation.
      */
-    result = mdb_env_set_maxreaders(fhdb_state->db_env, 1);
+    fhdb_state->workers = MAX(nis->jcr->res.client->ndmp_fhdb_workers, 1);
+    result =
+        mdb_env_set_maxreaders(fhdb_state->db_env, fhdb_state->workers + 1);
     if (result) {
       Dmsg1(debuglevel, _("Unable to set MDB maxreaders: %s\n"),
             mdb_strerror(result));
@@ -510,7 +525,8 @@ void NdmpFhdbLmdbRegister(struct ndmlog* ixlog)
     Mmsg(fhdb_state->lmdb_name, "%s/.fhdb_lmdb.%d", working_directory,
          nis->jcr->JobId);
     result = mdb_env_open(fhdb_state->db_env, fhdb_state->lmdb_name,
-                          MDB_NOSUBDIR | MDB_NOLOCK | MDB_NOSYNC, 0600);
+                          MDB_NOSUBDIR | MDB_NOLOCK | MDB_NOSYNC | MDB_NOTLS,
+                          0600);
     if (result) {
       Dmsg2(debuglevel,
             _("Unable to create LMDB database %s: %s. Check OS ulimit settings "
@@ -606,113 +622,343 @@ void NdmpFhdbLmdbUnregister(struct ndmlog* ixlog)
   }
 }
 
-static inline void CalculatePath(uint64_t node, fhdb_state* fhdb_state)
+/*
+ * A file with its path calculated, ready to be stored in the catalog.
+ */
+struct fhdb_file {
+  std::string path;
+  std::string attribs;
+  int8_t FileType;
+  uint64_t fh_info;
+};
+
+/*
+ * State shared by the workers calculating paths and the thread storing the
+ * files in the catalog.
+ */
+struct fhdb_processing {
+  NIS* nis;
+  struct fhdb_state* fhdb_state;
+  pthread_mutex_t mutex;
+  pthread_cond_t queue_filled;
+  pthread_cond_t queue_drained;
+  std::deque<fhdb_file> queue;
+  uint32_t running; /* Workers not yet done */
+  bool abort;       /* Storing failed, workers should stop */
+};
+
+/*
+ * A worker calculates the paths of the nodes in the range first - last.
+ */
+struct fhdb_worker {
+  struct fhdb_processing* proc;
+  uint64_t first;
+  uint64_t last;
+  pthread_t tid;
+  bool started;
+};
+
+/*
+ * Calculate the path of a directory node relative to the root node.
+ *
+ * The path of every directory walked through is kept in the cache so for
+ * most nodes only the record of the directory itself has to be looked up
+ * as files of the same directory tend to have nearby node numbers.
+ */
+static void CalculatePath(uint64_t node,
+                          MDB_txn* txn,
+                          struct fhdb_state* fhdb_state,
+                          std::unordered_map<uint64_t, std::string>& cache,
+                          std::string& path)
 {
-  PoolMem temp;
-  int result = 0;
+  int result;
   MDB_val rkey, rdata;
   struct fhdb_payload* payload;
-  bool root_node_reached = false;
+  std::vector<std::pair<uint64_t, std::string>> walked;
 
   Dmsg1(100, "CalculatePath for node %llu\n", node);
 
-  PmStrcpy(fhdb_state->path, "");
-  while (!result && !root_node_reached) {
+  path.clear();
+  while (node != fhdb_state->root_node) {
+    auto cached = cache.find(node);
+    if (cached != cache.end()) {
+      path = cached->second;
+      break;
+    }
+
     rkey.mv_data = &node;
     rkey.mv_size = sizeof(node);
-
-    result = mdb_get(fhdb_state->db_ro_txn, fhdb_state->db_dbi, &rkey, &rdata);
-    switch (result) {
-      case 0:
-        payload = (struct fhdb_payload*)rdata.mv_data;
-        if (node != fhdb_state->root_node) {
-          PmStrcpy(temp, "/");
-          PmStrcat(temp, payload->namebuffer);
-          PmStrcat(temp, fhdb_state->path);
-          PmStrcpy(fhdb_state->path, temp.c_str());
-          node = payload->dir_node;
-        } else {
-          /*
-           * Root reached
-           */
-          root_node_reached = true;
-        }
-        break;
-      case MDB_NOTFOUND:
-        break;
-      case EINVAL:
-        Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
-        break;
-      default:
+    result = mdb_get(txn, fhdb_state->db_dbi, &rkey, &rdata);
+    if (result) {
+      if (result != MDB_NOTFOUND) {
         Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
-        break;
+      }
+      break;
+    }
+
+    payload = (struct fhdb_payload*)rdata.mv_data;
+    walked.emplace_back(node, std::string("/") + payload->namebuffer);
+
+    /*
+     * Protect against a loop in broken file history.
+     */
+    if (walked.size() > 4096) {
+      Dmsg1(debuglevel, "Too deep directory nesting at node %llu\n", node);
+      break;
     }
+    node = payload->dir_node;
+  }
+
+  if (cache.size() + walked.size() > MAX_CACHED_PATHS) { cache.clear(); }
+
+  for (auto it = walked.rbegin(); it != walked.rend(); ++it) {
+    path.append(it->second);
+    cache[it->first] = path;
   }
 }
 
-static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
+/*
+ * Queue a calculated file for the catalog.
+ *
+ * Returns: false if the workers should stop.
+ */
+static bool QueueFile(struct fhdb_processing* proc, fhdb_file& file)
+{
+  bool retval;
+
+  P(proc->mutex);
+  while (proc->queue.size() >= MAX_QUEUED_FILES && !proc->abort) {
+    pthread_cond_wait(&proc->queue_drained, &proc->mutex);
+  }
+  if (!proc->abort) {
+    proc->queue.emplace_back(std::move(file));
+    pthread_cond_signal(&proc->queue_filled);
+  }
+  retval = !proc->abort;
+  V(proc->mutex);
+
+  return retval;
+}
+
+static void* fhdb_worker_thread(void* arg)
 {
   int result;
   uint64_t node;
-  MDB_cursor* cursor;
-  int8_t FileType = 0;
+  MDB_txn* txn = NULL;
+  MDB_cursor* cursor = NULL;
   MDB_val rkey, rdata;
   PoolMem attribs(PM_FNAME);
   ndmp9_file_stat ndmp_fstat;
-  PoolMem full_path(PM_FNAME);
   struct fhdb_payload* payload;
+  std::unordered_map<uint64_t, std::string> cache;
+  std::string dir_path;
+  struct fhdb_worker* worker = (struct fhdb_worker*)arg;
+  struct fhdb_processing* proc = worker->proc;
+  struct fhdb_state* fhdb_state = proc->fhdb_state;
+  NIS* nis = proc->nis;
+
+  result = mdb_txn_begin(fhdb_state->db_env, NULL, MDB_RDONLY, &txn);
+  if (result) {
+    Jmsg1(nis->jcr, M_FATAL, 0, _("Unable to create read transaction: %s\n"),
+          mdb_strerror(result));
+    goto bail_out;
+  }
 
-  result = mdb_cursor_open(fhdb_state->db_ro_txn, fhdb_state->db_dbi, &cursor);
-  if (result) { Dmsg1(debuglevel, "%s\n", mdb_strerror(result)); }
+  result = mdb_cursor_open(txn, fhdb_state->db_dbi, &cursor);
+  if (result) {
+    Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
+    goto bail_out;
+  }
 
+  node = worker->first;
   rkey.mv_data = &node;
   rkey.mv_size = sizeof(node);
-  result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_FIRST);
-  if (result) { Dmsg1(debuglevel, "%s\n", mdb_strerror(result)); }
+  result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_SET_RANGE);
 
   while (!result) {
-    switch (result) {
-      case 0:
-        payload = (struct fhdb_payload*)rdata.mv_data;
-        ndmp_fstat = payload->ndmp_fstat;
-        node = *(uint64_t*)rkey.mv_data;
+    fhdb_file file;
 
-        if (ndmp_fstat.node.valid == NDMP9_VALIDITY_VALID) {
-          CalculatePath(payload->dir_node, fhdb_state);
-          NdmpConvertFstat(&ndmp_fstat, nis->FileIndex, &FileType, attribs);
+    node = *(uint64_t*)rkey.mv_data;
+    if (node > worker->last) { break; }
 
-          PmStrcpy(full_path, nis->filesystem);
-          PmStrcat(full_path, fhdb_state->path);
-          PmStrcat(full_path, "/");
-          PmStrcat(full_path, payload->namebuffer);
+    payload = (struct fhdb_payload*)rdata.mv_data;
+    ndmp_fstat = payload->ndmp_fstat;
 
-          if (FileType == FT_DIREND) {
-            /*
-             * SplitPathAndFilename() expects directories to end with a '/'
-             * so append '/' if full_path does not already end with '/'
-             */
-            if (full_path.c_str()[strlen(full_path.c_str()) - 1] != '/') {
-              Dmsg1(100, ("appending / to %s \n"), full_path.c_str());
-              PmStrcat(full_path, "/");
-            }
-          }
-          NdmpStoreAttributeRecord(
-              nis->jcr, full_path.c_str(), nis->virtual_filename,
-              attribs.c_str(), FileType, 0,
-              (ndmp_fstat.fh_info.valid == NDMP9_VALIDITY_VALID)
-                  ? ndmp_fstat.fh_info.value
-                  : 0);
-        } else {
-          Dmsg1(100, "skipping node %lu because it has no valid node data\n",
-                node);
+    if (ndmp_fstat.node.valid == NDMP9_VALIDITY_VALID) {
+      CalculatePath(payload->dir_node, txn, fhdb_state, cache, dir_path);
+      NdmpConvertFstat(&ndmp_fstat, nis->FileIndex, &file.FileType, attribs);
+
+      file.path.assign(nis->filesystem);
+      file.path.append(dir_path);
+      file.path.append("/");
+      file.path.append(payload->namebuffer);
+
+      if (file.FileType == FT_DIREND) {
+        /*
+         * SplitPathAndFilename() expects directories to end with a '/'
+         * so append '/' if full_path does not already end with '/'
+         */
+        if (file.path.back() != '/') {
+          Dmsg1(100, ("appending / to %s \n"), file.path.c_str());
+          file.path.append("/");
         }
-        result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_NEXT);
-        break;
-      default:
-        Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
-        break;
+      }
+      file.attribs.assign(attribs.c_str());
+      file.fh_info = (ndmp_fstat.fh_info.valid == NDMP9_VALIDITY_VALID)
+                         ? ndmp_fstat.fh_info.value
+                         : 0;
+
+      if (!QueueFile(proc, file)) { break; }
+    } else {
+      Dmsg1(100, "skipping node %lu because it has no valid node data\n",
+            node);
     }
+    result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_NEXT);
+  }
+
+  if (result && result != MDB_NOTFOUND) {
+    Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
   }
+
+bail_out:
+  if (cursor) { mdb_cursor_close(cursor); }
+  if (txn) { mdb_txn_abort(txn); }
+
+  P(proc->mutex);
+  proc->running--;
+  pthread_cond_signal(&proc->queue_filled);
+  V(proc->mutex);
+
+  return NULL;
+}
+
+/*
+ * Split the node numbers in the LMDB into ranges, one for each worker.
+ */
+static uint32_t SplitNodeRanges(struct fhdb_state* fhdb_state,
+                                std::vector<fhdb_worker>& workers)
+{
+  int result;
+  uint64_t first = 0, last = 0, step;
+  MDB_cursor* cursor;
+  MDB_val rkey, rdata;
+
+  result = mdb_cursor_open(fhdb_state->db_ro_txn, fhdb_state->db_dbi, &cursor);
+  if (result) {
+    Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
+    return 0;
+  }
+
+  result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_FIRST);
+  if (!result) {
+    first = *(uint64_t*)rkey.mv_data;
+    result = mdb_cursor_get(cursor, &rkey, &rdata, MDB_LAST);
+  }
+  if (!result) { last = *(uint64_t*)rkey.mv_data; }
+  mdb_cursor_close(cursor);
+
+  if (result) {
+    if (result != MDB_NOTFOUND) {
+      Dmsg1(debuglevel, "%s\n", mdb_strerror(result));
+    }
+    return 0;
+  }
+
+  /*
+   * Node numbers are spread fairly evenly, don't give a worker less than a
+   * few thousand of them.
+   */
+  workers.resize(MAX(MIN(fhdb_state->workers, (last - first) / 4096 + 1), 1));
+  step = (last - first) / workers.size() + 1;
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].first = first + i * step;
+    workers[i].last =
+        (i == workers.size() - 1) ? last : first + (i + 1) * step - 1;
+  }
+
+  return workers.size();
+}
+
+/*
+ * Calculate the paths of all nodes with workers running over ranges of the
+ * LMDB and store the files in the catalog from this thread.
+ */
+static inline void ProcessLmdb(NIS* nis, struct fhdb_state* fhdb_state)
+{
+  int status;
+  uint64_t stored = 0;
+  std::vector<fhdb_worker> workers;
+  struct fhdb_processing proc;
+
+  if (!SplitNodeRanges(fhdb_state, workers)) { return; }
+
+  proc.nis = nis;
+  proc.fhdb_state = fhdb_state;
+  proc.running = 0;
+  proc.abort = false;
+  pthread_mutex_init(&proc.mutex, NULL);
+  pthread_cond_init(&proc.queue_filled, NULL);
+  pthread_cond_init(&proc.queue_drained, NULL);
+
+  for (auto& worker : workers) {
+    worker.proc = &proc;
+    P(proc.mutex);
+    proc.running++;
+    V(proc.mutex);
+    if ((status = pthread_create(&worker.tid, NULL, fhdb_worker_thread,
+                                 &worker)) != 0) {
+      BErrNo be;
+
+      Jmsg1(nis->jcr, M_FATAL, 0,
+            _("Cannot create file history worker thread: %s\n"),
+            be.bstrerror(status));
+      P(proc.mutex);
+      proc.running--;
+      proc.abort = true;
+      V(proc.mutex);
+      break;
+    }
+    worker.started = true;
+  }
+  Dmsg1(100, "Processing lmdb database with %d workers\n", proc.running);
+
+  P(proc.mutex);
+  while (proc.running || !proc.queue.empty()) {
+    if (proc.queue.empty()) {
+      pthread_cond_wait(&proc.queue_filled, &proc.mutex);
+      continue;
+    }
+
+    fhdb_file file = std::move(proc.queue.front());
+    proc.queue.pop_front();
+    pthread_cond_signal(&proc.queue_drained);
+    V(proc.mutex);
+
+    if (!proc.abort) {
+      NdmpStoreAttributeRecord(nis->jcr, (char*)file.path.c_str(),
+                               nis->virtual_filename,
+                               (char*)file.attribs.c_str(), file.FileType, 0,
+                               file.fh_info);
+      stored++;
+    }
+
+    P(proc.mutex);
+    if (JobCanceled(nis->jcr) && !proc.abort) {
+      proc.abort = true;
+      pthread_cond_broadcast(&proc.queue_drained);
+    }
+  }
+  V(proc.mutex);
+
+  for (auto& worker : workers) {
+    if (worker.started) { pthread_join(worker.tid, NULL); }
+  }
+
+  pthread_cond_destroy(&proc.queue_drained);
+  pthread_cond_destroy(&proc.queue_filled);
+  pthread_mutex_destroy(&proc.mutex);
+
+  Dmsg1(100, "Stored %llu files from the lmdb database\n", stored);
 }
 
 void NdmpFhdbLmdbProcessDb(struct ndmlog* ixlog)
@@ -759,6 +1005,9 @@ void NdmpFhdbLmdbProcessDb(struct ndmlog* ixlog)
 
   ProcessLmdb(nis, fhdb_state);
 
+  mdb_txn_abort(fhdb_state->db_ro_txn);
+  fhdb_state->db_ro_txn = NULL;
+
   Jmsg(nis->jcr, M_INFO, 0, "Processing lmdb database done\n");
 }
 
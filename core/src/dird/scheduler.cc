@@ -3,7 +3,7 @@
 
    Copyright (C) 2000-2011 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2012 Planets Communications B.V.
-   Copyright (C) 2013-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2019 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -30,14 +30,26 @@
  * It looks at what jobs are to be run and when
  * and waits around until it is time to
  * fire them up.
+ *
+ * The next run time of every run of every scheduled job is kept on a
+ * timeline ordered by run time, so only the run that was just started
+ * has to be looked at again. The timeline is rebuilt when the
+ * configuration is reloaded or the clock jumps.
  */
 
 #include "include/bareos.h"
 #include "dird.h"
 #include "dird/dird_globals.h"
 #include "dird/job.h"
+#include "dird/scheduler.h"
 #include "dird/storage.h"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
 namespace directordaemon {
 
 const int debuglevel = 200;
@@ -46,23 +58,47 @@ const int debuglevel = 200;
 struct job_item {
   RunResource* run;
   JobResource* job;
+  int run_index; /* position of run in the schedule of the job */
   time_t runtime;
   int Priority;
-  dlink link; /* link for list */
 };
 
-/* List of jobs to be run. They were scheduled in this hour or the next */
-static dlist* jobs_to_run; /* list of jobs to be run */
+/*
+ * Ordering of the timeline heap, the job that is to be run first (and
+ * for jobs starting at the same time the one with the best priority) is
+ * on top.
+ */
+static bool RunsLater(const job_item& a, const job_item& b)
+{
+  if (a.runtime != b.runtime) { return a.runtime > b.runtime; }
+  return a.Priority > b.Priority;
+}
+
+/*
+ * Timeline of jobs to be run, a min heap on runtime and priority holding the
+ * next time each scheduled run of each job fires.
+ */
+static std::vector<job_item> jobs_to_run;
+static bool timeline_valid = false;
+
+/*
+ * When a run of a job was last started, keyed by job name and run index so
+ * it survives a reload of the configuration.
+ */
+static std::map<std::string, time_t> last_runs;
 
 /* Time interval in secs to sleep if nothing to be run */
 static int const next_check_secs = 60;
 
+/* Number of days to look ahead for the next run of a schedule */
+static int const max_lookahead_days = 400;
+
 /* Forward referenced subroutines */
-static void find_runs();
-static void add_job(JobResource* job,
-                    RunResource* run,
-                    time_t now,
-                    time_t runtime);
+static void BuildTimeline();
+static void ScheduleNextRun(JobResource* job,
+                            RunResource* run,
+                            int run_index,
+                            time_t from);
 
 /* Imported subroutines */
 
@@ -70,16 +106,21 @@ static void add_job(JobResource* job,
 
 /**
  * called by reload_config to tell us that the schedules
- * we may have based our next jobs to run queues have been
- * invalidated.  In fact the schedules may not have changed
- * but the run object that we have recorded the last_run time
- * on are new and no longer have a valid last_run time which
- * causes us to double run schedules that get put into the list
- * because run_nh = 1.
+ * we based our timeline on have been invalidated.  In fact
+ * the schedules may not have changed but the job and run
+ * objects on the timeline are replaced by new ones so the
+ * timeline needs to be rebuilt. The last_runs map makes sure
+ * we don't double run a schedule that was started just before
+ * the reload. The flag is set by the reload thread, so it is atomic.
  */
-static bool schedules_invalidated = false;
+static std::atomic<bool> schedules_invalidated{false};
 void InvalidateSchedules(void) { schedules_invalidated = true; }
 
+static std::string LastRunKey(JobResource* job, int run_index)
+{
+  return std::string(job->name()) + ":" + std::to_string(run_index);
+}
+
 /**
  *
  *         Main Bareos Scheduler
@@ -92,13 +133,11 @@ JobControlRecord* wait_for_next_job(char* one_shot_job_to_run)
   RunResource* run;
   time_t now, prev;
   static bool first = true;
-  job_item* next_job = NULL;
+  job_item next_job;
 
   Dmsg0(debuglevel, "Enter wait_for_next_job\n");
   if (first) {
     first = false;
-    /* Create scheduled jobs list */
-    jobs_to_run = New(dlist(next_job, &next_job->link));
     if (one_shot_job_to_run) { /* one shot */
       job = (JobResource*)my_config->GetResWithName(R_JOB, one_shot_job_to_run);
       if (!job) {
@@ -111,49 +150,31 @@ JobControlRecord* wait_for_next_job(char* one_shot_job_to_run)
     }
   }
 
-  /* Wait until we have something in the
-   * next hour or so.
-   */
 again:
-  while (jobs_to_run->empty()) {
-    find_runs();
-    if (!jobs_to_run->empty()) { break; }
-    Bmicrosleep(next_check_secs, 0); /* recheck once per minute */
-  }
-
-  /*
-   * Pull the first job to run (already sorted by runtime and
-   *  Priority, then wait around until it is time to run it.
-   */
-  next_job = (job_item*)jobs_to_run->first();
-  jobs_to_run->remove(next_job);
-
-  if (!next_job) { /* we really should have something now */
-    Emsg0(M_ABORT, 0, _("Scheduler logic error\n"));
-  }
-
-  /* Now wait for the time to run the job */
+  /* Now wait for the time to run the first job on the timeline */
   for (;;) {
     time_t twait;
-    /* discard scheduled queue and rebuild with new schedule objects. */
+
+    /* discard the timeline and rebuild it with new schedule objects. */
     LockJobs();
-    if (schedules_invalidated) {
-      free(next_job);
-      while (!jobs_to_run->empty()) {
-        next_job = (job_item*)jobs_to_run->first();
-        jobs_to_run->remove(next_job);
-        free(next_job);
-      }
-      schedules_invalidated = false;
-      UnlockJobs();
-      goto again;
+    if (schedules_invalidated.exchange(false)) {
+      jobs_to_run.clear();
+      timeline_valid = false;
     }
     UnlockJobs();
+
+    if (!timeline_valid) { BuildTimeline(); }
+
     prev = now = time(NULL);
-    twait = next_job->runtime - now;
-    if (twait <= 0) { /* time to run it */
-      break;
+    if (jobs_to_run.empty()) {
+      twait = next_check_secs;
+    } else {
+      twait = jobs_to_run.front().runtime - now;
+      if (twait <= 0) { /* time to run it */
+        break;
+      }
     }
+
     /* Recheck at least once per minute */
     Bmicrosleep((next_check_secs < twait) ? next_check_secs : twait, 0);
     /* Attempt to handle clock shift (but not daylight savings time changes)
@@ -165,21 +186,28 @@ again:
     }
   }
 
-  jcr = new_jcr(sizeof(JobControlRecord), DirdFreeJcr);
-  run = next_job->run; /* pick up needed values */
-  job = next_job->job;
-
-  if (job->enabled && (!job->client || job->client->enabled)) {}
+  /*
+   * Pull the first job to run from the timeline and put the next
+   * occurrence of the same run back.
+   */
+  std::pop_heap(jobs_to_run.begin(), jobs_to_run.end(), RunsLater);
+  next_job = jobs_to_run.back();
+  jobs_to_run.pop_back();
+  ScheduleNextRun(next_job.job, next_job.run, next_job.run_index,
+                  next_job.runtime + 60);
 
-  free(next_job);
+  run = next_job.run; /* pick up needed values */
+  job = next_job.job;
 
   if (!job->enabled || (job->schedule && !job->schedule->enabled) ||
       (job->client && !job->client->enabled)) {
-    FreeJcr(jcr);
     goto again; /* ignore this job */
   }
 
   run->last_run = now; /* mark as run now */
+  last_runs[LastRunKey(job, next_job.run_index)] = next_job.runtime;
+
+  jcr = new_jcr(sizeof(JobControlRecord), DirdFreeJcr);
 
   ASSERT(job);
   SetJcrDefaults(jcr, job);
@@ -243,7 +271,8 @@ again:
  */
 void TermScheduler()
 {
-  if (jobs_to_run) { delete jobs_to_run; }
+  jobs_to_run.clear();
+  last_runs.clear();
 }
 
 /**
@@ -280,143 +309,148 @@ bool IsDoyInLastWeek(int year, int doy)
 }
 
 /**
- * Find all jobs to be run this hour and the next hour.
+ * Return the first time at or after from the given run fires, or 0 when it
+ * does not fire within the next max_lookahead_days days.
  */
-static void find_runs()
+time_t GetNextRunTime(RunResource* run, time_t from)
 {
-  time_t now, next_hour, runtime;
-  RunResource* run;
-  JobResource* job;
-  ScheduleResource* sched;
+  time_t day, runtime;
   struct tm tm;
-  bool is_last_week = false;    /* are we in the last week of a month? */
-  bool nh_is_last_week = false; /* are we in the last week of a month? */
   int hour, mday, wday, month, wom, woy, yday;
-  /* Items corresponding to above at the next hour */
-  int nh_hour, nh_mday, nh_wday, nh_month, nh_wom, nh_woy, nh_yday;
+  bool is_last_week; /* are we in the last week of a month? */
+
+  day = from;
+  Blocaltime(&day, &tm);
+  for (int i = 0; i < max_lookahead_days; i++) {
+    mday = tm.tm_mday - 1;
+    wday = tm.tm_wday;
+    month = tm.tm_mon;
+    wom = mday / 7;
+    woy = TmWoy(day);  /* get week of year */
+    yday = tm.tm_yday; /* get day of year */
+    is_last_week = IsDoyInLastWeek(tm.tm_year + 1900, yday);
+
+    if (BitIsSet(mday, run->mday) && BitIsSet(wday, run->wday) &&
+        BitIsSet(month, run->month) &&
+        (BitIsSet(wom, run->wom) || (run->last_set && is_last_week)) &&
+        BitIsSet(woy, run->woy)) {
+      /*
+       * Scheduled on this day, find the first hour that is not in the past.
+       */
+      for (hour = tm.tm_hour; hour < 24; hour++) {
+        if (!BitIsSet(hour, run->hour)) { continue; }
 
-  Dmsg0(debuglevel, "enter find_runs()\n");
+        tm.tm_hour = hour;
+        tm.tm_min = run->minute;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1; /* let mktime() find out about DST */
+        runtime = mktime(&tm);
+        if (runtime >= from) { return runtime; }
+      }
+    }
 
-  /*
-   * Compute values for time now
-   */
-  now = time(NULL);
-  Blocaltime(&now, &tm);
-  hour = tm.tm_hour;
-  mday = tm.tm_mday - 1;
-  wday = tm.tm_wday;
-  month = tm.tm_mon;
-  wom = mday / 7;
-  woy = TmWoy(now);  /* get week of year */
-  yday = tm.tm_yday; /* get day of year */
+    /*
+     * Go to the start of the next day.
+     */
+    tm.tm_mday++;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    day = mktime(&tm);
+    Blocaltime(&day, &tm);
+  }
 
-  Dmsg8(debuglevel, "now = %x: h=%d m=%d md=%d wd=%d wom=%d woy=%d yday=%d\n",
-        now, hour, month, mday, wday, wom, woy, yday);
+  return 0;
+}
 
-  is_last_week = IsDoyInLastWeek(tm.tm_year + 1900, yday);
+/**
+ * Put the first run of a job at or after from on the timeline.
+ */
+static void ScheduleNextRun(JobResource* job,
+                            RunResource* run,
+                            int run_index,
+                            time_t from)
+{
+  job_item je;
 
-  /*
-   * Compute values for next hour from now.
-   * We do this to be sure we don't miss a job while
-   * sleeping.
-   */
-  next_hour = now + 3600;
-  Blocaltime(&next_hour, &tm);
-  nh_hour = tm.tm_hour;
-  nh_mday = tm.tm_mday - 1;
-  nh_wday = tm.tm_wday;
-  nh_month = tm.tm_mon;
-  nh_wom = nh_mday / 7;
-  nh_woy = TmWoy(next_hour); /* get week of year */
-  nh_yday = tm.tm_yday;      /* get day of year */
-
-  Dmsg8(debuglevel, "nh = %x: h=%d m=%d md=%d wd=%d wom=%d woy=%d yday=%d\n",
-        next_hour, nh_hour, nh_month, nh_mday, nh_wday, nh_wom, nh_woy,
-        nh_yday);
-
-  nh_is_last_week = IsDoyInLastWeek(tm.tm_year + 1900, nh_yday);
+  je.runtime = GetNextRunTime(run, from);
+  if (!je.runtime) { return; }
+
+  je.run = run;
+  je.job = job;
+  je.run_index = run_index;
+  if (run->Priority) {
+    je.Priority = run->Priority;
+  } else {
+    je.Priority = job->Priority;
+  }
+
+  Dmsg3(debuglevel, "Job %s run %d next at %lld\n", job->name(), run_index,
+        (long long)je.runtime);
+  jobs_to_run.push_back(je);
+  std::push_heap(jobs_to_run.begin(), jobs_to_run.end(), RunsLater);
+}
+
+/**
+ * Compute the next run time of every scheduled job.
+ *
+ * As many jobs normally share a few schedules the next run time is computed
+ * once per run of a schedule. Runs started before a reload of the
+ * configuration are not started again.
+ */
+static void BuildTimeline()
+{
+  time_t now, from;
+  JobResource* job;
+  RunResource* run;
+  int run_index;
+  std::map<RunResource*, time_t> next_runs;
+  std::map<std::string, time_t>::iterator last;
+
+  Dmsg0(debuglevel, "enter BuildTimeline()\n");
 
   /*
-   * Loop through all jobs
+   * Do run any job scheduled less than a minute ago.
    */
+  now = time(NULL);
+  from = now - 59;
+
+  jobs_to_run.clear();
+
   LockRes(my_config);
   foreach_res (job, R_JOB) {
-    sched = job->schedule;
-    if (sched == NULL || !sched->enabled || !job->enabled ||
-        (job->client && !job->client->enabled)) { /* scheduled? or enabled? */
-      continue;                                   /* no, skip this job */
-    }
+    if (!job->schedule) { continue; }
 
-    Dmsg1(debuglevel, "Got job: %s\n", job->hdr.name);
-    for (run = sched->run; run; run = run->next) {
-      bool run_now, run_nh;
-      /*
-       * Find runs scheduled between now and the next hour.
-       */
-      run_now = BitIsSet(hour, run->hour) && BitIsSet(mday, run->mday) &&
-                BitIsSet(wday, run->wday) && BitIsSet(month, run->month) &&
-                (BitIsSet(wom, run->wom) || (run->last_set && is_last_week)) &&
-                BitIsSet(woy, run->woy);
-
-      run_nh =
-          BitIsSet(nh_hour, run->hour) && BitIsSet(nh_mday, run->mday) &&
-          BitIsSet(nh_wday, run->wday) && BitIsSet(nh_month, run->month) &&
-          (BitIsSet(nh_wom, run->wom) || (run->last_set && nh_is_last_week)) &&
-          BitIsSet(nh_woy, run->woy);
-
-      Dmsg3(debuglevel, "run@%p: run_now=%d run_nh=%d\n", run, run_now, run_nh);
-
-      if (run_now || run_nh) {
-        /*
-         * find time (time_t) job is to be run
-         */
-        Blocaltime(&now, &tm);   /* reset tm structure */
-        tm.tm_min = run->minute; /* set run minute */
-        tm.tm_sec = 0;           /* zero secs */
-        runtime = mktime(&tm);
-        if (run_now) { add_job(job, run, now, runtime); }
-        /* If job is to be run in the next hour schedule it */
-        if (run_nh) { add_job(job, run, now, runtime + 3600); }
+    for (run = job->schedule->run, run_index = 0; run;
+         run = run->next, run_index++) {
+      job_item je;
+
+      last = last_runs.find(LastRunKey(job, run_index));
+      if (last != last_runs.end() && last->second >= from) {
+        ScheduleNextRun(job, run, run_index, last->second + 60);
+        continue;
       }
+
+      if (next_runs.find(run) == next_runs.end()) {
+        next_runs[run] = GetNextRunTime(run, from);
+      }
+      if (!next_runs[run]) { continue; }
+
+      je.run = run;
+      je.job = job;
+      je.run_index = run_index;
+      je.runtime = next_runs[run];
+      je.Priority = run->Priority ? run->Priority : job->Priority;
+      jobs_to_run.push_back(je);
     }
   }
   UnlockRes(my_config);
-  Dmsg0(debuglevel, "Leave find_runs()\n");
-}
 
-static void add_job(JobResource* job,
-                    RunResource* run,
-                    time_t now,
-                    time_t runtime)
-{
-  job_item* ji;
-  bool inserted = false;
-  /*
-   * Don't run any job that ran less than a minute ago, but
-   *  do run any job scheduled less than a minute ago.
-   */
-  if (((runtime - run->last_run) < 61) || ((runtime + 59) < now)) { return; }
-  /* accept to run this job */
-  job_item* je = (job_item*)malloc(sizeof(job_item));
-  je->run = run;
-  je->job = job;
-  je->runtime = runtime;
-  if (run->Priority) {
-    je->Priority = run->Priority;
-  } else {
-    je->Priority = job->Priority;
-  }
+  std::make_heap(jobs_to_run.begin(), jobs_to_run.end(), RunsLater);
+  timeline_valid = true;
 
-  /* Add this job to the wait queue in runtime, priority sorted order */
-  foreach_dlist (ji, jobs_to_run) {
-    if (ji->runtime > je->runtime ||
-        (ji->runtime == je->runtime && ji->Priority > je->Priority)) {
-      jobs_to_run->InsertBefore(je, ji);
-      inserted = true;
-      break;
-    }
-  }
-  /* If place not found in queue, append it */
-  if (!inserted) { jobs_to_run->append(je); }
+  Dmsg1(debuglevel, "Leave BuildTimeline() %d runs\n",
+        (int)jobs_to_run.size());
 }
 } /* namespace directordaemon */
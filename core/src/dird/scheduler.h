@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2019 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -26,6 +26,7 @@ namespace directordaemon {
 
 JobControlRecord* wait_for_next_job(char* one_shot_job_to_run);
 bool IsDoyInLastWeek(int year, int doy);
+time_t GetNextRunTime(RunResource* run, time_t from);
 void TermScheduler();
 void InvalidateSchedules();
 
@@ -28,10 +28,13 @@
  */
 
 #include "include/bareos.h"
+#include "include/ch.h"
 #include "dird/dird.h"
+#include "dird/dird_globals.h"
 #include "findlib/find.h"
+#include "findlib/attribs.h"
+#include "lib/edit.h"
 #include "lib/mntent_cache.h"
-#include "ch.h"
 
 #if defined(HAVE_WIN32)
 #define isatty(fd) (fd == 0)
@@ -39,16 +42,9 @@
 
 using namespace directordaemon;
 
-/* Dummy functions */
-void GeneratePluginEvent(JobControlRecord* jcr,
-                         bEventType eventType,
-                         void* value)
-{
-}
-extern bool ParseDirConfig(const char* configfile, int exit_code);
-
 /* Global variables */
 static int num_files = 0;
+static uint64_t num_bytes = 0;
 static int max_file_len = 0;
 static int max_path_len = 0;
 static int trunc_fname = 0;
@@ -59,6 +55,8 @@ static JobControlRecord* jcr;
 
 static int PrintFile(JobControlRecord* jcr, FindFilesPacket* ff, bool);
 static void CountFiles(FindFilesPacket* ff);
+static void AddNamesFromFile(findIncludeExcludeItem* incexe,
+                             const char* filename);
 static bool CopyFileset(FindFilesPacket* ff, JobControlRecord* jcr);
 static void SetOptions(findFOPTS* fo, const char* opts);
 
@@ -93,6 +91,8 @@ int main(int argc, char* const* argv)
   const char* configfile = "bareos-dir.conf";
   const char* fileset_name = "Windows-Full-Set";
   int ch, hard_links;
+  btime_t start_time, elapsed;
+  char ed1[50];
 
   OSDependentInit();
 
@@ -163,7 +163,9 @@ int main(int argc, char* const* argv)
 
   CopyFileset(ff, jcr);
 
+  start_time = GetCurrentBtime();
   FindFiles(jcr, ff, PrintFile, NULL);
+  elapsed = GetCurrentBtime() - start_time;
 
   FreeJcr(jcr);
   if (my_config) {
@@ -197,6 +199,7 @@ int main(int argc, char* const* argv)
         fo->fstype.destroy();
         fo->Drivetype.destroy();
       }
+      FreeCompiledPatterns(incexe);
       incexe->opts_list.destroy();
       incexe->name_list.destroy();
     }
@@ -218,6 +221,7 @@ int main(int argc, char* const* argv)
         fo->fstype.destroy();
         fo->Drivetype.destroy();
       }
+      FreeCompiledPatterns(incexe);
       incexe->opts_list.destroy();
       incexe->name_list.destroy();
     }
@@ -229,13 +233,17 @@ int main(int argc, char* const* argv)
 
   printf(_("\n"
            "Total files    : %d\n"
+           "Total bytes    : %s\n"
            "Max file length: %d\n"
            "Max path length: %d\n"
            "Files truncated: %d\n"
            "Paths truncated: %d\n"
-           "Hard links     : %d\n"),
-         num_files, max_file_len, max_path_len, trunc_fname, trunc_path,
-         hard_links);
+           "Hard links     : %d\n"
+           "Walk time      : %.3f sec\n"
+           "Files/sec      : %.0f\n"),
+         num_files, edit_uint64(num_bytes, ed1), max_file_len, max_path_len,
+         trunc_fname, trunc_path, hard_links, (double)elapsed / 1000000,
+         elapsed ? (double)num_files * 1000000 / elapsed : 0.0);
 
   FlushMntentCache();
 
@@ -270,6 +278,7 @@ static int PrintFile(JobControlRecord* jcr, FindFilesPacket* ff, bool top_level)
       } else if (debug_level > 1) {
         printf(_("Reg: %s\n"), ff->fname);
       }
+      num_bytes += ff->statp.st_size;
       CountFiles(ff);
       break;
     case FT_LNK:
@@ -411,6 +420,30 @@ static void CountFiles(FindFilesPacket* ar)
   }
 }
 
+/*
+ * Expand a File = "<file" entry the same way the director does when sending
+ * the FileSet to the filedaemon, one name per line.
+ */
+static void AddNamesFromFile(findIncludeExcludeItem* incexe,
+                             const char* filename)
+{
+  FILE* fp;
+  char buf[1000];
+
+  if ((fp = fopen(filename, "rb")) == NULL) {
+    BErrNo be;
+
+    printf(_("Err: Cannot open included file: %s. ERR=%s\n"), filename,
+           be.bstrerror());
+    return;
+  }
+  while (fgets(buf, sizeof(buf), fp)) {
+    StripTrailingNewline(buf);
+    if (*buf) { incexe->name_list.append(new_dlistString(buf)); }
+  }
+  fclose(fp);
+}
+
 static bool CopyFileset(FindFilesPacket* ff, JobControlRecord* jcr)
 {
   FilesetResource* jcr_fileset = jcr->res.fileset;
@@ -446,7 +479,7 @@ static bool CopyFileset(FindFilesPacket* ff, JobControlRecord* jcr)
             (findIncludeExcludeItem*)malloc(sizeof(findIncludeExcludeItem));
         memset(fileset->incexe, 0, sizeof(findIncludeExcludeItem));
         fileset->incexe->opts_list.init(1, true);
-        fileset->incexe->name_list.init(0, 0);
+        fileset->incexe->name_list.init();
         fileset->include_list.append(fileset->incexe);
       } else {
         ie = jcr_fileset->exclude_items[i];
@@ -456,7 +489,7 @@ static bool CopyFileset(FindFilesPacket* ff, JobControlRecord* jcr)
             (findIncludeExcludeItem*)malloc(sizeof(findIncludeExcludeItem));
         memset(fileset->incexe, 0, sizeof(findIncludeExcludeItem));
         fileset->incexe->opts_list.init(1, true);
-        fileset->incexe->name_list.init(0, 0);
+        fileset->incexe->name_list.init();
         fileset->exclude_list.append(fileset->incexe);
       }
 
@@ -519,8 +552,13 @@ static bool CopyFileset(FindFilesPacket* ff, JobControlRecord* jcr)
       }
 
       for (j = 0; j < ie->name_list.size(); j++) {
-        fileset->incexe->name_list.append(
-            bstrdup((const char*)ie->name_list.get(j)));
+        const char* name = (const char*)ie->name_list.get(j);
+
+        if (*name == '<') {
+          AddNamesFromFile(fileset->incexe, name + 1);
+        } else {
+          fileset->incexe->name_list.append(new_dlistString(name));
+        }
       }
     }
 
@@ -593,6 +631,10 @@ static void SetOptions(findFOPTS* fo, const char* opts)
             p++;
             break;
 #endif
+          case '4':
+            SetBit(FO_XXH64, fo->flags);
+            p++;
+            break;
           default:
             /* Automatically downgrade to SHA-1 if an unsupported
              * SHA variant is specified */
@@ -57,6 +57,7 @@ UaContext::UaContext()
     , int32_val(0)
     , int64_val(0)
     , send(nullptr)
+    , prune_deadline(0)
     , cmddef(nullptr)
 {
   for (int i = 0; i < MAX_CMD_ARGS; i++) argk[i] = nullptr;
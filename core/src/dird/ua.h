@@ -85,6 +85,7 @@ class UaContext {
   int32_t int32_val;              /**< Positive/negative */
   int64_t int64_val;              /**< Big int */
   OutputFormatter* send;          /**< object instance to handle output */
+  time_t prune_deadline;          /**< Stop pruning at this time, 0 = never */
 
  private:
   ua_cmdstruct* cmddef; /**< Definition of the currently executed command */
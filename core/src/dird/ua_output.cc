@@ -1364,6 +1364,7 @@ RunResource* find_next_run(RunResource* run,
             runtm.tm_hour = i;
             runtm.tm_min = run->minute;
             runtm.tm_sec = 0;
+            runtm.tm_isdst = -1;
             runtime = mktime(&runtm);
             Dmsg2(200, "now=%d runtime=%lld\n", now, runtime);
             if ((runtime > now) && (runtime < endtime)) {
@@ -47,6 +47,8 @@ namespace directordaemon {
 static bool PruneDirectory(UaContext* ua, ClientResource* client);
 static bool PruneStats(UaContext* ua, utime_t retention);
 static bool GrowDelList(struct del_ctx* del);
+static void DropTempTables(UaContext* ua);
+static bool CreateTempTables(UaContext* ua);
 
 /**
  * Called here to count entries to be deleted
@@ -476,10 +478,9 @@ static bool prune_set_filter(UaContext* ua,
 /**
  * Prune File records from the database. For any Job which
  * is older than the retention period, we unconditionally delete
- * all File records for that Job.  This is simple enough that no
- * temporary tables are needed. We simply make an in memory list of
- * the JobIds meeting the prune conditions, then delete all File records
- * pointing to each of those JobIds.
+ * all File records for that Job. We select the JobIds meeting the
+ * prune conditions into the DelCandidates table and then delete all
+ * File records pointing to those JobIds.
  *
  * This routine assumes you want the pruning to be done. All checking
  *  must be done before calling this routine.
@@ -488,16 +489,13 @@ static bool prune_set_filter(UaContext* ua,
  */
 bool PruneFiles(UaContext* ua, ClientResource* client, PoolResource* pool)
 {
-  struct del_ctx del;
-  struct s_count_ctx cnt;
+  int num_del;
   PoolMem query(PM_MESSAGE);
   PoolMem sql_where(PM_MESSAGE);
   PoolMem sql_from(PM_MESSAGE);
   utime_t period;
   char ed1[50];
 
-  memset(&del, 0, sizeof(del));
-
   if (pool && pool->FileRetention > 0) {
     period = pool->FileRetention;
 
@@ -518,46 +516,42 @@ bool PruneFiles(UaContext* ua, ClientResource* client, PoolResource* pool)
   //   Jmsg(ua->jcr, M_INFO, 0, _("Begin pruning Jobs older than %s secs.\n"),
   //   ed1);
   Jmsg(ua->jcr, M_INFO, 0, _("Begin pruning Files.\n"));
-  /* Select Jobs -- for counting */
-  Mmsg(query, "SELECT COUNT(1) FROM Job %s WHERE PurgedFiles=0 %s",
+
+  /* Drop any previous temporary tables still there */
+  DropTempTables(ua);
+
+  /* Create temp tables and indicies */
+  if (!CreateTempTables(ua)) { goto bail_out; }
+
+  /*
+   * Select all jobs that are older than the FileRetention period
+   * and still have files into the "DeletionCandidates" table.
+   */
+  Mmsg(query,
+       "INSERT INTO DelCandidates "
+       "SELECT JobId,PurgedFiles,FileSetId,JobFiles,JobStatus "
+       "FROM Job %s " /* JOIN Pool/Client */
+       "WHERE PurgedFiles=0 %s ",
        sql_from.c_str(), sql_where.c_str());
   Dmsg1(050, "select sql=%s\n", query.c_str());
-  cnt.count = 0;
-  if (!ua->db->SqlQuery(query.c_str(), DelCountHandler, (void*)&cnt)) {
+  if (!ua->db->SqlQuery(query.c_str())) {
     ua->ErrorMsg("%s", ua->db->strerror());
-    Dmsg0(050, "Count failed\n");
     goto bail_out;
   }
 
-  if (cnt.count == 0) {
+  num_del = PurgeDelCandidates(ua, true);
+  if (num_del == 0) {
     if (ua->verbose) { ua->WarningMsg(_("No Files found to prune.\n")); }
     goto bail_out;
   }
 
-  if (cnt.count < MAX_DEL_LIST_LEN) {
-    del.max_ids = cnt.count + 1;
-  } else {
-    del.max_ids = MAX_DEL_LIST_LEN;
-  }
-  del.tot_ids = 0;
-
-  del.JobId = (JobId_t*)malloc(sizeof(JobId_t) * del.max_ids);
-
-  /* Now process same set but making a delete list */
-  Mmsg(query, "SELECT JobId FROM Job %s WHERE PurgedFiles=0 %s",
-       sql_from.c_str(), sql_where.c_str());
-  Dmsg1(050, "select sql=%s\n", query.c_str());
-  ua->db->SqlQuery(query.c_str(), FileDeleteHandler, (void*)&del);
-
-  PurgeFilesFromJobList(ua, del);
-
-  edit_uint64_with_commas(del.num_del, ed1);
+  edit_uint64_with_commas(num_del, ed1);
   ua->InfoMsg(_("Pruned Files from %s Jobs for client %s from catalog.\n"), ed1,
               client->name());
 
 bail_out:
+  DropTempTables(ua);
   DbUnlock(ua->db);
-  if (del.JobId) { free(del.JobId); }
   return 1;
 }
 
@@ -661,12 +655,11 @@ static bool PruneBackupJobs(UaContext* ua,
   PoolMem sql_from(PM_MESSAGE);
   utime_t period;
   char ed1[50];
+  int num_del;
   alist* jobids_check = NULL;
   struct accurate_check_ctx* elt = nullptr;
   db_list_ctx jobids, tempids;
   JobDbRecord jr;
-  struct del_ctx del;
-  memset(&del, 0, sizeof(del));
 
   if (pool && pool->JobRetention > 0) {
     period = pool->JobRetention;
@@ -690,10 +683,6 @@ static bool PruneBackupJobs(UaContext* ua,
   edit_utime(period, ed1, sizeof(ed1));
   Jmsg(ua->jcr, M_INFO, 0, _("Begin pruning Jobs older than %s.\n"), ed1);
 
-  del.max_ids = 100;
-  del.JobId = (JobId_t*)malloc(sizeof(JobId_t) * del.max_ids);
-  del.PurgedFiles = (char*)malloc(del.max_ids);
-
   /*
    * Select all files that are older than the JobRetention period
    * and add them into the "DeletionCandidates" table.
@@ -794,19 +783,10 @@ static bool PruneBackupJobs(UaContext* ua,
     Dmsg1(60, "jobids to exclude = %s\n", jobids.list);
   }
 
-  /* We use DISTINCT because we can have two times the same job */
-  Mmsg(query,
-       "SELECT DISTINCT DelCandidates.JobId,DelCandidates.PurgedFiles "
-       "FROM DelCandidates");
-  if (!ua->db->SqlQuery(query.c_str(), JobDeleteHandler, (void*)&del)) {
-    ua->ErrorMsg("%s", ua->db->strerror());
-  }
-
-  PurgeJobListFromCatalog(ua, del);
-
-  if (del.num_del > 0) {
-    ua->InfoMsg(_("Pruned %d %s for client %s from catalog.\n"), del.num_del,
-                del.num_del == 1 ? _("Job") : _("Jobs"), client->name());
+  num_del = PurgeDelCandidates(ua, false);
+  if (num_del > 0) {
+    ua->InfoMsg(_("Pruned %d %s for client %s from catalog.\n"), num_del,
+                num_del == 1 ? _("Job") : _("Jobs"), client->name());
   } else if (ua->verbose) {
     ua->InfoMsg(_("No Jobs found to prune.\n"));
   }
@@ -814,8 +794,6 @@ static bool PruneBackupJobs(UaContext* ua,
 bail_out:
   DropTempTables(ua);
   DbUnlock(ua->db);
-  if (del.JobId) { free(del.JobId); }
-  if (del.PurgedFiles) { free(del.PurgedFiles); }
   if (jobids_check) { delete jobids_check; }
   return 1;
 }
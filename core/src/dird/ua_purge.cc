@@ -3,7 +3,7 @@
 
    Copyright (C) 2002-2012 Free Software Foundation Europe e.V.
    Copyright (C) 2011-2016 Planets Communications B.V.
-   Copyright (C) 2013-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2013-2019 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -34,6 +34,7 @@
 
 #include "include/bareos.h"
 #include "dird.h"
+#include "cats/sql.h"
 #include "dird/next_vol.h"
 #include "dird/sd_cmds.h"
 #include "dird/ua_db.h"
@@ -46,6 +47,9 @@
 
 namespace directordaemon {
 
+/* Number of jobs purged with one set of delete statements */
+static const int purge_batch_size = 10000;
+
 /* Forward referenced functions */
 static bool PurgeFilesFromClient(UaContext* ua, ClientResource* client);
 static bool PurgeJobsFromClient(UaContext* ua, ClientResource* client);
@@ -520,6 +524,129 @@ void PurgeJobsFromCatalog(UaContext* ua, char* jobs)
   Dmsg1(050, "Delete Job sql=%s\n", query.c_str());
 }
 
+/**
+ * Delete the records of all jobs in the DelBatch table from a table.
+ */
+static void DeleteJobsFromTable(UaContext* ua, const char* table)
+{
+  PoolMem query(PM_MESSAGE);
+
+  ua->db->FillQuery(query, BareosDb::SQL_QUERY_delete_jobs_from_table_2, table,
+                    "DelBatch");
+  if (!ua->db->SqlQuery(query.c_str())) {
+    ua->ErrorMsg("%s", ua->db->strerror());
+  }
+  Dmsg1(050, "Delete %s sql=%s\n", table, query.c_str());
+}
+
+/**
+ * Delete the catalog records of all jobs in the DelCandidates table.
+ *
+ * Instead of building lists of JobIds the jobs are moved in batches of
+ * purge_batch_size jobs into the DelBatch table and the records of a whole
+ * batch are deleted with one statement per table. When files_only is set
+ * only the File and BaseFiles records get deleted and the jobs are marked
+ * as having their files purged.
+ *
+ * When ua->prune_deadline is set we stop after the batch that exceeded it,
+ * the remaining jobs get pruned by one of the next prune runs.
+ *
+ * Returns: number of jobs purged
+ */
+int PurgeDelCandidates(UaContext* ua, bool files_only)
+{
+  int num_del = 0;
+  struct s_count_ctx cnt;
+  db_list_ctx jobids;
+  PoolMem query(PM_MESSAGE);
+  char ed1[50], ed2[50];
+
+  DbLock(ua->db);
+
+  /*
+   * Never purge the job we are running in.
+   */
+  Mmsg(query, "DELETE FROM DelCandidates WHERE JobId=%s",
+       edit_int64(ua->jcr->JobId, ed1));
+  ua->db->SqlQuery(query.c_str());
+
+  cnt.count = 0;
+  if (!ua->db->SqlQuery("SELECT COUNT(DISTINCT JobId) FROM DelCandidates",
+                        DelCountHandler, (void*)&cnt)) {
+    ua->ErrorMsg("%s", ua->db->strerror());
+    goto bail_out;
+  }
+  if (cnt.count == 0) { goto bail_out; }
+
+  ua->db->SqlQuery("DROP TABLE IF EXISTS DelBatch");
+  if (!ua->db->SqlQuery(
+          "CREATE TEMPORARY TABLE DelBatch (JobId INTEGER NOT NULL)")) {
+    ua->ErrorMsg("%s", ua->db->strerror());
+    goto bail_out;
+  }
+
+  while (num_del < cnt.count) {
+    Mmsg(query,
+         "INSERT INTO DelBatch "
+         "SELECT DISTINCT JobId FROM DelCandidates ORDER BY JobId LIMIT %d",
+         purge_batch_size);
+    if (!ua->db->SqlQuery(query.c_str())) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      break;
+    }
+
+    jobids.reset();
+    if (!ua->db->SqlQuery("SELECT JobId FROM DelBatch", DbListHandler,
+                          &jobids)) {
+      ua->ErrorMsg("%s", ua->db->strerror());
+      break;
+    }
+    if (jobids.count == 0) { break; }
+
+    DeleteJobsFromTable(ua, "File");
+    DeleteJobsFromTable(ua, "BaseFiles");
+
+    if (files_only) {
+      ua->db->SqlQuery(
+          "UPDATE Job SET PurgedFiles=1 "
+          "WHERE JobId IN (SELECT JobId FROM DelBatch)");
+    } else {
+      DeleteJobsFromTable(ua, "JobMedia");
+      DeleteJobsFromTable(ua, "Log");
+      DeleteJobsFromTable(ua, "RestoreObject");
+      DeleteJobsFromTable(ua, "PathVisibility");
+      DeleteJobsFromTable(ua, "NDMPJobEnvironment");
+      DeleteJobsFromTable(ua, "JobStats");
+      UpgradeCopies(ua, jobids.list);
+      DeleteJobsFromTable(ua, "Job");
+    }
+
+    ua->db->SqlQuery(
+        "DELETE FROM DelCandidates "
+        "WHERE JobId IN (SELECT JobId FROM DelBatch)");
+    ua->db->SqlQuery("DELETE FROM DelBatch");
+    num_del += jobids.count;
+
+    if (num_del < cnt.count) {
+      ua->InfoMsg(_("Purged %s of %s Jobs.\n"), edit_int64(num_del, ed1),
+                  edit_int64(cnt.count, ed2));
+
+      if (ua->prune_deadline && time(NULL) >= ua->prune_deadline) {
+        ua->InfoMsg(_("Prune time limit reached, %s Jobs left to prune.\n"),
+                    edit_int64(cnt.count - num_del, ed1));
+        break;
+      }
+    }
+  }
+
+  ua->db->SqlQuery("DROP TABLE IF EXISTS DelBatch");
+
+bail_out:
+  DbUnlock(ua->db);
+
+  return num_del;
+}
+
 void PurgeFilesFromVolume(UaContext* ua, MediaDbRecord* mr) {
 } /* ***FIXME*** implement */
 
@@ -34,6 +34,7 @@ void PurgeFilesFromJobs(UaContext* ua, char* jobs);
 void PurgeJobsFromCatalog(UaContext* ua, char* jobs);
 void PurgeJobListFromCatalog(UaContext* ua, del_ctx& del);
 void PurgeFilesFromJobList(UaContext* ua, del_ctx& del);
+int PurgeDelCandidates(UaContext* ua, bool files_only);
 
 } /* namespace directordaemon */
 #endif  // BAREOS_DIRD_UA_PURGE_H_
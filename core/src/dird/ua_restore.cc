@@ -60,6 +60,7 @@ static bool SelectBackupsBeforeDate(UaContext* ua,
                                     RestoreContext* rx,
                                     char* date);
 static bool BuildDirectoryTree(UaContext* ua, RestoreContext* rx);
+static bool SelectFilesFromCatalog(UaContext* ua, RestoreContext* rx);
 static void free_rx(RestoreContext* rx);
 static void SplitPathAndFilename(UaContext* ua,
                                  RestoreContext* rx,
@@ -1090,6 +1091,105 @@ static void AddDeltaListFindex(RestoreContext* rx, struct delta_list* lst)
   AddFindex(rx->bsr, lst->JobId, lst->FileIndex);
 }
 
+struct catalog_selection_ctx {
+  bsr_append_ctx bsr;
+  uint32_t count;
+  bool has_delta;
+};
+
+/**
+ * row: JobId, FileIndex, DeltaSeq
+ */
+static int CatalogSelectionHandler(void* ctx, int num_fields, char** row)
+{
+  catalog_selection_ctx* sel = (catalog_selection_ctx*)ctx;
+
+  /*
+   * Delta sequences need the tree to find all the parts of a file.
+   */
+  if (str_to_int64(row[2]) > 0) {
+    sel->has_delta = true;
+    return 1;
+  }
+
+  AppendFindex(&sel->bsr, str_to_int64(row[0]), str_to_int64(row[1]));
+  sel->count++;
+
+  return 0;
+}
+
+/**
+ * Select the most recent version of all files of the selected JobIds in the
+ * catalog and add them straight to the bootstrap records. This is used when
+ * all files get restored without interactive selection, so we don't need to
+ * build the directory tree in memory.
+ *
+ * Returns: true if the files are selected
+ *          false if the directory tree needs to be built
+ */
+static bool SelectFilesFromCatalog(UaContext* ua, RestoreContext* rx)
+{
+  JobResource* job;
+  catalog_selection_ctx sel;
+  PoolMem jobids(PM_FNAME);
+  char ed1[50];
+
+  /*
+   * NDMP restores use the tree to know what to restore, so look at the
+   * Restore Job that is going to run. When there is more than one we select
+   * it now and remember it, so RestoreCmd() does not ask again.
+   */
+  if (rx->restore_jobs != 1) {
+    if (!(job = get_restore_job(ua))) { return false; }
+    rx->restore_job = job;
+    rx->restore_jobs = 1;
+  }
+  if (rx->restore_job->Protocol != PT_NATIVE) { return false; }
+
+  /*
+   * When any Job is purged BuildDirectoryTree() restores the complete Jobs.
+   */
+  PmStrcpy(jobids, rx->JobIds);
+  if (*rx->BaseJobIds) {
+    PmStrcat(jobids, ",");
+    PmStrcat(jobids, rx->BaseJobIds);
+  }
+  Mmsg(rx->query, "SELECT SUM(PurgedFiles) FROM Job WHERE JobId IN (%s)",
+       jobids.c_str());
+  if (!ua->db->SqlQuery(rx->query, RestoreCountHandler, (void*)rx)) {
+    ua->ErrorMsg("%s\n", ua->db->strerror());
+    return false;
+  }
+  if (rx->found && rx->JobId > 0) { return false; }
+
+  ua->InfoMsg(_("\nSelecting most recent files of JobId(s) %s ...\n"),
+              rx->JobIds);
+
+  memset(&sel, 0, sizeof(sel));
+  sel.bsr.root = rx->bsr;
+  if (!ua->db->GetFileIndexList(ua->jcr, rx->JobIds, CatalogSelectionHandler,
+                                (void*)&sel) &&
+      !sel.has_delta) {
+    ua->ErrorMsg("%s", ua->db->strerror());
+  }
+
+  if (sel.has_delta || sel.count == 0) {
+    /*
+     * Start over with an empty bsr and let the tree sort it out.
+     */
+    directordaemon::FreeBsr(rx->bsr);
+    rx->bsr = new_bsr();
+    return false;
+  }
+
+  PmStrcpy(rx->JobIds, jobids.c_str());
+  rx->selected_files = sel.count;
+  ua->InfoMsg(_("%s files selected from the catalog.\n"),
+              edit_uint64_with_commas(sel.count, ed1));
+
+  return true;
+}
+
 static bool BuildDirectoryTree(UaContext* ua, RestoreContext* rx)
 {
   TreeContext tree;
@@ -1098,6 +1198,14 @@ static bool BuildDirectoryTree(UaContext* ua, RestoreContext* rx)
   bool OK = true;
   char ed1[50];
 
+  /*
+   * Restoring everything without interactive selection doesn't need a tree.
+   */
+  if (rx->all && FindArg(ua, NT_("done")) >= 0 &&
+      SelectFilesFromCatalog(ua, rx)) {
+    return true;
+  }
+
   memset(&tree, 0, sizeof(tree));
 
   /*
@@ -31,6 +31,8 @@
 #include "include/bareos.h"
 #include "dird.h"
 #include "dird/dird_globals.h"
+#include "dird/attribute_ingest.h"
+#include "dird/catalog_log.h"
 #include "dird/fd_cmds.h"
 #include "dird/job.h"
 #include "dird/ndmp_dma_generic.h"
@@ -46,6 +48,10 @@
 #include "dird/ua_status.h"
 #include "lib/edit.h"
 
+#include <algorithm>
+#include <set>
+#include <vector>
+
 #define DEFAULT_STATUS_SCHED_DAYS 7
 
 namespace directordaemon {
@@ -56,6 +62,9 @@ static void ListScheduledJobs(UaContext* ua);
 static void ListRunningJobs(UaContext* ua);
 static void ListTerminatedJobs(UaContext* ua);
 static void ListConnectedClients(UaContext* ua);
+static void ListJobQueueWaitStatistics(UaContext* ua);
+static void ListCatalogLogStatistics(UaContext* ua);
+static void ListAttributeIngestStatistics(UaContext* ua);
 static void DoDirectorStatus(UaContext* ua);
 static void DoSchedulerStatus(UaContext* ua);
 static bool DoSubscriptionStatus(UaContext* ua);
@@ -372,129 +381,85 @@ void ListDirStatusHeader(UaContext* ua)
   if (len > 0) { ua->SendMsg("%s\n", msg.c_str()); }
 }
 
-static bool show_scheduled_preview(UaContext* ua,
-                                   ScheduleResource* sched,
-                                   PoolMem& overview,
-                                   int* max_date_len,
-                                   struct tm tm,
-                                   time_t time_to_check)
-{
-  int date_len, hour, mday, wday, month, wom, woy, yday;
-  bool is_last_week = false; /* Are we in the last week of a month? */
-  char dt[MAX_TIME_LENGTH];
+/**
+ * One run of a schedule in the scheduler preview.
+ */
+struct scheduled_preview {
   time_t runtime;
+  ScheduleResource* sched;
   RunResource* run;
-  PoolMem temp(PM_NAME);
-
-  hour = tm.tm_hour;
-  mday = tm.tm_mday - 1;
-  wday = tm.tm_wday;
-  month = tm.tm_mon;
-  wom = mday / 7;
-  woy = TmWoy(time_to_check); /* Get week of year */
-  yday = tm.tm_yday;          /* Get day of year */
-
-  is_last_week = IsDoyInLastWeek(tm.tm_year + 1900, yday);
-
-  for (run = sched->run; run; run = run->next) {
-    bool run_now;
-    int cnt = 0;
-
-    run_now = BitIsSet(hour, run->hour) && BitIsSet(mday, run->mday) &&
-              BitIsSet(wday, run->wday) && BitIsSet(month, run->month) &&
-              (BitIsSet(wom, run->wom) || (run->last_set && is_last_week)) &&
-              BitIsSet(woy, run->woy);
-
-    if (run_now) {
-      /*
-       * Find time (time_t) job is to be run
-       */
-      Blocaltime(&time_to_check, &tm); /* Reset tm structure */
-      tm.tm_min = run->minute;         /* Set run minute */
-      tm.tm_sec = 0;                   /* Zero secs */
+};
 
-      /*
-       * Convert the time into a user parsable string.
-       * As we use locale specific strings for weekday and month we
-       * need to keep track of the longest data string used.
-       */
-      runtime = mktime(&tm);
-      bstrftime_wd(dt, sizeof(dt), runtime);
-      date_len = strlen(dt);
-      if (date_len > *max_date_len) {
-        if (*max_date_len == 0) {
-          /*
-           * When the datelen changes during the loop the locale generates a
-           * date string that is variable. Only thing we can do about that is
-           * start from scratch again. We invoke this by return false from this
-           * function.
-           */
-          *max_date_len = date_len;
-          PmStrcpy(overview, "");
-          return false;
-        } else {
-          /*
-           * This is the first determined length we use this until we are proven
-           * wrong.
-           */
-          *max_date_len = date_len;
-        }
-      }
+/**
+ * Add all runs of a schedule between start and stop to the preview.
+ */
+static void AddScheduledPreview(std::vector<scheduled_preview>& preview,
+                                ScheduleResource* sched,
+                                time_t start,
+                                time_t stop)
+{
+  time_t runtime;
 
-      Mmsg(temp, "%-*s  %-22.22s  ", *max_date_len, dt, sched->hdr.name);
-      PmStrcat(overview, temp.c_str());
+  for (RunResource* run = sched->run; run; run = run->next) {
+    runtime = GetNextRunTime(run, start);
+    while (runtime && runtime < stop) {
+      preview.push_back(scheduled_preview{runtime, sched, run});
+      runtime = GetNextRunTime(run, runtime + 60);
+    }
+  }
+}
 
-      if (run->level) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Level=%s", level_to_str(run->level));
-        PmStrcat(overview, temp.c_str());
-      }
+/**
+ * Format the overrides of a run of a schedule.
+ */
+static void show_run_overrides(RunResource* run, PoolMem& overview)
+{
+  int cnt = 0;
+  PoolMem temp(PM_NAME);
 
-      if (run->Priority) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Priority=%d", run->Priority);
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->level) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Level=%s", level_to_str(run->level));
+    PmStrcat(overview, temp.c_str());
+  }
 
-      if (run->spool_data_set) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Spool Data=%d", run->spool_data);
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->Priority) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Priority=%d", run->Priority);
+    PmStrcat(overview, temp.c_str());
+  }
 
-      if (run->accurate_set) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Accurate=%d", run->accurate);
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->spool_data_set) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Spool Data=%d", run->spool_data);
+    PmStrcat(overview, temp.c_str());
+  }
 
-      if (run->pool) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Pool=%s", run->pool->name());
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->accurate_set) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Accurate=%d", run->accurate);
+    PmStrcat(overview, temp.c_str());
+  }
 
-      if (run->storage) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Storage=%s", run->storage->name());
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->pool) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Pool=%s", run->pool->name());
+    PmStrcat(overview, temp.c_str());
+  }
 
-      if (run->msgs) {
-        if (cnt++ > 0) { PmStrcat(overview, " "); }
-        Mmsg(temp, "Messages=%s", run->msgs->name());
-        PmStrcat(overview, temp.c_str());
-      }
+  if (run->storage) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Storage=%s", run->storage->name());
+    PmStrcat(overview, temp.c_str());
+  }
 
-      PmStrcat(overview, "\n");
-    }
+  if (run->msgs) {
+    if (cnt++ > 0) { PmStrcat(overview, " "); }
+    Mmsg(temp, "Messages=%s", run->msgs->name());
+    PmStrcat(overview, temp.c_str());
   }
 
-  /*
-   * If we make it till here the length of the datefield is constant or didn't
-   * change.
-   */
-  return true;
+  PmStrcat(overview, "\n");
 }
 
 /**
@@ -544,18 +509,18 @@ static void DoSchedulerStatus(UaContext* ua)
   int max_date_len = 0;
   int days = DEFAULT_STATUS_SCHED_DAYS; /* Default days for preview */
   bool schedulegiven = false;
-  time_t time_to_check, now, start, stop;
+  time_t now, start, stop;
   char schedulename[MAX_NAME_LENGTH];
+  char dt[MAX_TIME_LENGTH];
   const int seconds_per_day = 86400; /* Number of seconds in one day */
-  const int seconds_per_hour = 3600; /* Number of seconds in one hour */
-  struct tm tm;
   ClientResource* client = NULL;
   JobResource* job = NULL;
   ScheduleResource* sched;
+  std::vector<scheduled_preview> preview;
   PoolMem overview(PM_MESSAGE);
+  PoolMem temp(PM_NAME);
 
   now = time(NULL); /* Initialize to now */
-  time_to_check = now;
 
   i = FindArgWithValue(ua, NT_("days"));
   if (i >= 0) {
@@ -649,65 +614,67 @@ static void DoSchedulerStatus(UaContext* ua)
     stop = now;
   }
 
-start_again:
-  time_to_check = start;
-  while (time_to_check < stop) {
-    Blocaltime(&time_to_check, &tm);
-
-    if (client || job) {
-      /*
-       * List specific schedule.
-       */
-      if (job) {
-        if (job->schedule) {
-          if (!show_scheduled_preview(ua, job->schedule, overview,
-                                      &max_date_len, tm, time_to_check)) {
-            goto start_again;
-          }
-        }
-      } else {
-        LockRes(my_config);
-        foreach_res (job, R_JOB) {
-          if (!ua->AclAccessOk(Job_ACL, job->hdr.name)) { continue; }
-
-          if (job->schedule && job->client == client) {
-            if (!show_scheduled_preview(ua, job->schedule, overview,
-                                        &max_date_len, tm, time_to_check)) {
-              job = NULL;
-              UnlockRes(my_config);
-              goto start_again;
-            }
-          }
-        }
-        UnlockRes(my_config);
-        job = NULL;
+  LockRes(my_config);
+  if (client || job) {
+    /*
+     * List specific schedule.
+     */
+    if (job) {
+      if (job->schedule) {
+        AddScheduledPreview(preview, job->schedule, start, stop);
       }
     } else {
-      /*
-       * List all schedules.
-       */
-      LockRes(my_config);
-      foreach_res (sched, R_SCHEDULE) {
-        if (!schedulegiven && !sched->enabled) { continue; }
+      std::set<ScheduleResource*> seen;
 
-        if (!ua->AclAccessOk(Schedule_ACL, sched->hdr.name)) { continue; }
+      foreach_res (job, R_JOB) {
+        if (!ua->AclAccessOk(Job_ACL, job->hdr.name)) { continue; }
 
-        if (schedulegiven) {
-          if (!bstrcmp(sched->hdr.name, schedulename)) { continue; }
+        if (job->schedule && job->client == client &&
+            seen.insert(job->schedule).second) {
+          AddScheduledPreview(preview, job->schedule, start, stop);
         }
+      }
+      job = NULL;
+    }
+  } else {
+    /*
+     * List all schedules.
+     */
+    foreach_res (sched, R_SCHEDULE) {
+      if (!schedulegiven && !sched->enabled) { continue; }
 
-        if (!show_scheduled_preview(ua, sched, overview, &max_date_len, tm,
-                                    time_to_check)) {
-          UnlockRes(my_config);
-          goto start_again;
-        }
+      if (!ua->AclAccessOk(Schedule_ACL, sched->hdr.name)) { continue; }
+
+      if (schedulegiven) {
+        if (!bstrcmp(sched->hdr.name, schedulename)) { continue; }
       }
-      UnlockRes(my_config);
+
+      AddScheduledPreview(preview, sched, start, stop);
     }
+  }
+
+  std::stable_sort(preview.begin(), preview.end(),
+                   [](const scheduled_preview& a, const scheduled_preview& b) {
+                     return a.runtime < b.runtime;
+                   });
 
-    time_to_check += seconds_per_hour; /* next hour */
+  /*
+   * As we use locale specific strings for weekday and month we
+   * need to know the longest date string used before formatting.
+   */
+  for (const scheduled_preview& entry : preview) {
+    bstrftime_wd(dt, sizeof(dt), entry.runtime);
+    if ((int)strlen(dt) > max_date_len) { max_date_len = strlen(dt); }
   }
 
+  for (const scheduled_preview& entry : preview) {
+    bstrftime_wd(dt, sizeof(dt), entry.runtime);
+    Mmsg(temp, "%-*s  %-22.22s  ", max_date_len, dt, entry.sched->hdr.name);
+    PmStrcat(overview, temp.c_str());
+    show_run_overrides(entry.run, overview);
+  }
+  UnlockRes(my_config);
+
   ua->SendMsg("====\n\n");
   ua->SendMsg("Scheduler Preview for %d days:\n\n", days);
   ua->SendMsg("%-*s  %-22s  %s\n", max_date_len, _("Date"), _("Schedule"),
@@ -739,6 +706,12 @@ static void DoDirectorStatus(UaContext* ua)
 
   ListConnectedClients(ua);
 
+  ListJobQueueWaitStatistics(ua);
+
+  ListCatalogLogStatistics(ua);
+
+  ListAttributeIngestStatistics(ua);
+
   ua->SendMsg("====\n");
 }
 
@@ -1264,6 +1237,88 @@ static void ListConnectedClients(UaContext* ua)
   ua->send->ArrayEnd("client-connection");
 }
 
+/**
+ * Show how long jobs had to wait in the job queue for each resource.
+ */
+static void ListJobQueueWaitStatistics(UaContext* ua)
+{
+  std::map<std::string, jobq_wait_stat_t> stats;
+  const char* separator = "====================";
+  char ed1[50], ed2[50], ed3[50];
+
+  JobqGetWaitStatistics(&job_queue, stats);
+
+  ua->send->Decoration("\n");
+  ua->send->Decoration("Job Queue Wait Statistics:\n");
+  if (stats.empty()) {
+    ua->send->Decoration("No Jobs had to wait for resources.\n");
+  } else {
+    ua->send->Decoration("%-40s%-10s%-10s%-20s%-20s%-20s\n", "Resource",
+                         "Waiting", "Waited", "Total", "Average", "Max");
+    ua->send->Decoration("%-20s%-20s%-20s%-20s%-20s%-20s\n", separator,
+                         separator, separator, separator, separator, separator);
+  }
+  ua->send->ArrayStart("job-queue-wait");
+  for (const auto& stat : stats) {
+    const jobq_wait_stat_t& ws = stat.second;
+    utime_t average = ws.jobs ? ws.total / ws.jobs : 0;
+
+    ua->send->ObjectStart();
+    ua->send->ObjectKeyValue("resource", stat.first.c_str(), "%-40s");
+    ua->send->ObjectKeyValue("waiting", ws.waiting, "%-10d");
+    ua->send->ObjectKeyValue("jobs", ws.jobs, "%-10d");
+    ua->send->ObjectKeyValue("total", edit_utime(ws.total, ed1, sizeof(ed1)),
+                             "%-20s");
+    ua->send->ObjectKeyValue("average", edit_utime(average, ed2, sizeof(ed2)),
+                             "%-20s");
+    ua->send->ObjectKeyValue("max", edit_utime(ws.max, ed3, sizeof(ed3)),
+                             "%-20s");
+    ua->send->ObjectEnd();
+    ua->send->Decoration("\n");
+  }
+  ua->send->ArrayEnd("job-queue-wait");
+}
+
+/**
+ * Show what the background writer of the catalog Log table did.
+ */
+static void ListCatalogLogStatistics(UaContext* ua)
+{
+  catalog_log_stats_t stats;
+
+  if (!GetCatalogLogStatistics(stats)) { return; }
+
+  ua->send->Decoration("\n");
+  ua->send->Decoration("Catalog Log Writer:\n");
+  ua->send->ObjectStart("catalog-log");
+  ua->send->ObjectKeyValue("queued", stats.queued, " Queued=%llu");
+  ua->send->ObjectKeyValue("written", stats.written, " Written=%llu");
+  ua->send->ObjectKeyValue("inserts", stats.batches, " Inserts=%llu");
+  ua->send->ObjectKeyValue("dropped", stats.dropped, " Dropped=%llu");
+  ua->send->ObjectKeyValue("failed", stats.failed, " Failed=%llu\n");
+  ua->send->ObjectEnd("catalog-log");
+}
+
+/**
+ * Show what the attribute ingest workers did.
+ */
+static void ListAttributeIngestStatistics(UaContext* ua)
+{
+  attribute_ingest_stats_t stats;
+
+  if (!GetAttributeIngestStatistics(stats)) { return; }
+
+  ua->send->Decoration("\n");
+  ua->send->Decoration("Attribute Ingest:\n");
+  ua->send->ObjectStart("attribute-ingest");
+  ua->send->ObjectKeyValue("workers", stats.workers, " Workers=%llu");
+  ua->send->ObjectKeyValue("jobs", stats.jobs, " Jobs=%llu");
+  ua->send->ObjectKeyValue("queued", stats.queued, " QueuedBytes=%llu");
+  ua->send->ObjectKeyValue("messages", stats.messages, " Processed=%llu");
+  ua->send->ObjectKeyValue("stalls", stats.stalls, " Stalls=%llu\n");
+  ua->send->ObjectEnd("attribute-ingest");
+}
+
 static void ContentSendInfoApi(UaContext* ua,
                                char type,
                                int Slot,
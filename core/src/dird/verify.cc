@@ -49,8 +49,15 @@
 #include "lib/bnet.h"
 #include "lib/edit.h"
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace directordaemon {
 
+/* Files compared to the catalog in one query */
+static const size_t verify_batch_size = 10000;
+
 /* Commands sent to File daemon */
 static char verifycmd[] = "verify level=%s\n";
 static char storaddrcmd[] =
@@ -597,6 +604,279 @@ void VerifyCleanup(JobControlRecord* jcr, int TermCode)
   Dmsg0(100, "Leave VerifyCleanup()\n");
 }
 
+/**
+ * A file received from the File daemon during Verify and the catalog
+ * record it is compared to.
+ */
+struct verify_file_record {
+  int32_t FileIndex = 0;
+  std::string fname;
+  std::string opts;    /* Verify Opts */
+  std::string attr;    /* encoded stat packet from the File daemon */
+  int digest_stream = 0;
+  std::string digest;  /* digest from the File daemon */
+  bool found = false;  /* catalog record found */
+  FileId_t FileId = 0;
+  std::string LStat;   /* catalog stat packet */
+  std::string Digest;  /* catalog digest */
+};
+
+/**
+ * Files received since the last comparison to the catalog.
+ */
+struct verify_batch {
+  std::vector<verify_file_record> files;
+  std::unordered_map<int32_t, size_t> index; /* FileIndex to files position */
+};
+
+/**
+ * Called for each catalog record of a file in the batch table, the first
+ * record of a file is the one to compare to.
+ */
+static int VerifyBatchHandler(void* ctx, int num_fields, char** row)
+{
+  verify_batch* batch = (verify_batch*)ctx;
+  int32_t FileIndex = str_to_int64(row[0]);
+
+  auto it = batch->index.find(FileIndex);
+  if (it == batch->index.end()) { return 0; }
+
+  verify_file_record& rec = batch->files[it->second];
+  if (rec.found) { return 0; }
+
+  rec.found = true;
+  rec.FileId = str_to_int64(row[1]);
+  rec.LStat = row[2] ? row[2] : "";
+  rec.Digest = row[3] ? row[3] : "";
+
+  return 0;
+}
+
+/**
+ * Look up the catalog records of the files in the batch one by one, used
+ * when the catalog has no batch insert.
+ */
+static void GetVerifyFileRecords(JobControlRecord* jcr,
+                                 verify_batch* batch,
+                                 JobId_t JobId)
+{
+  FileDbRecord fdbr;
+
+  for (verify_file_record& rec : batch->files) {
+    memset(&fdbr, 0, sizeof(fdbr));
+    fdbr.JobId = JobId;
+    jcr->previous_jr.FileIndex = rec.FileIndex;
+    PmStrcpy(jcr->fname, rec.fname.c_str());
+    if (jcr->db->GetFileAttributesRecord(jcr, jcr->fname, &jcr->previous_jr,
+                                         &fdbr)) {
+      rec.found = true;
+      rec.FileId = fdbr.FileId;
+      rec.LStat = fdbr.LStat;
+      rec.Digest = fdbr.Digest;
+    }
+  }
+}
+
+/**
+ * Compare the fields selected by the Verify Opts of a file to its catalog
+ * record and report the differences.
+ */
+static void CompareVerifyFileRecord(JobControlRecord* jcr,
+                                    verify_file_record& rec)
+{
+  struct stat statf; /* file stat */
+  struct stat statc; /* catalog stat */
+  int32_t LinkFIf, LinkFIc;
+  bool do_Digest = false;
+  PoolMem buf(PM_MESSAGE);
+
+  Dmsg3(400, "Found %s in catalog. inx=%d Opts=%s\n", rec.fname.c_str(),
+        rec.FileIndex, rec.opts.c_str());
+  DecodeStat((char*)rec.attr.c_str(), &statf, sizeof(statf),
+             &LinkFIf); /* decode file stat packet */
+  DecodeStat((char*)rec.LStat.c_str(), &statc, sizeof(statc),
+             &LinkFIc); /* decode catalog stat */
+  /*
+   * Loop over options supplied by user and verify the
+   * fields he requests.
+   */
+  for (const char* p = rec.opts.c_str(); *p; p++) {
+    char ed1[30], ed2[30];
+    switch (*p) {
+      case 'i': /* compare INODEs */
+        if (statc.st_ino != statf.st_ino) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_ino   differ. Cat: %s File: %s\n"),
+               edit_uint64((uint64_t)statc.st_ino, ed1),
+               edit_uint64((uint64_t)statf.st_ino, ed2));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'p': /* permissions bits */
+        if (statc.st_mode != statf.st_mode) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_mode  differ. Cat: %x File: %x\n"),
+               (uint32_t)statc.st_mode, (uint32_t)statf.st_mode);
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'n': /* number of links */
+        if (statc.st_nlink != statf.st_nlink) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_nlink differ. Cat: %d File: %d\n"),
+               (uint32_t)statc.st_nlink, (uint32_t)statf.st_nlink);
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'u': /* user id */
+        if (statc.st_uid != statf.st_uid) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_uid   differ. Cat: %u File: %u\n"),
+               (uint32_t)statc.st_uid, (uint32_t)statf.st_uid);
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'g': /* group id */
+        if (statc.st_gid != statf.st_gid) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_gid   differ. Cat: %u File: %u\n"),
+               (uint32_t)statc.st_gid, (uint32_t)statf.st_gid);
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 's': /* size */
+        if (statc.st_size != statf.st_size) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_size  differ. Cat: %s File: %s\n"),
+               edit_uint64((uint64_t)statc.st_size, ed1),
+               edit_uint64((uint64_t)statf.st_size, ed2));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'a': /* access time */
+        if (statc.st_atime != statf.st_atime) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_atime differs\n"));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'm':
+        if (statc.st_mtime != statf.st_mtime) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_mtime differs\n"));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'c': /* ctime */
+        if (statc.st_ctime != statf.st_ctime) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_ctime differs\n"));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case 'd': /* file size decrease */
+        if (statc.st_size > statf.st_size) {
+          PrtFname(jcr);
+          Jmsg(jcr, M_INFO, 0, _("      st_size  decrease. Cat: %s File: %s\n"),
+               edit_uint64((uint64_t)statc.st_size, ed1),
+               edit_uint64((uint64_t)statf.st_size, ed2));
+          jcr->setJobStatus(JS_Differences);
+        }
+        break;
+      case '5': /* compare MD5 */
+        Dmsg1(500, "set Do_MD5 for %s\n", jcr->fname);
+        do_Digest = true;
+        break;
+      case '1': /* compare SHA1 */
+        do_Digest = true;
+        break;
+      case ':':
+      case 'V':
+      default:
+        break;
+    }
+  }
+
+  /*
+   * Compare the digest when the user requested it and the File daemon or
+   * the Storage daemon sent one.
+   */
+  if (do_Digest && !rec.digest.empty()) {
+    jcr->db->EscapeString(jcr, buf.c_str(), (char*)rec.digest.c_str(),
+                          rec.digest.size());
+    if (!bstrcmp(buf.c_str(), rec.Digest.c_str())) {
+      PrtFname(jcr);
+      Jmsg(jcr, M_INFO, 0, _("      %s differs. File=%s Cat=%s\n"),
+           stream_to_ascii(rec.digest_stream), buf.c_str(), rec.Digest.c_str());
+      jcr->setJobStatus(JS_Differences);
+    }
+  }
+}
+
+/**
+ * Compare the files of the batch to the catalog and report the differences
+ * per file in FileIndex order. The catalog records found are marked.
+ *
+ * With batch insert the files are compared in one query against the batch
+ * table, otherwise every file is looked up on its own.
+ */
+static bool CompareVerifyBatch(JobControlRecord* jcr,
+                               verify_batch* batch,
+                               JobId_t JobId)
+{
+  PoolMem FileIds(PM_MESSAGE);
+  int FileIds_len = 0;
+  char ed1[50];
+
+  if (batch->files.empty()) { return true; }
+
+  Dmsg1(100, "Compare %d files to the catalog\n", (int)batch->files.size());
+  if (jcr->db->BatchInsertAvailable()) {
+    if (!jcr->db->GetVerifyBatchFileRecords(jcr, &jcr->previous_jr,
+                                            VerifyBatchHandler, batch)) {
+      Jmsg(jcr, M_FATAL, 0, _("Could not compare files to catalog: ERR=%s\n"),
+           jcr->db->strerror());
+      return false;
+    }
+  } else {
+    GetVerifyFileRecords(jcr, batch, JobId);
+  }
+
+  for (verify_file_record& rec : batch->files) {
+    if (JobCanceled(jcr)) { return false; }
+
+    jcr->fn_printed = false;
+    PmStrcpy(jcr->fname, rec.fname.c_str());
+    if (!rec.found) {
+      Jmsg(jcr, M_INFO, 0, _("New file: %s\n"), jcr->fname);
+      Dmsg1(020, _("File not in catalog: %s\n"), jcr->fname);
+      jcr->setJobStatus(JS_Differences);
+      continue;
+    }
+
+    /*
+     * mark file record as visited by stuffing the
+     * current JobId, which is unique, into the MarkId field.
+     * Append at the running length, the list gets long for big batches.
+     */
+    FileIds.check_size(FileIds_len + sizeof(ed1) + 1);
+    FileIds_len += Bsnprintf(FileIds.c_str() + FileIds_len, sizeof(ed1) + 1,
+                             FileIds_len ? ",%s" : "%s",
+                             edit_uint64(rec.FileId, ed1));
+
+    CompareVerifyFileRecord(jcr, rec);
+  }
+
+  if (FileIds_len) {
+    jcr->db->MarkFileRecords(jcr, FileIds.c_str(), jcr->JobId);
+  }
+
+  batch->files.clear();
+  batch->index.clear();
+
+  return true;
+}
+
 /**
  * This routine is called only during a Verify
  */
@@ -604,17 +884,13 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
 {
   BareosSocket* fd;
   int n, len;
-  FileDbRecord fdbr;
-  struct stat statf; /* file stat */
-  struct stat statc; /* catalog stat */
   PoolMem buf(PM_MESSAGE);
   POOLMEM* fname = GetPoolMemory(PM_FNAME);
-  int do_Digest = CRYPTO_DIGEST_NONE;
   int32_t file_index = 0;
+  verify_batch batch;
+  AttributesDbRecord ar;
 
-  memset(&fdbr, 0, sizeof(fdbr));
   fd = jcr->file_bsock;
-  fdbr.JobId = JobId;
   jcr->FileIndex = 0;
 
   Dmsg0(20, "dir: waiting to receive file attributes\n");
@@ -627,6 +903,8 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
    *   Filename
    *   Attributes
    *   Link name  ???
+   *
+   * The files are compared to the catalog in batches of verify_batch_size.
    */
   while ((n = BgetDirmsg(fd)) >= 0 && !JobCanceled(jcr)) {
     int stream;
@@ -635,7 +913,6 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
 
     if (JobCanceled(jcr)) { goto bail_out; }
     fname = CheckPoolMemorySize(fname, fd->message_length);
-    jcr->fname = CheckPoolMemorySize(jcr->fname, fd->message_length);
     Dmsg1(200, "Atts+Digest=%s\n", fd->msg);
     if ((len = sscanf(fd->msg, "%ld %d %100s", &file_index, &stream, fname)) !=
         3) {
@@ -667,154 +944,51 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
      */
     switch (stream) {
       case STREAM_UNIX_ATTRIBUTES:
-      case STREAM_UNIX_ATTRIBUTES_EX:
-        int32_t LinkFIf, LinkFIc;
+      case STREAM_UNIX_ATTRIBUTES_EX: {
         Dmsg2(400, "file_index=%d attr=%s\n", file_index, attr);
         jcr->JobFiles++;
         jcr->FileIndex = file_index; /* remember attribute file_index */
-        jcr->previous_jr.FileIndex = file_index;
-        DecodeStat(attr, &statf, sizeof(statf),
-                   &LinkFIf); /* decode file stat packet */
-        do_Digest = CRYPTO_DIGEST_NONE;
-        jcr->fn_printed = false;
-        PmStrcpy(jcr->fname, fname); /* move filename into JobControlRecord */
-
-        Dmsg2(040, "dird<filed: stream=%d %s\n", stream, jcr->fname);
+
+        Dmsg2(040, "dird<filed: stream=%d %s\n", stream, fname);
         Dmsg1(020, "dird<filed: attr=%s\n", attr);
 
         /*
-         * Find equivalent record in the database
+         * Compare the full batch before adding the file, its digest is
+         * still to come.
          */
-        fdbr.FileId = 0;
-        if (!jcr->db->GetFileAttributesRecord(jcr, jcr->fname,
-                                              &jcr->previous_jr, &fdbr)) {
-          Jmsg(jcr, M_INFO, 0, _("New file: %s\n"), jcr->fname);
-          Dmsg1(020, _("File not in catalog: %s\n"), jcr->fname);
-          jcr->setJobStatus(JS_Differences);
-          continue;
-        } else {
-          /*
-           * mark file record as visited by stuffing the
-           * current JobId, which is unique, into the MarkId field.
-           */
-          jcr->db->MarkFileRecord(jcr, fdbr.FileId, jcr->JobId);
+        if (batch.files.size() >= verify_batch_size &&
+            !CompareVerifyBatch(jcr, &batch, JobId)) {
+          goto bail_out;
         }
 
-        Dmsg3(400, "Found %s in catalog. inx=%d Opts=%s\n", jcr->fname,
-              file_index, Opts_Digest.c_str());
-        DecodeStat(fdbr.LStat, &statc, sizeof(statc),
-                   &LinkFIc); /* decode catalog stat */
+        batch.index[file_index] = batch.files.size();
+        batch.files.emplace_back();
+        verify_file_record& rec = batch.files.back();
+        rec.FileIndex = file_index;
+        rec.fname = fname;
+        rec.opts = Opts_Digest.c_str();
+        rec.attr = attr;
+
         /*
-         * Loop over options supplied by user and verify the
-         * fields he requests.
+         * Add the file to the batch table that is compared to the catalog
          */
-        for (p = Opts_Digest.c_str(); *p; p++) {
-          char ed1[30], ed2[30];
-          switch (*p) {
-            case 'i': /* compare INODEs */
-              if (statc.st_ino != statf.st_ino) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_ino   differ. Cat: %s File: %s\n"),
-                     edit_uint64((uint64_t)statc.st_ino, ed1),
-                     edit_uint64((uint64_t)statf.st_ino, ed2));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'p': /* permissions bits */
-              if (statc.st_mode != statf.st_mode) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_mode  differ. Cat: %x File: %x\n"),
-                     (uint32_t)statc.st_mode, (uint32_t)statf.st_mode);
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'n': /* number of links */
-              if (statc.st_nlink != statf.st_nlink) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_nlink differ. Cat: %d File: %d\n"),
-                     (uint32_t)statc.st_nlink, (uint32_t)statf.st_nlink);
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'u': /* user id */
-              if (statc.st_uid != statf.st_uid) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_uid   differ. Cat: %u File: %u\n"),
-                     (uint32_t)statc.st_uid, (uint32_t)statf.st_uid);
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'g': /* group id */
-              if (statc.st_gid != statf.st_gid) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_gid   differ. Cat: %u File: %u\n"),
-                     (uint32_t)statc.st_gid, (uint32_t)statf.st_gid);
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 's': /* size */
-              if (statc.st_size != statf.st_size) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_size  differ. Cat: %s File: %s\n"),
-                     edit_uint64((uint64_t)statc.st_size, ed1),
-                     edit_uint64((uint64_t)statf.st_size, ed2));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'a': /* access time */
-              if (statc.st_atime != statf.st_atime) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0, _("      st_atime differs\n"));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'm':
-              if (statc.st_mtime != statf.st_mtime) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0, _("      st_mtime differs\n"));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'c': /* ctime */
-              if (statc.st_ctime != statf.st_ctime) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0, _("      st_ctime differs\n"));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case 'd': /* file size decrease */
-              if (statc.st_size > statf.st_size) {
-                PrtFname(jcr);
-                Jmsg(jcr, M_INFO, 0,
-                     _("      st_size  decrease. Cat: %s File: %s\n"),
-                     edit_uint64((uint64_t)statc.st_size, ed1),
-                     edit_uint64((uint64_t)statf.st_size, ed2));
-                jcr->setJobStatus(JS_Differences);
-              }
-              break;
-            case '5': /* compare MD5 */
-              Dmsg1(500, "set Do_MD5 for %s\n", jcr->fname);
-              do_Digest = CRYPTO_DIGEST_MD5;
-              break;
-            case '1': /* compare SHA1 */
-              do_Digest = CRYPTO_DIGEST_SHA1;
-              break;
-            case ':':
-            case 'V':
-            default:
-              break;
+        if (jcr->db->BatchInsertAvailable()) {
+          memset(&ar, 0, sizeof(ar));
+          ar.fname = fname;
+          ar.attr = attr;
+          ar.FileIndex = file_index;
+          ar.JobId = jcr->JobId;
+          if (!jcr->db->CreateVerifyBatchRecord(jcr, &ar)) {
+            Jmsg1(jcr, M_FATAL, 0, _("Batch insert failed. ERR=%s\n"),
+                  jcr->db->strerror());
+            goto bail_out;
           }
         }
         break;
+      }
 
       case STREAM_RESTORE_OBJECT:
-        Dmsg1(400, "RESTORE_OBJECT %s\n", jcr->fname);
+        Dmsg1(400, "RESTORE_OBJECT %s\n", fname);
         break;
 
       default:
@@ -829,23 +1003,14 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
            * When ever we get a digest it MUST have been
            * preceded by an attributes record, which sets attr_file_index
            */
-          if (jcr->FileIndex != (uint32_t)file_index) {
+          if (jcr->FileIndex != (uint32_t)file_index || batch.files.empty()) {
             Jmsg2(jcr, M_FATAL, 0,
                   _("MD5/SHA1 index %d not same as attributes %d\n"),
                   file_index, jcr->FileIndex);
             goto bail_out;
           }
-          if (do_Digest != CRYPTO_DIGEST_NONE) {
-            jcr->db->EscapeString(jcr, buf.c_str(), Opts_Digest.c_str(),
-                                  strlen(Opts_Digest.c_str()));
-            if (!bstrcmp(buf.c_str(), fdbr.Digest)) {
-              PrtFname(jcr);
-              Jmsg(jcr, M_INFO, 0, _("      %s differs. File=%s Cat=%s\n"),
-                   stream_to_ascii(stream), buf.c_str(), fdbr.Digest);
-              jcr->setJobStatus(JS_Differences);
-            }
-            do_Digest = CRYPTO_DIGEST_NONE;
-          }
+          batch.files.back().digest_stream = stream;
+          batch.files.back().digest = Opts_Digest.c_str();
         }
         break;
     }
@@ -860,6 +1025,8 @@ void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId)
     goto bail_out;
   }
 
+  if (!CompareVerifyBatch(jcr, &batch, JobId)) { goto bail_out; }
+
   /* Now find all the files that are missing -- i.e. all files in
    *  the database where the MarkId != current JobId
    */
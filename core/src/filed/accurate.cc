@@ -155,6 +155,7 @@ bool AccurateCheckFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
 
   ff_pkt->delta_seq = 0;
   ff_pkt->accurate_found = false;
+  ff_pkt->accurate_pruned = false;
 
   if (!jcr->accurate && !jcr->rerunning) { return true; }
 
@@ -291,7 +292,8 @@ bool AccurateCheckFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
              (BitIsSet(FO_MD5, ff_pkt->flags) ||
               BitIsSet(FO_SHA1, ff_pkt->flags) ||
               BitIsSet(FO_SHA256, ff_pkt->flags) ||
-              BitIsSet(FO_SHA512, ff_pkt->flags)))) {
+              BitIsSet(FO_SHA512, ff_pkt->flags) ||
+              BitIsSet(FO_XXH64, ff_pkt->flags)))) {
           if (!*payload->chksum && !jcr->rerunning) {
             Jmsg(jcr, M_WARNING, 0, _("Cannot verify checksum for %s\n"),
                  ff_pkt->fname);
@@ -311,6 +313,24 @@ bool AccurateCheckFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
     }
   }
 
+  /**
+   * When pruning directories an unchanged directory stands for its whole
+   * tree. This only holds on filesystems with recursive change times, that
+   * update the times of a directory for every change below it. Elsewhere a
+   * changed file in the tree is missed, so it must be enabled explicitly.
+   */
+  if (!status && jcr->file_list->PruneDirectories() &&
+      S_ISDIR(ff_pkt->statp.st_mode) && jcr->getJobLevel() != L_FULL &&
+      statc.st_mtime == ff_pkt->statp.st_mtime &&
+      statc.st_ctime == ff_pkt->statp.st_ctime) {
+    StripPath(ff_pkt);
+    if (jcr->file_list->MarkDirectoryTreeAsSeen(ff_pkt->link, payload)) {
+      Dmsg1(debuglevel, "accurate %s (tree unchanged)\n", ff_pkt->link);
+      ff_pkt->accurate_pruned = true;
+    }
+    UnstripPath(ff_pkt);
+  }
+
   /**
    * In Incr/Diff accurate mode, we mark all files as seen
    * When in Full+Base mode, we mark only if the file match exactly
@@ -334,6 +354,7 @@ bail_out:
 bool AccurateCmd(JobControlRecord* jcr)
 {
   uint32_t number_of_previous_files;
+  int prune_directories = 0;
   int fname_length, lstat_length, chksum_length;
   char *fname, *lstat, *chksum;
   uint16_t delta_seq;
@@ -341,7 +362,9 @@ bool AccurateCmd(JobControlRecord* jcr)
 
   if (JobCanceled(jcr)) { return true; }
 
-  if (sscanf(dir->msg, "accurate files=%u", &number_of_previous_files) != 1) {
+  if (sscanf(dir->msg, "accurate files=%u prunedirs=%d",
+             &number_of_previous_files, &prune_directories) != 2 &&
+      sscanf(dir->msg, "accurate files=%u", &number_of_previous_files) != 1) {
     dir->fsend(_("2991 Bad accurate command\n"));
     return false;
   }
@@ -362,6 +385,8 @@ bool AccurateCmd(JobControlRecord* jcr)
 
   if (!jcr->file_list->init()) { return false; }
 
+  jcr->file_list->SetPruneDirectories(prune_directories != 0);
+
   jcr->accurate = true;
 
   /**
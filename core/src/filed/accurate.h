@@ -43,6 +43,10 @@
 
 #include "include/hostconfig.h"
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #ifdef HAVE_HPUX_OS
 #pragma pack(push, 4)
 #endif
@@ -66,6 +70,7 @@ class BareosAccurateFilelist : public SmartAlloc {
   char* seen_bitmap_;
   JobControlRecord* jcr_;
   uint32_t number_of_previous_files_;
+  bool prune_directories_; /* Skip the trees of unchanged directories */
 
  public:
   /* methods */
@@ -75,6 +80,7 @@ class BareosAccurateFilelist : public SmartAlloc {
     seen_bitmap_ = NULL;
     number_of_previous_files_ = 0;
     jcr_ = NULL;
+    prune_directories_ = false;
   }
 
   virtual ~BareosAccurateFilelist() {}
@@ -92,6 +98,10 @@ class BareosAccurateFilelist : public SmartAlloc {
   virtual bool UpdatePayload(char* fname, accurate_payload* payload) = 0;
   virtual bool SendBaseFileList() = 0;
   virtual bool SendDeletedList() = 0;
+  virtual bool MarkDirectoryTreeAsSeen(char* dirname,
+                                       accurate_payload* payload) = 0;
+  void SetPruneDirectories(bool prune) { prune_directories_ = prune; }
+  bool PruneDirectories() const { return prune_directories_; }
   void MarkFileAsSeen(accurate_payload* payload)
   {
     SetBit(payload->filenr, seen_bitmap_);
@@ -124,7 +134,9 @@ struct CurFile {
 class BareosAccurateFilelistHtable : public BareosAccurateFilelist {
  protected:
   htable* file_list_;
+  std::unordered_map<int64_t, int64_t> last_filenr_in_tree_;
   void destroy();
+  void NumberFilesByTree();
 
  public:
   /* methods */
@@ -146,6 +158,8 @@ class BareosAccurateFilelistHtable : public BareosAccurateFilelist {
   bool UpdatePayload(char* fname, accurate_payload* payload) override;
   bool SendBaseFileList() override;
   bool SendDeletedList() override;
+  bool MarkDirectoryTreeAsSeen(char* dirname,
+                               accurate_payload* payload) override;
 };
 
 #ifdef HAVE_LMDB
@@ -155,18 +169,60 @@ class BareosAccurateFilelistHtable : public BareosAccurateFilelist {
 /*
  * Lightning Memory DataBase (LMDB) specific storage abstraction class using the
  * Symas LMDB.
+ *
+ * Files are keyed by the id of their directory and their name, the directory
+ * paths are stored only once in a separate database. Files are loaded in
+ * sorted chunks so most of them can be appended to the database and the
+ * lookups of a backup are served from the entries of the current directory.
  */
 class BareosAccurateFilelistLmdb : public BareosAccurateFilelist {
  protected:
+  /*
+   * A file added to the chunk in chunk_data_ but not yet to the database.
+   */
+  struct PendingFile {
+    size_t offset;        /* Start of the key in chunk_data_ */
+    uint32_t key_length;  /* Key bytes, directly followed by the payload */
+    uint32_t data_length; /* Payload bytes */
+  };
+
+  /*
+   * The entries of a directory cached for the lookups of a backup.
+   */
+  struct CachedDirectory {
+    std::string dir; /* Directory path including the trailing slash */
+    uint32_t dir_id; /* 0 when the directory is not in the list */
+    bool complete;   /* All entries of the directory are cached */
+    std::unordered_map<std::string, std::string> entries;
+  };
+
   int pay_load_length_;
   POOLMEM* pay_load_;
   POOLMEM* lmdb_name_;
   MDB_env* db_env_;
-  MDB_dbi db_dbi_;
+  MDB_dbi db_dbi_;           /* directory id + name -> payload */
+  MDB_dbi db_dirs_dbi_;      /* directory path -> directory id */
+  MDB_dbi db_dir_names_dbi_; /* directory id -> directory path */
   MDB_txn* db_rw_txn_;
   MDB_txn* db_ro_txn_;
 
+  uint32_t next_dir_id_;
+  std::string load_dir_; /* Directory of the last file added */
+  uint32_t load_dir_id_;
+  std::vector<char> chunk_data_;
+  std::vector<PendingFile> chunk_;
+  std::string last_key_; /* Highest key in the database */
+
+  std::vector<CachedDirectory> cached_dirs_; /* Current dir and ancestors */
+  size_t cached_entry_count_;
+
   void destroy();
+  int PutRecord(MDB_dbi dbi, MDB_val* key, MDB_val* data, unsigned int flags);
+  uint32_t GetDirId(MDB_txn* txn, const std::string& dir);
+  uint32_t AddDir(const std::string& dir);
+  bool FlushChunk();
+  bool CacheDirectory(const std::string& dir);
+  CachedDirectory* FindCachedDirectory(const std::string& dir);
 
  public:
   /* methods */
@@ -186,6 +242,8 @@ class BareosAccurateFilelistLmdb : public BareosAccurateFilelist {
   bool UpdatePayload(char* fname, accurate_payload* payload) override;
   bool SendBaseFileList() override;
   bool SendDeletedList() override;
+  bool MarkDirectoryTreeAsSeen(char* dirname,
+                               accurate_payload* payload) override;
 };
 #endif /* HAVE_LMDB */
 
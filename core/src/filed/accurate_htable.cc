@@ -33,6 +33,9 @@
 #include "accurate.h"
 #include "lib/attribs.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace filedaemon {
 
 static int debuglevel = 100;
@@ -96,9 +99,72 @@ bool BareosAccurateFilelistHtable::AddFile(char* fname,
 
 bool BareosAccurateFilelistHtable::EndLoad()
 {
-  /*
-   * Nothing to do.
-   */
+  if (prune_directories_) { NumberFilesByTree(); }
+
+  return true;
+}
+
+/*
+ * Renumber the files in the order of their names. All files below a
+ * directory then have adjacent numbers following the number of the
+ * directory and the whole tree can be marked as seen at once.
+ */
+void BareosAccurateFilelistHtable::NumberFilesByTree()
+{
+  CurFile* elt;
+  std::vector<CurFile*> files;
+  std::vector<CurFile*> open_dirs;
+
+  files.reserve(filenr_);
+  foreach_htable (elt, file_list_) {
+    files.push_back(elt);
+  }
+
+  std::sort(files.begin(), files.end(), [](CurFile* a, CurFile* b) {
+    return strcmp(a->fname, b->fname) < 0;
+  });
+
+  last_filenr_in_tree_.clear();
+  for (size_t i = 0; i < files.size(); i++) {
+    elt = files[i];
+    elt->payload.filenr = i;
+
+    /*
+     * Close the trees of the directories this file is not part of.
+     */
+    while (!open_dirs.empty() &&
+           !bstrncmp(elt->fname, open_dirs.back()->fname,
+                     strlen(open_dirs.back()->fname))) {
+      last_filenr_in_tree_[open_dirs.back()->payload.filenr] = i - 1;
+      open_dirs.pop_back();
+    }
+
+    if (*elt->fname && IsPathSeparator(elt->fname[strlen(elt->fname) - 1])) {
+      open_dirs.push_back(elt);
+    }
+  }
+
+  while (!open_dirs.empty()) {
+    last_filenr_in_tree_[open_dirs.back()->payload.filenr] = files.size() - 1;
+    open_dirs.pop_back();
+  }
+
+  Dmsg2(debuglevel, "numbered %d files in %d directory trees\n",
+        (int)files.size(), (int)last_filenr_in_tree_.size());
+}
+
+bool BareosAccurateFilelistHtable::MarkDirectoryTreeAsSeen(
+    char* dirname,
+    accurate_payload* payload)
+{
+  auto tree = last_filenr_in_tree_.find(payload->filenr);
+
+  if (tree == last_filenr_in_tree_.end()) { return false; }
+
+  SetBits(payload->filenr, tree->second, seen_bitmap_);
+  Dmsg3(debuglevel, "marked tree <%s> files %lld-%lld as seen\n", dirname,
+        (long long)payload->filenr, (long long)tree->second);
+
   return true;
 }
 
@@ -30,6 +30,8 @@
 #include "filed/filed.h"
 #include "filed/filed_globals.h"
 
+#include <algorithm>
+
 #ifdef HAVE_LMDB
 #include "accurate.h"
 #endif
@@ -42,10 +44,114 @@ static int debuglevel = 100;
 #define AVG_NR_BYTES_PER_ENTRY 256
 #define B_PAGE_SIZE 4096
 
+/*
+ * Files are collected in a chunk of this size (or number of entries) and
+ * sorted before they are put into the database.
+ */
+#define MAX_CHUNK_SIZE (32 * 1024 * 1024)
+#define MAX_CHUNK_ENTRIES (1024 * 1024)
+
+/*
+ * Maximum number of entries of a single directory cached for lookups.
+ */
+#define MAX_CACHED_ENTRIES 100000
+#define MAX_CACHED_DIRS 64
+
+#define DIR_ID_LENGTH sizeof(uint32_t)
+
+/*
+ * Split a filename into the directory part (including the trailing slash)
+ * and the name within that directory.
+ */
+static inline void SplitFilename(const char* fname,
+                                 int fname_length,
+                                 std::string& dir,
+                                 const char** name,
+                                 int* name_length)
+{
+  const char* p = fname + fname_length;
+
+  while (p > fname && *(p - 1) != '/') { p--; }
+
+  if (p > fname) {
+    dir.assign(fname, p - fname);
+    *name = p;
+  } else {
+    dir.clear();
+    *name = fname;
+  }
+  *name_length = fname_length - (*name - fname);
+}
+
+static inline void EncodeDirId(uint32_t dir_id, char* buf)
+{
+  buf[0] = (dir_id >> 24) & 0xff;
+  buf[1] = (dir_id >> 16) & 0xff;
+  buf[2] = (dir_id >> 8) & 0xff;
+  buf[3] = dir_id & 0xff;
+}
+
+static inline uint32_t DecodeDirId(const void* data)
+{
+  const unsigned char* buf = (const unsigned char*)data;
+
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+         ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
+
+/*
+ * Compare two keys the same way as the default LMDB key compare does.
+ */
+static inline int CompareKeys(const char* key1,
+                              size_t length1,
+                              const char* key2,
+                              size_t length2)
+{
+  int result;
+
+  result = memcmp(key1, key2, MIN(length1, length2));
+  if (result) { return result; }
+
+  return (length1 < length2) ? -1 : (length1 > length2);
+}
+
+/*
+ * Build the payload as stored in the database:
+ *
+ * accurate_payload structure\0lstat\0chksum\0
+ *
+ * The buffer is not necessarily aligned for the structure as payloads
+ * follow their keys in the chunk.
+ */
+static inline void BuildPayload(char* buf,
+                                const char* lstat,
+                                int lstat_length,
+                                const char* chksum,
+                                int chksum_length,
+                                int32_t delta_seq,
+                                int64_t filenr)
+{
+  accurate_payload payload;
+
+  payload.lstat = buf + sizeof(accurate_payload);
+  memcpy(payload.lstat, lstat, lstat_length);
+  payload.lstat[lstat_length] = '\0';
+
+  payload.chksum = payload.lstat + lstat_length + 1;
+  if (chksum_length) { memcpy(payload.chksum, chksum, chksum_length); }
+  payload.chksum[chksum_length] = '\0';
+
+  payload.delta_seq = delta_seq;
+  payload.filenr = filenr;
+  memcpy(buf, &payload, sizeof(accurate_payload));
+}
+
 BareosAccurateFilelistLmdb::BareosAccurateFilelistLmdb(JobControlRecord* jcr,
                                                        uint32_t number_of_files)
 {
+  jcr_ = jcr;
   filenr_ = 0;
+  number_of_previous_files_ = number_of_files;
   pay_load_ = GetPoolMemory(PM_MESSAGE);
   lmdb_name_ = GetPoolMemory(PM_FNAME);
   seen_bitmap_ = (char*)malloc(NbytesForBits(number_of_previous_files_));
@@ -54,13 +160,17 @@ BareosAccurateFilelistLmdb::BareosAccurateFilelistLmdb(JobControlRecord* jcr,
   db_ro_txn_ = NULL;
   db_rw_txn_ = NULL;
   db_dbi_ = 0;
-  number_of_previous_files_ = number_of_files;
+  db_dirs_dbi_ = 0;
+  db_dir_names_dbi_ = 0;
+  next_dir_id_ = 1;
+  load_dir_id_ = 0;
+  cached_entry_count_ = 0;
 }
 
 bool BareosAccurateFilelistLmdb::init()
 {
   int result;
-  MDB_env* env;
+  MDB_env* env = NULL;
   size_t mapsize = 10485760;
 
   if (!db_env_) {
@@ -102,6 +212,17 @@ bool BareosAccurateFilelistLmdb::init()
       goto bail_out;
     }
 
+    /*
+     * We use a database for the files, the directories and the directory
+     * names.
+     */
+    result = mdb_env_set_maxdbs(env, 3);
+    if (result) {
+      Jmsg1(jcr_, M_FATAL, 0, _("Unable to set MDB maxdbs: %s\n"),
+            mdb_strerror(result));
+      goto bail_out;
+    }
+
     Mmsg(lmdb_name_, "%s/.accurate_lmdb.%d", me->working_directory,
          jcr_->JobId);
     result = mdb_env_open(env, lmdb_name_,
@@ -119,12 +240,22 @@ bool BareosAccurateFilelistLmdb::init()
       goto bail_out;
     }
 
-    result = mdb_dbi_open(db_rw_txn_, NULL, MDB_CREATE, &db_dbi_);
+    result = mdb_dbi_open(db_rw_txn_, "files", MDB_CREATE, &db_dbi_);
+    if (result == 0) {
+      result = mdb_dbi_open(db_rw_txn_, "dirs", MDB_CREATE, &db_dirs_dbi_);
+    }
+    if (result == 0) {
+      result = mdb_dbi_open(db_rw_txn_, "dirnames", MDB_CREATE | MDB_INTEGERKEY,
+                            &db_dir_names_dbi_);
+    }
     if (result) {
       Jmsg1(jcr_, M_FATAL, 0, _("Unable to open LMDB internal database: %s\n"),
             mdb_strerror(result));
       mdb_txn_abort(db_rw_txn_);
       db_rw_txn_ = NULL;
+      db_dbi_ = 0;
+      db_dirs_dbi_ = 0;
+      db_dir_names_dbi_ = 0;
       goto bail_out;
     }
 
@@ -139,62 +270,22 @@ bail_out:
   return false;
 }
 
-bool BareosAccurateFilelistLmdb::AddFile(char* fname,
-                                         int fname_length,
-                                         char* lstat,
-                                         int lstat_length,
-                                         char* chksum,
-                                         int chksulength_,
-                                         int32_t delta_seq)
+/*
+ * Put a record into one of the databases using the write transaction. When
+ * the transaction is full it is committed and the put is retried in a new
+ * one.
+ */
+int BareosAccurateFilelistLmdb::PutRecord(MDB_dbi dbi,
+                                          MDB_val* key,
+                                          MDB_val* data,
+                                          unsigned int flags)
 {
-  accurate_payload* payload;
   int result;
-  int total_length;
-  MDB_val key, data;
-  bool retval = false;
-
-  total_length = sizeof(accurate_payload) + lstat_length + chksulength_ + 2;
-
-  /*
-   * Make sure pay_load_ is large enough.
-   */
-  pay_load_ = CheckPoolMemorySize(pay_load_, total_length);
-
-  /*
-   * We store the total pay load as:
-   *
-   * accurate_payload structure\0lstat\0chksum\0
-   */
-  payload = (accurate_payload*)pay_load_;
-
-  payload->lstat = (char*)payload + sizeof(accurate_payload);
-  memcpy(payload->lstat, lstat, lstat_length);
-  payload->lstat[lstat_length] = '\0';
-
-  payload->chksum = (char*)payload->lstat + lstat_length + 1;
-  if (chksulength_) { memcpy(payload->chksum, chksum, chksulength_); }
-  payload->chksum[chksulength_] = '\0';
-
-  payload->delta_seq = delta_seq;
-  payload->filenr = filenr_++;
-
-  key.mv_data = fname;
-  key.mv_size = strlen(fname) + 1;
-
-  data.mv_data = payload;
-  data.mv_size = total_length;
 
 retry:
-  result = mdb_put(db_rw_txn_, db_dbi_, &key, &data, MDB_NOOVERWRITE);
+  result = mdb_put(db_rw_txn_, dbi, key, data, flags);
   switch (result) {
     case 0:
-      if (chksum) {
-        Dmsg4(debuglevel, "add fname=<%s> lstat=%s delta_seq=%i chksum=%s\n",
-              fname, lstat, delta_seq, chksum);
-      } else {
-        Dmsg2(debuglevel, "add fname=<%s> lstat=%s\n", fname, lstat);
-      }
-      retval = true;
       break;
     case MDB_TXN_FULL:
       /*
@@ -207,20 +298,188 @@ retry:
         if (result == 0) {
           goto retry;
         } else {
+          db_rw_txn_ = NULL;
           Jmsg1(jcr_, M_FATAL, 0, _("Unable create new transaction: %s\n"),
                 mdb_strerror(result));
         }
       } else {
+        db_rw_txn_ = NULL;
         Jmsg1(jcr_, M_FATAL, 0, _("Unable to commit full transaction: %s\n"),
               mdb_strerror(result));
       }
       break;
+    case MDB_KEYEXIST:
+      break;
     default:
       Jmsg1(jcr_, M_FATAL, 0, _("Unable insert new data: %s\n"),
             mdb_strerror(result));
       break;
   }
 
+  return result;
+}
+
+/*
+ * Lookup the id of a directory, returns 0 when it is not known.
+ */
+uint32_t BareosAccurateFilelistLmdb::GetDirId(MDB_txn* txn,
+                                              const std::string& dir)
+{
+  MDB_val key, data;
+
+  key.mv_data = (void*)dir.c_str();
+  key.mv_size = dir.size() + 1;
+
+  if (mdb_get(txn, db_dirs_dbi_, &key, &data) != 0 ||
+      data.mv_size != sizeof(uint32_t)) {
+    return 0;
+  }
+
+  return DecodeDirId(data.mv_data);
+}
+
+/*
+ * Get the id of a directory, a new id is assigned to unknown directories.
+ */
+uint32_t BareosAccurateFilelistLmdb::AddDir(const std::string& dir)
+{
+  uint32_t dir_id;
+  char encoded_dir_id[DIR_ID_LENGTH];
+  MDB_val key, data;
+
+  if (load_dir_id_ && dir == load_dir_) { return load_dir_id_; }
+
+  dir_id = GetDirId(db_rw_txn_, dir);
+  if (!dir_id) {
+    dir_id = next_dir_id_++;
+    EncodeDirId(dir_id, encoded_dir_id);
+
+    key.mv_data = (void*)dir.c_str();
+    key.mv_size = dir.size() + 1;
+    data.mv_data = encoded_dir_id;
+    data.mv_size = DIR_ID_LENGTH;
+    if (PutRecord(db_dirs_dbi_, &key, &data, MDB_NOOVERWRITE) != 0) {
+      return 0;
+    }
+
+    /*
+     * Directory ids are handed out in ascending order so the names can
+     * always be appended.
+     */
+    key.mv_data = &dir_id;
+    key.mv_size = sizeof(dir_id);
+    data.mv_data = (void*)dir.c_str();
+    data.mv_size = dir.size() + 1;
+    if (PutRecord(db_dir_names_dbi_, &key, &data, MDB_APPEND) != 0) {
+      return 0;
+    }
+  }
+
+  load_dir_ = dir;
+  load_dir_id_ = dir_id;
+
+  return dir_id;
+}
+
+bool BareosAccurateFilelistLmdb::AddFile(char* fname,
+                                         int fname_length,
+                                         char* lstat,
+                                         int lstat_length,
+                                         char* chksum,
+                                         int chksulength_,
+                                         int32_t delta_seq)
+{
+  std::string dir;
+  const char* name;
+  int name_length;
+  uint32_t dir_id;
+  size_t offset;
+  PendingFile entry;
+
+  if (!db_rw_txn_) { return false; }
+
+  SplitFilename(fname, strlen(fname), dir, &name, &name_length);
+  dir_id = AddDir(dir);
+  if (!dir_id) { return false; }
+
+  /*
+   * The key is the id of the directory followed by the name, the payload
+   * directly follows the key in the chunk.
+   */
+  entry.key_length = DIR_ID_LENGTH + name_length;
+  entry.data_length =
+      sizeof(accurate_payload) + lstat_length + chksulength_ + 2;
+
+  offset = chunk_data_.size();
+  chunk_data_.resize(offset + entry.key_length + entry.data_length);
+  entry.offset = offset;
+
+  EncodeDirId(dir_id, &chunk_data_[offset]);
+  memcpy(&chunk_data_[offset + DIR_ID_LENGTH], name, name_length);
+  BuildPayload(&chunk_data_[offset + entry.key_length], lstat, lstat_length,
+               chksum, chksulength_, delta_seq, filenr_++);
+  chunk_.push_back(entry);
+
+  if (chksum) {
+    Dmsg4(debuglevel, "add fname=<%s> lstat=%s delta_seq=%i chksum=%s\n",
+          fname, lstat, delta_seq, chksum);
+  } else {
+    Dmsg2(debuglevel, "add fname=<%s> lstat=%s\n", fname, lstat);
+  }
+
+  if (chunk_data_.size() >= MAX_CHUNK_SIZE ||
+      chunk_.size() >= MAX_CHUNK_ENTRIES) {
+    return FlushChunk();
+  }
+
+  return true;
+}
+
+/*
+ * Sort the files collected in the chunk and put them into the database.
+ * Keys sorting after all keys already in the database are appended which
+ * saves the page splits and searches of a normal put.
+ */
+bool BareosAccurateFilelistLmdb::FlushChunk()
+{
+  int result;
+  MDB_val key, data;
+  const char* buf = chunk_data_.data();
+  bool retval = true;
+
+  std::stable_sort(chunk_.begin(), chunk_.end(),
+                   [buf](const PendingFile& a, const PendingFile& b) {
+                     return CompareKeys(buf + a.offset, a.key_length,
+                                        buf + b.offset, b.key_length) < 0;
+                   });
+
+  for (const PendingFile& entry : chunk_) {
+    key.mv_data = (void*)(buf + entry.offset);
+    key.mv_size = entry.key_length;
+    data.mv_data = (void*)(buf + entry.offset + entry.key_length);
+    data.mv_size = entry.data_length;
+
+    if (CompareKeys(buf + entry.offset, entry.key_length, last_key_.data(),
+                    last_key_.size()) > 0) {
+      result = PutRecord(db_dbi_, &key, &data, MDB_APPEND);
+      if (result == 0) {
+        last_key_.assign(buf + entry.offset, entry.key_length);
+      }
+    } else {
+      result = PutRecord(db_dbi_, &key, &data, MDB_NOOVERWRITE);
+    }
+
+    if (result != 0 && result != MDB_KEYEXIST) {
+      retval = false;
+      break;
+    }
+  }
+
+  Dmsg1(debuglevel, "flushed chunk of %d files\n", (int)chunk_.size());
+
+  chunk_.clear();
+  chunk_data_.clear();
+
   return retval;
 }
 
@@ -228,18 +487,29 @@ bool BareosAccurateFilelistLmdb::EndLoad()
 {
   int result;
 
+  /*
+   * Put the last files into the database and release the chunk.
+   */
+  if (!chunk_.empty() && !FlushChunk()) { return false; }
+  std::vector<char>().swap(chunk_data_);
+  std::vector<PendingFile>().swap(chunk_);
+  load_dir_.clear();
+  load_dir_id_ = 0;
+
   /*
    * Commit any pending write transactions.
    */
   if (db_rw_txn_) {
     result = mdb_txn_commit(db_rw_txn_);
     if (result != 0) {
+      db_rw_txn_ = NULL;
       Jmsg1(jcr_, M_FATAL, 0, _("Unable close write transaction: %s\n"),
             mdb_strerror(result));
       return false;
     }
     result = mdb_txn_begin(db_env_, NULL, 0, &db_rw_txn_);
     if (result != 0) {
+      db_rw_txn_ = NULL;
       Jmsg1(jcr_, M_FATAL, 0, _("Unable to create write transaction: %s\n"),
             mdb_strerror(result));
       return false;
@@ -262,55 +532,182 @@ bool BareosAccurateFilelistLmdb::EndLoad()
   return true;
 }
 
-accurate_payload* BareosAccurateFilelistLmdb::lookup_payload(char* fname)
+/*
+ * We keep the read transaction as short a possible so after copying the
+ * actual data out we reset the read transaction and do a renew of the read
+ * transaction for a new run.
+ */
+static inline bool RenewReadTransaction(JobControlRecord* jcr, MDB_txn* txn)
 {
   int result;
-  int lstat_length;
+
+  mdb_txn_reset(txn);
+  result = mdb_txn_renew(txn);
+  if (result != 0) {
+    Jmsg1(jcr, M_FATAL, 0, _("Unable to renew read transaction: %s\n"),
+          mdb_strerror(result));
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Load the entries of a directory into the cache. A backup looks up the
+ * files of a directory one after another so one cursor scan over the
+ * adjacent keys replaces a tree search per file.
+ *
+ * The cached directories form a stack of the current directory and its
+ * ancestors, so the remaining files of a parent are still cached when the
+ * backup returns from a subdirectory. Directories that are not ancestors of
+ * the new one are dropped, and the ones nearest to the root go first when
+ * the cache holds too many entries.
+ */
+bool BareosAccurateFilelistLmdb::CacheDirectory(const std::string& dir)
+{
+  int result;
+  MDB_cursor* cursor;
   MDB_val key, data;
-  accurate_payload* payload = NULL;
+  char encoded_dir_id[DIR_ID_LENGTH];
+  MDB_cursor_op op = MDB_SET_RANGE;
+
+  while (!cached_dirs_.empty() &&
+         dir.compare(0, cached_dirs_.back().dir.size(),
+                     cached_dirs_.back().dir) != 0) {
+    cached_entry_count_ -= cached_dirs_.back().entries.size();
+    cached_dirs_.pop_back();
+  }
+  while (!cached_dirs_.empty() && (cached_dirs_.size() >= MAX_CACHED_DIRS ||
+                                   cached_entry_count_ > MAX_CACHED_ENTRIES)) {
+    cached_entry_count_ -= cached_dirs_.front().entries.size();
+    cached_dirs_.erase(cached_dirs_.begin());
+  }
 
-  key.mv_data = fname;
-  key.mv_size = strlen(fname) + 1;
+  cached_dirs_.emplace_back();
+  CachedDirectory& cd = cached_dirs_.back();
+  cd.dir = dir;
+  cd.complete = true;
+  cd.dir_id = GetDirId(db_ro_txn_, dir);
+  if (!cd.dir_id) { return RenewReadTransaction(jcr_, db_ro_txn_); }
 
-  result = mdb_get(db_ro_txn_, db_dbi_, &key, &data);
-  switch (result) {
-    case 0:
-      /*
-       * Success.
-       *
-       * We need to make a private copy of the LDMB data as we are not
-       * allowed to change its content and we need to update the lstat
-       * and chksum pointer to point to the actual lstat and chksum that
-       * is stored behind the accurate_payload structure in the LMDB.
-       */
-      pay_load_ = CheckPoolMemorySize(pay_load_, data.mv_size);
+  EncodeDirId(cd.dir_id, encoded_dir_id);
 
-      payload = (accurate_payload*)pay_load_;
-      memcpy(payload, data.mv_data, data.mv_size);
-      payload->lstat = (char*)payload + sizeof(accurate_payload);
-      lstat_length = strlen(payload->lstat);
-      payload->chksum = (char*)payload->lstat + lstat_length + 1;
+  result = mdb_cursor_open(db_ro_txn_, db_dbi_, &cursor);
+  if (result != 0) {
+    Jmsg1(jcr_, M_FATAL, 0, _("Unable create cursor: %s\n"),
+          mdb_strerror(result));
+    cd.complete = false;
+    return RenewReadTransaction(jcr_, db_ro_txn_);
+  }
 
-      /*
-       * We keep the transaction as short a possible so after a lookup
-       * and copying the actual data out we reset the read transaction
-       * and do a renew of the read transaction for a new run.
-       */
-      mdb_txn_reset(db_ro_txn_);
-      result = mdb_txn_renew(db_ro_txn_);
-      if (result != 0) {
-        Jmsg1(jcr_, M_FATAL, 0, _("Unable to renew read transaction: %s\n"),
-              mdb_strerror(result));
-        return NULL;
-      }
-      break;
-    case MDB_NOTFOUND:
-      /*
-       * Failed to find the given key.
-       */
+  key.mv_data = encoded_dir_id;
+  key.mv_size = DIR_ID_LENGTH;
+  while ((result = mdb_cursor_get(cursor, &key, &data, op)) == 0) {
+    op = MDB_NEXT;
+    if (key.mv_size < DIR_ID_LENGTH ||
+        memcmp(key.mv_data, encoded_dir_id, DIR_ID_LENGTH) != 0) {
       break;
-    default:
+    }
+
+    if (cd.entries.size() >= MAX_CACHED_ENTRIES) {
+      cd.complete = false;
       break;
+    }
+
+    cd.entries.emplace(std::string((char*)key.mv_data + DIR_ID_LENGTH,
+                                   key.mv_size - DIR_ID_LENGTH),
+                       std::string((char*)data.mv_data, data.mv_size));
+  }
+  mdb_cursor_close(cursor);
+  cached_entry_count_ += cd.entries.size();
+
+  Dmsg3(debuglevel, "cached %d entries of dir=%s, %d dirs cached\n",
+        (int)cd.entries.size(), dir.c_str(), (int)cached_dirs_.size());
+
+  return RenewReadTransaction(jcr_, db_ro_txn_);
+}
+
+/*
+ * Find a directory in the cache. When we find one of the ancestors of the
+ * current directory, the backup went back up the tree and the directories
+ * below it are dropped.
+ */
+BareosAccurateFilelistLmdb::CachedDirectory*
+BareosAccurateFilelistLmdb::FindCachedDirectory(const std::string& dir)
+{
+  for (size_t i = cached_dirs_.size(); i > 0; i--) {
+    if (cached_dirs_[i - 1].dir == dir) {
+      while (cached_dirs_.size() > i) {
+        cached_entry_count_ -= cached_dirs_.back().entries.size();
+        cached_dirs_.pop_back();
+      }
+      return &cached_dirs_.back();
+    }
+  }
+
+  return NULL;
+}
+
+accurate_payload* BareosAccurateFilelistLmdb::lookup_payload(char* fname)
+{
+  int result;
+  int lstat_length;
+  std::string dir;
+  const char* name;
+  int name_length;
+  const char* found_data;
+  size_t found_size;
+  MDB_val key, data;
+  accurate_payload* payload;
+  CachedDirectory* cd;
+
+  SplitFilename(fname, strlen(fname), dir, &name, &name_length);
+  if (!(cd = FindCachedDirectory(dir))) {
+    if (!CacheDirectory(dir)) { return NULL; }
+    cd = &cached_dirs_.back();
+  }
+  if (!cd->dir_id) { return NULL; }
+
+  auto entry = cd->entries.find(std::string(name, name_length));
+  if (entry != cd->entries.end()) {
+    found_data = entry->second.data();
+    found_size = entry->second.size();
+  } else if (!cd->complete) {
+    /*
+     * The directory is too large to cache all of its entries.
+     */
+    std::vector<char> lookup_key(DIR_ID_LENGTH + name_length);
+
+    EncodeDirId(cd->dir_id, lookup_key.data());
+    memcpy(lookup_key.data() + DIR_ID_LENGTH, name, name_length);
+    key.mv_data = lookup_key.data();
+    key.mv_size = lookup_key.size();
+
+    result = mdb_get(db_ro_txn_, db_dbi_, &key, &data);
+    if (result != 0) { return NULL; }
+
+    found_data = (const char*)data.mv_data;
+    found_size = data.mv_size;
+  } else {
+    return NULL;
+  }
+
+  /*
+   * We need to make a private copy of the LDMB data as we are not
+   * allowed to change its content and we need to update the lstat
+   * and chksum pointer to point to the actual lstat and chksum that
+   * is stored behind the accurate_payload structure in the LMDB.
+   */
+  pay_load_ = CheckPoolMemorySize(pay_load_, found_size);
+
+  payload = (accurate_payload*)pay_load_;
+  memcpy(payload, found_data, found_size);
+  payload->lstat = (char*)payload + sizeof(accurate_payload);
+  lstat_length = strlen(payload->lstat);
+  payload->chksum = (char*)payload->lstat + lstat_length + 1;
+
+  if (entry == cd->entries.end() && !RenewReadTransaction(jcr_, db_ro_txn_)) {
+    return NULL;
   }
 
   return payload;
@@ -320,89 +717,105 @@ bool BareosAccurateFilelistLmdb::UpdatePayload(char* fname,
                                                accurate_payload* payload)
 {
   int result, total_length, lstat_length, chksulength_;
+  std::string dir;
+  const char* name;
+  int name_length;
+  uint32_t dir_id;
   MDB_val key, data;
-  bool retval = false;
-  accurate_payload* new_payload;
+  std::vector<char> update_key;
+  std::string new_payload;
+  CachedDirectory* cd;
 
+  if (!db_rw_txn_) { return false; }
+
+  SplitFilename(fname, strlen(fname), dir, &name, &name_length);
+  cd = FindCachedDirectory(dir);
+  dir_id = cd ? cd->dir_id : GetDirId(db_rw_txn_, dir);
+  if (!dir_id) { return false; }
+
+  /*
+   * The payload may point into pay_load_ so build the new one separately.
+   */
   lstat_length = strlen(payload->lstat);
   chksulength_ = strlen(payload->chksum);
   total_length = sizeof(accurate_payload) + lstat_length + chksulength_ + 2;
 
-  /*
-   * Make sure pay_load_ is large enough.
-   */
-  pay_load_ = CheckPoolMemorySize(pay_load_, total_length);
+  new_payload.resize(total_length);
+  BuildPayload(&new_payload[0], payload->lstat, lstat_length, payload->chksum,
+               chksulength_, payload->delta_seq, payload->filenr);
 
-  /*
-   * We store the total pay load as:
-   *
-   * accurate_payload structure\0lstat\0chksum\0
-   */
-  new_payload = (accurate_payload*)pay_load_;
+  update_key.resize(DIR_ID_LENGTH + name_length);
+  EncodeDirId(dir_id, update_key.data());
+  memcpy(update_key.data() + DIR_ID_LENGTH, name, name_length);
 
-  new_payload->lstat = (char*)payload + sizeof(accurate_payload);
-  memcpy(new_payload->lstat, payload->lstat, lstat_length);
-  new_payload->lstat[lstat_length] = '\0';
+  key.mv_data = update_key.data();
+  key.mv_size = update_key.size();
+  data.mv_data = &new_payload[0];
+  data.mv_size = total_length;
+
+  if (PutRecord(db_dbi_, &key, &data, 0) != 0) { return false; }
+
+  result = mdb_txn_commit(db_rw_txn_);
+  if (result != 0) {
+    db_rw_txn_ = NULL;
+    Jmsg1(jcr_, M_FATAL, 0, _("Unable close write transaction: %s\n"),
+          mdb_strerror(result));
+    return false;
+  }
+
+  result = mdb_txn_begin(db_env_, NULL, 0, &db_rw_txn_);
+  if (result != 0) {
+    db_rw_txn_ = NULL;
+    Jmsg1(jcr_, M_FATAL, 0, _("Unable to create write transaction: %s\n"),
+          mdb_strerror(result));
+    return false;
+  }
 
-  new_payload->chksum = (char*)new_payload->lstat + lstat_length + 1;
-  if (chksulength_) {
-    memcpy(new_payload->chksum, payload->chksum, chksulength_);
+  /*
+   * Keep the cached entries of the directory in sync.
+   */
+  if (cd) {
+    auto entry = cd->entries.find(std::string(name, name_length));
+
+    if (entry != cd->entries.end()) {
+      entry->second = new_payload;
+    } else if (cd->complete) {
+      cd->entries.emplace(std::string(name, name_length), new_payload);
+      cached_entry_count_++;
+    }
   }
-  new_payload->chksum[chksulength_] = '\0';
 
-  new_payload->delta_seq = payload->delta_seq;
-  new_payload->filenr = payload->filenr;
+  return true;
+}
 
-  key.mv_data = fname;
-  key.mv_size = strlen(fname) + 1;
+/*
+ * Get the full filename of a record in the files database, the directory
+ * name is looked up with the read transaction.
+ */
+static inline bool GetFilename(MDB_txn* txn,
+                               MDB_dbi dir_names_dbi,
+                               MDB_val* key,
+                               POOLMEM*& fname)
+{
+  uint32_t dir_id;
+  MDB_val dir_key, dir_name;
+  int name_length;
 
-  data.mv_data = new_payload;
-  data.mv_size = total_length;
+  if (key->mv_size < DIR_ID_LENGTH) { return false; }
 
-retry:
-  result = mdb_put(db_rw_txn_, db_dbi_, &key, &data, 0);
-  switch (result) {
-    case 0:
-      result = mdb_txn_commit(db_rw_txn_);
-      if (result == 0) {
-        result = mdb_txn_begin(db_env_, NULL, 0, &db_rw_txn_);
-        if (result != 0) {
-          Jmsg1(jcr_, M_FATAL, 0, _("Unable to create write transaction: %s\n"),
-                mdb_strerror(result));
-        } else {
-          retval = true;
-        }
-      } else {
-        Jmsg1(jcr_, M_FATAL, 0, _("Unable close write transaction: %s\n"),
-              mdb_strerror(result));
-      }
-      break;
-    case MDB_TXN_FULL:
-      /*
-       * Seems we filled the transaction.
-       * Flush the current transaction start a new one and retry the put.
-       */
-      result = mdb_txn_commit(db_rw_txn_);
-      if (result == 0) {
-        result = mdb_txn_begin(db_env_, NULL, 0, &db_rw_txn_);
-        if (result == 0) {
-          goto retry;
-        } else {
-          Jmsg1(jcr_, M_FATAL, 0, _("Unable create new transaction: %s\n"),
-                mdb_strerror(result));
-        }
-      } else {
-        Jmsg1(jcr_, M_FATAL, 0, _("Unable to commit full transaction: %s\n"),
-              mdb_strerror(result));
-      }
-      break;
-    default:
-      Jmsg1(jcr_, M_FATAL, 0, _("Unable insert new data: %s\n"),
-            mdb_strerror(result));
-      break;
-  }
+  dir_id = DecodeDirId(key->mv_data);
+  dir_key.mv_data = &dir_id;
+  dir_key.mv_size = sizeof(dir_id);
+  if (mdb_get(txn, dir_names_dbi, &dir_key, &dir_name) != 0) { return false; }
 
-  return retval;
+  name_length = key->mv_size - DIR_ID_LENGTH;
+  fname = CheckPoolMemorySize(fname, dir_name.mv_size + name_length);
+  memcpy(fname, dir_name.mv_data, dir_name.mv_size - 1);
+  memcpy(fname + dir_name.mv_size - 1, (char*)key->mv_data + DIR_ID_LENGTH,
+         name_length);
+  fname[dir_name.mv_size - 1 + name_length] = '\0';
+
+  return true;
 }
 
 bool BareosAccurateFilelistLmdb::SendBaseFileList()
@@ -415,6 +828,7 @@ bool BareosAccurateFilelistLmdb::SendBaseFileList()
   bool retval = false;
   accurate_payload* payload;
   int stream = STREAM_UNIX_ATTRIBUTES;
+  POOLMEM* fname;
 
   if (!jcr_->accurate || jcr_->getJobLevel() != L_FULL) { return true; }
 
@@ -431,6 +845,7 @@ bool BareosAccurateFilelistLmdb::SendBaseFileList()
     db_rw_txn_ = NULL;
   }
 
+  fname = GetPoolMemory(PM_FNAME);
   ff_pkt = init_find_files();
   ff_pkt->type = FT_BASE;
 
@@ -439,10 +854,13 @@ bool BareosAccurateFilelistLmdb::SendBaseFileList()
     while ((result = mdb_cursor_get(cursor, &key, &data, MDB_NEXT)) == 0) {
       payload = (accurate_payload*)data.mv_data;
       if (BitIsSet(payload->filenr, seen_bitmap_)) {
-        Dmsg1(debuglevel, "base file fname=%s\n", key.mv_data);
-        DecodeStat(payload->lstat, &ff_pkt->statp, sizeof(struct stat),
-                   &LinkFIc); /* decode catalog stat */
-        ff_pkt->fname = (char*)key.mv_data;
+        if (!GetFilename(db_ro_txn_, db_dir_names_dbi_, &key, fname)) {
+          continue;
+        }
+        Dmsg1(debuglevel, "base file fname=%s\n", fname);
+        DecodeStat((char*)payload + sizeof(accurate_payload), &ff_pkt->statp,
+                   sizeof(struct stat), &LinkFIc); /* decode catalog stat */
+        ff_pkt->fname = fname;
         EncodeAndSendAttributes(jcr_, ff_pkt, stream);
       }
     }
@@ -464,6 +882,7 @@ bool BareosAccurateFilelistLmdb::SendBaseFileList()
 
 bail_out:
   TermFindFiles(ff_pkt);
+  FreePoolMemory(fname);
   return retval;
 }
 
@@ -478,6 +897,7 @@ bool BareosAccurateFilelistLmdb::SendDeletedList()
   bool retval = false;
   accurate_payload* payload;
   int stream = STREAM_UNIX_ATTRIBUTES;
+  POOLMEM* fname;
 
   if (!jcr_->accurate) { return true; }
 
@@ -494,6 +914,7 @@ bool BareosAccurateFilelistLmdb::SendDeletedList()
     db_rw_txn_ = NULL;
   }
 
+  fname = GetPoolMemory(PM_FNAME);
   ff_pkt = init_find_files();
   ff_pkt->type = FT_DELETED;
 
@@ -503,14 +924,15 @@ bool BareosAccurateFilelistLmdb::SendDeletedList()
       payload = (accurate_payload*)data.mv_data;
 
       if (BitIsSet(payload->filenr, seen_bitmap_) ||
-          PluginCheckFile(jcr_, (char*)key.mv_data)) {
+          !GetFilename(db_ro_txn_, db_dir_names_dbi_, &key, fname) ||
+          PluginCheckFile(jcr_, fname)) {
         continue;
       }
 
-      Dmsg1(debuglevel, "deleted fname=%s\n", key.mv_data);
-      DecodeStat(payload->lstat, &statp, sizeof(struct stat),
-                 &LinkFIc); /* decode catalog stat */
-      ff_pkt->fname = (char*)key.mv_data;
+      Dmsg1(debuglevel, "deleted fname=%s\n", fname);
+      DecodeStat((char*)payload + sizeof(accurate_payload), &statp,
+                 sizeof(struct stat), &LinkFIc); /* decode catalog stat */
+      ff_pkt->fname = fname;
       ff_pkt->statp.st_mtime = statp.st_mtime;
       ff_pkt->statp.st_ctime = statp.st_ctime;
       EncodeAndSendAttributes(jcr_, ff_pkt, stream);
@@ -533,6 +955,82 @@ bool BareosAccurateFilelistLmdb::SendDeletedList()
 
 bail_out:
   TermFindFiles(ff_pkt);
+  FreePoolMemory(fname);
+  return retval;
+}
+
+/*
+ * Mark all files below a directory as seen. The directory database is
+ * ordered by path so the directories of the tree are found with one cursor
+ * scan and their files are adjacent in the files database.
+ */
+bool BareosAccurateFilelistLmdb::MarkDirectoryTreeAsSeen(
+    char* dirname,
+    accurate_payload* payload)
+{
+  int result;
+  MDB_cursor *dir_cursor, *file_cursor;
+  MDB_val dir_key, dir_data, key, data;
+  MDB_cursor_op dir_op = MDB_SET_RANGE;
+  MDB_cursor_op op;
+  size_t dirname_length = strlen(dirname);
+  char encoded_dir_id[DIR_ID_LENGTH];
+  accurate_payload file_payload;
+  int64_t nr_files = 0;
+  bool retval = false;
+
+  result = mdb_cursor_open(db_ro_txn_, db_dirs_dbi_, &dir_cursor);
+  if (result != 0) {
+    Jmsg1(jcr_, M_FATAL, 0, _("Unable create cursor: %s\n"),
+          mdb_strerror(result));
+    goto bail_out;
+  }
+
+  result = mdb_cursor_open(db_ro_txn_, db_dbi_, &file_cursor);
+  if (result != 0) {
+    Jmsg1(jcr_, M_FATAL, 0, _("Unable create cursor: %s\n"),
+          mdb_strerror(result));
+    mdb_cursor_close(dir_cursor);
+    goto bail_out;
+  }
+
+  dir_key.mv_data = dirname;
+  dir_key.mv_size = dirname_length;
+  while (mdb_cursor_get(dir_cursor, &dir_key, &dir_data, dir_op) == 0) {
+    dir_op = MDB_NEXT;
+    if (dir_key.mv_size <= dirname_length ||
+        memcmp(dir_key.mv_data, dirname, dirname_length) != 0) {
+      break;
+    }
+    if (dir_data.mv_size != DIR_ID_LENGTH) { continue; }
+
+    memcpy(encoded_dir_id, dir_data.mv_data, DIR_ID_LENGTH);
+    key.mv_data = encoded_dir_id;
+    key.mv_size = DIR_ID_LENGTH;
+    op = MDB_SET_RANGE;
+    while (mdb_cursor_get(file_cursor, &key, &data, op) == 0) {
+      op = MDB_NEXT;
+      if (key.mv_size < DIR_ID_LENGTH ||
+          memcmp(key.mv_data, encoded_dir_id, DIR_ID_LENGTH) != 0) {
+        break;
+      }
+
+      memcpy(&file_payload, data.mv_data, sizeof(accurate_payload));
+      SetBit(file_payload.filenr, seen_bitmap_);
+      nr_files++;
+    }
+  }
+
+  mdb_cursor_close(file_cursor);
+  mdb_cursor_close(dir_cursor);
+
+  Dmsg2(debuglevel, "marked %lld files of tree <%s> as seen\n",
+        (long long)nr_files, dirname);
+  retval = nr_files > 0;
+
+bail_out:
+  if (!RenewReadTransaction(jcr_, db_ro_txn_)) { return false; }
+
   return retval;
 }
 
@@ -37,6 +37,7 @@
 #include "filed/crypto.h"
 #include "filed/heartbeat.h"
 #include "filed/backup.h"
+#include "filed/digest_workers.h"
 #include "include/ch.h"
 #include "findlib/attribs.h"
 #include "findlib/hardlink.h"
@@ -254,9 +255,11 @@ static inline bool SaveRsrcAndFinder(b_save_ctx& bsctx)
   PmMemcpy(sd->msg, bsctx.ff_pkt->hfsinfo.fndrinfo, 32);
   sd->message_length = 32;
   if (bsctx.digest) {
+    DigestWorkersWait(bsctx.digest);
     CryptoDigestUpdate(bsctx.digest, (uint8_t*)sd->msg, sd->message_length);
   }
   if (bsctx.signing_digest) {
+    DigestWorkersWait(bsctx.signing_digest);
     CryptoDigestUpdate(bsctx.signing_digest, (uint8_t*)sd->msg,
                        sd->message_length);
   }
@@ -302,6 +305,9 @@ static inline bool SetupEncryptionDigests(b_save_ctx& bsctx)
   } else if (BitIsSet(FO_SHA512, bsctx.ff_pkt->flags)) {
     bsctx.digest = crypto_digest_new(bsctx.jcr, CRYPTO_DIGEST_SHA512);
     bsctx.digest_stream = STREAM_SHA512_DIGEST;
+  } else if (BitIsSet(FO_XXH64, bsctx.ff_pkt->flags)) {
+    bsctx.digest = crypto_digest_new(bsctx.jcr, CRYPTO_DIGEST_XXH64);
+    bsctx.digest_stream = STREAM_XXH64_DIGEST;
   }
 
   /*
@@ -356,6 +362,8 @@ static inline bool TerminateSigningDigest(b_save_ctx& bsctx)
   SIGNATURE* signature = NULL;
   BareosSocket* sd = bsctx.jcr->store_bsock;
 
+  DigestWorkersWait(bsctx.signing_digest);
+
   if ((signature = crypto_sign_new(bsctx.jcr)) == NULL) {
     Jmsg(bsctx.jcr, M_FATAL, 0,
          _("Failed to allocate memory for crypto signature.\n"));
@@ -419,6 +427,8 @@ static inline bool TerminateDigest(b_save_ctx& bsctx)
   bool retval = false;
   BareosSocket* sd = bsctx.jcr->store_bsock;
 
+  DigestWorkersWait(bsctx.digest);
+
   sd->fsend("%ld %d 0", bsctx.jcr->JobFiles, bsctx.digest_stream);
   Dmsg1(300, "filed>stored:header %s", sd->msg);
 
@@ -882,8 +892,14 @@ bail_out:
     jcr->plugin_sp = NULL; /* sp is local to this function */
     jcr->opt_plugin = false;
   }
-  if (bsctx.digest) { CryptoDigestFree(bsctx.digest); }
-  if (bsctx.signing_digest) { CryptoDigestFree(bsctx.signing_digest); }
+  if (bsctx.digest) {
+    DigestWorkersWait(bsctx.digest);
+    CryptoDigestFree(bsctx.digest);
+  }
+  if (bsctx.signing_digest) {
+    DigestWorkersWait(bsctx.signing_digest);
+    CryptoDigestFree(bsctx.signing_digest);
+  }
 
   return rtnstat;
 }
@@ -944,15 +960,26 @@ static inline bool SendDataToSd(b_ctx* bctx)
    * Update checksum if requested
    */
   if (bctx->digest) {
-    CryptoDigestUpdate(bctx->digest, (uint8_t*)bctx->rbuf, sd->message_length);
+    if (bctx->offload_digests) {
+      DigestWorkersUpdate(bctx->digest, (uint8_t*)bctx->rbuf,
+                          sd->message_length);
+    } else {
+      CryptoDigestUpdate(bctx->digest, (uint8_t*)bctx->rbuf,
+                         sd->message_length);
+    }
   }
 
   /*
    * Update signing digest if requested
    */
   if (bctx->signing_digest) {
-    CryptoDigestUpdate(bctx->signing_digest, (uint8_t*)bctx->rbuf,
-                       sd->message_length);
+    if (bctx->offload_digests) {
+      DigestWorkersUpdate(bctx->signing_digest, (uint8_t*)bctx->rbuf,
+                          sd->message_length);
+    } else {
+      CryptoDigestUpdate(bctx->signing_digest, (uint8_t*)bctx->rbuf,
+                         sd->message_length);
+    }
   }
 
   /*
@@ -1151,6 +1178,14 @@ static int send_data(JobControlRecord* jcr,
   bctx.digest = digest;                    /* encryption digest */
   bctx.signing_digest = signing_digest;    /* signing digest */
 
+  /*
+   * Hashing a file that fits into one read buffer in the digest workers
+   * would only add the copy and the wait for the worker.
+   */
+  bctx.offload_digests =
+      (digest || signing_digest) && DigestWorkersRunning() &&
+      ff_pkt->statp.st_size > (boffset_t)jcr->buf_size;
+
   Dmsg1(300, "Saving data, type=%d\n", ff_pkt->type);
 
   if (!SetupCompressionContext(bctx)) { goto bail_out; }
@@ -1269,6 +1304,42 @@ bail_out:
   return 0;
 }
 
+/**
+ * Send the file attributes as STREAM_UNIX_ATTRIBUTES_BINARY record with the
+ * same fields as the text record.
+ */
+static bool SendBinaryAttributes(JobControlRecord* jcr,
+                                 FindFilesPacket* ff_pkt,
+                                 int data_stream,
+                                 const char* attribsEx)
+{
+  BareosSocket* sd = jcr->store_bsock;
+  const char* fname = ff_pkt->fname;
+  const char* link = "";
+
+  switch (ff_pkt->type) {
+    case FT_JUNCTION:
+    case FT_LNK:
+    case FT_LNKSAVED:
+      link = ff_pkt->link;
+      break;
+    case FT_DIREND:
+    case FT_REPARSE:
+      /* Here link is the canonical filename (i.e. with trailing slash) */
+      fname = ff_pkt->link;
+      break;
+    default:
+      break;
+  }
+
+  sd->message_length = EncodeAttributesBinary(
+      sd->msg, jcr->JobFiles, ff_pkt->type, fname, &ff_pkt->statp,
+      sizeof(ff_pkt->statp), ff_pkt->LinkFI, data_stream, link, attribsEx,
+      ff_pkt->delta_seq);
+
+  return sd->send();
+}
+
 bool EncodeAndSendAttributes(JobControlRecord* jcr,
                              FindFilesPacket* ff_pkt,
                              int& data_stream)
@@ -1292,8 +1363,6 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
           _("Invalid file flags, no supported data stream type.\n"));
     return false;
   }
-  EncodeStat(attribs.c_str(), &ff_pkt->statp, sizeof(ff_pkt->statp),
-             ff_pkt->LinkFI, data_stream);
 
   /** Now possibly extend the attributes */
   if (IS_FT_OBJECT(ff_pkt->type)) {
@@ -1303,6 +1372,16 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
     attr_stream = encode_attribsEx(jcr, attribsEx, ff_pkt);
   }
 
+  /*
+   * Only plain Unix attributes are sent as binary record when negotiated.
+   */
+  if (jcr->binary_attributes && attr_stream == STREAM_UNIX_ATTRIBUTES) {
+    attr_stream = STREAM_UNIX_ATTRIBUTES_BINARY;
+  } else {
+    EncodeStat(attribs.c_str(), &ff_pkt->statp, sizeof(ff_pkt->statp),
+               ff_pkt->LinkFI, data_stream);
+  }
+
   Dmsg3(300, "File %s\nattribs=%s\nattribsEx=%s\n", ff_pkt->fname,
         attribs.c_str(), attribsEx);
 
@@ -1363,75 +1442,84 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
       ff_pkt->type != FT_DELETED) { /* already stripped */
     StripPath(ff_pkt);
   }
-  switch (ff_pkt->type) {
-    case FT_JUNCTION:
-    case FT_LNK:
-    case FT_LNKSAVED:
-      Dmsg3(300, "Link %d %s to %s\n", jcr->JobFiles, ff_pkt->fname,
-            ff_pkt->link);
-      status = sd->fsend("%ld %d %s%c%s%c%s%c%s%c%u%c", jcr->JobFiles,
-                         ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0,
-                         ff_pkt->link, 0, attribsEx, 0, ff_pkt->delta_seq, 0);
-      break;
-    case FT_DIREND:
-    case FT_REPARSE:
-      /* Here link is the canonical filename (i.e. with trailing slash) */
-      status = sd->fsend("%ld %d %s%c%s%c%c%s%c%u%c", jcr->JobFiles,
-                         ff_pkt->type, ff_pkt->link, 0, attribs.c_str(), 0, 0,
-                         attribsEx, 0, ff_pkt->delta_seq, 0);
-      break;
-    case FT_PLUGIN_CONFIG:
-    case FT_RESTORE_FIRST:
-      comp_len = ff_pkt->object_len;
-      ff_pkt->object_compression = 0;
+  if (attr_stream == STREAM_UNIX_ATTRIBUTES_BINARY) {
+    status = SendBinaryAttributes(jcr, ff_pkt, data_stream, attribsEx);
+  } else {
+    switch (ff_pkt->type) {
+      case FT_JUNCTION:
+      case FT_LNK:
+      case FT_LNKSAVED:
+        Dmsg3(300, "Link %d %s to %s\n", jcr->JobFiles, ff_pkt->fname,
+              ff_pkt->link);
+        status = sd->fsend("%ld %d %s%c%s%c%s%c%s%c%u%c", jcr->JobFiles,
+                           ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0,
+                           ff_pkt->link, 0, attribsEx, 0, ff_pkt->delta_seq,
+                           0);
+        break;
+      case FT_DIREND:
+      case FT_REPARSE:
+        /* Here link is the canonical filename (i.e. with trailing slash) */
+        status = sd->fsend("%ld %d %s%c%s%c%c%s%c%u%c", jcr->JobFiles,
+                           ff_pkt->type, ff_pkt->link, 0, attribs.c_str(), 0,
+                           0, attribsEx, 0, ff_pkt->delta_seq, 0);
+        break;
+      case FT_PLUGIN_CONFIG:
+      case FT_RESTORE_FIRST:
+        comp_len = ff_pkt->object_len;
+        ff_pkt->object_compression = 0;
 
-      if (ff_pkt->object_len > 1000) {
-        /*
-         * Big object, compress it
-         */
-        comp_len = compressBound(ff_pkt->object_len);
-        POOLMEM* comp_obj = GetMemory(comp_len);
-        /*
-         * FIXME: check Zdeflate error
-         */
-        Zdeflate(ff_pkt->object, ff_pkt->object_len, comp_obj, comp_len);
-        if (comp_len < ff_pkt->object_len) {
-          ff_pkt->object = comp_obj;
-          ff_pkt->object_compression = 1; /* zlib level 9 compression */
-        } else {
+        if (ff_pkt->object_len > 1000) {
+          /*
+           * Big object, compress it
+           */
+          comp_len = compressBound(ff_pkt->object_len);
+          POOLMEM* comp_obj = GetMemory(comp_len);
           /*
-           * Uncompressed object smaller, use it
+           * FIXME: check Zdeflate error
            */
-          comp_len = ff_pkt->object_len;
+          Zdeflate(ff_pkt->object, ff_pkt->object_len, comp_obj, comp_len);
+          if (comp_len < ff_pkt->object_len) {
+            ff_pkt->object = comp_obj;
+            ff_pkt->object_compression = 1; /* zlib level 9 compression */
+          } else {
+            /*
+             * Uncompressed object smaller, use it
+             */
+            comp_len = ff_pkt->object_len;
+          }
+          Dmsg2(100, "Object compressed from %d to %d bytes\n",
+                ff_pkt->object_len, comp_len);
         }
-        Dmsg2(100, "Object compressed from %d to %d bytes\n",
-              ff_pkt->object_len, comp_len);
-      }
 
-      sd->message_length = Mmsg(
-          sd->msg, "%d %d %d %d %d %d %s%c%s%c", jcr->JobFiles, ff_pkt->type,
-          ff_pkt->object_index, comp_len, ff_pkt->object_len,
-          ff_pkt->object_compression, ff_pkt->fname, 0, ff_pkt->object_name, 0);
-      sd->msg = CheckPoolMemorySize(sd->msg, sd->message_length + comp_len + 2);
-      memcpy(sd->msg + sd->message_length, ff_pkt->object, comp_len);
+        sd->message_length =
+            Mmsg(sd->msg, "%d %d %d %d %d %d %s%c%s%c", jcr->JobFiles,
+                 ff_pkt->type, ff_pkt->object_index, comp_len,
+                 ff_pkt->object_len, ff_pkt->object_compression, ff_pkt->fname,
+                 0, ff_pkt->object_name, 0);
+        sd->msg =
+            CheckPoolMemorySize(sd->msg, sd->message_length + comp_len + 2);
+        memcpy(sd->msg + sd->message_length, ff_pkt->object, comp_len);
 
-      /*
-       * Note we send one extra byte so Dir can store zero after object
-       */
-      sd->message_length += comp_len + 1;
-      status = sd->send();
-      if (ff_pkt->object_compression) { FreeAndNullPoolMemory(ff_pkt->object); }
-      break;
-    case FT_REG:
-      status = sd->fsend("%ld %d %s%c%s%c%c%s%c%d%c", jcr->JobFiles,
-                         ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0, 0,
-                         attribsEx, 0, ff_pkt->delta_seq, 0);
-      break;
-    default:
-      status = sd->fsend("%ld %d %s%c%s%c%c%s%c%u%c", jcr->JobFiles,
-                         ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0, 0,
-                         attribsEx, 0, ff_pkt->delta_seq, 0);
-      break;
+        /*
+         * Note we send one extra byte so Dir can store zero after object
+         */
+        sd->message_length += comp_len + 1;
+        status = sd->send();
+        if (ff_pkt->object_compression) {
+          FreeAndNullPoolMemory(ff_pkt->object);
+        }
+        break;
+      case FT_REG:
+        status = sd->fsend("%ld %d %s%c%s%c%c%s%c%d%c", jcr->JobFiles,
+                           ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0,
+                           0, attribsEx, 0, ff_pkt->delta_seq, 0);
+        break;
+      default:
+        status = sd->fsend("%ld %d %s%c%s%c%c%s%c%u%c", jcr->JobFiles,
+                           ff_pkt->type, ff_pkt->fname, 0, attribs.c_str(), 0,
+                           0, attribsEx, 0, ff_pkt->delta_seq, 0);
+        break;
+    }
   }
 
   if (!IS_FT_OBJECT(ff_pkt->type) && ff_pkt->type != FT_DELETED) {
@@ -63,6 +63,7 @@ struct b_ctx {
   uint32_t encrypted_len;      /* Actual length after encryption */
   DIGEST* digest;              /* Encryption Digest */
   DIGEST* signing_digest;      /* Signing Digest */
+  bool offload_digests;        /* Digests are updated by the digest workers */
   CIPHER_CONTEXT* cipher_ctx;  /* Cipher context */
 };
 
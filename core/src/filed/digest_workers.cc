@@ -0,0 +1,277 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Calculation of file digests by worker threads during backup.
+ *
+ * The thread reading a file hands a copy of every data block to the digest
+ * workers and goes on compressing, encrypting and sending the block while
+ * the workers hash it. The blocks of one digest context are hashed by only
+ * one worker at a time and in the order they were read, but the checksum
+ * and the signing digest of a file and the files of concurrent jobs are
+ * hashed in parallel.
+ *
+ * The Director expects the digest of a file before the attributes of the
+ * next file, so the reading thread waits for the workers to finish the
+ * digests of a file before it sends them.
+ *
+ * The queue is limited in size. When it is full the reading thread waits,
+ * so reading is slowed down to the speed the digests can be calculated.
+ */
+
+#include "include/bareos.h"
+#include "filed/filed.h"
+#include "filed/filed_globals.h"
+#include "filed/digest_workers.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace filedaemon {
+
+static const int debuglevel = 200;
+
+/* Limit of the bytes waiting to be hashed per worker */
+static const uint64_t queue_size_per_worker = 16 * 1024 * 1024;
+
+/* Number of spare buffers kept per worker for the next blocks */
+static const size_t spare_buffers_per_worker = 8;
+
+typedef std::vector<uint8_t> digest_chunk;
+
+struct digest_job {
+  DIGEST* digest;
+  std::deque<digest_chunk> chunks; /* data blocks in order */
+};
+
+static bool quit = false;
+static bool digest_initialized = false;
+static std::vector<pthread_t> worker_tids;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t space_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Digests with queued data, a digest is either on the ready list or taken
+ * by a worker.
+ */
+static std::map<DIGEST*, digest_job*> jobs;
+static std::deque<digest_job*> ready;
+static std::vector<digest_chunk> spare;
+static uint64_t queued_bytes = 0;
+static uint64_t max_queued_bytes = 0;
+static size_t max_spare_buffers = 0;
+static digest_worker_stats_t digest_stats;
+
+extern "C" void* digest_worker_thread(void* arg)
+{
+  digest_job* job;
+  std::vector<digest_chunk> batch;
+  uint64_t bytes;
+  bool finished;
+
+  Dmsg0(debuglevel, "Starting digest worker\n");
+
+  while (1) {
+    P(mutex);
+    while (ready.empty() && !quit) { pthread_cond_wait(&work_cond, &mutex); }
+
+    if (ready.empty()) {
+      V(mutex);
+      break;
+    }
+
+    job = ready.front();
+    ready.pop_front();
+    while (!job->chunks.empty()) {
+      batch.push_back(std::move(job->chunks.front()));
+      job->chunks.pop_front();
+    }
+    V(mutex);
+
+    bytes = 0;
+    for (digest_chunk& chunk : batch) {
+      CryptoDigestUpdate(job->digest, chunk.data(), chunk.size());
+      bytes += chunk.size();
+    }
+
+    P(mutex);
+    queued_bytes -= bytes;
+    digest_stats.chunks += batch.size();
+    digest_stats.bytes += bytes;
+    for (digest_chunk& chunk : batch) {
+      if (spare.size() >= max_spare_buffers) { break; }
+      spare.push_back(std::move(chunk));
+    }
+    pthread_cond_broadcast(&space_cond);
+
+    finished = job->chunks.empty();
+    if (finished) {
+      jobs.erase(job->digest);
+      pthread_cond_broadcast(&done_cond);
+    } else {
+      ready.push_back(job);
+      pthread_cond_signal(&work_cond);
+    }
+    V(mutex);
+
+    batch.clear();
+    if (finished) { delete job; }
+  }
+
+  Dmsg0(debuglevel, "Finished digest worker\n");
+
+  return NULL;
+}
+
+bool DigestWorkersRunning() { return digest_initialized; }
+
+/**
+ * Queue a copy of a data block to be added to a digest. Waits while the
+ * queue is full. Falls back to updating the digest directly when the workers
+ * are stopped.
+ */
+void DigestWorkersUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
+{
+  digest_job* job;
+  bool stalled = false;
+
+  P(mutex);
+  while (queued_bytes > 0 && queued_bytes + length > max_queued_bytes &&
+         !quit) {
+    if (!stalled) {
+      digest_stats.stalls++;
+      stalled = true;
+    }
+    pthread_cond_wait(&space_cond, &mutex);
+  }
+
+  if (quit || !digest_initialized) {
+    V(mutex);
+    DigestWorkersWait(digest);
+    CryptoDigestUpdate(digest, data, length);
+    return;
+  }
+
+  auto it = jobs.find(digest);
+  if (it == jobs.end()) {
+    job = new digest_job;
+    job->digest = digest;
+    jobs[digest] = job;
+    ready.push_back(job);
+    pthread_cond_signal(&work_cond);
+  } else {
+    job = it->second;
+  }
+
+  if (spare.empty()) {
+    job->chunks.emplace_back(data, data + length);
+  } else {
+    job->chunks.push_back(std::move(spare.back()));
+    spare.pop_back();
+    job->chunks.back().assign(data, data + length);
+  }
+  queued_bytes += length;
+  V(mutex);
+}
+
+/**
+ * Wait until all data queued for a digest is hashed, the digest can then be
+ * finalized or freed.
+ */
+void DigestWorkersWait(DIGEST* digest)
+{
+  if (!digest) { return; }
+
+  P(mutex);
+  while (jobs.find(digest) != jobs.end()) {
+    pthread_cond_wait(&done_cond, &mutex);
+  }
+  V(mutex);
+}
+
+/**
+ * Get the counters of the workers.
+ *
+ * Returns: false if the workers are not running.
+ */
+bool GetDigestWorkerStatistics(digest_worker_stats_t& stats)
+{
+  if (!digest_initialized) { return false; }
+
+  P(mutex);
+  stats = digest_stats;
+  stats.workers = worker_tids.size();
+  stats.queued = queued_bytes;
+  V(mutex);
+
+  return true;
+}
+
+int StartDigestWorkers(void)
+{
+  int status;
+  pthread_t tid;
+
+  if (!me->digest_workers) { return 0; }
+
+  quit = false;
+  max_queued_bytes = queue_size_per_worker * me->digest_workers;
+  max_spare_buffers = spare_buffers_per_worker * me->digest_workers;
+
+  for (uint32_t i = 0; i < me->digest_workers; i++) {
+    if ((status = pthread_create(&tid, NULL, digest_worker_thread, NULL)) !=
+        0) {
+      if (worker_tids.empty()) { return status; }
+      break;
+    }
+    worker_tids.push_back(tid);
+  }
+
+  digest_initialized = true;
+
+  return 0;
+}
+
+/**
+ * Stop the workers after they hashed all queued data.
+ */
+void StopDigestWorkers()
+{
+  if (!digest_initialized) { return; }
+
+  P(mutex);
+  quit = true;
+  pthread_cond_broadcast(&work_cond);
+  pthread_cond_broadcast(&space_cond);
+  V(mutex);
+
+  for (pthread_t tid : worker_tids) {
+    if (!pthread_equal(tid, pthread_self())) { pthread_join(tid, NULL); }
+  }
+  worker_tids.clear();
+  spare.clear();
+  digest_initialized = false;
+}
+
+} /* namespace filedaemon */
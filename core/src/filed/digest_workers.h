@@ -0,0 +1,50 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Calculation of file digests by worker threads during backup.
+ */
+
+#ifndef BAREOS_FILED_DIGEST_WORKERS_H_
+#define BAREOS_FILED_DIGEST_WORKERS_H_
+
+namespace filedaemon {
+
+/**
+ * Counters of the digest workers
+ */
+struct digest_worker_stats_t {
+  uint32_t workers; /* number of worker threads */
+  uint64_t queued;  /* bytes waiting to be hashed */
+  uint64_t chunks;  /* data chunks hashed */
+  uint64_t bytes;   /* bytes hashed */
+  uint64_t stalls;  /* times a job had to wait for free queue space */
+};
+
+int StartDigestWorkers(void);
+void StopDigestWorkers();
+bool DigestWorkersRunning();
+void DigestWorkersUpdate(DIGEST* digest, const uint8_t* data, uint32_t length);
+void DigestWorkersWait(DIGEST* digest);
+bool GetDigestWorkerStatistics(digest_worker_stats_t& stats);
+
+} /* namespace filedaemon */
+#endif  // BAREOS_FILED_DIGEST_WORKERS_H_
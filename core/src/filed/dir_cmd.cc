@@ -350,6 +350,7 @@ static inline void CleanupFileset(JobControlRecord* jcr)
         fo->fstype.destroy();
         fo->Drivetype.destroy();
       }
+      FreeCompiledPatterns(incexe);
       incexe->opts_list.destroy();
       incexe->name_list.destroy();
       incexe->plugin_list.destroy();
@@ -376,6 +377,7 @@ static inline void CleanupFileset(JobControlRecord* jcr)
         fo->fstype.destroy();
         fo->Drivetype.destroy();
       }
+      FreeCompiledPatterns(incexe);
       incexe->opts_list.destroy();
       incexe->name_list.destroy();
       incexe->plugin_list.destroy();
@@ -1922,6 +1924,7 @@ static bool BackupCmd(JobControlRecord* jcr)
   int ok = 0;
   int SDJobStatus;
   int32_t FileIndex;
+  int BinaryAttributes = 0;
   BareosSocket* dir = jcr->dir_bsock;
   BareosSocket* sd = jcr->store_bsock;
   crypto_cipher_t cipher = CRYPTO_CIPHER_NONE;
@@ -1951,9 +1954,12 @@ static bool BackupCmd(JobControlRecord* jcr)
   if (jcr->enable_vss) { VSSInit(jcr); }
 #endif
 
-  if (sscanf(dir->msg, "backup FileIndex=%ld\n", &FileIndex) == 1) {
+  if (sscanf(dir->msg, "backup FileIndex=%ld BinaryAttributes=%d\n",
+             &FileIndex, &BinaryAttributes) >= 1) {
     jcr->JobFiles = FileIndex;
-    Dmsg1(100, "JobFiles=%ld\n", jcr->JobFiles);
+    jcr->binary_attributes = BinaryAttributes != 0;
+    Dmsg2(100, "JobFiles=%ld BinaryAttributes=%d\n", jcr->JobFiles,
+          BinaryAttributes);
   }
 
   /**
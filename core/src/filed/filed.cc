@@ -33,6 +33,7 @@
 #include "filed/filed_globals.h"
 #include "filed/dir_cmd.h"
 #include "filed/socket_server.h"
+#include "filed/digest_workers.h"
 #include "lib/mntent_cache.h"
 #include "lib/daemon.h"
 #include "lib/bsignal.h"
@@ -264,6 +265,8 @@ int main(int argc, char* argv[])
 
   LoadFdPlugins(me->plugin_directory, me->plugin_names);
 
+  StartDigestWorkers();
+
   if (!no_signals) {
     StartWatchdog(); /* start watchdog thread */
     if (me->jcr_watchdog_time) {
@@ -304,6 +307,7 @@ void TerminateFiled(int sig)
 
   StopConnectToDirectorThreads(true);
   StopSocketServer(true);
+  StopDigestWorkers();
 
   UnloadFdPlugins();
   FlushMntentCache();
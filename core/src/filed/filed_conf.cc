@@ -128,6 +128,11 @@ static ResourceItem cli_items[] = {
   {"SecureEraseCommand", CFG_TYPE_STR, ITEM(res_client.secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
       "Specify command that will be called when bareos unlinks files."},
   {"LogTimestampFormat", CFG_TYPE_STR, ITEM(res_client.log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL},
+  {"TlsKernelOffload", CFG_TYPE_BOOL, ITEM(res_client.enable_ktls_), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+      "Let the kernel encrypt and decrypt TLS connections (kTLS) when OpenSSL and the kernel support it."},
+  {"DigestWorkers", CFG_TYPE_PINT32, ITEM(res_client.digest_workers), 0, CFG_ITEM_DEFAULT, "2", "19.2.0-",
+      "Number of threads calculating the Signature of files larger than one network buffer during backup "
+      "and of all files during verify. 0 calculates it in the thread reading the file."},
     TLS_COMMON_CONFIG(res_client),
     TLS_CERT_CONFIG(res_client),
   {NULL, 0, {0}, 0, 0, NULL, NULL, NULL}};
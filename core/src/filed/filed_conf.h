@@ -105,6 +105,7 @@ class ClientResource : public TlsResource {
   bool always_use_lmdb;         /* Use LMDB for accurate data */
   uint32_t lmdb_threshold;      /* Switch to using LDMD when number of accurate
                                    entries exceeds treshold. */
+  uint32_t digest_workers;      /* Threads calculating file digests */
   X509_KEYPAIR* pki_keypair;    /* Shared PKI Public/Private Keypair */
   alist* pki_signers;           /* Shared PKI Trusted Signers */
   alist* pki_recipients;        /* Shared PKI Recipients */
@@ -593,6 +593,10 @@ static int SetOptions(findFOPTS* fo, const char* opts)
             p++;
             break;
 #endif
+          case '4':
+            SetBit(FO_XXH64, fo->flags);
+            p++;
+            break;
           default:
             /*
              * If 2 or 3 is seen here, SHA2 is not configured, so eat the
@@ -561,6 +561,7 @@ void DoRestore(JobControlRecord* jcr)
     switch (rctx.stream) {
       case STREAM_UNIX_ATTRIBUTES:
       case STREAM_UNIX_ATTRIBUTES_EX:
+      case STREAM_UNIX_ATTRIBUTES_BINARY:
         /*
          * if any previous stream open, close it
          */
@@ -591,8 +592,10 @@ void DoRestore(JobControlRecord* jcr)
         Dmsg3(100, "=== message_length=%d attrExlen=%d msg=%s\n",
               sd->message_length, strlen(attr->attrEx), sd->msg);
 
-        attr->data_stream = DecodeStat(attr->attr, &attr->statp,
-                                       sizeof(attr->statp), &attr->LinkFI);
+        if (rctx.stream != STREAM_UNIX_ATTRIBUTES_BINARY) {
+          attr->data_stream = DecodeStat(attr->attr, &attr->statp,
+                                         sizeof(attr->statp), &attr->LinkFI);
+        }
 
         if (!IsRestoreStreamSupported(attr->data_stream)) {
           if (!non_support_data++) {
@@ -783,6 +786,7 @@ void DoRestore(JobControlRecord* jcr)
             switch (rctx.prev_stream) {
               case STREAM_UNIX_ATTRIBUTES:
               case STREAM_UNIX_ATTRIBUTES_EX:
+              case STREAM_UNIX_ATTRIBUTES_BINARY:
               case STREAM_ENCRYPTED_SESSION_DATA:
                 process_data = true;
                 break;
@@ -1060,6 +1064,7 @@ void DoRestore(JobControlRecord* jcr)
       case STREAM_SHA1_DIGEST:
       case STREAM_SHA256_DIGEST:
       case STREAM_SHA512_DIGEST:
+      case STREAM_XXH64_DIGEST:
         break;
 
       case STREAM_PROGRAM_NAMES:
@@ -32,6 +32,7 @@
 #include "include/bareos.h"
 #include "filed/filed.h"
 #include "filed/filed_globals.h"
+#include "filed/digest_workers.h"
 #include "lib/status.h"
 #include "lib/edit.h"
 #include "findlib/enable_priv.h"
@@ -155,6 +156,18 @@ static void ListStatusHeader(StatusPacket* sp)
     sendit(msg, len, sp);
   }
 
+  digest_worker_stats_t stats;
+  if (GetDigestWorkerStatistics(stats)) {
+    len = Mmsg(msg,
+               _(" Digest workers: %d queued=%s bytes=%s chunks=%s "
+                 "stalls=%s\n"),
+               stats.workers, edit_uint64_with_commas(stats.queued, b1),
+               edit_uint64_with_commas(stats.bytes, b2),
+               edit_uint64_with_commas(stats.chunks, b3),
+               edit_uint64_with_commas(stats.stalls, b4));
+    sendit(msg, len, sp);
+  }
+
   len = ListFdPlugins(msg);
   if (len > 0) { sendit(msg, len, sp); }
 }
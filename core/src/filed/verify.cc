@@ -29,11 +29,15 @@
 
 #include "include/bareos.h"
 #include "filed/filed.h"
+#include "filed/filed_globals.h"
 #include "findlib/find.h"
 #include "findlib/attribs.h"
 #include "lib/attribs.h"
 #include "lib/bnet.h"
 
+#include <deque>
+#include <vector>
+
 namespace filedaemon {
 
 #ifdef HAVE_DARWIN_OS
@@ -42,16 +46,68 @@ const bool have_darwin_os = true;
 const bool have_darwin_os = false;
 #endif
 
+/* Files queued per verify worker before the find thread waits */
+static const size_t files_per_verify_worker = 64;
+
+/*
+ * A file found by the find thread. The attributes message is built right
+ * away, the digest is calculated by a verify worker or by the find thread
+ * when there are no workers.
+ */
+struct verify_file {
+  int32_t file_index = 0;
+  PoolMem attributes;         /* attributes message for the Director */
+  int32_t attributes_len = 0; /* length including the embedded zeros */
+  PoolMem fname;
+  char flags[FOPTS_BYTES];
+  struct stat statp;
+  int type = 0;
+  struct HfsPlusInfo hfsinfo;
+  DIGEST* digest = NULL;
+  int digest_stream = STREAM_NONE;
+  PoolMem digest_buf; /* base64 encoded digest */
+  const char* digest_name = NULL;
+  PoolMem errmsg; /* errors to report when the file is sent */
+  uint32_t errors = 0;
+  uint64_t bytes = 0; /* bytes read for the digest */
+  bool done = false;
+
+  ~verify_file()
+  {
+    if (digest) { CryptoDigestFree(digest); }
+  }
+};
+
+/*
+ * Verify workers of a job. Files are sent to the Director from the front
+ * of the files list when their digest is done, so the Director sees them
+ * in FileIndex order and every digest right after its attributes.
+ */
+struct verify_ctx {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+  pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+  std::deque<verify_file*> files; /* not yet sent, in FileIndex order */
+  std::deque<verify_file*> todo;  /* waiting for a worker */
+  std::vector<pthread_t> worker_tids;
+  size_t max_files = 0;
+  bool quit = false;
+};
+
 static int VerifyFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool);
 static int ReadDigest(BareosWinFilePacket* bfd,
                       DIGEST* digest,
-                      JobControlRecord* jcr);
-static bool calculate_file_chksum(JobControlRecord* jcr,
-                                  FindFilesPacket* ff_pkt,
-                                  DIGEST** digest,
-                                  int* digest_stream,
-                                  char** digest_buf,
-                                  const char** digest_name);
+                      verify_file* vf);
+static DIGEST* NewFileDigest(JobControlRecord* jcr,
+                             const char* flags,
+                             int* digest_stream);
+static void FillVerifyFile(verify_file* vf, FindFilesPacket* ff_pkt);
+static int DigestVerifyFile(verify_file* vf, DIGEST* digest);
+static void CalculateVerifyFileChksum(verify_file* vf);
+static bool SendVerifyFile(JobControlRecord* jcr, verify_file* vf);
+static bool SendVerifiedFiles(JobControlRecord* jcr, bool flush);
+static void StartVerifyWorkers(JobControlRecord* jcr);
+static void StopVerifyWorkers(JobControlRecord* jcr);
 
 /**
  * Find all the requested files and send attributes
@@ -67,10 +123,13 @@ void DoVerify(JobControlRecord* jcr)
           DEFAULT_NETWORK_BUFFER_SIZE);
   }
   SetFindOptions((FindFilesPacket*)jcr->ff, jcr->incremental, jcr->mtime);
+  StartVerifyWorkers(jcr);
   Dmsg0(10, "Start find files\n");
   /* Subroutine VerifyFile() is called for each file */
   FindFiles(jcr, (FindFilesPacket*)jcr->ff, VerifyFile, NULL);
   Dmsg0(10, "End find files\n");
+  if (jcr->verify_ctx && !JobCanceled(jcr)) { SendVerifiedFiles(jcr, true); }
+  StopVerifyWorkers(jcr);
 
   if (jcr->big_buf) {
     free(jcr->big_buf);
@@ -89,12 +148,12 @@ static int VerifyFile(JobControlRecord* jcr,
                       bool top_level)
 {
   PoolMem attribs(PM_NAME), attribsEx(PM_NAME);
-  int status;
-  BareosSocket* dir;
+  bool status;
+  verify_file* vf;
+  verify_ctx* vctx;
 
   if (JobCanceled(jcr)) { return 0; }
 
-  dir = jcr->dir_bsock;
   jcr->num_files_examined++; /* bump total file count */
 
   switch (ff_pkt->type) {
@@ -199,8 +258,11 @@ static int VerifyFile(JobControlRecord* jcr,
   PmStrcpy(jcr->last_fname, ff_pkt->fname);
   jcr->unlock();
 
+  vf = new verify_file;
+  vf->file_index = jcr->JobFiles;
+
   /*
-   * Send file attributes to Director
+   * Build file attributes message for the Director
    *   File_index
    *   Stream
    *   Verify Options
@@ -215,66 +277,267 @@ static int VerifyFile(JobControlRecord* jcr,
    */
   Dmsg2(400, "send Attributes inx=%d fname=%s\n", jcr->JobFiles, ff_pkt->fname);
   if (ff_pkt->type == FT_LNK || ff_pkt->type == FT_LNKSAVED) {
-    status = dir->fsend("%d %d %s %s%c%s%c%s%c", jcr->JobFiles,
-                        STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts,
-                        ff_pkt->fname, 0, attribs.c_str(), 0, ff_pkt->link, 0);
+    vf->attributes_len = Mmsg(vf->attributes, "%d %d %s %s%c%s%c%s%c",
+                              jcr->JobFiles, STREAM_UNIX_ATTRIBUTES,
+                              ff_pkt->VerifyOpts, ff_pkt->fname, 0,
+                              attribs.c_str(), 0, ff_pkt->link, 0);
   } else if (ff_pkt->type == FT_DIREND || ff_pkt->type == FT_REPARSE ||
              ff_pkt->type == FT_JUNCTION) {
     /*
      * Here link is the canonical filename (i.e. with trailing slash)
      */
-    status =
-        dir->fsend("%d %d %s %s%c%s%c%c", jcr->JobFiles, STREAM_UNIX_ATTRIBUTES,
-                   ff_pkt->VerifyOpts, ff_pkt->link, 0, attribs.c_str(), 0, 0);
+    vf->attributes_len =
+        Mmsg(vf->attributes, "%d %d %s %s%c%s%c%c", jcr->JobFiles,
+             STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts, ff_pkt->link, 0,
+             attribs.c_str(), 0, 0);
   } else {
-    status =
-        dir->fsend("%d %d %s %s%c%s%c%c", jcr->JobFiles, STREAM_UNIX_ATTRIBUTES,
-                   ff_pkt->VerifyOpts, ff_pkt->fname, 0, attribs.c_str(), 0, 0);
+    vf->attributes_len =
+        Mmsg(vf->attributes, "%d %d %s %s%c%s%c%c", jcr->JobFiles,
+             STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts, ff_pkt->fname, 0,
+             attribs.c_str(), 0, 0);
   }
-  Dmsg2(20, "filed>dir: attribs len=%d: msg=%s\n", dir->message_length,
-        dir->msg);
-  if (!status) {
+
+  if (ff_pkt->type != FT_LNKSAVED && S_ISREG(ff_pkt->statp.st_mode)) {
+    FillVerifyFile(vf, ff_pkt);
+    vf->digest = NewFileDigest(jcr, vf->flags, &vf->digest_stream);
+  }
+
+  if (!jcr->verify_ctx || !vf->digest) {
+    if (vf->digest) { CalculateVerifyFileChksum(vf); }
+    vf->done = true;
+  }
+
+  if (!jcr->verify_ctx) {
+    status = SendVerifyFile(jcr, vf);
+    delete vf;
+    return status ? 1 : 0;
+  }
+
+  /*
+   * Queue the file, the attributes are sent when all files found before
+   * it are sent and its digest is calculated.
+   */
+  vctx = jcr->verify_ctx;
+  P(vctx->mutex);
+  vctx->files.push_back(vf);
+  if (!vf->done) {
+    vctx->todo.push_back(vf);
+    pthread_cond_signal(&vctx->work_cond);
+  }
+  V(vctx->mutex);
+
+  return SendVerifiedFiles(jcr, false) ? 1 : 0;
+}
+
+/**
+ * Create the digest context for the Signature selected in the FileSet.
+ * Returns NULL when no Signature is selected or initialization failed, in
+ * the latter case digest_stream is set.
+ */
+static DIGEST* NewFileDigest(JobControlRecord* jcr,
+                             const char* flags,
+                             int* digest_stream)
+{
+  if (BitIsSet(FO_MD5, flags)) {
+    *digest_stream = STREAM_MD5_DIGEST;
+    return crypto_digest_new(jcr, CRYPTO_DIGEST_MD5);
+  } else if (BitIsSet(FO_SHA1, flags)) {
+    *digest_stream = STREAM_SHA1_DIGEST;
+    return crypto_digest_new(jcr, CRYPTO_DIGEST_SHA1);
+  } else if (BitIsSet(FO_SHA256, flags)) {
+    *digest_stream = STREAM_SHA256_DIGEST;
+    return crypto_digest_new(jcr, CRYPTO_DIGEST_SHA256);
+  } else if (BitIsSet(FO_SHA512, flags)) {
+    *digest_stream = STREAM_SHA512_DIGEST;
+    return crypto_digest_new(jcr, CRYPTO_DIGEST_SHA512);
+  } else if (BitIsSet(FO_XXH64, flags)) {
+    *digest_stream = STREAM_XXH64_DIGEST;
+    return crypto_digest_new(jcr, CRYPTO_DIGEST_XXH64);
+  }
+
+  return NULL;
+}
+
+/**
+ * Copy what is needed to read the file of ff_pkt, the find thread reuses
+ * ff_pkt for the next file.
+ */
+static void FillVerifyFile(verify_file* vf, FindFilesPacket* ff_pkt)
+{
+  PmStrcpy(vf->fname, ff_pkt->fname);
+  memcpy(vf->flags, ff_pkt->flags, sizeof(vf->flags));
+  memcpy(&vf->statp, &ff_pkt->statp, sizeof(vf->statp));
+  vf->type = ff_pkt->type;
+  memcpy(&vf->hfsinfo, &ff_pkt->hfsinfo, sizeof(vf->hfsinfo));
+}
+
+/**
+ * Send the attributes and the digest of a file to the Director and report
+ * the errors found while reading it.
+ */
+static bool SendVerifyFile(JobControlRecord* jcr, verify_file* vf)
+{
+  BareosSocket* dir = jcr->dir_bsock;
+
+  if (!dir->send(vf->attributes.c_str(), vf->attributes_len)) {
     Jmsg(jcr, M_FATAL, 0, _("Network error in send to Director: ERR=%s\n"),
          BnetStrerror(dir));
-    return 0;
+    return false;
   }
+  Dmsg2(20, "filed>dir: attribs len=%d: msg=%s\n", dir->message_length,
+        dir->msg);
 
-  if (ff_pkt->type != FT_LNKSAVED && S_ISREG(ff_pkt->statp.st_mode) &&
-      (BitIsSet(FO_MD5, ff_pkt->flags) || BitIsSet(FO_SHA1, ff_pkt->flags) ||
-       BitIsSet(FO_SHA256, ff_pkt->flags) ||
-       BitIsSet(FO_SHA512, ff_pkt->flags))) {
-    int digest_stream = STREAM_NONE;
-    DIGEST* digest = NULL;
-    char* digest_buf = NULL;
-    const char* digest_name = NULL;
-
-    if (calculate_file_chksum(jcr, ff_pkt, &digest, &digest_stream, &digest_buf,
-                              &digest_name)) {
-      /*
-       * Did digest initialization fail?
-       */
-      if (digest_stream != STREAM_NONE && digest == NULL) {
-        Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
-             stream_to_ascii(digest_stream));
-      } else if (digest && digest_buf) {
-        Dmsg3(400, "send inx=%d %s=%s\n", jcr->JobFiles, digest_name,
-              digest_buf);
-        dir->fsend("%d %d %s *%s-%d*", jcr->JobFiles, digest_stream, digest_buf,
-                   digest_name, jcr->JobFiles);
-        Dmsg3(20, "filed>dir: %s len=%d: msg=%s\n", digest_name,
-              dir->message_length, dir->msg);
-      }
+  if (vf->errors) {
+    Jmsg(jcr, M_ERROR, 1, "%s", vf->errmsg.c_str());
+    jcr->JobErrors += vf->errors;
+  }
+
+  /*
+   * Can be used by BaseJobs or with accurate, update only for Verify
+   * jobs
+   */
+  if (jcr->is_JobType(JT_VERIFY)) { jcr->JobBytes += vf->bytes; }
+  jcr->ReadBytes += vf->bytes;
+
+  /*
+   * Did digest initialization fail?
+   */
+  if (vf->digest_stream != STREAM_NONE && vf->digest == NULL) {
+    Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
+         stream_to_ascii(vf->digest_stream));
+  } else if (vf->digest && vf->digest_name) {
+    Dmsg3(400, "send inx=%d %s=%s\n", vf->file_index, vf->digest_name,
+          vf->digest_buf.c_str());
+    dir->fsend("%d %d %s *%s-%d*", vf->file_index, vf->digest_stream,
+               vf->digest_buf.c_str(), vf->digest_name, vf->file_index);
+    Dmsg3(20, "filed>dir: %s len=%d: msg=%s\n", vf->digest_name,
+          dir->message_length, dir->msg);
+  }
+
+  return true;
+}
+
+/**
+ * Send the files at the front of the queue whose digest is done. Waits
+ * for the front file while the queue is full, or until all files are sent
+ * when flush is set.
+ *
+ * Returns: false on a network error
+ */
+static bool SendVerifiedFiles(JobControlRecord* jcr, bool flush)
+{
+  verify_ctx* vctx = jcr->verify_ctx;
+  verify_file* vf;
+  bool status;
+
+  while (1) {
+    P(vctx->mutex);
+    while (!vctx->files.empty() && !vctx->files.front()->done &&
+           (flush || vctx->files.size() >= vctx->max_files)) {
+      pthread_cond_wait(&vctx->done_cond, &vctx->mutex);
     }
 
-    /*
-     * Cleanup.
-     */
-    if (digest_buf) { free(digest_buf); }
+    if (vctx->files.empty() || !vctx->files.front()->done) {
+      V(vctx->mutex);
+      return true;
+    }
 
-    if (digest) { CryptoDigestFree(digest); }
+    vf = vctx->files.front();
+    vctx->files.pop_front();
+    V(vctx->mutex);
+
+    status = SendVerifyFile(jcr, vf);
+    delete vf;
+    if (!status) { return false; }
   }
+}
+
+/**
+ * Verify worker, reads the queued files and calculates their digests.
+ */
+extern "C" void* verify_worker_thread(void* arg)
+{
+  JobControlRecord* jcr = (JobControlRecord*)arg;
+  verify_ctx* vctx = jcr->verify_ctx;
+  verify_file* vf;
+
+  while (1) {
+    P(vctx->mutex);
+    while (vctx->todo.empty() && !vctx->quit) {
+      pthread_cond_wait(&vctx->work_cond, &vctx->mutex);
+    }
+
+    if (vctx->quit) {
+      V(vctx->mutex);
+      break;
+    }
+
+    vf = vctx->todo.front();
+    vctx->todo.pop_front();
+    V(vctx->mutex);
+
+    if (!JobCanceled(jcr)) { CalculateVerifyFileChksum(vf); }
+
+    P(vctx->mutex);
+    vf->done = true;
+    pthread_cond_broadcast(&vctx->done_cond);
+    V(vctx->mutex);
+  }
+
+  return NULL;
+}
+
+/**
+ * Start the verify workers of a job, the number of workers is the
+ * Digest Workers setting of the Client.
+ */
+static void StartVerifyWorkers(JobControlRecord* jcr)
+{
+  verify_ctx* vctx;
+  pthread_t tid;
+
+  if (!me->digest_workers) { return; }
+
+  vctx = new verify_ctx;
+  vctx->max_files = files_per_verify_worker * me->digest_workers;
+  jcr->verify_ctx = vctx;
+
+  for (uint32_t i = 0; i < me->digest_workers; i++) {
+    if (pthread_create(&tid, NULL, verify_worker_thread, (void*)jcr) != 0) {
+      break;
+    }
+    vctx->worker_tids.push_back(tid);
+  }
+
+  if (vctx->worker_tids.empty()) {
+    delete vctx;
+    jcr->verify_ctx = NULL;
+    return;
+  }
+
+  Dmsg1(50, "Started %d verify workers\n", (int)vctx->worker_tids.size());
+}
+
+/**
+ * Stop the verify workers of a job, files not sent yet are dropped.
+ */
+static void StopVerifyWorkers(JobControlRecord* jcr)
+{
+  verify_ctx* vctx = jcr->verify_ctx;
+
+  if (!vctx) { return; }
+
+  P(vctx->mutex);
+  vctx->quit = true;
+  pthread_cond_broadcast(&vctx->work_cond);
+  V(vctx->mutex);
+
+  for (pthread_t tid : vctx->worker_tids) { pthread_join(tid, NULL); }
+
+  for (verify_file* vf : vctx->files) { delete vf; }
 
-  return 1;
+  jcr->verify_ctx = NULL;
+  delete vctx;
 }
 
 /**
@@ -282,46 +545,75 @@ static int VerifyFile(JobControlRecord* jcr,
  * In case of errors we need the job control record and file name.
  */
 int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
+{
+  verify_file vf;
+  int status;
+
+  FillVerifyFile(&vf, ff_pkt);
+  status = DigestVerifyFile(&vf, digest);
+  if (status != 0) { ff_pkt->ff_errno = errno; }
+  if (vf.errors) {
+    Jmsg(jcr, M_ERROR, 1, "%s", vf.errmsg.c_str());
+    if (status == 0) { jcr->JobErrors += vf.errors; }
+  }
+
+  /* Can be used by BaseJobs or with accurate, update only for Verify
+   * jobs
+   */
+  if (jcr->is_JobType(JT_VERIFY)) { jcr->JobBytes += vf.bytes; }
+  jcr->ReadBytes += vf.bytes;
+
+  return status;
+}
+
+/**
+ * Compute message digest for the file specified by vf. Does not use Jmsg as
+ * it runs in the verify workers, errors are collected in vf->errmsg.
+ *
+ * Returns: 0 on success, 1 if the file could not be opened
+ */
+static int DigestVerifyFile(verify_file* vf, DIGEST* digest)
 {
   BareosWinFilePacket bfd;
+  PoolMem errmsg;
 
   binit(&bfd);
 
-  int noatime = BitIsSet(FO_NOATIME, ff_pkt->flags) ? O_NOATIME : 0;
+  int noatime = BitIsSet(FO_NOATIME, vf->flags) ? O_NOATIME : 0;
 
-  if ((bopen(&bfd, ff_pkt->fname, O_RDONLY | O_BINARY | noatime, 0,
-             ff_pkt->statp.st_rdev)) < 0) {
-    ff_pkt->ff_errno = errno;
+  if ((bopen(&bfd, vf->fname.c_str(), O_RDONLY | O_BINARY | noatime, 0,
+             vf->statp.st_rdev)) < 0) {
     BErrNo be;
     be.SetErrno(bfd.BErrNo);
-    Dmsg2(100, "Cannot open %s: ERR=%s\n", ff_pkt->fname, be.bstrerror());
-    Jmsg(jcr, M_ERROR, 1, _("     Cannot open %s: ERR=%s.\n"), ff_pkt->fname,
+    Dmsg2(100, "Cannot open %s: ERR=%s\n", vf->fname.c_str(), be.bstrerror());
+    Mmsg(errmsg, _("     Cannot open %s: ERR=%s.\n"), vf->fname.c_str(),
          be.bstrerror());
+    PmStrcat(vf->errmsg, errmsg.c_str());
+    vf->errors++;
     return 1;
   }
-  ReadDigest(&bfd, digest, jcr);
+  ReadDigest(&bfd, digest, vf);
   bclose(&bfd);
 
   if (have_darwin_os) {
     /*
      * Open resource fork if necessary
      */
-    if (BitIsSet(FO_HFSPLUS, ff_pkt->flags) && ff_pkt->hfsinfo.rsrclength > 0) {
-      if (BopenRsrc(&bfd, ff_pkt->fname, O_RDONLY | O_BINARY, 0) < 0) {
-        ff_pkt->ff_errno = errno;
+    if (BitIsSet(FO_HFSPLUS, vf->flags) && vf->hfsinfo.rsrclength > 0) {
+      if (BopenRsrc(&bfd, vf->fname.c_str(), O_RDONLY | O_BINARY, 0) < 0) {
         BErrNo be;
-        Jmsg(jcr, M_ERROR, -1,
-             _("     Cannot open resource fork for %s: ERR=%s.\n"),
-             ff_pkt->fname, be.bstrerror());
-        if (IsBopen(&ff_pkt->bfd)) { bclose(&ff_pkt->bfd); }
+        Mmsg(errmsg, _("     Cannot open resource fork for %s: ERR=%s.\n"),
+             vf->fname.c_str(), be.bstrerror());
+        PmStrcat(vf->errmsg, errmsg.c_str());
+        vf->errors++;
         return 1;
       }
-      ReadDigest(&bfd, digest, jcr);
+      ReadDigest(&bfd, digest, vf);
       bclose(&bfd);
     }
 
-    if (digest && BitIsSet(FO_HFSPLUS, ff_pkt->flags)) {
-      CryptoDigestUpdate(digest, (uint8_t*)ff_pkt->hfsinfo.fndrinfo, 32);
+    if (digest && BitIsSet(FO_HFSPLUS, vf->flags)) {
+      CryptoDigestUpdate(digest, (uint8_t*)vf->hfsinfo.fndrinfo, 32);
     }
   }
   return 0;
@@ -329,27 +621,26 @@ int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
 
 /**
  * Read message digest of bfd, updating digest
- * In case of errors we need the job control record and file name.
+ * In case of errors we need the file name.
  */
 static int ReadDigest(BareosWinFilePacket* bfd,
                       DIGEST* digest,
-                      JobControlRecord* jcr)
+                      verify_file* vf)
 {
   char buf[DEFAULT_NETWORK_BUFFER_SIZE];
   int64_t n;
   int64_t bufsiz = (int64_t)sizeof(buf);
-  FindFilesPacket* ff_pkt = (FindFilesPacket*)jcr->ff;
   uint64_t fileAddr = 0; /* file address */
 
 
   Dmsg0(50, "=== ReadDigest\n");
   while ((n = bread(bfd, buf, bufsiz)) > 0) {
     /* Check for sparse blocks */
-    if (BitIsSet(FO_SPARSE, ff_pkt->flags)) {
+    if (BitIsSet(FO_SPARSE, vf->flags)) {
       bool allZeros = false;
-      if ((n == bufsiz && fileAddr + n < (uint64_t)ff_pkt->statp.st_size) ||
-          ((ff_pkt->type == FT_RAW || ff_pkt->type == FT_FIFO) &&
-           (uint64_t)ff_pkt->statp.st_size == 0)) {
+      if ((n == bufsiz && fileAddr + n < (uint64_t)vf->statp.st_size) ||
+          ((vf->type == FT_RAW || vf->type == FT_FIFO) &&
+           (uint64_t)vf->statp.st_size == 0)) {
         allZeros = IsBufZero(buf, bufsiz);
       }
       fileAddr += n; /* update file address */
@@ -358,83 +649,46 @@ static int ReadDigest(BareosWinFilePacket* bfd,
     }
 
     CryptoDigestUpdate(digest, (uint8_t*)buf, n);
-
-    /* Can be used by BaseJobs or with accurate, update only for Verify
-     * jobs
-     */
-    if (jcr->is_JobType(JT_VERIFY)) { jcr->JobBytes += n; }
-    jcr->ReadBytes += n;
+    vf->bytes += n;
   }
   if (n < 0) {
     BErrNo be;
+    PoolMem errmsg;
     be.SetErrno(bfd->BErrNo);
-    Dmsg2(100, "Error reading file %s: ERR=%s\n", jcr->last_fname,
+    Dmsg2(100, "Error reading file %s: ERR=%s\n", vf->fname.c_str(),
           be.bstrerror());
-    Jmsg(jcr, M_ERROR, 1, _("Error reading file %s: ERR=%s\n"), jcr->last_fname,
+    Mmsg(errmsg, _("Error reading file %s: ERR=%s\n"), vf->fname.c_str(),
          be.bstrerror());
-    jcr->JobErrors++;
+    PmStrcat(vf->errmsg, errmsg.c_str());
+    vf->errors++;
     return -1;
   }
   return 0;
 }
 
 /**
- * Calculate the chksum of a whole file and updates:
- * - digest
- * - digest_stream
- * - digest_buffer
- * - digest_name
+ * Calculate the chksum of a whole file into vf->digest_buf, the digest
+ * context vf->digest must have been created by NewFileDigest().
  *
- * Returns: true   if digest calculation succeeded.
- *          false  if digest calculation failed.
+ * When the file cannot be read digest_name stays NULL.
  */
-static bool calculate_file_chksum(JobControlRecord* jcr,
-                                  FindFilesPacket* ff_pkt,
-                                  DIGEST** digest,
-                                  int* digest_stream,
-                                  char** digest_buf,
-                                  const char** digest_name)
+static void CalculateVerifyFileChksum(verify_file* vf)
 {
-  /*
-   * Create our digest context.
-   * If this fails, the digest will be set to NULL and not used.
-   */
-  if (BitIsSet(FO_MD5, ff_pkt->flags)) {
-    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_MD5);
-    *digest_stream = STREAM_MD5_DIGEST;
-  } else if (BitIsSet(FO_SHA1, ff_pkt->flags)) {
-    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_SHA1);
-    *digest_stream = STREAM_SHA1_DIGEST;
-  } else if (BitIsSet(FO_SHA256, ff_pkt->flags)) {
-    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_SHA256);
-    *digest_stream = STREAM_SHA256_DIGEST;
-  } else if (BitIsSet(FO_SHA512, ff_pkt->flags)) {
-    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_SHA512);
-    *digest_stream = STREAM_SHA512_DIGEST;
-  }
+  uint32_t size;
+  char md[CRYPTO_DIGEST_MAX_SIZE];
 
   /*
    * compute MD5 or SHA1 hash
    */
-  if (*digest) {
-    uint32_t size;
-    char md[CRYPTO_DIGEST_MAX_SIZE];
+  size = sizeof(md);
+  if (DigestVerifyFile(vf, vf->digest) != 0) { return; }
 
-    size = sizeof(md);
-    if (DigestFile(jcr, ff_pkt, *digest) != 0) {
-      jcr->JobErrors++;
-      return false;
-    }
-
-    if (CryptoDigestFinalize(*digest, (uint8_t*)md, &size)) {
-      *digest_buf = (char*)malloc(BASE64_SIZE(size));
-      *digest_name = crypto_digest_name(*digest);
+  if (CryptoDigestFinalize(vf->digest, (uint8_t*)md, &size)) {
+    vf->digest_buf.check_size(BASE64_SIZE(size));
+    vf->digest_name = crypto_digest_name(vf->digest);
 
-      BinToBase64(*digest_buf, BASE64_SIZE(size), md, size, true);
-    }
+    BinToBase64(vf->digest_buf.c_str(), BASE64_SIZE(size), md, size, true);
   }
-
-  return true;
 }
 
 /**
@@ -448,29 +702,29 @@ bool CalculateAndCompareFileChksum(JobControlRecord* jcr,
                                    const char* fname,
                                    const char* chksum)
 {
-  DIGEST* digest = NULL;
-  int digest_stream = STREAM_NONE;
-  char* digest_buf = NULL;
-  const char* digest_name;
+  verify_file vf;
   bool retval = false;
 
-  if (calculate_file_chksum(jcr, ff_pkt, &digest, &digest_stream, &digest_buf,
-                            &digest_name)) {
-    if (digest_stream != STREAM_NONE && digest == NULL) {
-      Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
-           stream_to_ascii(digest_stream));
-    } else if (digest && digest_buf) {
-      if (!bstrcmp(digest_buf, chksum)) {
-        Dmsg4(100, "%s      %s chksum  diff. Cat: %s File: %s\n", fname,
-              digest_name, chksum, digest_buf);
-      } else {
-        retval = true;
-      }
-    }
+  FillVerifyFile(&vf, ff_pkt);
+  vf.digest = NewFileDigest(jcr, vf.flags, &vf.digest_stream);
+  if (vf.digest) { CalculateVerifyFileChksum(&vf); }
 
-    if (digest_buf) { free(digest_buf); }
-
-    if (digest) { CryptoDigestFree(digest); }
+  if (vf.errors) {
+    Jmsg(jcr, M_ERROR, 1, "%s", vf.errmsg.c_str());
+    jcr->JobErrors += vf.errors;
+  }
+  jcr->ReadBytes += vf.bytes;
+
+  if (vf.digest_stream != STREAM_NONE && vf.digest == NULL) {
+    Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
+         stream_to_ascii(vf.digest_stream));
+  } else if (vf.digest && vf.digest_name) {
+    if (!bstrcmp(vf.digest_buf.c_str(), chksum)) {
+      Dmsg4(100, "%s      %s chksum  diff. Cat: %s File: %s\n", fname,
+            vf.digest_name, chksum, vf.digest_buf.c_str());
+    } else {
+      retval = true;
+    }
   }
 
   return retval;
@@ -56,6 +56,7 @@ void DoVerifyVolume(JobControlRecord* jcr)
   uint32_t VolSessionId, VolSessionTime, file_index;
   uint32_t record_file_index;
   char digest[BASE64_SIZE(CRYPTO_DIGEST_MAX_SIZE)];
+  char encoded_stat[MAX_ENCODED_STAT_LENGTH];
   int type, status;
 
   sd = jcr->store_bsock;
@@ -119,6 +120,7 @@ void DoVerifyVolume(JobControlRecord* jcr)
     switch (stream) {
       case STREAM_UNIX_ATTRIBUTES:
       case STREAM_UNIX_ATTRIBUTES_EX:
+      case STREAM_UNIX_ATTRIBUTES_BINARY:
         char *ap, *lp, *fp;
 
         Dmsg0(400, "Stream=Unix Attributes.\n");
@@ -133,40 +135,63 @@ void DoVerifyVolume(JobControlRecord* jcr)
         *fname = 0;
         *lname = 0;
 
-        /*
-         * An Attributes record consists of:
-         *    File_index
-         *    Type   (FT_types)
-         *    Filename
-         *    Attributes
-         *    Link name (if file linked i.e. FT_LNK)
-         *    Extended Attributes (if Win32)
-         */
-        if (sscanf(sd->msg, "%d %d", &record_file_index, &type) != 2) {
-          Jmsg(jcr, M_FATAL, 0, _("Error scanning record header: %s\n"),
-               sd->msg);
-          Dmsg0(0, "\nError scanning header\n");
-          goto bail_out;
-        }
-        Dmsg2(30, "Got Attr: FilInx=%d type=%d\n", record_file_index, type);
-        ap = sd->msg;
-        while (*ap++ != ' ') /* skip record file index */
-          ;
-        while (*ap++ != ' ') /* skip type */
-          ;
-        /* Save filename and position to attributes */
-        fp = fname;
-        while (*ap != 0) { *fp++ = *ap++; /* copy filename to fname */ }
-        *fp = *ap++; /* Terminate filename & point to attribs */
-
-        Dmsg1(200, "Attr=%s\n", ap);
-        /* Skip to Link name */
-        if (type == FT_LNK || type == FT_LNKSAVED) {
-          lp = ap;
-          while (*lp++ != 0) { ; }
-          PmStrcat(lname, lp); /* "save" link name */
+        if (stream == STREAM_UNIX_ATTRIBUTES_BINARY) {
+          BinaryAttributes attribs;
+
+          if (!DecodeAttributesBinary(sd->msg, sd->message_length,
+                                      &attribs)) {
+            Jmsg(jcr, M_FATAL, 0, _("Error decoding binary attributes.\n"));
+            goto bail_out;
+          }
+          record_file_index = attribs.file_index;
+          type = attribs.type;
+          PmStrcpy(fname, attribs.fname);
+          if (type == FT_LNK || type == FT_LNKSAVED) {
+            PmStrcpy(lname, attribs.link);
+          }
+
+          /*
+           * The Director compares the base64 encoded stat packet.
+           */
+          EncodeStat(encoded_stat, &attribs.statp, sizeof(attribs.statp),
+                     attribs.LinkFI, attribs.data_stream);
+          ap = encoded_stat;
         } else {
-          *lname = 0;
+          /*
+           * An Attributes record consists of:
+           *    File_index
+           *    Type   (FT_types)
+           *    Filename
+           *    Attributes
+           *    Link name (if file linked i.e. FT_LNK)
+           *    Extended Attributes (if Win32)
+           */
+          if (sscanf(sd->msg, "%d %d", &record_file_index, &type) != 2) {
+            Jmsg(jcr, M_FATAL, 0, _("Error scanning record header: %s\n"),
+                 sd->msg);
+            Dmsg0(0, "\nError scanning header\n");
+            goto bail_out;
+          }
+          Dmsg2(30, "Got Attr: FilInx=%d type=%d\n", record_file_index, type);
+          ap = sd->msg;
+          while (*ap++ != ' ') /* skip record file index */
+            ;
+          while (*ap++ != ' ') /* skip type */
+            ;
+          /* Save filename and position to attributes */
+          fp = fname;
+          while (*ap != 0) { *fp++ = *ap++; /* copy filename to fname */ }
+          *fp = *ap++; /* Terminate filename & point to attribs */
+
+          Dmsg1(200, "Attr=%s\n", ap);
+          /* Skip to Link name */
+          if (type == FT_LNK || type == FT_LNKSAVED) {
+            lp = ap;
+            while (*lp++ != 0) { ; }
+            PmStrcat(lname, lp); /* "save" link name */
+          } else {
+            *lname = 0;
+          }
         }
         jcr->lock();
         jcr->JobFiles++;
@@ -250,6 +275,16 @@ void DoVerifyVolume(JobControlRecord* jcr)
               dir->msg);
         break;
 
+      case STREAM_XXH64_DIGEST:
+        BinToBase64(digest, sizeof(digest), (char*)sd->msg,
+                    CRYPTO_DIGEST_XXH64_SIZE, true);
+        Dmsg2(400, "send inx=%d XXH64=%s\n", jcr->JobFiles, digest);
+        dir->fsend("%d %d %s *XXH64-%d*", jcr->JobFiles, STREAM_XXH64_DIGEST,
+                   digest, jcr->JobFiles);
+        Dmsg2(20, "filed>dir: XXH64 len=%d: msg=%s\n", dir->message_length,
+              dir->msg);
+        break;
+
       case STREAM_RESTORE_OBJECT:
         jcr->lock();
         jcr->JobFiles++;
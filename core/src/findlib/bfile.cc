@@ -109,6 +109,8 @@ const char* stream_to_ascii(int stream)
       return _("Compressed data");
     case STREAM_UNIX_ATTRIBUTES_EX:
       return _("Extended attributes");
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
+      return _("Binary Unix attributes");
     case STREAM_SPARSE_DATA:
       return _("Sparse data");
     case STREAM_SPARSE_GZIP_DATA:
@@ -139,6 +141,8 @@ const char* stream_to_ascii(int stream)
       return _("SHA256 digest");
     case STREAM_SHA512_DIGEST:
       return _("SHA512 digest");
+    case STREAM_XXH64_DIGEST:
+      return _("XXH64 digest");
     case STREAM_SIGNED_DIGEST:
       return _("Signed digest");
     case STREAM_ENCRYPTED_FILE_DATA:
@@ -456,10 +460,12 @@ bool IsRestoreStreamSupported(int stream)
     case STREAM_FILE_DATA:
     case STREAM_MD5_DIGEST:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
     case STREAM_SPARSE_DATA:
     case STREAM_PROGRAM_NAMES:
     case STREAM_PROGRAM_DATA:
     case STREAM_SHA1_DIGEST:
+    case STREAM_XXH64_DIGEST:
 #ifdef HAVE_SHA2
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
@@ -1060,10 +1066,12 @@ bool IsRestoreStreamSupported(int stream)
     case STREAM_FILE_DATA:
     case STREAM_MD5_DIGEST:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
     case STREAM_SPARSE_DATA:
     case STREAM_PROGRAM_NAMES:
     case STREAM_PROGRAM_DATA:
     case STREAM_SHA1_DIGEST:
+    case STREAM_XXH64_DIGEST:
 #ifdef HAVE_SHA2
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
@@ -36,6 +36,7 @@
 #include "include/jcr.h"
 #include "find.h"
 #include "findlib/find_one.h"
+#include "findlib/pattern_matcher.h"
 
 static const int debuglevel = 450;
 
@@ -236,6 +237,76 @@ bool IsInFileset(FindFilesPacket* ff)
   return false;
 }
 
+/**
+ * The wild cards of an include or exclude block compiled for AcceptFile().
+ * For every options block we keep the id of the first pattern of each list,
+ * the ids of the patterns of a list are consecutive.
+ */
+struct findCompiledPatterns {
+  struct OptionsIds {
+    int wilddir;
+    int wildfile;
+    int wild;
+    int wildbase;
+  };
+
+  PatternMatcher fname_patterns;    /* wilddir, wildfile, wild and names */
+  PatternMatcher basename_patterns; /* wildbase */
+  std::vector<OptionsIds> options;
+  int names;
+};
+
+static inline int AddPatterns(PatternMatcher& matcher, alist& patterns)
+{
+  int first = matcher.size();
+
+  for (int k = 0; k < patterns.size(); k++) {
+    matcher.AddPattern((char*)patterns.get(k));
+  }
+
+  return first;
+}
+
+static findCompiledPatterns* CompilePatterns(findIncludeExcludeItem* incexe,
+                                             bool with_names)
+{
+  dlistString* node;
+  findCompiledPatterns* compiled = new findCompiledPatterns;
+
+  for (int j = 0; j < incexe->opts_list.size(); j++) {
+    findFOPTS* fo = (findFOPTS*)incexe->opts_list.get(j);
+    findCompiledPatterns::OptionsIds ids;
+
+    ids.wilddir = AddPatterns(compiled->fname_patterns, fo->wilddir);
+    ids.wildfile = AddPatterns(compiled->fname_patterns, fo->wildfile);
+    ids.wild = AddPatterns(compiled->fname_patterns, fo->wild);
+    ids.wildbase = AddPatterns(compiled->basename_patterns, fo->wildbase);
+    compiled->options.push_back(ids);
+  }
+
+  compiled->names = compiled->fname_patterns.size();
+  if (with_names) {
+    foreach_dlist (node, &incexe->name_list) {
+      compiled->fname_patterns.AddPattern(node->c_str());
+    }
+  }
+
+  compiled->fname_patterns.Compile();
+  compiled->basename_patterns.Compile();
+  Dmsg2(debuglevel, "compiled %d filename and %d basename patterns\n",
+        compiled->fname_patterns.size(), compiled->basename_patterns.size());
+
+  return compiled;
+}
+
+void FreeCompiledPatterns(findIncludeExcludeItem* incexe)
+{
+  if (incexe->compiled) {
+    delete incexe->compiled;
+    incexe->compiled = NULL;
+  }
+}
+
 bool AcceptFile(FindFilesPacket* ff)
 {
   int i, j, k;
@@ -243,6 +314,7 @@ bool AcceptFile(FindFilesPacket* ff)
   const char* basename;
   findFILESET* fileset = ff->fileset;
   findIncludeExcludeItem* incexe = fileset->incexe;
+  findCompiledPatterns* compiled;
   int (*match_func)(const char* pattern, const char* string, int flags);
 
   Dmsg1(debuglevel, "enter AcceptFile: fname=%s\n", ff->fname);
@@ -257,8 +329,18 @@ bool AcceptFile(FindFilesPacket* ff)
     basename = ff->fname;
   }
 
+  /*
+   * Find the wild cards that can match in one pass over the names, only
+   * those are checked by the match function below.
+   */
+  if (!incexe->compiled) { incexe->compiled = CompilePatterns(incexe, false); }
+  compiled = incexe->compiled;
+  compiled->fname_patterns.Scan(ff->fname);
+  compiled->basename_patterns.Scan(basename);
+
   for (j = 0; j < incexe->opts_list.size(); j++) {
     findFOPTS* fo;
+    const findCompiledPatterns::OptionsIds& ids = compiled->options[j];
 
     fo = (findFOPTS*)incexe->opts_list.get(j);
     CopyBits(FO_MAX, fo->flags, ff->flags);
@@ -272,6 +354,7 @@ bool AcceptFile(FindFilesPacket* ff)
 
     if (S_ISDIR(ff->statp.st_mode)) {
       for (k = 0; k < fo->wilddir.size(); k++) {
+        if (!compiled->fname_patterns.MayMatch(ids.wilddir + k)) { continue; }
         if (match_func((char*)fo->wilddir.get(k), ff->fname,
                        fnmode | fnm_flags) == 0) {
           if (BitIsSet(FO_EXCLUDE, ff->flags)) {
@@ -284,6 +367,7 @@ bool AcceptFile(FindFilesPacket* ff)
       }
     } else {
       for (k = 0; k < fo->wildfile.size(); k++) {
+        if (!compiled->fname_patterns.MayMatch(ids.wildfile + k)) { continue; }
         if (match_func((char*)fo->wildfile.get(k), ff->fname,
                        fnmode | fnm_flags) == 0) {
           if (BitIsSet(FO_EXCLUDE, ff->flags)) {
@@ -296,6 +380,9 @@ bool AcceptFile(FindFilesPacket* ff)
       }
 
       for (k = 0; k < fo->wildbase.size(); k++) {
+        if (!compiled->basename_patterns.MayMatch(ids.wildbase + k)) {
+          continue;
+        }
         if (match_func((char*)fo->wildbase.get(k), basename,
                        fnmode | fnm_flags) == 0) {
           if (BitIsSet(FO_EXCLUDE, ff->flags)) {
@@ -309,6 +396,7 @@ bool AcceptFile(FindFilesPacket* ff)
     }
 
     for (k = 0; k < fo->wild.size(); k++) {
+      if (!compiled->fname_patterns.MayMatch(ids.wild + k)) { continue; }
       if (match_func((char*)fo->wild.get(k), ff->fname, fnmode | fnm_flags) ==
           0) {
         if (BitIsSet(FO_EXCLUDE, ff->flags)) {
@@ -369,10 +457,17 @@ bool AcceptFile(FindFilesPacket* ff)
     findIncludeExcludeItem* incexe =
         (findIncludeExcludeItem*)fileset->exclude_list.get(i);
 
+    if (!incexe->compiled) { incexe->compiled = CompilePatterns(incexe, true); }
+    compiled = incexe->compiled;
+    compiled->fname_patterns.Scan(ff->fname);
+
     for (j = 0; j < incexe->opts_list.size(); j++) {
       findFOPTS* fo = (findFOPTS*)incexe->opts_list.get(j);
+      const findCompiledPatterns::OptionsIds& ids = compiled->options[j];
+
       fnm_flags = BitIsSet(FO_IGNORECASE, fo->flags) ? FNM_CASEFOLD : 0;
       for (k = 0; k < fo->wild.size(); k++) {
+        if (!compiled->fname_patterns.MayMatch(ids.wild + k)) { continue; }
         if (fnmatch((char*)fo->wild.get(k), ff->fname, fnmode | fnm_flags) ==
             0) {
           Dmsg1(debuglevel, "Reject wild1: %s\n", ff->fname);
@@ -384,9 +479,11 @@ bool AcceptFile(FindFilesPacket* ff)
                  BitIsSet(FO_IGNORECASE, incexe->current_opts->flags))
                     ? FNM_CASEFOLD
                     : 0;
+    k = compiled->names;
     foreach_dlist (node, &incexe->name_list) {
       char* fname = node->c_str();
 
+      if (!compiled->fname_patterns.MayMatch(k++)) { continue; }
       if (fnmatch(fname, ff->fname, fnmode | fnm_flags) == 0) {
         Dmsg1(debuglevel, "Reject wild2: %s\n", ff->fname);
         return false; /* reject file */
@@ -154,11 +154,14 @@ struct findFOPTS {
   alist Drivetype;                   /**< Drive type limitation */
 };
 
+struct findCompiledPatterns;
+
 /**
  * This is either an include item or an exclude item
  */
 struct findIncludeExcludeItem {
   findFOPTS* current_opts; /**< Points to current options structure */
+  findCompiledPatterns* compiled; /**< Wild cards compiled by AcceptFile() */
   alist opts_list;         /**< Options list */
   dlist name_list;         /**< Filename list -- holds dlistString */
   dlist plugin_list;       /**< Plugin list -- holds dlistString */
@@ -233,6 +236,8 @@ struct FindFilesPacket {
   time_t save_time;           /**< Start of incremental time */
   bool accurate_found;        /**< Found in the accurate hash (valid after
                                  CheckChanges()) */
+  bool accurate_pruned;       /**< Directory tree unchanged, do not descend
+                                 (valid after CheckChanges()) */
   bool dereference;           /**< Follow links (not implemented) */
   bool null_output_device;    /**< Using null output device */
   bool incremental;           /**< Incremental save */
@@ -299,6 +304,7 @@ int TermFindFiles(FindFilesPacket* ff);
 bool IsInFileset(FindFilesPacket* ff);
 bool AcceptFile(FindFilesPacket* ff);
 findIncludeExcludeItem* allocate_new_incexe(void);
+void FreeCompiledPatterns(findIncludeExcludeItem* incexe);
 findIncludeExcludeItem* new_exclude(findFILESET* fileset);
 findIncludeExcludeItem* new_include(findFILESET* fileset);
 findIncludeExcludeItem* new_preinclude(findFILESET* fileset);
@@ -678,8 +678,13 @@ static inline int process_directory(JobControlRecord* jcr,
    * If we are crossing file systems, we are either not allowed
    * to cross, or we may be restricted by a list of permitted
    * file systems.
+   *
+   * In accurate mode the whole tree of an unchanged directory
+   * may already be accounted for.
    */
-  if (!top_level && BitIsSet(FO_NO_RECURSION, ff_pkt->flags)) {
+  if (ff_pkt->type == FT_DIRNOCHG && ff_pkt->accurate_pruned) {
+    recurse = false;
+  } else if (!top_level && BitIsSet(FO_NO_RECURSION, ff_pkt->flags)) {
     ff_pkt->type = FT_NORECURSE;
     recurse = false;
   } else if (!top_level &&
@@ -285,6 +285,10 @@ void AddFnameToIncludeList(FindFilesPacket* ff, int prefixed, const char* fname)
               rp++;
               break;
 #endif
+            case '4':
+              SetBit(FO_XXH64, inc->options);
+              rp++;
+              break;
             default:
               /*
                * If 2 or 3 is seen here, SHA2 is not configured, so
@@ -0,0 +1,210 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Prefilter for matching a filename against many fnmatch() patterns.
+ */
+
+#include "include/bareos.h"
+#include "findlib/pattern_matcher.h"
+
+#include <deque>
+
+/*
+ * Literal runs and filenames are compared case insensitive the same way as
+ * fnmatch() does with FNM_CASEFOLD, a case sensitive pattern is still
+ * checked by fnmatch() itself.
+ */
+static inline unsigned char FoldChar(unsigned char c)
+{
+  return B_ISUPPER(c) ? tolower(c) : c;
+}
+
+/*
+ * Get the longest run of characters in a pattern that fnmatch() compares
+ * literally. A bracket expression ends the scan as without parsing it we
+ * can't tell where the literal characters continue.
+ */
+static std::string LongestLiteral(const char* pattern)
+{
+  std::string run, longest;
+  const char* p = pattern;
+
+  while (*p) {
+    switch (*p) {
+      case '*':
+      case '?':
+        if (run.size() > longest.size()) { longest = run; }
+        run.clear();
+        p++;
+        continue;
+      case '[':
+        if (run.size() > longest.size()) { longest = run; }
+        return longest;
+      case '\\':
+        if (p[1]) { p++; }
+        break;
+      default:
+        break;
+    }
+    run.push_back(FoldChar(*p));
+    p++;
+  }
+  if (run.size() > longest.size()) { longest = run; }
+
+  return longest;
+}
+
+static inline bool IsAscii(const char* str)
+{
+  for (const char* p = str; *p; p++) {
+    if ((unsigned char)*p & 0x80) { return false; }
+  }
+
+  return true;
+}
+
+/*
+ * Add a pattern and return its id, ids are handed out in ascending order.
+ *
+ * FoldChar() only folds ASCII while fnmatch() with FNM_CASEFOLD may also
+ * fold other characters of the locale, so patterns with non-ASCII bytes
+ * get no literal run and are always checked.
+ */
+int PatternMatcher::AddPattern(const char* pattern)
+{
+  int id = always_.size();
+  std::string literal = IsAscii(pattern) ? LongestLiteral(pattern) : "";
+
+  always_.push_back(literal.empty());
+  if (!literal.empty()) { keys_.push_back(Key{literal, id}); }
+  compiled_ = false;
+
+  return id;
+}
+
+void PatternMatcher::Compile()
+{
+  std::vector<std::vector<int32_t>> trie(1);
+  std::vector<int32_t> fail;
+  std::deque<int32_t> queue;
+
+  memset(class_of_, 0, sizeof(class_of_));
+  nr_classes_ = 1;
+  for (const Key& key : keys_) {
+    for (unsigned char c : key.literal) {
+      if (!class_of_[c]) { class_of_[c] = nr_classes_++; }
+    }
+  }
+  for (int c = 0; c < 256; c++) {
+    if (B_ISUPPER(c)) { class_of_[c] = class_of_[tolower(c)]; }
+  }
+
+  /*
+   * Build the trie of all literal runs.
+   */
+  trie[0].assign(nr_classes_, -1);
+  outputs_.assign(1, std::vector<int>());
+  for (const Key& key : keys_) {
+    int32_t state = 0;
+
+    for (unsigned char c : key.literal) {
+      int32_t& next = trie[state][class_of_[c]];
+
+      if (next < 0) {
+        next = trie.size();
+        trie.push_back(std::vector<int32_t>(nr_classes_, -1));
+        outputs_.push_back(std::vector<int>());
+      }
+      state = next;
+    }
+    outputs_[state].push_back(key.id);
+  }
+
+  /*
+   * Turn the trie into a deterministic automaton by filling in the missing
+   * transitions from the failure links, breadth first.
+   */
+  fail.assign(trie.size(), 0);
+  output_link_.assign(trie.size(), 0);
+  for (int c = 0; c < nr_classes_; c++) {
+    if (trie[0][c] < 0) {
+      trie[0][c] = 0;
+    } else {
+      queue.push_back(trie[0][c]);
+    }
+  }
+
+  while (!queue.empty()) {
+    int32_t state = queue.front();
+
+    queue.pop_front();
+    for (int c = 0; c < nr_classes_; c++) {
+      int32_t next = trie[state][c];
+
+      if (next < 0) {
+        trie[state][c] = trie[fail[state]][c];
+        continue;
+      }
+
+      fail[next] = trie[fail[state]][c];
+      output_link_[next] = outputs_[fail[next]].empty()
+                               ? output_link_[fail[next]]
+                               : fail[next];
+      queue.push_back(next);
+    }
+  }
+
+  delta_.resize(trie.size() * nr_classes_);
+  for (size_t state = 0; state < trie.size(); state++) {
+    memcpy(&delta_[state * nr_classes_], trie[state].data(),
+           nr_classes_ * sizeof(int32_t));
+  }
+
+  marks_.assign(always_.size(), 0);
+  generation_ = 0;
+  compiled_ = true;
+}
+
+/*
+ * Find all patterns whose literal run occurs in the filename.
+ */
+void PatternMatcher::Scan(const char* fname)
+{
+  int32_t state = 0;
+
+  if (keys_.empty()) { return; }
+  if (!compiled_) { Compile(); }
+
+  if (++generation_ == 0) {
+    std::fill(marks_.begin(), marks_.end(), 0);
+    generation_ = 1;
+  }
+
+  for (const unsigned char* p = (const unsigned char*)fname; *p; p++) {
+    state = delta_[state * nr_classes_ + class_of_[*p]];
+
+    for (int32_t found = outputs_[state].empty() ? output_link_[state] : state;
+         found > 0; found = output_link_[found]) {
+      for (int id : outputs_[found]) { marks_[id] = generation_; }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Prefilter for matching a filename against many fnmatch() patterns.
+ *
+ * Every literal character of a pattern matches exactly one character of a
+ * filename, so the longest run of literal characters of a pattern is a
+ * substring of every filename the pattern matches. The runs of all patterns
+ * are compiled into one Aho-Corasick automaton that finds all patterns whose
+ * run occurs in a filename in a single pass over the filename. Only those
+ * patterns can match and need to be checked with fnmatch().
+ */
+
+#ifndef BAREOS_FINDLIB_PATTERN_MATCHER_H_
+#define BAREOS_FINDLIB_PATTERN_MATCHER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class PatternMatcher {
+ public:
+  int AddPattern(const char* pattern);
+  void Compile();
+  void Scan(const char* fname);
+
+  /*
+   * Returns false when the pattern can not match the last scanned filename.
+   */
+  bool MayMatch(int id) const
+  {
+    return always_[id] || (compiled_ && marks_[id] == generation_);
+  }
+
+  int size() const { return (int)always_.size(); }
+
+ private:
+  struct Key {
+    std::string literal;
+    int id;
+  };
+
+  std::vector<Key> keys_;
+  std::vector<bool> always_; /* pattern without a literal run */
+
+  /*
+   * The automaton, state transitions are indexed by the state and the class
+   * of the character. All characters that don't appear in any literal run
+   * share class 0.
+   */
+  int nr_classes_ = 1;
+  uint8_t class_of_[256] = {0};
+  std::vector<int32_t> delta_;
+  std::vector<std::vector<int>> outputs_; /* patterns ending in a state */
+  std::vector<int32_t> output_link_; /* next suffix state with outputs */
+  bool compiled_ = false;
+
+  std::vector<uint32_t> marks_; /* generation the pattern was found in */
+  uint32_t generation_ = 0;
+};
+
+#endif /* BAREOS_FINDLIB_PATTERN_MATCHER_H_ */
@@ -71,13 +71,14 @@ enum
   FO_PLUGIN = 29,      /**< Plugin data stream -- return to plugin on restore */
   FO_OFFSETS = 30,     /**< Keep I/O file offsets */
   FO_NO_AUTOEXCL = 31, /**< Don't use autoexclude methods */
-  FO_FORCE_ENCRYPT = 32 /**< Force encryption */
+  FO_FORCE_ENCRYPT = 32, /**< Force encryption */
+  FO_XXH64 = 33          /**< Do XXH64 checksum */
 };
 
 /**
  * Keep this set to the last entry in the enum.
  */
-#define FO_MAX FO_FORCE_ENCRYPT
+#define FO_MAX FO_XXH64
 
 /**
  * Make sure you have enough bits to store all above bit fields.
@@ -60,11 +60,13 @@ struct VolumeList;
 class DeviceControlRecord;
 class DirectorResource;
 struct BootStrapRecord;
+class VolumePrefetchContext;
 }  // namespace storagedaemon
 
 namespace filedaemon {
 class BareosAccurateFilelist;
 struct save_pkt;
+struct verify_ctx;
 }  // namespace filedaemon
 
 /**
@@ -449,6 +451,7 @@ class JobControlRecord {
   bool HasBase;          /**< True if job use base jobs */
   bool rerunning;        /**< Rerunning an incomplete job */
   bool job_started;      /**< Set when the job is actually started */
+  bool binary_attributes; /**< Send attributes as binary records */
   bool suppress_output;  /**< Set if this JobControlRecord should not output any
                             Jmsgs */
   JobControlRecord* cjcr; /**< Controlling JobControlRecord when this is a slave
@@ -600,9 +603,10 @@ class JobControlRecord {
   bool got_metadata;                      /**< Set when found job_metadata */
   bool multi_restore; /**< Dir can do multiple storage restore */
   filedaemon::BareosAccurateFilelist*
-      file_list;                   /**< Previous file list (accurate mode) */
-  uint64_t base_size;              /**< Compute space saved with base job */
-  filedaemon::save_pkt* plugin_sp; /**< Plugin save packet */
+      file_list;                      /**< Previous file list (accurate mode) */
+  uint64_t base_size;                 /**< Compute space saved with base job */
+  filedaemon::save_pkt* plugin_sp;    /**< Plugin save packet */
+  filedaemon::verify_ctx* verify_ctx; /**< Verify workers */
 #ifdef HAVE_WIN32
   VSSClient* pVSSClient; /**< VSS Client Instance */
 #endif
@@ -660,6 +664,8 @@ class JobControlRecord {
       rctx; /**< Read context used to keep track of what is processed or not */
   storagedaemon::BootStrapRecord*
       bsr;                /**< Bootstrap record -- has everything */
+  storagedaemon::VolumePrefetchContext*
+      prefetch_ctx;       /**< Read ahead of upcoming read volumes */
   bool mount_next_volume; /**< Set to cause next volume mount */
   uint32_t read_VolSessionId;
   uint32_t read_VolSessionTime;
@@ -63,10 +63,12 @@
  *
  * STREAM_UNIX_ATTRIBUTES
  * STREAM_UNIX_ATTRIBUTES_EX
+ * STREAM_UNIX_ATTRIBUTES_BINARY
  * STREAM_MD5_DIGEST
  * STREAM_SHA1_DIGEST
  * STREAM_SHA256_DIGEST
  * STREAM_SHA512_DIGEST
+ * STREAM_XXH64_DIGEST
  */
 #define STREAM_NONE                             0       /**< Reserved Non-Stream */
 #define STREAM_UNIX_ATTRIBUTES                  1       /**< Generic Unix attributes */
@@ -111,6 +113,14 @@
 #define STREAM_ENCRYPTED_FILE_COMPRESSED_DATA  32       /**< Encrypted, compressed data */
 #define STREAM_ENCRYPTED_WIN32_COMPRESSED_DATA 33       /**< Encrypted, compressed Win32 BackupRead data */
 
+/**
+ * Unix attributes with varint encoded fields instead of the space separated
+ * base64 stat packet, only sent when negotiated between FD, SD and DIR.
+ */
+#define STREAM_UNIX_ATTRIBUTES_BINARY          34       /**< Binary Unix attributes */
+
+#define STREAM_XXH64_DIGEST                    35       /**< XXH64 hash of the file, not cryptographic */
+
 #define STREAM_NDMP_SEPARATOR                 999       /**< NDMP separator between multiple data streams of one job */
 
 /**
@@ -55,6 +55,44 @@ void FreeAttr(Attributes* attr)
   free(attr);
 }
 
+/**
+ * A binary attributes record already carries the decoded stat packet, so
+ *  attr->statp, attr->LinkFI and attr->data_stream are filled in here and
+ *  attr->attr is left empty, callers must not call DecodeStat() on it.
+ */
+static int UnpackBinaryAttributesRecord(JobControlRecord* jcr,
+                                        char* rec,
+                                        int32_t reclen,
+                                        Attributes* attr)
+{
+  BinaryAttributes attribs;
+
+  if (!DecodeAttributesBinary(rec, reclen, &attribs)) {
+    Jmsg(jcr, M_FATAL, 0, _("Error decoding binary attributes record.\n"));
+    return 0;
+  }
+
+  attr->file_index = attribs.file_index;
+  attr->type = attribs.type & FT_MASK;
+  attr->fname = attribs.fname;
+  attr->attr = attribs.fname + strlen(attribs.fname);
+  attr->lname = attribs.link;
+  PmStrcpy(attr->attrEx, attribs.attribsEx);
+  attr->delta_seq = attribs.delta_seq;
+  attr->LinkFI = attribs.LinkFI;
+  attr->data_stream = attribs.data_stream;
+  memcpy(&attr->statp, &attribs.statp, sizeof(attr->statp));
+
+  Dmsg6(debuglevel,
+        "unpack_attr binary FI=%d Type=%d fname=%s lname=%s datastr=%d "
+        "delta_seq=%d\n",
+        attr->file_index, attr->type, attr->fname, attr->lname,
+        attr->data_stream, attr->delta_seq);
+  *attr->ofname = 0;
+  *attr->olname = 0;
+  return 1;
+}
+
 int UnpackAttributesRecord(JobControlRecord* jcr,
                            int32_t stream,
                            char* rec,
@@ -76,6 +114,10 @@ int UnpackAttributesRecord(JobControlRecord* jcr,
    *
    */
   attr->stream = stream;
+  if ((stream & STREAMMASK_TYPE) == STREAM_UNIX_ATTRIBUTES_BINARY) {
+    return UnpackBinaryAttributesRecord(jcr, rec, reclen, attr);
+  }
+
   Dmsg1(debuglevel, "Attr: %s\n", rec);
   if (sscanf(rec, "%d %d", &attr->file_index, &attr->type) != 2) {
     Jmsg(jcr, M_FATAL, 0, _("Error scanning attributes: %s\n"), rec);
@@ -271,3 +271,198 @@ int32_t DecodeLinkFI(char* buf, struct stat* statp, int stat_size)
   }
   return 0;
 }
+
+/*
+ * Binary attributes record, all integers are zigzag encoded base 128
+ * varints, strings are a varint length followed by the bytes and a
+ * terminating zero so the decoder can hand them out in place:
+ *
+ *   File_index
+ *   File type
+ *   Filename
+ *   Number of stat fields
+ *   Stat fields in the order of EncodeStat()
+ *   Link name
+ *   Extended attributes
+ *   Delta Sequence Number
+ *
+ * A decoder skips stat fields it doesn't know, so fields can be appended.
+ */
+static const int nr_binary_stat_fields = 16;
+static const int max_varint_length = 10;
+
+static inline char* PutVarint(char* p, int64_t value)
+{
+  uint64_t val = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+
+  while (val >= 0x80) {
+    *p++ = (char)(val | 0x80);
+    val >>= 7;
+  }
+  *p++ = (char)val;
+
+  return p;
+}
+
+static inline char* PutString(char* p, const char* str, int32_t len)
+{
+  p = PutVarint(p, len);
+  memcpy(p, str, len);
+  p += len;
+  *p++ = 0;
+
+  return p;
+}
+
+static inline bool GetVarint(char*& p, char* end, int64_t* value)
+{
+  uint64_t val = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p >= end) { return false; }
+    uint8_t byte = (uint8_t)*p++;
+
+    val |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *value = (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static inline bool GetString(char*& p, char* end, char** str)
+{
+  int64_t len;
+
+  if (!GetVarint(p, end, &len) || len < 0 || len >= end - p || p[len] != 0) {
+    return false;
+  }
+  *str = p;
+  p += len + 1;
+
+  return true;
+}
+
+/**
+ * Encode file attributes into a binary attributes record in buf,
+ *  returns the length of the record.
+ */
+int EncodeAttributesBinary(POOLMEM*& buf,
+                           int32_t file_index,
+                           int32_t type,
+                           const char* fname,
+                           struct stat* statp,
+                           int stat_size,
+                           int32_t LinkFI,
+                           int data_stream,
+                           const char* link,
+                           const char* attribsEx,
+                           int32_t delta_seq)
+{
+  char* p;
+  int32_t fname_len = strlen(fname);
+  int32_t link_len = strlen(link);
+  int32_t attribsEx_len = strlen(attribsEx);
+
+  ASSERT(stat_size == (int)sizeof(struct stat));
+
+  buf = CheckPoolMemorySize(
+      buf, fname_len + link_len + attribsEx_len + 3 +
+               (nr_binary_stat_fields + 7) * max_varint_length);
+  p = buf;
+
+  p = PutVarint(p, file_index);
+  p = PutVarint(p, type);
+  p = PutString(p, fname, fname_len);
+
+  p = PutVarint(p, nr_binary_stat_fields);
+  p = PutVarint(p, (int64_t)statp->st_dev);
+  p = PutVarint(p, (int64_t)statp->st_ino);
+  p = PutVarint(p, (int64_t)statp->st_mode);
+  p = PutVarint(p, (int64_t)statp->st_nlink);
+  p = PutVarint(p, (int64_t)statp->st_uid);
+  p = PutVarint(p, (int64_t)statp->st_gid);
+  p = PutVarint(p, (int64_t)statp->st_rdev);
+  p = PutVarint(p, (int64_t)statp->st_size);
+#ifndef HAVE_MINGW
+  p = PutVarint(p, (int64_t)statp->st_blksize);
+  p = PutVarint(p, (int64_t)statp->st_blocks);
+#else
+  p = PutVarint(p, 0); /* output place holder */
+  p = PutVarint(p, 0); /* output place holder */
+#endif
+  p = PutVarint(p, (int64_t)statp->st_atime);
+  p = PutVarint(p, (int64_t)statp->st_mtime);
+  p = PutVarint(p, (int64_t)statp->st_ctime);
+  p = PutVarint(p, LinkFI);
+#ifdef HAVE_CHFLAGS
+  p = PutVarint(p, (int64_t)statp->st_flags);
+#else
+  p = PutVarint(p, 0); /* output place holder */
+#endif
+  p = PutVarint(p, data_stream);
+
+  p = PutString(p, link, link_len);
+  p = PutString(p, attribsEx, attribsEx_len);
+  p = PutVarint(p, delta_seq);
+
+  return p - buf;
+}
+
+/**
+ * Decode a binary attributes record, returns false when the record is
+ *  malformed.
+ */
+bool DecodeAttributesBinary(char* rec,
+                            int32_t reclen,
+                            BinaryAttributes* attribs)
+{
+  char* p = rec;
+  char* end = rec + reclen;
+  int64_t val, nr_fields;
+  int64_t fields[nr_binary_stat_fields];
+
+  memset(attribs, 0, sizeof(BinaryAttributes));
+
+  if (!GetVarint(p, end, &val)) { return false; }
+  attribs->file_index = (int32_t)val;
+  if (!GetVarint(p, end, &val)) { return false; }
+  attribs->type = (int32_t)val;
+  if (!GetString(p, end, &attribs->fname)) { return false; }
+
+  if (!GetVarint(p, end, &nr_fields) || nr_fields < 0) { return false; }
+  memset(fields, 0, sizeof(fields));
+  for (int64_t i = 0; i < nr_fields; i++) {
+    if (!GetVarint(p, end, &val)) { return false; }
+    if (i < nr_binary_stat_fields) { fields[i] = val; }
+  }
+
+  plug(attribs->statp.st_dev, fields[0]);
+  plug(attribs->statp.st_ino, fields[1]);
+  plug(attribs->statp.st_mode, fields[2]);
+  plug(attribs->statp.st_nlink, fields[3]);
+  plug(attribs->statp.st_uid, fields[4]);
+  plug(attribs->statp.st_gid, fields[5]);
+  plug(attribs->statp.st_rdev, fields[6]);
+  plug(attribs->statp.st_size, fields[7]);
+#ifndef HAVE_MINGW
+  plug(attribs->statp.st_blksize, fields[8]);
+  plug(attribs->statp.st_blocks, fields[9]);
+#endif
+  plug(attribs->statp.st_atime, fields[10]);
+  plug(attribs->statp.st_mtime, fields[11]);
+  plug(attribs->statp.st_ctime, fields[12]);
+  attribs->LinkFI = (int32_t)fields[13];
+#ifdef HAVE_CHFLAGS
+  plug(attribs->statp.st_flags, fields[14]);
+#endif
+  attribs->data_stream = (int32_t)fields[15];
+
+  if (!GetString(p, end, &attribs->link)) { return false; }
+  if (!GetString(p, end, &attribs->attribsEx)) { return false; }
+  if (GetVarint(p, end, &val)) { attribs->delta_seq = (int32_t)val; }
+
+  return true;
+}
@@ -22,6 +22,9 @@
 #define BAREOS_LIB_ATTRIBS_H_
 #include "include/baconfig.h"
 
+/* Room for a stat packet encoded by EncodeStat() */
+#define MAX_ENCODED_STAT_LENGTH 256
+
 void EncodeStat(char* buf,
                 struct stat* statp,
                 int stat_size,
@@ -30,4 +33,35 @@ void EncodeStat(char* buf,
 int DecodeStat(char* buf, struct stat* statp, int stat_size, int32_t* LinkFI);
 int32_t DecodeLinkFI(char* buf, struct stat* statp, int stat_size);
 
+/*
+ * Attributes record of a STREAM_UNIX_ATTRIBUTES_BINARY stream, the strings
+ * point into the decoded record.
+ */
+struct BinaryAttributes {
+  int32_t file_index;
+  int32_t type;
+  int32_t LinkFI;
+  int32_t data_stream;
+  int32_t delta_seq;
+  char* fname;
+  char* link;
+  char* attribsEx;
+  struct stat statp;
+};
+
+int EncodeAttributesBinary(POOLMEM*& buf,
+                           int32_t file_index,
+                           int32_t type,
+                           const char* fname,
+                           struct stat* statp,
+                           int stat_size,
+                           int32_t LinkFI,
+                           int data_stream,
+                           const char* link,
+                           const char* attribsEx,
+                           int32_t delta_seq);
+bool DecodeAttributesBinary(char* rec,
+                            int32_t reclen,
+                            BinaryAttributes* attribs);
+
 #endif  // BAREOS_LIB_ATTRIBS_H_
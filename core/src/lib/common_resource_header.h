@@ -24,7 +24,7 @@
 #ifndef BAREOS_LIB_COMMON_RESOURCE_HEADER_
 #define BAREOS_LIB_COMMON_RESOURCE_HEADER_
 
-#define MAX_RES_ITEMS 90 /* maximum resource items per CommonResourceHeader */
+#define MAX_RES_ITEMS 100 /* maximum resource items per CommonResourceHeader */
 
 /*
  * This is the universal header that is at the beginning of every resource
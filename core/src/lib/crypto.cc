@@ -137,6 +137,8 @@ const char* crypto_digest_name(crypto_digest_t type)
       return "SHA256";
     case CRYPTO_DIGEST_SHA512:
       return "SHA512";
+    case CRYPTO_DIGEST_XXH64:
+      return "XXH64";
     case CRYPTO_DIGEST_NONE:
       return "None";
     default:
@@ -159,6 +161,8 @@ crypto_digest_t CryptoDigestStreamType(int stream)
       return CRYPTO_DIGEST_SHA256;
     case STREAM_SHA512_DIGEST:
       return CRYPTO_DIGEST_SHA512;
+    case STREAM_XXH64_DIGEST:
+      return CRYPTO_DIGEST_XXH64;
     default:
       return CRYPTO_DIGEST_NONE;
   }
@@ -68,7 +68,8 @@ typedef enum
   CRYPTO_DIGEST_MD5 = 1,
   CRYPTO_DIGEST_SHA1 = 2,
   CRYPTO_DIGEST_SHA256 = 3,
-  CRYPTO_DIGEST_SHA512 = 4
+  CRYPTO_DIGEST_SHA512 = 4,
+  CRYPTO_DIGEST_XXH64 = 5 /* Not cryptographic, detects changes only */
 } crypto_digest_t;
 
 /* Cipher Types */
@@ -106,6 +107,7 @@ typedef enum
 #define CRYPTO_DIGEST_SHA1_SIZE 20   /* 160 bits */
 #define CRYPTO_DIGEST_SHA256_SIZE 32 /* 256 bits */
 #define CRYPTO_DIGEST_SHA512_SIZE 64 /* 512 bits */
+#define CRYPTO_DIGEST_XXH64_SIZE 8    /* 64 bits */
 
 /* Maximum Message Digest Size */
 #ifdef HAVE_OPENSSL
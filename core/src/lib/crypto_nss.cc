@@ -40,6 +40,7 @@ struct Digest {
   union {
     SHA1_CTX sha1;
     MD5_CTX md5;
+    XXH64_CTX xxh64;
   };
 };
 
@@ -63,6 +64,9 @@ DIGEST* crypto_digest_new(JobControlRecord* jcr, crypto_digest_t type)
     case CRYPTO_DIGEST_SHA1:
       SHA1Init(&digest->sha1);
       break;
+    case CRYPTO_DIGEST_XXH64:
+      XXH64Init(&digest->xxh64);
+      break;
     default:
       Jmsg1(jcr, M_ERROR, 0, _("Unsupported digest type=%d specified\n"), type);
       free(digest);
@@ -83,6 +87,9 @@ bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
       /* Doesn't return anything ... */
       SHA1Update(&digest->sha1, (const u_int8_t*)data, (unsigned int)length);
       return true;
+    case CRYPTO_DIGEST_XXH64:
+      XXH64Update(&digest->xxh64, (const unsigned char*)data, length);
+      return true;
     default:
       return false;
   }
@@ -106,6 +113,11 @@ bool CryptoDigestFinalize(DIGEST* digest, uint8_t* dest, uint32_t* length)
       *length = CRYPTO_DIGEST_SHA1_SIZE;
       SHA1Final((u_int8_t*)dest, &digest->sha1);
       return true;
+    case CRYPTO_DIGEST_XXH64:
+      assert(*length >= CRYPTO_DIGEST_XXH64_SIZE);
+      *length = CRYPTO_DIGEST_XXH64_SIZE;
+      XXH64Final((unsigned char*)dest, &digest->xxh64);
+      return true;
     default:
       return false;
   }
@@ -260,6 +260,7 @@ struct X509_Keypair {
 struct Digest {
   JobControlRecord* jcr;
   crypto_digest_t type;
+  XXH64_CTX xxh64; /* CRYPTO_DIGEST_XXH64 is not provided by OpenSSL */
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
   /* Openssl Version < 1.1 */
@@ -612,6 +613,22 @@ void CryptoKeypairFree(X509_KEYPAIR* keypair)
 }
 
 
+/*
+ * With OpenSSL 3 the EVP_sha*() methods are looked up in the provider on
+ * every EVP_DigestInit_ex(), which costs more than hashing a small file.
+ * Fetch every algorithm once on first use and keep it, fall back to the
+ * implicit lookup when the fetch fails e.g. for MD5 in FIPS mode.
+ */
+static const EVP_MD* FetchDigest(const char* name, const EVP_MD* md)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+  const EVP_MD* fetched = EVP_MD_fetch(NULL, name, NULL);
+
+  if (fetched) { return fetched; }
+#endif
+  return md;
+}
+
 /*
  * Create a new message digest context of the specified type
  *  Returns: A pointer to a DIGEST object on success.
@@ -626,20 +643,31 @@ DIGEST* crypto_digest_new(JobControlRecord* jcr, crypto_digest_t type)
 
   /* Determine the correct OpenSSL message digest type */
   switch (type) {
-    case CRYPTO_DIGEST_MD5:
-      md = EVP_md5();
+    case CRYPTO_DIGEST_MD5: {
+      static const EVP_MD* md5 = FetchDigest("MD5", EVP_md5());
+      md = md5;
       break;
-    case CRYPTO_DIGEST_SHA1:
-      md = EVP_sha1();
+    }
+    case CRYPTO_DIGEST_SHA1: {
+      static const EVP_MD* sha1 = FetchDigest("SHA1", EVP_sha1());
+      md = sha1;
       break;
+    }
 #ifdef HAVE_SHA2
-    case CRYPTO_DIGEST_SHA256:
-      md = EVP_sha256();
+    case CRYPTO_DIGEST_SHA256: {
+      static const EVP_MD* sha256 = FetchDigest("SHA256", EVP_sha256());
+      md = sha256;
       break;
-    case CRYPTO_DIGEST_SHA512:
-      md = EVP_sha512();
+    }
+    case CRYPTO_DIGEST_SHA512: {
+      static const EVP_MD* sha512 = FetchDigest("SHA512", EVP_sha512());
+      md = sha512;
       break;
+    }
 #endif
+    case CRYPTO_DIGEST_XXH64:
+      XXH64Init(&digest->xxh64);
+      return digest;
     default:
       Jmsg1(jcr, M_ERROR, 0, _("Unsupported digest type: %d\n"), type);
       goto err;
@@ -665,6 +693,11 @@ err:
  */
 bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
 {
+  if (digest->type == CRYPTO_DIGEST_XXH64) {
+    XXH64Update(&digest->xxh64, data, length);
+    return true;
+  }
+
   if (EVP_DigestUpdate(&digest->get_ctx(), data, length) == 0) {
     Dmsg0(150, "digest update failed\n");
     OpensslPostErrors(digest->jcr, M_ERROR, _("OpenSSL digest update failed"));
@@ -683,6 +716,13 @@ bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
  */
 bool CryptoDigestFinalize(DIGEST* digest, uint8_t* dest, uint32_t* length)
 {
+  if (digest->type == CRYPTO_DIGEST_XXH64) {
+    assert(*length >= CRYPTO_DIGEST_XXH64_SIZE);
+    *length = CRYPTO_DIGEST_XXH64_SIZE;
+    XXH64Final(dest, &digest->xxh64);
+    return true;
+  }
+
   if (!EVP_DigestFinal(&digest->get_ctx(), dest, (unsigned int*)length)) {
     Dmsg0(150, "digest finalize failed\n");
     OpensslPostErrors(digest->jcr, M_ERROR,
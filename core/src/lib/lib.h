@@ -54,6 +54,7 @@
 #endif
 #include "md5.h"
 #include "sha1.h"
+#include "xxhash64.h"
 #include "tree.h"
 #include "watchdog.h"
 #include "btimers.h"
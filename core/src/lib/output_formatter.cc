@@ -67,6 +67,12 @@ OutputFormatter::OutputFormatter(SEND_HANDLER* send_func_arg,
   result_stack_json = New(alist(10, false));
   result_stack_json->push(result_json);
   message_object_json = json_object();
+  stream_array_json = NULL;
+  stream_buffer = new PoolMem(PM_MESSAGE);
+  stream_length = 0;
+  stream_started = false;
+  stream_member_sent = false;
+  stream_row_sent = false;
 #endif
 }
 
@@ -81,6 +87,8 @@ OutputFormatter::~OutputFormatter()
   delete result_stack_json;
   json_object_clear(message_object_json);
   json_decref(message_object_json);
+  if (stream_array_json) { json_decref(stream_array_json); }
+  delete stream_buffer;
 #endif
 }
 
@@ -155,6 +163,7 @@ void OutputFormatter::ObjectEnd(const char* name)
     case API_MODE_JSON:
       result_stack_json->pop();
       Dmsg1(800, "result stack: %d\n", result_stack_json->size());
+      JsonStreamRows();
       break;
 #endif
     default:
@@ -216,6 +225,10 @@ void OutputFormatter::ArrayEnd(const char* name)
   switch (api) {
 #if HAVE_JANSSON
     case API_MODE_JSON:
+      if (stream_array_json &&
+          result_stack_json->last() == (void*)stream_array_json) {
+        JsonStreamEndArray();
+      }
       result_stack_json->pop();
       Dmsg1(800, "result stack: %d\n", result_stack_json->size());
       break;
@@ -808,17 +821,46 @@ bool OutputFormatter::JsonSendErrorMessage(const char* message)
   return send_func(send_ctx, json_error_message.c_str());
 }
 
+json_t* OutputFormatter::JsonRangeMeta()
+{
+  json_t* meta_obj = json_object();
+  json_t* range_obj = json_object();
+  of_filter_tuple* tuple = nullptr;
+
+  foreach_alist (tuple, filters) {
+    if (tuple->type == OF_FILTER_LIMIT) {
+      json_object_set_new(range_obj, "limit",
+                          json_integer(tuple->u.limit_filter.limit));
+    }
+    if (tuple->type == OF_FILTER_OFFSET) {
+      json_object_set_new(range_obj, "offset",
+                          json_integer(tuple->u.offset_filter.offset));
+    }
+  }
+  json_object_set_new(range_obj, "filtered",
+                      json_integer(get_num_rows_filtered()));
+  json_object_set_new(meta_obj, "range", range_obj);
+
+  return meta_obj;
+}
+
 void OutputFormatter::JsonFinalizeResult(bool result)
 {
-  json_t* msg_obj = json_object();
+  json_t* msg_obj;
   json_t* error_obj = NULL;
   json_t* data_obj = NULL;
-  json_t* meta_obj = NULL;
-  json_t* range_obj = NULL;
   PoolMem ErrorMsg;
   char* string;
   size_t string_length = 0;
 
+  if (stream_started) {
+    JsonStreamFinalizeResult(result);
+    JsonResetResult();
+    return;
+  }
+
+  msg_obj = json_object();
+
   /*
    * We mimic json-rpc result and error messages,
    * To make it easier to implement real json-rpc later on.
@@ -838,25 +880,7 @@ void OutputFormatter::JsonFinalizeResult(bool result)
   } else {
     json_object_set(msg_obj, "result", result_json);
     if (HasFilters()) {
-      meta_obj = json_object();
-      json_object_set_new(result_json, "meta", meta_obj);
-
-      range_obj = json_object();
-
-      of_filter_tuple* tuple = nullptr;
-      foreach_alist (tuple, filters) {
-        if (tuple->type == OF_FILTER_LIMIT) {
-          json_object_set_new(range_obj, "limit",
-                              json_integer(tuple->u.limit_filter.limit));
-        }
-        if (tuple->type == OF_FILTER_OFFSET) {
-          json_object_set_new(range_obj, "offset",
-                              json_integer(tuple->u.offset_filter.offset));
-        }
-      }
-      json_object_set_new(range_obj, "filtered",
-                          json_integer(get_num_rows_filtered()));
-      json_object_set_new(meta_obj, "range", range_obj);
+      json_object_set_new(result_json, "meta", JsonRangeMeta());
     }
   }
 
@@ -896,7 +920,15 @@ void OutputFormatter::JsonFinalizeResult(bool result)
     free(string);
   }
 
-  /* cleanup and reinitialize */
+  json_object_clear(msg_obj);
+  json_decref(msg_obj);
+  msg_obj = nullptr;
+
+  JsonResetResult();
+}
+
+void OutputFormatter::JsonResetResult()
+{
   while (result_stack_json->pop()) {}
 
   json_object_clear(result_json);
@@ -910,8 +942,234 @@ void OutputFormatter::JsonFinalizeResult(bool result)
   message_object_json = nullptr;
   message_object_json = json_object();
 
-  json_object_clear(msg_obj);
-  json_decref(msg_obj);
-  msg_obj = nullptr;
+  if (stream_array_json) {
+    json_decref(stream_array_json);
+    stream_array_json = NULL;
+  }
+  stream_length = 0;
+  *stream_buffer->c_str() = 0;
+  stream_started = false;
+  stream_member_sent = false;
+  stream_row_sent = false;
+}
+
+/*
+ * Large listings (e.g. list files or bvfs_lsfiles) can have millions of rows.
+ * Instead of building the complete result tree and serializing it at the end,
+ * a top level array of the result is streamed once it holds
+ * OF_JSON_STREAM_ROWS rows: the start of the json-rpc result, the result
+ * members added so far and the rows are sent and every following row is sent
+ * as soon as it is complete. Smaller results are sent unchanged by
+ * JsonFinalizeResult().
+ *
+ * Called whenever an object is closed.
+ */
+void OutputFormatter::JsonStreamRows()
+{
+  json_t* array;
+
+  /*
+   * Only rows of arrays that are a direct member of the result.
+   */
+  if (result_stack_json->size() != 2) { return; }
+  array = (json_t*)result_stack_json->last();
+  if (!json_is_array(array)) { return; }
+
+  if (array != stream_array_json) {
+    if (json_array_size(array) < OF_JSON_STREAM_ROWS) { return; }
+    JsonStreamStartArray(array);
+    if (array != stream_array_json) { return; }
+  }
+  JsonStreamAppendRows(array);
+}
+
+void OutputFormatter::JsonStreamStartArray(json_t* array)
+{
+  PoolMem name;
+  void* iter;
+
+  for (iter = json_object_iter(result_json); iter;
+       iter = json_object_iter_next(result_json, iter)) {
+    if (json_object_iter_value(iter) == array) {
+      name.strcpy(json_object_iter_key(iter));
+      break;
+    }
+  }
+  if (!iter) { return; }
+
+  if (!stream_started) {
+    /*
+     * Same members as build by JsonFinalizeResult() on success.
+     */
+    const char* start =
+        compact ? "{\"jsonrpc\":\"2.0\",\"id\":null,\"result\":{"
+                : "{\n  \"jsonrpc\": \"2.0\",\n  \"id\": null,\n"
+                  "  \"result\": {";
+
+    JsonStreamAppend(start, strlen(start));
+    stream_started = true;
+    stream_member_sent = false;
+  }
+  Dmsg1(100, "streaming json array %s\n", name.c_str());
+
+  /*
+   * Send everything added to the result so far, the array itself is kept
+   * on the result stack but is no longer part of the result object.
+   */
+  json_incref(array);
+  json_object_del(result_json, name.c_str());
+  JsonStreamAppendMembers();
+  JsonStreamAppendMember(name.c_str(), array, true);
+  stream_array_json = array;
+  stream_row_sent = false;
+}
+
+void OutputFormatter::JsonStreamEndArray()
+{
+  JsonStreamAppendRows(stream_array_json);
+  JsonStreamAppend("]", 1);
+  json_decref(stream_array_json);
+  stream_array_json = NULL;
+}
+
+void OutputFormatter::JsonStreamAppend(const char* string, int32_t length)
+{
+  stream_buffer->check_size(stream_length + length + 1);
+  memcpy(stream_buffer->c_str() + stream_length, string, length);
+  stream_length += length;
+  stream_buffer->c_str()[stream_length] = 0;
+}
+
+/*
+ * Append "key": value. With open_array, value must be an empty array and
+ * only its opening bracket is appended.
+ */
+void OutputFormatter::JsonStreamAppendMember(const char* key,
+                                             json_t* value,
+                                             bool open_array)
+{
+  json_t* member = json_object();
+  char* string;
+  int32_t length;
+
+  /*
+   * Let jansson do the escaping and formatting by serializing an object
+   * that only holds this member and strip its braces.
+   */
+  if (open_array) {
+    json_object_set_new(member, key, json_array());
+  } else {
+    json_object_set(member, key, value);
+  }
+  string = json_dumps(member,
+                      compact ? UA_JSON_FLAGS_COMPACT : UA_JSON_FLAGS_NORMAL);
+  json_object_clear(member);
+  json_decref(member);
+  if (string == NULL) {
+    Emsg0(M_ERROR, 0, "Failed to generate json string.\n");
+    return;
+  }
+
+  length = strlen(string);
+  while (length > 0 && B_ISSPACE(string[length - 1])) { length--; }
+  if (length > 0 && string[length - 1] == '}') { length--; }
+  while (length > 0 && B_ISSPACE(string[length - 1])) { length--; }
+  if (open_array && length > 0 && string[length - 1] == ']') { length--; }
+
+  if (stream_member_sent) { JsonStreamAppend(",", 1); }
+  if (length > 1) { JsonStreamAppend(string + 1, length - 1); }
+  stream_member_sent = true;
+  free(string);
+}
+
+/*
+ * Append and remove all members of the result object.
+ */
+void OutputFormatter::JsonStreamAppendMembers()
+{
+  void* iter;
+
+  for (iter = json_object_iter(result_json); iter;
+       iter = json_object_iter_next(result_json, iter)) {
+    JsonStreamAppendMember(json_object_iter_key(iter),
+                           json_object_iter_value(iter));
+  }
+  json_object_clear(result_json);
+}
+
+/*
+ * Append and remove all rows of a streamed array.
+ */
+void OutputFormatter::JsonStreamAppendRows(json_t* array)
+{
+  char* string;
+
+  for (size_t i = 0; i < json_array_size(array); i++) {
+    string = json_dumps(json_array_get(array, i),
+                        compact ? UA_JSON_FLAGS_COMPACT : UA_JSON_FLAGS_NORMAL);
+    if (string == NULL) {
+      Emsg0(M_ERROR, 0, "Failed to generate json string.\n");
+      continue;
+    }
+    if (stream_row_sent) { JsonStreamAppend(",", 1); }
+    JsonStreamAppend(string, strlen(string));
+    stream_row_sent = true;
+    free(string);
+  }
+  json_array_clear(array);
+
+  if (stream_length >= OF_JSON_STREAM_BUFFER_SIZE) { JsonStreamSend(); }
+}
+
+void OutputFormatter::JsonStreamSend()
+{
+  if (stream_length == 0) { return; }
+
+  Dmsg1(800, "message length (json stream): %d\n", stream_length);
+  if (!send_func(send_ctx, stream_buffer->c_str())) {
+    /*
+     * Part of the result is already sent, so an error message would only
+     * produce invalid json.
+     */
+    Dmsg1(100, "Failed to send json message (length=%d).\n", stream_length);
+  }
+  stream_length = 0;
+  *stream_buffer->c_str() = 0;
+}
+
+/*
+ * Send the rest of a streamed result.
+ *
+ * The start of the json-rpc result is already sent, so a streamed response
+ * is always a json-rpc result. When the command fails after streaming
+ * started, the result object gets an "error" member instead, holding the
+ * code, message and messages of the json-rpc error object a non-streamed
+ * response would have.
+ */
+void OutputFormatter::JsonStreamFinalizeResult(bool result)
+{
+  json_t* error_obj;
+  json_t* data_obj;
+  bool failed = !result || JsonHasErrorMessage();
+
+  if (stream_array_json) { JsonStreamEndArray(); }
+  if (!failed && HasFilters()) {
+    json_object_set_new(result_json, "meta", JsonRangeMeta());
+  }
+  JsonStreamAppendMembers();
+
+  if (failed) {
+    error_obj = json_object();
+    json_object_set_new(error_obj, "code", json_integer(1));
+    json_object_set_new(error_obj, "message", json_string("failed"));
+    data_obj = json_object();
+    json_object_set(data_obj, "messages", message_object_json);
+    json_object_set_new(error_obj, "data", data_obj);
+    JsonStreamAppendMember("error", error_obj);
+    json_decref(error_obj);
+  }
+
+  JsonStreamAppend(compact ? "}}" : "\n  }\n}", compact ? 2 : 6);
+  JsonStreamSend();
 }
 #endif
@@ -36,6 +36,13 @@
 
 #define OF_MAX_NR_HIDDEN_COLUMNS 64
 
+/**
+ * In json api mode a top level array with more rows than this is sent while
+ * the rows are added, instead of keeping the whole result in memory.
+ */
+#define OF_JSON_STREAM_ROWS 1000
+#define OF_JSON_STREAM_BUFFER_SIZE (64 * 1024)
+
 #if HAVE_JANSSON
 #define UA_JSON_FLAGS_NORMAL JSON_INDENT(2)
 #define UA_JSON_FLAGS_COMPACT JSON_COMPACT
@@ -134,6 +141,12 @@ class OutputFormatter : public SmartAlloc {
   json_t* result_json;
   alist* result_stack_json;
   json_t* message_object_json;
+  json_t* stream_array_json; /* top level array that is currently streamed */
+  PoolMem* stream_buffer;    /* streamed output not yet sent */
+  int32_t stream_length;
+  bool stream_started;     /* beginning of the result has been sent */
+  bool stream_member_sent; /* separator needed before next result member */
+  bool stream_row_sent;    /* separator needed before next row */
 #endif
 
  private:
@@ -158,6 +171,23 @@ class OutputFormatter : public SmartAlloc {
 
 #if HAVE_JANSSON
   bool JsonSendErrorMessage(const char* message);
+  json_t* JsonRangeMeta();
+  void JsonResetResult();
+
+  /*
+   * Streaming of large top level arrays.
+   */
+  void JsonStreamRows();
+  void JsonStreamStartArray(json_t* array);
+  void JsonStreamEndArray();
+  void JsonStreamAppend(const char* string, int32_t length);
+  void JsonStreamAppendMember(const char* key,
+                              json_t* value,
+                              bool open_array = false);
+  void JsonStreamAppendMembers();
+  void JsonStreamAppendRows(json_t* array);
+  void JsonStreamSend();
+  void JsonStreamFinalizeResult(bool result);
 #endif
 
  public:
@@ -563,3 +563,29 @@ bool send_scsi_cmd_page(int fd,
 
 bool CheckScsiAtEod(int fd) { return false; }
 #endif /* HAVE_LOWLEVEL_SCSI_INTERFACE */
+
+/*
+ * Get the block length limits of a tape drive with READ BLOCK LIMITS.
+ */
+bool GetScsiBlockLimits(int fd,
+                        const char* device_name,
+                        uint32_t* min_block_length,
+                        uint32_t* max_block_length)
+{
+  unsigned char cdb[6];
+  unsigned char limits[6];
+
+  memset(cdb, 0, sizeof(cdb));
+  memset(limits, 0, sizeof(limits));
+  cdb[0] = 0x05; /* READ BLOCK LIMITS */
+
+  if (!RecvScsiCmdPage(fd, device_name, (void*)cdb, sizeof(cdb),
+                       (void*)limits, sizeof(limits))) {
+    return false;
+  }
+
+  *max_block_length = (limits[1] << 16) | (limits[2] << 8) | limits[3];
+  *min_block_length = (limits[4] << 8) | limits[5];
+
+  return true;
+}
@@ -179,4 +179,8 @@ bool send_scsi_cmd_page(int fd,
                         void* cmd_page,
                         unsigned int cmd_page_len);
 bool CheckScsiAtEod(int fd);
+bool GetScsiBlockLimits(int fd,
+                        const char* device_name,
+                        uint32_t* min_block_length,
+                        uint32_t* max_block_length);
 #endif /* BAREOS_LIB_SCSI_LLI_H_ */
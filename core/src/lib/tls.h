@@ -72,6 +72,7 @@ class Tls {
                               int port,
                               const char* who) const = 0;
   virtual std::string TlsCipherGetName() const { return std::string(); }
+  virtual bool KtlsSendActive() const { return false; }
 
   virtual void SetCipherList(const std::string& cipherlist) = 0;
 
@@ -84,6 +85,7 @@ class Tls {
   virtual void SetPemUserdata(void* pem_userdata) = 0;
   virtual void SetDhFile(const std::string& dhfile_) = 0;
   virtual void SetVerifyPeer(const bool& verify_peer) = 0;
+  virtual void SetEnableKtls(const bool& enable_ktls) = 0;
   virtual void SetTcpFileDescriptor(const int& fd) = 0;
 };
 
@@ -27,6 +27,7 @@ TlsResource::TlsResource()
     , authenticate_(false)
     , tls_enable_(false)
     , tls_require_(false)
+    , enable_ktls_(false)
 {
   return;
 }
@@ -45,6 +45,7 @@ class TlsResource : public BareosResource {
   bool authenticate_;       /* Authenticate only with TLS */
   bool tls_enable_;
   bool tls_require_;
+  bool enable_ktls_; /* use kernel TLS offload if available */
 
   TlsResource();
   bool IsTlsConfigured() const;
@@ -125,6 +125,18 @@ std::string TlsOpenSsl::TlsCipherGetName() const
   return std::string();
 }
 
+/*
+ * Returns true when the kernel does the TLS record encryption on send, so
+ * data can be passed to the socket with sendfile() or splice().
+ */
+bool TlsOpenSsl::KtlsSendActive() const
+{
+#ifdef SSL_OP_ENABLE_KTLS
+  if (d_->openssl_) { return BIO_get_ktls_send(SSL_get_wbio(d_->openssl_)); }
+#endif
+  return false;
+}
+
 void TlsOpenSsl::TlsLogConninfo(JobControlRecord* jcr,
                                 const char* host,
                                 int port,
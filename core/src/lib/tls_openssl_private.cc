@@ -56,6 +56,7 @@ TlsOpenSslPrivate::TlsOpenSslPrivate()
     , pem_callback_(nullptr)
     , pem_userdata_(nullptr)
     , verify_peer_(false)
+    , enable_ktls_(false)
 {
   Dmsg0(100, "Construct TlsOpenSslPrivate\n");
 }
@@ -185,6 +186,18 @@ bool TlsOpenSslPrivate::init()
     SSL_CTX_set_verify(openssl_ctx_, SSL_VERIFY_NONE, NULL);
   }
 
+  if (enable_ktls_) {
+#ifdef SSL_OP_ENABLE_KTLS
+    /*
+     * Let OpenSSL hand the record layer to the kernel after the handshake,
+     * it silently stays in userspace if the kernel or cipher does not allow.
+     */
+    SSL_CTX_set_options(openssl_ctx_, SSL_OP_ENABLE_KTLS);
+#else
+    Dmsg0(100, "Kernel TLS offload is not supported by this OpenSSL\n");
+#endif
+  }
+
   openssl_ = SSL_new(openssl_ctx_);
   if (!openssl_) {
     OpensslPostErrors(M_FATAL, _("Error creating new SSL object"));
@@ -270,7 +283,12 @@ int TlsOpenSslPrivate::OpensslBsockReadwrite(BareosSocket* bsock,
         if (nwritten == -1) {
           if (errno == EINTR) { continue; }
           if (errno == EAGAIN) {
-            Bmicrosleep(0, 20000); /* try again in 20 ms */
+            /* wait until the socket is ready again */
+            if (write) {
+              WaitForWritableFd(bsock->fd_, 10000, false);
+            } else {
+              WaitForReadableFd(bsock->fd_, 10000, false);
+            }
             continue;
           }
         }
@@ -338,6 +356,13 @@ bool TlsOpenSslPrivate::OpensslBsockSessionStart(BareosSocket* bsock,
     switch (ssl_error) {
       case SSL_ERROR_NONE:
         bsock->SetTlsEstablished();
+#ifdef SSL_OP_ENABLE_KTLS
+        if (enable_ktls_) {
+          Dmsg2(100, "Kernel TLS offload send=%s receive=%s\n",
+                BIO_get_ktls_send(SSL_get_wbio(openssl_)) ? "yes" : "no",
+                BIO_get_ktls_recv(SSL_get_rbio(openssl_)) ? "yes" : "no");
+        }
+#endif
         status = true;
         goto cleanup;
       case SSL_ERROR_ZERO_RETURN:
@@ -555,6 +580,12 @@ void TlsOpenSsl::SetVerifyPeer(const bool& verify_peer)
   d_->verify_peer_ = verify_peer;
 }
 
+void TlsOpenSsl::SetEnableKtls(const bool& enable_ktls)
+{
+  Dmsg1(100, "Set Kernel TLS offload:\t<%s>\n", enable_ktls ? "true" : "false");
+  d_->enable_ktls_ = enable_ktls;
+}
+
 void TlsOpenSsl::SetTcpFileDescriptor(const int& fd)
 {
   Dmsg1(100, "Set tcp filedescriptor: <%d>\n", fd);
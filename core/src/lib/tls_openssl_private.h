@@ -91,6 +91,7 @@ class TlsOpenSslPrivate {
   std::string dhfile_;
   std::string cipherlist_;
   bool verify_peer_;
+  bool enable_ktls_;
   /* *************** */
 };
 
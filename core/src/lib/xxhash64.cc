@@ -0,0 +1,193 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * XXH64 as specified in the xxHash format description, with seed 0.
+ *
+ * The digest is stored big endian like the canonical representation of the
+ * reference implementation, so it reads the same as the hex value printed by
+ * xxh64sum.
+ *
+ * Test Vectors
+ * ""
+ *   EF46DB3751D8E999
+ * "abc"
+ *   44BC2CF5AD770999
+ */
+
+#include "include/bareos.h"
+#include "lib/xxhash64.h"
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t Rotl64(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/*
+ * Input is read little endian independent of the host byte order.
+ */
+static inline uint64_t Read64(const unsigned char* p)
+{
+  return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+         ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) |
+         ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) |
+         ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t Read32(const unsigned char* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input)
+{
+  acc += input * PRIME64_2;
+  acc = Rotl64(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+{
+  acc ^= Round(0, value);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+/*
+ * Consume complete stripes of 32 bytes, returns the number of bytes used.
+ */
+static size_t ConsumeStripes(uint64_t v[4], const unsigned char* p, size_t len)
+{
+  const unsigned char* start = p;
+  const unsigned char* limit;
+  uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+
+  if (len < XXH64_BLOCK_LENGTH) { return 0; }
+
+  limit = p + len - XXH64_BLOCK_LENGTH;
+  do {
+    v1 = Round(v1, Read64(p));
+    v2 = Round(v2, Read64(p + 8));
+    v3 = Round(v3, Read64(p + 16));
+    v4 = Round(v4, Read64(p + 24));
+    p += XXH64_BLOCK_LENGTH;
+  } while (p <= limit);
+
+  v[0] = v1;
+  v[1] = v2;
+  v[2] = v3;
+  v[3] = v4;
+
+  return p - start;
+}
+
+void XXH64Init(XXH64_CTX* context)
+{
+  context->total_len = 0;
+  context->v[0] = PRIME64_1 + PRIME64_2;
+  context->v[1] = PRIME64_2;
+  context->v[2] = 0;
+  context->v[3] = 0 - PRIME64_1;
+  context->buffered = 0;
+}
+
+void XXH64Update(XXH64_CTX* context, const unsigned char* data, size_t len)
+{
+  size_t used;
+
+  context->total_len += len;
+
+  /*
+   * Complete a partial stripe left over from the last update first.
+   */
+  if (context->buffered) {
+    size_t fill = XXH64_BLOCK_LENGTH - context->buffered;
+
+    if (len < fill) {
+      memcpy(context->buffer + context->buffered, data, len);
+      context->buffered += len;
+      return;
+    }
+
+    memcpy(context->buffer + context->buffered, data, fill);
+    ConsumeStripes(context->v, context->buffer, XXH64_BLOCK_LENGTH);
+    context->buffered = 0;
+    data += fill;
+    len -= fill;
+  }
+
+  used = ConsumeStripes(context->v, data, len);
+  if (used < len) {
+    memcpy(context->buffer, data + used, len - used);
+    context->buffered = len - used;
+  }
+}
+
+void XXH64Final(unsigned char digest[XXH64_DIGEST_LENGTH], XXH64_CTX* context)
+{
+  const unsigned char* p = context->buffer;
+  const unsigned char* end = p + context->buffered;
+  uint64_t h;
+
+  if (context->total_len >= XXH64_BLOCK_LENGTH) {
+    h = Rotl64(context->v[0], 1) + Rotl64(context->v[1], 7) +
+        Rotl64(context->v[2], 12) + Rotl64(context->v[3], 18);
+    h = MergeRound(h, context->v[0]);
+    h = MergeRound(h, context->v[1]);
+    h = MergeRound(h, context->v[2]);
+    h = MergeRound(h, context->v[3]);
+  } else {
+    h = context->v[2] + PRIME64_5;
+  }
+  h += context->total_len;
+
+  while (p + 8 <= end) {
+    h ^= Round(0, Read64(p));
+    h = Rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= (uint64_t)Read32(p) * PRIME64_1;
+    h = Rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p) * PRIME64_5;
+    h = Rotl64(h, 11) * PRIME64_1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+
+  for (int i = 0; i < XXH64_DIGEST_LENGTH; i++) {
+    digest[i] = (unsigned char)(h >> (56 - 8 * i));
+  }
+}
@@ -0,0 +1,43 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * XXH64, a fast non-cryptographic hash for detecting changed files.
+ */
+
+#ifndef BAREOS_LIB_XXHASH64_H_
+#define BAREOS_LIB_XXHASH64_H_
+
+#define XXH64_BLOCK_LENGTH 32
+#define XXH64_DIGEST_LENGTH 8
+
+typedef struct {
+  uint64_t total_len;
+  uint64_t v[4];
+  unsigned char buffer[XXH64_BLOCK_LENGTH];
+  uint32_t buffered;
+} XXH64_CTX;
+
+void XXH64Init(XXH64_CTX* context);
+void XXH64Update(XXH64_CTX* context, const unsigned char* data, size_t len);
+void XXH64Final(unsigned char digest[XXH64_DIGEST_LENGTH], XXH64_CTX* context);
+
+#endif /* BAREOS_LIB_XXHASH64_H_ */
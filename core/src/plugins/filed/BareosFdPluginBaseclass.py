@@ -184,8 +184,8 @@ class BareosFdPluginBaseclass(object):
                 context, 200,
                 "Reading %d from file %s\n" %
                 (IOP.count, self.FNAME))
-            IOP.buf = bytearray(IOP.count)
-            IOP.status = self.file.readinto(IOP.buf)
+            # Read directly into the buffer of Bareos
+            IOP.status = self.file.readinto(IOP.membuf)
             IOP.io_errno = 0
             return bRCs['bRC_OK']
 
@@ -194,7 +194,7 @@ class BareosFdPluginBaseclass(object):
                 context, 200,
                 "Writing buffer to file %s\n" %
                 (self.FNAME))
-            self.file.write(IOP.buf)
+            self.file.write(IOP.membuf)
             IOP.status = IOP.count
             IOP.io_errno = 0
             return bRCs['bRC_OK']
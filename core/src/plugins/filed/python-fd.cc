@@ -84,6 +84,7 @@ static bRC PyHandlePluginEvent(bpContext* ctx, bEvent* event, void* value);
 static bRC PyStartBackupFile(bpContext* ctx, struct save_pkt* sp);
 static bRC PyEndBackupFile(bpContext* ctx);
 static bRC PyPluginIO(bpContext* ctx, struct io_pkt* io);
+static bool ReadFromIoBatch(struct plugin_ctx* p_ctx, struct io_pkt* io);
 static bRC PyStartRestoreFile(bpContext* ctx, const char* cmd);
 static bRC PyEndRestoreFile(bpContext* ctx);
 static bRC PyCreateFile(bpContext* ctx, struct restore_pkt* rp);
@@ -139,6 +140,11 @@ struct plugin_ctx {
   PyObject* pModule;   /* Python Module entry point */
   PyObject* pDict;     /* Python Dictionary */
   PyObject* bpContext; /* Python representation of plugin context */
+  char* io_batch;         /* Data read ahead by plugin_io() */
+  int32_t io_batch_alloc; /* Allocated size of io_batch */
+  int32_t io_batch_size;  /* Bytes to read per plugin_io() call, 0 = off */
+  int32_t io_batch_len;   /* Bytes of data in io_batch */
+  int32_t io_batch_pos;   /* Bytes of io_batch already returned */
 };
 
 /**
@@ -254,6 +260,8 @@ static bRC freePlugin(bpContext* ctx)
 
   if (p_ctx->object) { free(p_ctx->object); }
 
+  if (p_ctx->io_batch) { free(p_ctx->io_batch); }
+
   /*
    * Stop any sub interpreter started per plugin instance.
    */
@@ -574,6 +582,12 @@ static bRC pluginIO(bpContext* ctx, struct io_pkt* io)
 
   if (!p_ctx->python_loaded) { goto bail_out; }
 
+  /*
+   * Reads of data the plugin already returned in a batch don't need the
+   * interpreter.
+   */
+  if (io->func == IO_READ && ReadFromIoBatch(p_ctx, io)) { return bRC_OK; }
+
   PyEval_AcquireThread(p_ctx->interpreter);
   retval = PyPluginIO(ctx, io);
   PyEval_ReleaseThread(p_ctx->interpreter);
@@ -1706,7 +1720,40 @@ bail_out:
   return retval;
 }
 
-static inline PyIoPacket* NativeToPyIoPacket(struct io_pkt* io)
+/**
+ * Return the next part of the data the plugin read ahead in a batch.
+ *
+ * Returns: false if there is no data left in the batch.
+ */
+static bool ReadFromIoBatch(struct plugin_ctx* p_ctx, struct io_pkt* io)
+{
+  int32_t len;
+
+  if (p_ctx->io_batch_pos >= p_ctx->io_batch_len) { return false; }
+
+  len = MIN(io->count, p_ctx->io_batch_len - p_ctx->io_batch_pos);
+  memcpy(io->buf, p_ctx->io_batch + p_ctx->io_batch_pos, len);
+  p_ctx->io_batch_pos += len;
+
+  io->status = len;
+  io->io_errno = 0;
+  io->lerror = 0;
+  io->win32 = false;
+
+  return true;
+}
+
+/**
+ * Create the Python IoPacket for an I/O request, data points to the buffer
+ * the plugin reads into or the data to write, size is its length.
+ *
+ * The buffer is not copied into a Python object, the plugin gets it as a
+ * memoryview in the membuf attribute. Only when the plugin accesses the buf
+ * attribute of a write request a bytearray copy of the data is made.
+ */
+static inline PyIoPacket* NativeToPyIoPacket(struct io_pkt* io,
+                                             char* data,
+                                             int32_t size)
 {
   PyIoPacket* pIoPkt = PyObject_New(PyIoPacket, &PyIoPacketType);
 
@@ -1715,25 +1762,17 @@ static inline PyIoPacket* NativeToPyIoPacket(struct io_pkt* io)
      * Initialize the Python IoPkt with the data we got passed in.
      */
     pIoPkt->func = io->func;
-    pIoPkt->count = io->count;
+    pIoPkt->count = size;
     pIoPkt->flags = io->flags;
     pIoPkt->mode = io->mode;
     pIoPkt->fname = io->fname;
     pIoPkt->whence = io->whence;
     pIoPkt->offset = io->offset;
-    if (io->func == IO_WRITE && io->count > 0) {
-      /*
-       * Only initialize the buffer with read data when we are writing and there
-       * is data.
-       */
-      pIoPkt->buf = PyByteArray_FromStringAndSize(io->buf, io->count);
-      if (!pIoPkt->buf) {
-        Py_DECREF((PyObject*)pIoPkt);
-        return (PyIoPacket*)NULL;
-      }
-    } else {
-      pIoPkt->buf = NULL;
-    }
+    pIoPkt->buf = NULL;
+    pIoPkt->membuf = NULL;
+    pIoPkt->data = data;
+    pIoPkt->data_size = size;
+    pIoPkt->batch_size = 0;
 
     /*
      * These must be set by the Python function but we initialize them to zero
@@ -1758,24 +1797,70 @@ static inline bool PyIoPacketToNative(PyIoPacket* pIoPkt, struct io_pkt* io)
   io->win32 = pIoPkt->win32;
   io->status = pIoPkt->status;
   if (io->func == IO_READ && io->status > 0) {
+    if (io->status > pIoPkt->data_size) { return false; }
+
     /*
-     * Only copy back the data when doing a read and there is data.
+     * Only copy back the data when doing a read and the plugin returned it in
+     * a bytearray, data read into membuf is already in place.
      */
-    if (PyByteArray_Check(pIoPkt->buf)) {
+    if (pIoPkt->buf && PyByteArray_Check(pIoPkt->buf)) {
       char* buf;
 
-      if (PyByteArray_Size(pIoPkt->buf) > io->count || io->status > io->count) {
-        return false;
-      }
+      if (PyByteArray_Size(pIoPkt->buf) > pIoPkt->data_size) { return false; }
 
       if (!(buf = PyByteArray_AsString(pIoPkt->buf))) { return false; }
-      memcpy(io->buf, buf, io->status);
+      if (buf != pIoPkt->data) { memcpy(pIoPkt->data, buf, io->status); }
     }
   }
 
   return true;
 }
 
+/**
+ * Invalidate the membuf attribute once plugin_io() returned, the buffer of
+ * Bareos it points to is reused or freed from now on. The memoryview is
+ * released so a plugin that kept a reference gets an error instead of
+ * accessing stale memory.
+ */
+static void PyIoPacketReleaseMembuf(PyIoPacket* pIoPkt)
+{
+  if (pIoPkt->membuf) {
+#if PY_MAJOR_VERSION >= 3
+    PyObject *type, *value, *traceback, *result;
+
+    /*
+     * Keep a pending exception of plugin_io() for the error handler.
+     */
+    PyErr_Fetch(&type, &value, &traceback);
+    result = PyObject_CallMethod(pIoPkt->membuf, (char*)"release", NULL);
+    if (result) {
+      Py_DECREF(result);
+    } else {
+      PyErr_Clear();
+    }
+    PyErr_Restore(type, value, traceback);
+#else
+    /*
+     * Python 2 has no memoryview.release(), empty the view instead. Its
+     * length and indexing use the shape and strides of the one dimensional
+     * view, so these are cleared too and it is made read-only.
+     */
+    Py_buffer* view = PyMemoryView_GET_BUFFER(pIoPkt->membuf);
+
+    view->buf = NULL;
+    view->len = 0;
+    view->readonly = 1;
+    if (view->shape) { view->shape[0] = 0; }
+    if (view->strides) { view->strides[0] = 0; }
+#endif
+    Py_DECREF(pIoPkt->membuf);
+    pIoPkt->membuf = NULL;
+  }
+
+  pIoPkt->data = NULL;
+  pIoPkt->data_size = 0;
+}
+
 /**
  * Do actual I/O. Bareos calls this after startBackupFile
  * or after startRestoreFile to do the actual file
@@ -1795,13 +1880,50 @@ static bRC PyPluginIO(bpContext* ctx, struct io_pkt* io)
   if (pFunc && PyCallable_Check(pFunc)) {
     PyIoPacket* pIoPkt;
     PyObject* pRetVal;
+    bool batched = false;
 
-    pIoPkt = NativeToPyIoPacket(io);
+    switch (io->func) {
+      case IO_READ:
+        /*
+         * Let the plugin read a whole batch into our own buffer.
+         */
+        if (p_ctx->io_batch_size > io->count) {
+          if (p_ctx->io_batch_alloc < p_ctx->io_batch_size) {
+            char* buf = (char*)realloc(p_ctx->io_batch, p_ctx->io_batch_size);
+
+            if (!buf) { goto bail_out; }
+            p_ctx->io_batch = buf;
+            p_ctx->io_batch_alloc = p_ctx->io_batch_size;
+          }
+          batched = true;
+        }
+        break;
+      case IO_SEEK:
+        /*
+         * The plugin is ahead of the position Bareos knows about by the data
+         * left in the batch.
+         */
+        if (io->whence == SEEK_CUR) {
+          io->offset -= p_ctx->io_batch_len - p_ctx->io_batch_pos;
+        }
+        p_ctx->io_batch_len = p_ctx->io_batch_pos = 0;
+        break;
+      default:
+        p_ctx->io_batch_len = p_ctx->io_batch_pos = 0;
+        break;
+    }
+
+    if (batched) {
+      pIoPkt = NativeToPyIoPacket(io, p_ctx->io_batch, p_ctx->io_batch_size);
+    } else {
+      pIoPkt = NativeToPyIoPacket(io, io->buf, io->count);
+    }
     if (!pIoPkt) { goto bail_out; }
 
     pRetVal = PyObject_CallFunctionObjArgs(pFunc, p_ctx->bpContext,
                                            (PyObject*)pIoPkt, NULL);
     if (!pRetVal) {
+      PyIoPacketReleaseMembuf(pIoPkt);
       Py_DECREF((PyObject*)pIoPkt);
       goto bail_out;
     } else {
@@ -1809,11 +1931,23 @@ static bRC PyPluginIO(bpContext* ctx, struct io_pkt* io)
       Py_DECREF(pRetVal);
 
       if (!PyIoPacketToNative(pIoPkt, io)) {
+        PyIoPacketReleaseMembuf(pIoPkt);
         Py_DECREF((PyObject*)pIoPkt);
         goto bail_out;
       }
     }
+
+    if (io->func == IO_OPEN) {
+      p_ctx->io_batch_size = MAX(pIoPkt->batch_size, 0);
+    }
+    PyIoPacketReleaseMembuf(pIoPkt);
     Py_DECREF((PyObject*)pIoPkt);
+
+    if (batched && io->status > 0) {
+      p_ctx->io_batch_len = io->status;
+      p_ctx->io_batch_pos = 0;
+      ReadFromIoBatch(p_ctx, io);
+    }
   } else {
     Dmsg(ctx, debuglevel,
          "python-fd: Failed to find function named plugin_io()\n");
@@ -3486,6 +3620,10 @@ static int PyIoPacket_init(PyIoPacket* self, PyObject* args, PyObject* kwds)
   self->flags = 0;
   self->mode = 0;
   self->buf = NULL;
+  self->membuf = NULL;
+  self->data = NULL;
+  self->data_size = 0;
+  self->batch_size = 0;
   self->fname = NULL;
   self->status = 0;
   self->io_errno = 0;
@@ -3511,9 +3649,59 @@ static int PyIoPacket_init(PyIoPacket* self, PyObject* args, PyObject* kwds)
 static void PyIoPacket_dealloc(PyIoPacket* self)
 {
   if (self->buf) { Py_XDECREF(self->buf); }
+  if (self->membuf) { Py_XDECREF(self->membuf); }
   PyObject_Del(self);
 }
 
+/**
+ * Get the buf attribute, for a write it is created on first access.
+ */
+static PyObject* PyIoPacket_getbuf(PyIoPacket* self, void* closure)
+{
+  if (!self->buf && self->func == IO_WRITE && self->data &&
+      self->data_size > 0) {
+    self->buf = PyByteArray_FromStringAndSize(self->data, self->data_size);
+    if (!self->buf) { return NULL; }
+  }
+
+  if (!self->buf) { Py_RETURN_NONE; }
+
+  Py_INCREF(self->buf);
+  return self->buf;
+}
+
+static int PyIoPacket_setbuf(PyIoPacket* self, PyObject* value, void* closure)
+{
+  Py_XINCREF(value);
+  Py_XDECREF(self->buf);
+  self->buf = value;
+
+  return 0;
+}
+
+/**
+ * Get the membuf attribute, a memoryview on the buffer of Bareos. It is
+ * writable for a read and only valid during the plugin_io() call.
+ */
+static PyObject* PyIoPacket_getmembuf(PyIoPacket* self, void* closure)
+{
+  if (!self->membuf && self->data) {
+    Py_buffer view;
+
+    if (PyBuffer_FillInfo(&view, NULL, self->data, self->data_size,
+                          self->func != IO_READ, PyBUF_FULL_RO) < 0) {
+      return NULL;
+    }
+    self->membuf = PyMemoryView_FromBuffer(&view);
+    if (!self->membuf) { return NULL; }
+  }
+
+  if (!self->membuf) { Py_RETURN_NONE; }
+
+  Py_INCREF(self->membuf);
+  return self->membuf;
+}
+
 /**
  * Python specific handlers for PyAclPacket structure mapping.
  */
@@ -463,6 +463,7 @@ typedef struct {
   int32_t flags;               /* Open flags */
   int32_t mode;                /* Permissions for created files */
   PyObject* buf;               /* Read/Write buffer */
+  PyObject* membuf;            /* Memoryview on data */
   const char* fname;           /* Open filename */
   int32_t status;              /* Return status */
   int32_t io_errno;            /* Errno code */
@@ -470,6 +471,9 @@ typedef struct {
   int32_t whence;              /* Lseek argument */
   int64_t offset;              /* Lseek argument */
   bool win32;                  /* Win32 GetLastError returned */
+  int32_t batch_size;          /* Bytes to read per call, set on open */
+  char* data;                  /* Buffer of Bareos to read into or write */
+  int32_t data_size;           /* Size of data */
 } PyIoPacket;
 
 /**
@@ -478,11 +482,22 @@ typedef struct {
 static void PyIoPacket_dealloc(PyIoPacket* self);
 static int PyIoPacket_init(PyIoPacket* self, PyObject* args, PyObject* kwds);
 static PyObject* PyIoPacket_repr(PyIoPacket* self);
+static PyObject* PyIoPacket_getbuf(PyIoPacket* self, void* closure);
+static int PyIoPacket_setbuf(PyIoPacket* self, PyObject* value, void* closure);
+static PyObject* PyIoPacket_getmembuf(PyIoPacket* self, void* closure);
 
 static PyMethodDef PyIoPacket_methods[] = {
     {NULL} /* Sentinel */
 };
 
+static PyGetSetDef PyIoPacket_getset[] = {
+    {(char*)"buf", (getter)PyIoPacket_getbuf, (setter)PyIoPacket_setbuf,
+     (char*)"Read/write buffer", NULL},
+    {(char*)"membuf", (getter)PyIoPacket_getmembuf, NULL,
+     (char*)"Memoryview on the read/write buffer, only valid during the call",
+     NULL},
+    {NULL}};
+
 static PyMemberDef PyIoPacket_members[] = {
     {(char*)"func", T_USHORT, offsetof(PyIoPacket, func), 0,
      (char*)"Function code"},
@@ -492,8 +507,6 @@ static PyMemberDef PyIoPacket_members[] = {
      (char*)"Open flags"},
     {(char*)"mode", T_INT, offsetof(PyIoPacket, mode), 0,
      (char*)"Permissions for created files"},
-    {(char*)"buf", T_OBJECT, offsetof(PyIoPacket, buf), 0,
-     (char*)"Read/write buffer"},
     {(char*)"fname", T_STRING, offsetof(PyIoPacket, fname), 0,
      (char*)"Open filename"},
     {(char*)"status", T_INT, offsetof(PyIoPacket, status), 0,
@@ -508,6 +521,8 @@ static PyMemberDef PyIoPacket_members[] = {
      (char*)"Lseek argument"},
     {(char*)"win32", T_BOOL, offsetof(PyIoPacket, win32), 0,
      (char*)"Win32 GetLastError returned"},
+    {(char*)"batch_size", T_INT, offsetof(PyIoPacket, batch_size), 0,
+     (char*)"Bytes to read per call, set on open to read ahead"},
     {NULL}};
 
 static PyTypeObject PyIoPacketType = {
@@ -539,7 +554,7 @@ static PyTypeObject PyIoPacketType = {
     0,                                        /* tp_iternext */
     PyIoPacket_methods,                       /* tp_methods */
     PyIoPacket_members,                       /* tp_members */
-    0,                                        /* tp_getset */
+    PyIoPacket_getset,                        /* tp_getset */
     0,                                        /* tp_base */
     0,                                        /* tp_dict */
     0,                                        /* tp_descr_get */
@@ -71,6 +71,8 @@ static int const rdebuglevel = 100;
 /* Forward referenced functions */
 static void AttachDcrToDev(DeviceControlRecord* dcr);
 static void DetachDcrFromDev(DeviceControlRecord* dcr);
+static void FreeSharedReadDevice(DeviceControlRecord* dcr);
+static void ReportTapeWriteStatistics(DeviceControlRecord* dcr);
 static void SetDcrFromVol(DeviceControlRecord* dcr, VolumeList* vol);
 
 /**
@@ -598,6 +600,7 @@ bool ReleaseDevice(DeviceControlRecord* dcr)
      */
     dev->num_writers--;
     Dmsg1(100, "There are %d writers in ReleaseDevice\n", dev->num_writers);
+    if (dev->IsTape()) { ReportTapeWriteStatistics(dcr); }
     if (dev->IsLabeled()) {
       Dmsg2(200, "dir_create_jobmedia. Release vol=%s dev=%s\n",
             dev->getVolCatName(), dev->print_name());
@@ -718,18 +721,55 @@ bool ReleaseDevice(DeviceControlRecord* dcr)
     dev->Unlock();
   }
 
+  /*
+   * Freeing the dcr also frees a shared read clone, so report first.
+   */
+  Dmsg2(100, "Device %s released by JobId=%u\n", dev->print_name(),
+        (uint32_t)jcr->JobId);
+
   if (dcr->keep_dcr) {
     DetachDcrFromDev(dcr);
   } else {
     FreeDeviceControlRecord(dcr);
   }
 
-  Dmsg2(100, "Device %s released by JobId=%u\n", dev->print_name(),
-        (uint32_t)jcr->JobId);
-
   return retval;
 }
 
+/**
+ * Report the throughput of the tape drive seen by the job and the number of
+ * pauses in the data stream that likely made the drive backhitch.
+ */
+static void ReportTapeWriteStatistics(DeviceControlRecord* dcr)
+{
+  btime_t elapsed;
+  uint64_t write_rate, stream_rate;
+  char ed1[50], ed2[50], ed3[50];
+
+  if (!dcr->tape_write_blocks) { return; }
+
+  elapsed = dcr->tape_last_write - dcr->tape_first_write;
+  write_rate = dcr->tape_write_time
+                   ? dcr->tape_write_bytes * 1000000 / dcr->tape_write_time
+                   : 0;
+  stream_rate = elapsed ? dcr->tape_write_bytes * 1000000 / elapsed : 0;
+
+  Jmsg(dcr->jcr, M_INFO, 0,
+       _("Drive %s wrote %s bytes in %u blocks at %s bytes/s (%s bytes/s "
+         "including pauses), %u pauses likely caused backhitches.\n"),
+       dcr->dev->print_name(),
+       edit_uint64_with_commas(dcr->tape_write_bytes, ed1),
+       dcr->tape_write_blocks, edit_uint64_with_commas(write_rate, ed2),
+       edit_uint64_with_commas(stream_rate, ed3), dcr->tape_write_stalls);
+
+  dcr->tape_first_write = 0;
+  dcr->tape_last_write = 0;
+  dcr->tape_write_time = 0;
+  dcr->tape_write_bytes = 0;
+  dcr->tape_write_blocks = 0;
+  dcr->tape_write_stalls = 0;
+}
+
 /**
  * Clean up the device for reuse without freeing the memory
  */
@@ -776,6 +816,7 @@ void SetupNewDcrDevice(JobControlRecord* jcr,
     dcr->rec = new_record();
 
     if (dcr->attached_to_dev) { DetachDcrFromDev(dcr); }
+    if (dcr->dev != dev) { FreeSharedReadDevice(dcr); }
 
     /*
      * Use job spoolsize prior to device spoolsize
@@ -857,6 +898,27 @@ static void DetachDcrFromDev(DeviceControlRecord* dcr)
   V(dcr->mutex_);
 }
 
+/**
+ * A shared read clone only lives as long as the dcr reading from it is on it.
+ * Put the dcr back on the device the clone was made of and free the clone.
+ */
+static void FreeSharedReadDevice(DeviceControlRecord* dcr)
+{
+  Device* clone = dcr->dev;
+
+  /*
+   * Only look at the device when it is our own clone, the stand alone tools
+   * already deleted their device with term() when they free the dcr.
+   */
+  if (!dcr->shared_read || !clone) { return; }
+  dcr->shared_read = false;
+
+  Dmsg1(100, "Free shared read clone of %s\n", clone->print_name());
+  dcr->SetDev(clone->shared_read_parent);
+  FreeVolume(clone);
+  clone->term();
+}
+
 /**
  * Free up all aspects of the given dcr -- i.e. dechain it,
  *  release allocated memory, zap pointers, ...
@@ -869,6 +931,7 @@ void FreeDeviceControlRecord(DeviceControlRecord* dcr)
   jcr = dcr->jcr;
 
   LockedDetachDcrFromDev(dcr);
+  FreeSharedReadDevice(dcr);
 
   if (dcr->block) { FreeBlock(dcr->block); }
 
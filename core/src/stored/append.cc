@@ -357,6 +357,7 @@ bool SendAttrsToDir(JobControlRecord* jcr, DeviceRecord* rec)
 {
   if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES ||
       rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX ||
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_BINARY ||
       rec->maskedStream == STREAM_RESTORE_OBJECT ||
       CryptoDigestStreamType(rec->maskedStream) != CRYPTO_DIGEST_NONE) {
     if (!jcr->no_attributes) {
@@ -31,6 +31,7 @@
 #include "include/bareos.h" /* pull in global headers */
 #include "stored/stored.h"  /* pull in Storage Daemon headers */
 #include "stored/autochanger.h"
+#include "stored/scsi_changer.h"
 #include "stored/wait.h"
 #include "lib/bnet.h"
 #include "lib/edit.h"
@@ -50,6 +51,12 @@ static char* transfer_edit_device_codes(DeviceControlRecord* dcr,
                                         const char* cmd,
                                         slot_number_t src_slot,
                                         slot_number_t dst_slot);
+static int RunChangerCommand(DeviceControlRecord* dcr,
+                             const char* cmd,
+                             char* program,
+                             uint32_t timeout,
+                             POOLMEM*& results);
+static void SendChangerOutput(BareosSocket* dir, const char* output);
 
 /**
  * Init all the autochanger resources found
@@ -245,7 +252,8 @@ int AutoloadDevice(DeviceControlRecord* dcr, int writing, BareosSocket* dir)
           edit_device_codes(dcr, changer, dcr->device->changer_command, "load");
       dev->close(dcr);
       Dmsg1(200, "Run program=%s\n", changer);
-      status = RunProgramFullOutput(changer, timeout, results.addr());
+      status =
+          RunChangerCommand(dcr, "load", changer, timeout, results.addr());
       if (status == 0) {
         Jmsg(
             jcr, M_INFO, 0,
@@ -340,7 +348,7 @@ slot_number_t GetAutochangerLoadedSlot(DeviceControlRecord* dcr, bool lock_set)
   changer =
       edit_device_codes(dcr, changer, dcr->device->changer_command, "loaded");
   Dmsg1(100, "Run program=%s\n", changer);
-  status = RunProgramFullOutput(changer, timeout, results.addr());
+  status = RunChangerCommand(dcr, "loaded", changer, timeout, results.addr());
   Dmsg3(100, "run_prog: %s stat=%d result=%s", changer, status,
         results.c_str());
 
@@ -492,7 +500,8 @@ bool UnloadAutochanger(DeviceControlRecord* dcr,
         edit_device_codes(dcr, changer, dcr->device->changer_command, "unload");
     dev->close(dcr);
     Dmsg1(100, "Run program=%s\n", changer);
-    status = RunProgramFullOutput(changer, timeout, results.addr());
+    status =
+        RunChangerCommand(dcr, "unload", changer, timeout, results.addr());
     dcr->VolCatInfo.Slot = slot;
     if (status != 0) {
       BErrNo be;
@@ -666,7 +675,8 @@ bool UnloadDev(DeviceControlRecord* dcr, Device* dev, bool lock_set)
         dev->NumReserved());
   Dmsg1(100, "Run program=%s\n", ChangerCmd);
 
-  status = RunProgramFullOutput(ChangerCmd, timeout, results.addr());
+  status =
+      RunChangerCommand(dcr, "unload", ChangerCmd, timeout, results.addr());
   dcr->VolCatInfo.Slot = save_slot;
   dcr->SetDev(save_dev);
   if (status != 0) {
@@ -744,6 +754,20 @@ bool AutochangerCmd(DeviceControlRecord* dcr,
   changer = edit_device_codes(dcr, changer, dcr->device->changer_command, cmd);
   dir->fsend(_("3306 Issuing autochanger \"%s\" command.\n"), cmd);
 
+  if (IsNativeChanger(dcr->device)) {
+    PoolMem results(PM_MESSAGE);
+
+    status = NativeChangerCommand(dcr, cmd, 0, 0, results.addr());
+    if (status != 0) {
+      dir->fsend(_("3998 Autochanger error: ERR=%s"), results.c_str());
+    } else if (bstrcmp(cmd, "slots")) {
+      dir->fsend("slots=%hd", str_to_int16(results.c_str()));
+    } else {
+      SendChangerOutput(dir, results.c_str());
+    }
+    goto bail_out;
+  }
+
   /*
    * Now issue the command
    */
@@ -835,6 +859,21 @@ bool AutochangerTransferCmd(DeviceControlRecord* dcr,
                                  "transfer", src_slot, dst_slot);
   dir->fsend(_("3306 Issuing autochanger transfer command.\n"));
 
+  if (IsNativeChanger(dcr->device)) {
+    PoolMem results(PM_MESSAGE);
+
+    status = NativeChangerCommand(dcr, "transfer", src_slot, dst_slot,
+                                  results.addr());
+    if (status != 0) {
+      dir->fsend(_("3998 Autochanger error: ERR=%s"), results.c_str());
+    } else {
+      dir->fsend(
+          _("3308 Successfully transferred volume from slot %hd to %hd.\n"),
+          src_slot, dst_slot);
+    }
+    goto bail_out;
+  }
+
   /*
    * Now issue the command
    */
@@ -870,6 +909,45 @@ bail_out:
   return true;
 }
 
+/**
+ * Run a changer command, either by the native changer driver or by running
+ * the changer script.
+ */
+static int RunChangerCommand(DeviceControlRecord* dcr,
+                             const char* cmd,
+                             char* program,
+                             uint32_t timeout,
+                             POOLMEM*& results)
+{
+  if (IsNativeChanger(dcr->device)) {
+    Dmsg2(100, "Native changer %s command=%s\n", dcr->device->changer_name,
+          cmd);
+    return NativeChangerCommand(dcr, cmd, 0, 0, results);
+  }
+
+  return RunProgramFullOutput(program, timeout, results);
+}
+
+/**
+ * Send the output of a native changer command line by line to the Director.
+ */
+static void SendChangerOutput(BareosSocket* dir, const char* output)
+{
+  const char* p = output;
+
+  while (*p) {
+    const char* eol = strchr(p, '\n');
+    int len = eol ? eol - p + 1 : strlen(p);
+
+    dir->msg = CheckPoolMemorySize(dir->msg, len + 1);
+    bstrncpy(dir->msg, p, len + 1);
+    dir->message_length = len;
+    Dmsg1(100, "<stored: %s", dir->msg);
+    BnetSend(dir);
+    p += len;
+  }
+}
+
 /**
  * Special version of edit_device_codes for use with transfer subcommand.
  * Edit codes into ChangerCommand
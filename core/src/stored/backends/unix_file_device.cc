@@ -33,8 +33,13 @@
 #include "stored/stored.h"
 #include "stored/stored_globals.h"
 #include "unix_file_device.h"
+#include "lib/edit.h"
 #include "lib/util.h"
 
+#ifdef HAVE_SYS_STATVFS_H
+#include <sys/statvfs.h>
+#endif
+
 namespace storagedaemon {
 
 /**
@@ -207,22 +212,467 @@ bool unix_file_device::UnmountBackend(DeviceControlRecord* dcr, int timeout)
   return retval;
 }
 
+/*
+ * Optional write engine for file volumes.
+ *
+ * When one of the DirectIo, OutstandingWrites or PreallocationSize
+ * directives is set, writes to a volume opened for writing do not go
+ * through ::write() but are written with pwrite() at an offset we track
+ * ourselves in write_pos_. The file offset of fd_ is only brought up to
+ * date by SyncWrites(), which every other operation on the volume calls
+ * first.
+ *
+ * - DirectIo writes blocks that are aligned in offset and length through a
+ *   second descriptor opened with O_DIRECT, so backup data does not evict
+ *   the page cache. Other writes (e.g. with variable block sizes) are
+ *   written back and dropped from the page cache behind the write position.
+ * - OutstandingWrites queues up to that number of block writes to a writer
+ *   thread per device so the job thread does not wait for the disk. When
+ *   the file system gets full we go back to synchronous writes, so running
+ *   out of space is reported by the write of the block that did not fit and
+ *   the block is written again on the next volume. Any other error of a
+ *   queued write is returned by the next operation on the device and by the
+ *   flush when the device is released.
+ * - PreallocationSize preallocates the volume file ahead of the write
+ *   position to reduce fragmentation. The space beyond the end of the
+ *   volume is given back when the volume is closed.
+ */
+static const size_t direct_io_alignment = 4096;
+static const boffset_t drop_behind_chunk = 8 * 1024 * 1024;
+static const boffset_t space_check_interval = 64 * 1024 * 1024;
+
+static inline bool IsAligned(size_t value)
+{
+  return (value % direct_io_alignment) == 0;
+}
+
+bool unix_file_device::UseWriteEngine() const
+{
+  return device->direct_io || device->outstanding_writes > 0 ||
+         device->preallocation_size > 0;
+}
+
+/**
+ * Open the O_DIRECT descriptor used for aligned writes.
+ */
+void unix_file_device::OpenDirect(const char* pathname)
+{
+#ifdef O_DIRECT
+  if ((direct_fd_ = ::open(pathname, O_WRONLY | O_BINARY | O_DIRECT)) < 0) {
+    BErrNo be;
+
+    Dmsg2(100, "Direct I/O not possible on %s, ERR=%s\n", pathname,
+          be.bstrerror());
+  }
+#endif
+}
+
+/**
+ * Allocate the backing store of the volume up to at least end.
+ */
+void unix_file_device::Preallocate(boffset_t offset, boffset_t end)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+  boffset_t start;
+  boffset_t len;
+
+  if (!device->preallocation_size || prealloc_failed_ ||
+      end <= prealloc_end_) {
+    return;
+  }
+
+  start = prealloc_end_ ? prealloc_end_ : offset;
+  len = end - start + device->preallocation_size;
+
+  /*
+   * Keep the file size, the end of data is where eod() finds it.
+   */
+  if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, start, len) < 0) {
+    BErrNo be;
+
+    Dmsg2(100, "Preallocation on %s failed, ERR=%s\n", prt_name,
+          be.bstrerror());
+    prealloc_failed_ = true;
+    return;
+  }
+
+  prealloc_end_ = start + len;
+#endif
+}
+
+/**
+ * Give back the space preallocated beyond the end of the volume.
+ */
+void unix_file_device::ReleasePreallocation()
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_PUNCH_HOLE)
+  struct stat st;
+
+  if (prealloc_end_ && fstat(fd_, &st) == 0 && prealloc_end_ > st.st_size) {
+    if (fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, st.st_size,
+                  prealloc_end_ - st.st_size) < 0) {
+      BErrNo be;
+
+      Dmsg2(100, "Releasing preallocated space of %s failed, ERR=%s\n",
+            prt_name, be.bstrerror());
+    }
+  }
+#endif
+  prealloc_end_ = 0;
+  prealloc_failed_ = false;
+}
+
+/**
+ * Write back the data written through the page cache and drop it from the
+ * cache once a chunk of it has been collected.
+ */
+void unix_file_device::DropBehind(boffset_t end)
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
+  if (end - drop_start_ < drop_behind_chunk) { return; }
+
+#if defined(HAVE_SYNC_FILE_RANGE)
+  sync_file_range(fd_, drop_start_, end - drop_start_,
+                  SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                      SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+  posix_fadvise(fd_, drop_start_, end - drop_start_, POSIX_FADV_DONTNEED);
+  drop_start_ = end;
+#endif
+}
+
+/**
+ * Write one block at the given offset.
+ */
+ssize_t unix_file_device::WriteAt(const char* buffer,
+                                  size_t count,
+                                  boffset_t offset)
+{
+  int fd = fd_;
+  size_t done = 0;
+
+  Preallocate(offset, offset + count);
+
+  if (direct_fd_ >= 0 && IsAligned(offset) && IsAligned(count)) {
+    fd = direct_fd_;
+  }
+
+  while (done < count) {
+    ssize_t status;
+
+    status = ::pwrite(fd, buffer + done, count - done, offset + done);
+    if (status < 0 && errno == EINTR) { continue; }
+    if (status <= 0) { return done ? done : status; }
+    done += status;
+  }
+
+  if (fd == direct_fd_) {
+    drop_start_ = offset + count;
+  } else if (device->direct_io) {
+    DropBehind(offset + count);
+  }
+
+  return count;
+}
+
+/**
+ * Get a buffer for a queued write, waits when all buffers are in use.
+ */
+bool unix_file_device::GetWriteBuffer(WriteBuffer& buf, size_t count)
+{
+  size_t size = ((count + direct_io_alignment - 1) / direct_io_alignment) *
+                direct_io_alignment;
+  std::unique_lock<std::mutex> lock(write_mutex_);
+
+  while (free_buffers_.empty() &&
+         num_buffers_ >= device->outstanding_writes && !write_errno_) {
+    done_cv_.wait(lock);
+  }
+
+  if (write_errno_) {
+    errno = write_errno_;
+    return false;
+  }
+
+  if (free_buffers_.empty()) {
+    buf.data = nullptr;
+    buf.size = 0;
+    num_buffers_++;
+  } else {
+    buf = free_buffers_.back();
+    free_buffers_.pop_back();
+  }
+  lock.unlock();
+
+  if (buf.size < size) {
+    void* data;
+
+    /*
+     * Buffers come from posix_memalign() and bypass smartalloc.
+     */
+    Actuallyfree(buf.data);
+    if (posix_memalign(&data, direct_io_alignment, size) != 0) {
+      Emsg1(M_ABORT, 0, _("Out of memory allocating %d bytes\n"), (int)size);
+    }
+    buf.data = (char*)data;
+    buf.size = size;
+  }
+
+  return true;
+}
+
+void unix_file_device::WriterLoop()
+{
+  std::unique_lock<std::mutex> lock(write_mutex_);
+
+  while (1) {
+    WriteRequest req;
+    ssize_t status;
+    char ed1[50];
+
+    while (write_queue_.empty() && !writer_quit_) { work_cv_.wait(lock); }
+    if (write_queue_.empty()) { break; }
+
+    req = write_queue_.front();
+    write_queue_.pop_front();
+    write_in_flight_ = true;
+    lock.unlock();
+
+    errno = 0;
+    status = write_errno_ ? -1 : WriteAt(req.buf.data, req.len, req.offset);
+
+    lock.lock();
+    if (status != (ssize_t)req.len && !write_errno_) {
+      BErrNo be;
+
+      write_errno_ = errno ? errno : ENOSPC;
+      Emsg4(M_ERROR, 0, _("Write of %u bytes at %s on device %s failed: %s\n"),
+            req.len, edit_uint64(req.offset, ed1), prt_name, be.bstrerror());
+    }
+    free_buffers_.push_back(req.buf);
+    write_in_flight_ = false;
+    done_cv_.notify_all();
+  }
+}
+
+void unix_file_device::StartWriter()
+{
+  writer_quit_ = false;
+  write_errno_ = 0;
+  writer_ = std::thread(&unix_file_device::WriterLoop, this);
+}
+
+void unix_file_device::StopWriter()
+{
+  {
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    writer_quit_ = true;
+  }
+  work_cv_.notify_all();
+  writer_.join();
+
+  for (WriteBuffer& buf : free_buffers_) { Actuallyfree(buf.data); }
+  free_buffers_.clear();
+  num_buffers_ = 0;
+}
+
+/**
+ * Wait for all queued writes.
+ *
+ * Returns: true on success
+ *          false when a write failed, errno is set to its error
+ */
+bool unix_file_device::WaitForWrites()
+{
+  int error;
+
+  if (writer_.joinable()) {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+
+    while (!write_queue_.empty() || write_in_flight_) { done_cv_.wait(lock); }
+  }
+
+  error = write_errno_;
+  if (error) {
+    errno = error;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Wait for all queued writes and move the file offset to the end of the
+ * data written.
+ *
+ * Returns: true on success
+ *          false when a write failed, errno is set to its error
+ */
+bool unix_file_device::SyncWrites()
+{
+  bool retval = WaitForWrites();
+
+  if (pos_valid_) {
+    ::lseek(fd_, write_pos_, SEEK_SET);
+    pos_valid_ = false;
+  }
+
+  return retval;
+}
+
+/**
+ * See if the file system of the volume is about to run out of space, so
+ * queued writes could fail after we told the caller they succeeded. The
+ * free space is checked again every space_check_interval bytes written and
+ * we need room for all queued writes plus two intervals, as other jobs may
+ * write to the same file system.
+ */
+bool unix_file_device::LowOnSpace(size_t count)
+{
+#ifdef HAVE_SYS_STATVFS_H
+  struct statvfs st;
+  uint64_t needed;
+
+  if (write_pos_ < next_space_check_) { return low_on_space_; }
+
+  if (fstatvfs(fd_, &st) == 0) {
+    needed = (uint64_t)(device->outstanding_writes + 1) * count +
+             2 * space_check_interval;
+    low_on_space_ = (uint64_t)st.f_bavail * st.f_frsize < needed;
+  }
+  next_space_check_ = write_pos_ + space_check_interval;
+
+  return low_on_space_;
+#else
+  return false;
+#endif
+}
+
 int unix_file_device::d_open(const char* pathname, int flags, int mode)
 {
-  return ::open(pathname, flags, mode);
+  int fd;
+
+  fd = ::open(pathname, flags, mode);
+  if (fd < 0 || (flags & (O_WRONLY | O_RDWR)) == 0 || !UseWriteEngine()) {
+    return fd;
+  }
+
+  fd_ = fd;
+  pos_valid_ = false;
+  drop_start_ = 0;
+  next_space_check_ = 0;
+  low_on_space_ = false;
+  if (device->direct_io) { OpenDirect(pathname); }
+  if (device->outstanding_writes > 0) { StartWriter(); }
+
+  return fd;
 }
 
 ssize_t unix_file_device::d_read(int fd, void* buffer, size_t count)
 {
+  if (!SyncWrites()) { return -1; }
+
   return ::read(fd, buffer, count);
 }
 
 ssize_t unix_file_device::d_write(int fd, const void* buffer, size_t count)
 {
-  return ::write(fd, buffer, count);
+  WriteRequest req;
+
+  if (!UseWriteEngine()) { return ::write(fd, buffer, count); }
+
+  if (!pos_valid_) {
+    if ((write_pos_ = ::lseek(fd, 0, SEEK_CUR)) < 0) { return -1; }
+    if (!drop_start_) { drop_start_ = write_pos_; }
+    pos_valid_ = true;
+  }
+
+  if (!writer_.joinable() || LowOnSpace(count)) {
+    const char* data = (const char*)buffer;
+    ssize_t status;
+
+    if (!WaitForWrites()) { return -1; }
+
+    /*
+     * O_DIRECT needs an aligned buffer.
+     */
+    if (direct_fd_ >= 0 && IsAligned(write_pos_) && IsAligned(count) &&
+        ((uintptr_t)data % direct_io_alignment) != 0) {
+      if (bounce_.size < count) {
+        void* buf;
+
+        Actuallyfree(bounce_.data);
+        if (posix_memalign(&buf, direct_io_alignment, count) != 0) {
+          Emsg1(M_ABORT, 0, _("Out of memory allocating %d bytes\n"),
+                (int)count);
+        }
+        bounce_.data = (char*)buf;
+        bounce_.size = count;
+      }
+      memcpy(bounce_.data, data, count);
+      data = bounce_.data;
+    }
+
+    status = WriteAt(data, count, write_pos_);
+    if (status > 0) { write_pos_ += status; }
+
+    return status;
+  }
+
+  if (!GetWriteBuffer(req.buf, count)) { return -1; }
+  memcpy(req.buf.data, buffer, count);
+  req.len = count;
+  req.offset = write_pos_;
+  write_pos_ += count;
+
+  {
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    write_queue_.push_back(req);
+  }
+  work_cv_.notify_one();
+
+  return count;
+}
+
+bool unix_file_device::d_flush(DeviceControlRecord* dcr)
+{
+  if (!SyncWrites()) {
+    BErrNo be;
+
+    Mmsg2(errmsg, _("Unable to write data to device %s. ERR=%s\n"), prt_name,
+          be.bstrerror());
+    return false;
+  }
+
+  return true;
 }
 
-int unix_file_device::d_close(int fd) { return ::close(fd); }
+int unix_file_device::d_close(int fd)
+{
+  int status;
+  int error = 0;
+
+  if (!SyncWrites()) { error = errno; }
+  if (writer_.joinable()) { StopWriter(); }
+  ReleasePreallocation();
+
+  if (direct_fd_ >= 0) {
+    ::close(direct_fd_);
+    direct_fd_ = -1;
+  }
+  Actuallyfree(bounce_.data);
+  bounce_.data = nullptr;
+  bounce_.size = 0;
+  write_errno_ = 0;
+
+  status = ::close(fd);
+  if (status == 0 && error) {
+    errno = error;
+    status = -1;
+  }
+
+  return status;
+}
 
 int unix_file_device::d_ioctl(int fd, ioctl_req_t request, char* op)
 {
@@ -233,6 +683,8 @@ boffset_t unix_file_device::d_lseek(DeviceControlRecord* dcr,
                                     boffset_t offset,
                                     int whence)
 {
+  if (!SyncWrites()) { return -1; }
+
   return ::lseek(fd_, offset, whence);
 }
 
@@ -241,6 +693,14 @@ bool unix_file_device::d_truncate(DeviceControlRecord* dcr)
   struct stat st;
   PoolMem archive_name(PM_FNAME);
 
+  /*
+   * Errors of queued writes of the old content don't matter anymore.
+   */
+  SyncWrites();
+  write_errno_ = 0;
+  prealloc_end_ = 0;
+  drop_start_ = 0;
+
   /*
    * When secure erase is configured never truncate the file.
    */
@@ -319,6 +779,11 @@ bool unix_file_device::d_truncate(DeviceControlRecord* dcr)
    */
   chown(archive_name.c_str(), st.st_uid, st.st_gid);
 
+  if (direct_fd_ >= 0) {
+    ::close(direct_fd_);
+    OpenDirect(archive_name.c_str());
+  }
+
 bail_out:
   return true;
 }
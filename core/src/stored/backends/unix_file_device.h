@@ -28,6 +28,12 @@
 #ifndef BAREOS_STORED_BACKENDS_UNIX_FILE_DEVICE_H_
 #define BAREOS_STORED_BACKENDS_UNIX_FILE_DEVICE_H_
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace storagedaemon {
 
 class unix_file_device : public Device {
@@ -49,6 +55,61 @@ class unix_file_device : public Device {
   ssize_t d_read(int fd, void* buffer, size_t count) override;
   ssize_t d_write(int fd, const void* buffer, size_t count) override;
   bool d_truncate(DeviceControlRecord* dcr) override;
+  bool d_flush(DeviceControlRecord* dcr) override;
+
+ private:
+  /*
+   * Aligned buffer holding the data of a queued write.
+   */
+  struct WriteBuffer {
+    char* data;
+    size_t size;
+  };
+
+  struct WriteRequest {
+    WriteBuffer buf;
+    size_t len;
+    boffset_t offset;
+  };
+
+  bool UseWriteEngine() const;
+  void OpenDirect(const char* pathname);
+  ssize_t WriteAt(const char* buffer, size_t count, boffset_t offset);
+  bool WaitForWrites();
+  bool SyncWrites();
+  bool LowOnSpace(size_t count);
+  void Preallocate(boffset_t offset, boffset_t end);
+  void ReleasePreallocation();
+  void DropBehind(boffset_t end);
+  bool GetWriteBuffer(WriteBuffer& buf, size_t count);
+  void StartWriter();
+  void StopWriter();
+  void WriterLoop();
+
+  int direct_fd_ = -1;             /**< O_DIRECT descriptor of the volume */
+  bool pos_valid_ = false;         /**< write_pos_ is ahead of the fd */
+  boffset_t write_pos_ = 0;        /**< Offset of the next write */
+  boffset_t prealloc_end_ = 0;     /**< End of the preallocated area */
+  bool prealloc_failed_ = false;   /**< Filesystem can't preallocate */
+  boffset_t drop_start_ = 0;       /**< Start of range still in page cache */
+  WriteBuffer bounce_{nullptr, 0}; /**< Aligned copy for direct writes */
+
+  /*
+   * Write behind queue, see OutstandingWrites.
+   */
+  std::thread writer_;
+  std::mutex write_mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<WriteRequest> write_queue_;
+  std::vector<WriteBuffer> free_buffers_;
+  uint32_t num_buffers_ = 0;
+  bool write_in_flight_ = false;
+  bool writer_quit_ = false;
+  int write_errno_ = 0; /**< errno of the first failed queued write */
+  boffset_t next_space_check_ = 0; /**< write_pos_ of the next free space
+                                      check */
+  bool low_on_space_ = false;      /**< Write synchronously, see LowOnSpace() */
 };
 
 } /* namespace storagedaemon */
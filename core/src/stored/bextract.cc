@@ -496,6 +496,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
 
       /* If extracting, it was from previous stream, so
        * close the output file.
@@ -515,8 +516,10 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
       }
 
       if (FileIsIncluded(ff, attr->fname) && !FileIsExcluded(ff, attr->fname)) {
-        attr->data_stream = DecodeStat(attr->attr, &attr->statp,
-                                       sizeof(attr->statp), &attr->LinkFI);
+        if (rec->maskedStream != STREAM_UNIX_ATTRIBUTES_BINARY) {
+          attr->data_stream = DecodeStat(attr->attr, &attr->statp,
+                                         sizeof(attr->statp), &attr->LinkFI);
+        }
         if (!IsRestoreStreamSupported(attr->data_stream)) {
           if (!non_support_data++) {
             Jmsg(jcr, M_ERROR, 0,
@@ -649,6 +652,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
     case STREAM_SHA1_DIGEST:
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
+    case STREAM_XXH64_DIGEST:
       break;
 
     case STREAM_SIGNED_DIGEST:
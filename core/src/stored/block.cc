@@ -37,6 +37,7 @@
 #include "stored/label.h"
 #include "stored/socket_server.h"
 #include "stored/spool.h"
+#include "stored/volume_index.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
 
@@ -580,6 +581,39 @@ static const bool no_tape_write_test = true;
 static const bool no_tape_write_test = false;
 #endif
 
+/*
+ * A pause in the data stream to a tape drive longer than this most likely
+ * lets the drive run out of data, stop and reposition (backhitch).
+ */
+static const btime_t tape_stall_usec = 1000000;
+
+/**
+ * Account a write to a tape drive in the write statistics of the job.
+ */
+static void UpdateTapeWriteStatistics(DeviceControlRecord* dcr,
+                                      btime_t write_start,
+                                      ssize_t status)
+{
+  btime_t write_end = GetCurrentBtime();
+
+  if (!dcr->tape_first_write) { dcr->tape_first_write = write_start; }
+
+  /*
+   * The first block of a tape file follows a label, weof or mount.
+   */
+  if (dcr->tape_last_write && dcr->dev->block_num > 0 &&
+      write_start - dcr->tape_last_write > tape_stall_usec) {
+    dcr->tape_write_stalls++;
+  }
+
+  dcr->tape_last_write = write_end;
+  dcr->tape_write_time += write_end - write_start;
+  if (status > 0) {
+    dcr->tape_write_bytes += status;
+    dcr->tape_write_blocks++;
+  }
+}
+
 /**
  * Write a block to the device
  *
@@ -755,8 +789,10 @@ bool DeviceControlRecord::WriteBlockToDev()
    * from the OS telling us it is busy.
    */
   int retry = 0;
+  btime_t write_start = 0;
   errno = 0;
   status = 0;
+  if (dev->IsTape()) { write_start = GetCurrentBtime(); }
   do {
     if (retry > 0 && status == -1 && errno == EBUSY) {
       BErrNo be;
@@ -768,6 +804,8 @@ bool DeviceControlRecord::WriteBlockToDev()
     status = dev->write(block->buf, (size_t)wlen);
   } while (status == -1 && (errno == EBUSY) && retry++ < 3);
 
+  if (dev->IsTape()) { UpdateTapeWriteStatistics(dcr, write_start, status); }
+
   if (debug_block_checksum) {
     uint32_t achecksum = SerBlockHeader(block, dev->DoChecksum());
     if (checksum != achecksum) {
@@ -879,6 +917,7 @@ bool DeviceControlRecord::WriteBlockToDev()
   }
   if (block->LastIndex > 0) { dcr->VolLastIndex = block->LastIndex; }
   dcr->WroteVol = true;
+  if (!dev->IsTape()) { IndexWrittenBlock(dcr, block, dev->file_addr); }
   dev->file_addr += wlen; /* update file address */
   dev->file_size += wlen;
 
@@ -1044,6 +1083,35 @@ reread:
   } while (status == -1 && (errno == EBUSY || errno == EINTR || errno == EIO) &&
            retry++ < 3);
 
+  /*
+   * A tape block larger than the buffer (e.g. written with a Large Block
+   * Size) fails with ENOMEM and is skipped. Go back and read it again with a
+   * buffer for the largest block the drive can write.
+   */
+  if (status < 0 && errno == ENOMEM && dev->IsTape() && !looping) {
+    uint32_t buf_len = dev->DriveMaxBlockLength();
+
+    if (!buf_len || buf_len > MAX_BLOCK_LENGTH) { buf_len = MAX_BLOCK_LENGTH; }
+    if (buf_len > block->buf_len) {
+      dev->clrerror(-1);
+      if (!dev->bsr(1)) {
+        Mmsg(dev->errmsg, "%s", dev->bstrerror());
+        Jmsg(jcr, M_ERROR, 0, "%s", dev->errmsg);
+        block->read_len = 0;
+        return ReadStatus::Error;
+      }
+      Mmsg1(dev->errmsg, _("Setting block buffer size to %u bytes.\n"),
+            buf_len);
+      Jmsg(jcr, M_INFO, 0, "%s", dev->errmsg);
+      block->buf_len = buf_len;
+      FreeMemory(block->buf);
+      block->buf = GetMemory(block->buf_len);
+      EmptyBlock(block);
+      looping++;
+      goto reread;
+    }
+  }
+
   if (status < 0) {
     BErrNo be;
 
@@ -1205,6 +1273,7 @@ reread:
     dev->file = dev->EndFile = dcr->EndFile;
   }
   dcr->VolMediaId = dev->VolCatInfo.VolMediaId;
+  if (!dev->IsTape()) { IndexReadBlock(dcr, dev->file_addr); }
   dev->file_addr += block->read_len;
   dev->file_size += block->read_len;
 
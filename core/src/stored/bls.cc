@@ -39,6 +39,7 @@
 #include "stored/match_bsr.h"
 #include "stored/mount.h"
 #include "stored/read_record.h"
+#include "stored/volume_index.h"
 #include "findlib/match.h"
 #include "lib/attribs.h"
 #include "lib/bsignal.h"
@@ -99,6 +100,7 @@ static void usage()
         "       -p              proceed inspite of errors\n"
         "       -v              be verbose (can be specified multiple times)\n"
         "       -V              specify Volume names (separated by |)\n"
+        "       -x              rebuild the volume index\n"
         "       -?              print this message\n\n"),
       2000, VERSION, BDATE);
   exit(1);
@@ -113,6 +115,7 @@ int main(int argc, char* argv[])
   char* bsrName = NULL;
   char* DirectorName = NULL;
   bool ignore_label_errors = false;
+  bool rebuild_index = false;
   DirectorResource* director = NULL;
 
   setlocale(LC_ALL, "");
@@ -128,7 +131,7 @@ int main(int argc, char* argv[])
 
   ff = init_find_files();
 
-  while ((ch = getopt(argc, argv, "b:c:D:d:e:i:jkLpvV:?")) != -1) {
+  while ((ch = getopt(argc, argv, "b:c:D:d:e:i:jkLpvV:x?")) != -1) {
     switch (ch) {
       case 'b':
         bsrName = optarg;
@@ -208,6 +211,10 @@ int main(int argc, char* argv[])
         VolumeName = optarg;
         break;
 
+      case 'x':
+        rebuild_index = true;
+        break;
+
       case '?':
       default:
         usage();
@@ -244,6 +251,16 @@ int main(int argc, char* argv[])
 
   if (ff->included_files_list == NULL) { AddFnameToIncludeList(ff, 0, "/"); }
 
+  /*
+   * The index can only be rebuilt when every block of the volume is read.
+   */
+  if (rebuild_index && bsrName) {
+    Pmsg0(0, _("Cannot rebuild the volume index with a bootstrap file, "
+               "ignoring -x\n"));
+    rebuild_index = false;
+  }
+  SetVolumeIndexRebuild(rebuild_index);
+
   for (i = 0; i < argc; i++) {
     if (bsrName) { bsr = libbareos::parse_bsr(NULL, bsrName); }
     dcr = New(DeviceControlRecord);
@@ -407,6 +424,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
       if (!UnpackAttributesRecord(jcr, rec->Stream, rec->data, rec->data_len,
                                   attr)) {
         if (!forge_on) {
@@ -418,8 +436,10 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         return true;
       }
 
-      attr->data_stream = DecodeStat(attr->attr, &attr->statp,
-                                     sizeof(attr->statp), &attr->LinkFI);
+      if (rec->maskedStream != STREAM_UNIX_ATTRIBUTES_BINARY) {
+        attr->data_stream = DecodeStat(attr->attr, &attr->statp,
+                                       sizeof(attr->statp), &attr->LinkFI);
+      }
       BuildAttrOutputFnames(jcr, attr);
 
       if (FileIsIncluded(ff, attr->fname) && !FileIsExcluded(ff, attr->fname)) {
@@ -38,17 +38,26 @@
 #include "cats/cats.h"
 #include "cats/cats_backends.h"
 #include "cats/sql.h"
+#include "cats/sql_pooling.h"
 #include "stored/acquire.h"
 #include "stored/butil.h"
 #include "stored/label.h"
 #include "stored/mount.h"
 #include "stored/read_record.h"
+#include "stored/volume_index.h"
 #include "lib/attribs.h"
 #include "lib/edit.h"
 #include "lib/parse_bsr.h"
 #include "lib/bsignal.h"
 #include "include/jcr.h"
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 /* Dummy functions */
 namespace storagedaemon {
 extern bool ParseSdConfig(const char* configfile, int exit_code);
@@ -56,58 +65,55 @@ extern bool ParseSdConfig(const char* configfile, int exit_code);
 
 using namespace storagedaemon;
 
+/*
+ * Every device given on the command line is scanned by its own reader thread
+ * with its own catalog connection. The state of the volume and session being
+ * read is kept in the scan context of the reader.
+ */
+struct ScanContext;
+
 /* Forward referenced functions */
 static void do_scan(void);
+static void PrintScanSummary(void);
+static bool StartCatalogWriter(void);
+static void StopCatalogWriter(void);
+static void WriteJobFileRecords(ScanContext* ctx, JobControlRecord* mjcr);
+static void WriteAllJobFileRecords(ScanContext* ctx);
 static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec);
-static bool CreateFileAttributesRecord(BareosDb* db,
+static bool CreateFileAttributesRecord(ScanContext* ctx,
                                        JobControlRecord* mjcr,
                                        char* fname,
                                        char* lname,
                                        int type,
                                        char* ap,
                                        DeviceRecord* rec);
-static bool CreateMediaRecord(BareosDb* db,
+static bool CreateMediaRecord(ScanContext* ctx,
                               MediaDbRecord* mr,
                               VOLUME_LABEL* vl);
-static bool UpdateMediaRecord(BareosDb* db, MediaDbRecord* mr);
-static bool CreatePoolRecord(BareosDb* db, PoolDbRecord* pr);
-static JobControlRecord* CreateJobRecord(BareosDb* db,
+static bool UpdateMediaRecord(ScanContext* ctx, MediaDbRecord* mr);
+static bool CreatePoolRecord(ScanContext* ctx, PoolDbRecord* pr);
+static JobControlRecord* CreateJobRecord(ScanContext* ctx,
                                          JobDbRecord* mr,
                                          SESSION_LABEL* label,
                                          DeviceRecord* rec);
-static bool UpdateJobRecord(BareosDb* db,
+static bool UpdateJobRecord(ScanContext* ctx,
                             JobDbRecord* mr,
                             SESSION_LABEL* elabel,
                             DeviceRecord* rec);
-static bool CreateClientRecord(BareosDb* db, ClientDbRecord* cr);
-static bool CreateFilesetRecord(BareosDb* db, FileSetDbRecord* fsr);
-static bool CreateJobmediaRecord(BareosDb* db, JobControlRecord* jcr);
-static JobControlRecord* create_jcr(JobDbRecord* jr,
+static bool CreateClientRecord(ScanContext* ctx, ClientDbRecord* cr);
+static bool CreateFilesetRecord(ScanContext* ctx, FileSetDbRecord* fsr);
+static bool CreateJobmediaRecord(ScanContext* ctx, JobControlRecord* jcr);
+static JobControlRecord* create_jcr(ScanContext* ctx,
+                                    JobDbRecord* jr,
                                     DeviceRecord* rec,
                                     uint32_t JobId);
-static bool UpdateDigestRecord(BareosDb* db,
+static bool UpdateDigestRecord(ScanContext* ctx,
                                char* digest,
                                DeviceRecord* rec,
                                int type);
 
 /* Local variables */
-static Device* dev = NULL;
-static BareosDb* db;
-static JobControlRecord* bjcr; /* jcr for bscan */
 static BootStrapRecord* bsr = NULL;
-static MediaDbRecord mr;
-static PoolDbRecord pr;
-static JobDbRecord jr;
-static ClientDbRecord cr;
-static FileSetDbRecord fsr;
-static RestoreObjectDbRecord rop;
-static AttributesDbRecord ar;
-static FileDbRecord fr;
-static SESSION_LABEL label;
-static SESSION_LABEL elabel;
-static Attributes* attr;
-
-static time_t lasttime = 0;
 
 static const char* backend_directory = _PATH_BAREOS_BACKENDDIR;
 static const char* db_driver = "NULL";
@@ -120,16 +126,96 @@ static const char* wd = NULL;
 static bool update_db = false;
 static bool update_vol_info = false;
 static bool list_records = false;
-static int ignored_msgs = 0;
 
-static uint64_t currentVolumeSize;
-static int last_pct = -1;
 static bool showProgress = false;
-static int num_jobs = 0;
-static int num_pools = 0;
-static int num_media = 0;
-static int num_files = 0;
-static int num_restoreobjects = 0;
+static std::atomic<int> num_jobs{0};
+static std::atomic<int> num_pools{0};
+static std::atomic<int> num_media{0};
+static std::atomic<int> num_files{0};
+static std::atomic<int> num_restoreobjects{0};
+static std::atomic<uint64_t> bytes_scanned{0};
+static time_t scan_start_time = 0;
+
+/*
+ * The records of the volume labels and session labels are checked against
+ * and stored in the catalog by one reader at a time, so two readers don't
+ * create the same Pool, Client or FileSet twice.
+ */
+static pthread_mutex_t catalog_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * When the catalog supports batch inserts, the File records are not inserted
+ * one by one by the thread reading the volume. The decoded attributes are
+ * handed to a catalog writer thread which feeds them into the batch
+ * connection of their job. The attributes of the last file of a job are held
+ * back until its digest is read, so both are stored with a single insert.
+ */
+struct bscan_file_item {
+  JobControlRecord* jcr; /* job of the file, holds a reference */
+  AttributesDbRecord ar;
+  std::string fname;
+  std::string lname;
+  std::string attr;
+  char digest[BASE64_SIZE(CRYPTO_DIGEST_MAX_SIZE)];
+};
+
+struct ScanContext {
+  JobControlRecord* bjcr = nullptr; /* jcr of the reader */
+  Device* dev = nullptr;
+  BareosDb* db = nullptr;
+  const char* dev_name = nullptr;
+  const char* VolumeNames = nullptr;
+  pthread_t tid;
+  MediaDbRecord mr;
+  PoolDbRecord pr;
+  JobDbRecord jr;
+  ClientDbRecord cr;
+  FileSetDbRecord fsr;
+  RestoreObjectDbRecord rop;
+  AttributesDbRecord ar;
+  FileDbRecord fr;
+  SESSION_LABEL label;
+  SESSION_LABEL elabel;
+  Attributes* attr = nullptr;
+  time_t lasttime = 0;
+  uint64_t currentVolumeSize = 0;
+  int last_pct = -1;
+  int ignored_msgs = 0;
+  bool update_db = false; /* cleared while an existing Job is processed */
+
+  std::map<JobControlRecord*, bscan_file_item*> pending_files;
+  std::set<JobControlRecord*> batch_jobs;
+};
+
+static std::vector<ScanContext*> readers;
+
+/* Maximum number of files waiting for the catalog writer */
+static const size_t max_queued_files = 10000;
+
+/* Number of files the catalog writer takes from the queue at once */
+static const size_t writer_batch_size = 1000;
+
+static bool batch_insert = false;
+static pthread_t writer_tid;
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t writer_done = PTHREAD_COND_INITIALIZER;
+static std::deque<bscan_file_item*> file_queue;
+static bool writer_busy = false;
+static bool writer_quit = false;
+
+/**
+ * Find the scan context of the reader a read callback is called for.
+ */
+static ScanContext* GetScanContext(DeviceControlRecord* dcr)
+{
+  for (ScanContext* ctx : readers) {
+    if (ctx->bjcr == dcr->jcr) { return ctx; }
+  }
+
+  Emsg0(M_ABORT, 0, _("Record of an unknown reader\n"));
+  return NULL;
+}
 
 static void usage()
 {
@@ -137,7 +223,7 @@ static void usage()
       stderr,
       _(PROG_COPYRIGHT
         "\nVersion: %s (%s)\n\n"
-        "Usage: bscan [ options ] <device-name>\n"
+        "Usage: bscan [ options ] <device-name> [<device-name> ...]\n"
         "       -B <drivername>   specify the database driver name (default "
         "NULL) <postgresql|mysql|sqlite3>\n"
         "       -b <bootstrap>    specify a bootstrap file\n"
@@ -162,12 +248,18 @@ static void usage()
         "       -s                synchronize or store in database\n"
         "       -S                show scan progress periodically\n"
         "       -v                verbose\n"
-        "       -V <Volumes>      specify Volume names (separated by |)\n"
+        "       -V <Volumes>      specify Volume names (separated by |), once "
+        "per device\n"
         "       -w <directory>    specify working directory (default from "
         "configuration file)\n"
+        "       -x                rebuild the volume index\n"
         "       -?                print this message\n\n"
+        "Several devices are scanned at the same time, the Volumes of a Job\n"
+        "that spans Volumes must be scanned by the same device.\n\n"
         "example:\n"
-        "bscan -B postgresql -V Full-0001 FileStorage\n"),
+        "bscan -B postgresql -V Full-0001 FileStorage\n"
+        "bscan -B postgresql -s -V Full-0001 -V Full-0002 FileStorage "
+        "FileStorage2\n"),
       2001, VERSION, BDATE, backend_directory);
   exit(1);
 }
@@ -176,10 +268,10 @@ int main(int argc, char* argv[])
 {
   int ch;
   struct stat stat_buf;
-  char* VolumeName = NULL;
+  std::vector<const char*> VolumeNames;
   char* DirectorName = NULL;
+  bool rebuild_index = false;
   DirectorResource* director = NULL;
-  DeviceControlRecord* dcr;
 #if defined(HAVE_DYNAMIC_CATS_BACKENDS)
   alist* backend_directories = NULL;
 #endif
@@ -194,7 +286,7 @@ int main(int argc, char* argv[])
 
   OSDependentInit();
 
-  while ((ch = getopt(argc, argv, "a:B:b:c:d:D:h:p:mn:pP:q:rsSt:u:vV:w:?")) !=
+  while ((ch = getopt(argc, argv, "a:B:b:c:d:D:h:p:mn:pP:q:rsSt:u:vV:w:x?")) !=
          -1) {
     switch (ch) {
       case 'a':
@@ -269,7 +361,7 @@ int main(int argc, char* argv[])
         break;
 
       case 'V': /* Volume name */
-        VolumeName = optarg;
+        VolumeNames.push_back(optarg);
         break;
 
       case 'v':
@@ -280,6 +372,10 @@ int main(int argc, char* argv[])
         wd = optarg;
         break;
 
+      case 'x':
+        rebuild_index = true;
+        break;
+
       case '?':
       default:
         usage();
@@ -288,11 +384,30 @@ int main(int argc, char* argv[])
   argc -= optind;
   argv += optind;
 
-  if (argc != 1) {
+  if (argc < 1) {
     Pmsg0(0, _("Wrong number of arguments: \n"));
     usage();
   }
 
+  if (argc > 1) {
+    if (bsr) {
+      Pmsg0(0, _("A bootstrap file can only be used with one device.\n"));
+      usage();
+    }
+    if (VolumeNames.size() != (size_t)argc) {
+      Pmsg0(0, _("Give the Volumes of every device with its own -V.\n"));
+      usage();
+    }
+    for (int i = 1; i < argc; i++) {
+      for (int j = 0; j < i; j++) {
+        if (bstrcmp(argv[i], argv[j])) {
+          Pmsg1(0, _("Device %s is given twice.\n"), argv[i]);
+          usage();
+        }
+      }
+    }
+  }
+
   my_config = InitSdConfig(configfile, M_ERROR_TERM);
   ParseSdConfig(configfile, M_ERROR_TERM);
 
@@ -336,18 +451,39 @@ int main(int argc, char* argv[])
           working_directory);
   }
 
-  dcr = New(DeviceControlRecord);
-  bjcr = SetupJcr("bscan", argv[0], bsr, director, dcr, VolumeName, true);
-  if (!bjcr) { exit(1); }
-  dev = bjcr->read_dcr->dev;
+  /*
+   * The index can only be rebuilt when every block of the volume is read.
+   */
+  if (rebuild_index && bsr) {
+    Pmsg0(0, _("Cannot rebuild the volume index with a bootstrap file, "
+               "ignoring -x\n"));
+    rebuild_index = false;
+  }
+  SetVolumeIndexRebuild(rebuild_index);
 
-  if (showProgress) {
-    char ed1[50];
-    struct stat sb;
-    fstat(dev->fd(), &sb);
-    currentVolumeSize = sb.st_size;
-    Pmsg1(000, _("First Volume Size = %s\n"),
-          edit_uint64(currentVolumeSize, ed1));
+  for (int i = 0; i < argc; i++) {
+    ScanContext* ctx = new ScanContext();
+    DeviceControlRecord* dcr = New(DeviceControlRecord);
+
+    ctx->dev_name = argv[i];
+    if (!VolumeNames.empty()) {
+      ctx->VolumeNames = (argc > 1) ? VolumeNames[i] : VolumeNames.back();
+    }
+    ctx->bjcr =
+        SetupJcr("bscan", argv[i], bsr, director, dcr, ctx->VolumeNames, true);
+    if (!ctx->bjcr) { exit(1); }
+    ctx->dev = ctx->bjcr->read_dcr->dev;
+    ctx->update_db = update_db;
+
+    if (showProgress) {
+      char ed1[50];
+      struct stat sb;
+      fstat(ctx->dev->fd(), &sb);
+      ctx->currentVolumeSize = sb.st_size;
+      Pmsg1(000, _("First Volume Size = %s\n"),
+            edit_uint64(ctx->currentVolumeSize, ed1));
+    }
+    readers.push_back(ctx);
   }
 
 #if defined(HAVE_DYNAMIC_CATS_BACKENDS)
@@ -357,36 +493,51 @@ int main(int argc, char* argv[])
   DbSetBackendDirs(backend_directories);
 #endif
 
-  db = db_init_database(NULL, db_driver, db_name, db_user, db_password, db_host,
-                        db_port, NULL, false, false, false, false);
-  if (db == NULL) {
-    Emsg0(M_ERROR_TERM, 0, _("Could not init Bareos database\n"));
+  /*
+   * Every reader uses its own connection.
+   */
+  for (ScanContext* ctx : readers) {
+    ctx->db = db_init_database(NULL, db_driver, db_name, db_user, db_password,
+                               db_host, db_port, NULL, readers.size() > 1,
+                               false, false, false);
+    if (ctx->db == NULL) {
+      Emsg0(M_ERROR_TERM, 0, _("Could not init Bareos database\n"));
+    }
+    if (!ctx->db->OpenDatabase(NULL)) {
+      Emsg0(M_ERROR_TERM, 0, ctx->db->strerror());
+    }
   }
-  if (!db->OpenDatabase(NULL)) { Emsg0(M_ERROR_TERM, 0, db->strerror()); }
   Dmsg0(200, "Database opened\n");
   if (verbose) {
     Pmsg2(000, _("Using Database: %s, User: %s\n"), db_name, db_user);
   }
 
   do_scan();
+  PrintScanSummary();
   if (update_db) {
     printf(
         "Records added or updated in the catalog:\n%7d Media\n"
         "%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
-        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+        num_media.load(), num_pools.load(), num_jobs.load(), num_files.load(),
+        num_restoreobjects.load());
   } else {
     printf(
         "Records would have been added or updated in the catalog:\n"
         "%7d Media\n%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
-        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+        num_media.load(), num_pools.load(), num_jobs.load(), num_files.load(),
+        num_restoreobjects.load());
   }
+  for (ScanContext* ctx : readers) {
+    CleanDevice(ctx->bjcr->dcr);
+    ctx->dev->term();
+    FreeDeviceControlRecord(ctx->bjcr->dcr);
+    FreeJcr(ctx->bjcr);
+    ctx->db->CloseDatabase(NULL);
+    delete ctx;
+  }
+  readers.clear();
   DbFlushBackends();
 
-  CleanDevice(bjcr->dcr);
-  dev->term();
-  FreeDeviceControlRecord(bjcr->dcr);
-  FreeJcr(bjcr);
-
   return 0;
 }
 
@@ -398,6 +549,7 @@ int main(int argc, char* argv[])
 static bool BscanMountNextReadVolume(DeviceControlRecord* dcr)
 {
   bool status;
+  ScanContext* ctx = GetScanContext(dcr);
   Device* dev = dcr->dev;
   DeviceControlRecord* mdcr;
 
@@ -414,14 +566,14 @@ static bool BscanMountNextReadVolume(DeviceControlRecord* dcr)
     mdcr->VolMediaId = dcr->VolMediaId;
     mjcr->read_dcr->VolLastIndex = dcr->VolLastIndex;
     if (mjcr->insert_jobmedia_records) {
-      if (!CreateJobmediaRecord(db, mjcr)) {
+      if (!CreateJobmediaRecord(ctx, mjcr)) {
         Pmsg2(000, _("Could not create JobMedia record for Volume=%s Job=%s\n"),
               dev->getVolCatName(), mjcr->Job);
       }
     }
   }
 
-  UpdateMediaRecord(db, &mr);
+  UpdateMediaRecord(ctx, &ctx->mr);
 
   /* Now let common read routine get up next tape. Note,
    * we call mount_next... with bscan's jcr because that is where we
@@ -432,34 +584,96 @@ static bool BscanMountNextReadVolume(DeviceControlRecord* dcr)
     char ed1[50];
     struct stat sb;
     fstat(dev->fd(), &sb);
-    currentVolumeSize = sb.st_size;
+    ctx->currentVolumeSize = sb.st_size;
     Pmsg1(000, _("First Volume Size = %s\n"),
-          edit_uint64(currentVolumeSize, ed1));
+          edit_uint64(ctx->currentVolumeSize, ed1));
   }
   return status;
 }
 
-static void do_scan()
+/**
+ * Read all volumes of one reader.
+ */
+static void ScanVolumes(ScanContext* ctx)
 {
-  attr = new_attr(bjcr);
+  ctx->attr = new_attr(ctx->bjcr);
 
-  memset(&ar, 0, sizeof(ar));
-  memset(&pr, 0, sizeof(pr));
-  memset(&jr, 0, sizeof(jr));
-  memset(&cr, 0, sizeof(cr));
-  memset(&fsr, 0, sizeof(fsr));
-  memset(&fr, 0, sizeof(fr));
+  memset(&ctx->mr, 0, sizeof(ctx->mr));
+  memset(&ctx->ar, 0, sizeof(ctx->ar));
+  memset(&ctx->pr, 0, sizeof(ctx->pr));
+  memset(&ctx->jr, 0, sizeof(ctx->jr));
+  memset(&ctx->cr, 0, sizeof(ctx->cr));
+  memset(&ctx->fsr, 0, sizeof(ctx->fsr));
+  memset(&ctx->fr, 0, sizeof(ctx->fr));
 
   /*
    * Detach bscan's jcr as we are not a real Job on the tape
    */
-  ReadRecords(bjcr->read_dcr, RecordCb, BscanMountNextReadVolume);
+  ReadRecords(ctx->bjcr->read_dcr, RecordCb, BscanMountNextReadVolume);
 
-  if (update_db) {
-    db->WriteBatchFileRecords(bjcr); /* used by bulk batch file insert */
+  /*
+   * Store the files of jobs that did not end on the scanned volumes.
+   */
+  if (batch_insert) { WriteAllJobFileRecords(ctx); }
+
+  FreeAttr(ctx->attr);
+}
+
+extern "C" void* ScanThread(void* arg)
+{
+  ScanVolumes((ScanContext*)arg);
+
+  return NULL;
+}
+
+static void do_scan()
+{
+  if (update_db && readers.front()->db->BatchInsertAvailable()) {
+    batch_insert = StartCatalogWriter();
   }
+  scan_start_time = time(NULL);
+
+  if (readers.size() == 1) {
+    ScanVolumes(readers.front());
+  } else {
+    for (ScanContext* ctx : readers) {
+      int status;
 
-  FreeAttr(attr);
+      if ((status = pthread_create(&ctx->tid, NULL, ScanThread, ctx)) != 0) {
+        BErrNo be;
+
+        Emsg2(M_ERROR_TERM, 0, _("Cannot create reader for %s: ERR=%s\n"),
+              ctx->dev_name, be.bstrerror(status));
+      }
+    }
+    for (ScanContext* ctx : readers) { pthread_join(ctx->tid, NULL); }
+  }
+
+  if (batch_insert) { StopCatalogWriter(); }
+}
+
+/**
+ * Edit the average number of items per second since the scan started.
+ */
+static char* EditRate(uint64_t value, char* buf)
+{
+  time_t elapsed = time(NULL) - scan_start_time;
+
+  if (elapsed <= 0) { elapsed = 1; }
+
+  return edit_uint64_with_suffix(value / elapsed, buf);
+}
+
+static void PrintScanSummary()
+{
+  char ed1[50], ed2[50], ed3[50], ed4[50], ed5[50];
+  time_t elapsed = time(NULL) - scan_start_time;
+
+  Pmsg5(000, _("Scanned %s bytes and %s files in %s (%sB/s, %s files/s)\n"),
+        edit_uint64_with_commas(bytes_scanned, ed1),
+        edit_uint64_with_commas(num_files, ed2),
+        edit_utime(elapsed > 0 ? elapsed : 1, ed3, sizeof(ed3)),
+        EditRate(bytes_scanned, ed4), EditRate(num_files, ed5));
 }
 
 /**
@@ -502,322 +716,364 @@ static inline bool UnpackRestoreObject(JobControlRecord* jcr,
 }
 
 /**
+ * Handle a Volume or Session label record.
+ *
  * Returns: true  if OK
  *          false if error
  */
-static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
+static bool HandleLabelRecord(ScanContext* ctx,
+                              DeviceControlRecord* dcr,
+                              DeviceRecord* rec)
 {
   JobControlRecord* mjcr;
   char ec1[30];
   Device* dev = dcr->dev;
-  JobControlRecord* bjcr = dcr->jcr;
-  DeviceBlock* block = dcr->block;
   PoolMem sql_buffer;
   db_int64_ctx jmr_count;
-  char digest[BASE64_SIZE(CRYPTO_DIGEST_MAX_SIZE)];
+  bool save_update_db = ctx->update_db;
 
-  if (rec->data_len > 0) {
-    mr.VolBytes +=
-        rec->data_len + WRITE_RECHDR_LENGTH; /* Accumulate Volume bytes */
-    if (showProgress && currentVolumeSize > 0) {
-      int pct = (mr.VolBytes * 100) / currentVolumeSize;
-      if (pct != last_pct) {
-        fprintf(stdout, _("done: %d%%\n"), pct);
-        fflush(stdout);
-        last_pct = pct;
+  if (verbose > 1) { DumpLabelRecord(dev, rec, true); }
+  switch (rec->FileIndex) {
+    case PRE_LABEL:
+      Pmsg0(000, _("Volume is prelabeled. This tape cannot be scanned.\n"));
+      return false;
+      break;
+
+    case VOL_LABEL:
+      UnserVolumeLabel(dev, rec);
+      /*
+       * Check Pool info
+       */
+      bstrncpy(ctx->pr.Name, dev->VolHdr.PoolName, sizeof(ctx->pr.Name));
+      bstrncpy(ctx->pr.PoolType, dev->VolHdr.PoolType,
+               sizeof(ctx->pr.PoolType));
+      num_pools++;
+      if (ctx->db->GetPoolRecord(ctx->bjcr, &ctx->pr)) {
+        if (verbose) {
+          Pmsg1(000, _("Pool record for %s found in DB.\n"), ctx->pr.Name);
+        }
+      } else {
+        if (!ctx->update_db) {
+          Pmsg1(000, _("VOL_LABEL: Pool record not found for Pool: %s\n"),
+                ctx->pr.Name);
+        }
+        CreatePoolRecord(ctx, &ctx->pr);
+      }
+      if (!bstrcmp(ctx->pr.PoolType, dev->VolHdr.PoolType)) {
+        Pmsg2(000, _("VOL_LABEL: PoolType mismatch. DB=%s Vol=%s\n"),
+              ctx->pr.PoolType, dev->VolHdr.PoolType);
+        return true;
+      } else if (verbose) {
+        Pmsg1(000, _("Pool type \"%s\" is OK.\n"), ctx->pr.PoolType);
       }
-    }
-  }
 
-  if (list_records) {
-    Pmsg5(000,
-          _("Record: SessId=%u SessTim=%u FileIndex=%d Stream=%d len=%u\n"),
-          rec->VolSessionId, rec->VolSessionTime, rec->FileIndex, rec->Stream,
-          rec->data_len);
-  }
+      /*
+       * Check Media Info
+       */
+      memset(&ctx->mr, 0, sizeof(ctx->mr));
+      bstrncpy(ctx->mr.VolumeName, dev->VolHdr.VolumeName,
+               sizeof(ctx->mr.VolumeName));
+      ctx->mr.PoolId = ctx->pr.PoolId;
+      num_media++;
+      if (ctx->db->GetMediaRecord(ctx->bjcr, &ctx->mr)) {
+        if (verbose) {
+          Pmsg1(000, _("Media record for %s found in DB.\n"),
+                ctx->mr.VolumeName);
+        }
+        /*
+         * Clear out some volume statistics that will be updated
+         */
+        ctx->mr.VolJobs = ctx->mr.VolFiles = ctx->mr.VolBlocks = 0;
+        ctx->mr.VolBytes = rec->data_len + 20;
+      } else {
+        if (!ctx->update_db) {
+          Pmsg1(000, _("VOL_LABEL: Media record not found for Volume: %s\n"),
+                ctx->mr.VolumeName);
+        }
+        bstrncpy(ctx->mr.MediaType, dev->VolHdr.MediaType,
+                 sizeof(ctx->mr.MediaType));
+        CreateMediaRecord(ctx, &ctx->mr, &dev->VolHdr);
+      }
+      if (!bstrcmp(ctx->mr.MediaType, dev->VolHdr.MediaType)) {
+        Pmsg2(000, _("VOL_LABEL: MediaType mismatch. DB=%s Vol=%s\n"),
+              ctx->mr.MediaType, dev->VolHdr.MediaType);
+        return true; /* ignore error */
+      } else if (verbose) {
+        Pmsg1(000, _("Media type \"%s\" is OK.\n"), ctx->mr.MediaType);
+      }
 
-  /*
-   * Check for Start or End of Session Record
-   */
-  if (rec->FileIndex < 0) {
-    bool save_update_db = update_db;
+      /*
+       * Reset some DeviceControlRecord variables
+       */
+      foreach_dlist (dcr, dev->attached_dcrs) {
+        dcr->VolFirstIndex = dcr->FileIndex = 0;
+        dcr->StartBlock = dcr->EndBlock = 0;
+        dcr->StartFile = dcr->EndFile = 0;
+        dcr->VolMediaId = 0;
+      }
 
-    if (verbose > 1) { DumpLabelRecord(dev, rec, true); }
-    switch (rec->FileIndex) {
-      case PRE_LABEL:
-        Pmsg0(000, _("Volume is prelabeled. This tape cannot be scanned.\n"));
-        return false;
-        break;
+      Pmsg1(000, _("VOL_LABEL: OK for Volume: %s\n"), ctx->mr.VolumeName);
+      break;
 
-      case VOL_LABEL:
-        UnserVolumeLabel(dev, rec);
+    case SOS_LABEL:
+      if (bsr && rec->match_stat < 1) {
         /*
-         * Check Pool info
+         * Skipping record, because does not match BootStrapRecord filter
          */
-        bstrncpy(pr.Name, dev->VolHdr.PoolName, sizeof(pr.Name));
-        bstrncpy(pr.PoolType, dev->VolHdr.PoolType, sizeof(pr.PoolType));
-        num_pools++;
-        if (db->GetPoolRecord(bjcr, &pr)) {
+        Dmsg0(200, _("SOS_LABEL skipped. Record does not match "
+                     "BootStrapRecord filter.\n"));
+      } else {
+        ctx->mr.VolJobs++;
+        num_jobs++;
+        if (ctx->ignored_msgs > 0) {
+          Pmsg1(000,
+                _("%d \"errors\" ignored before first Start of Session "
+                  "record.\n"),
+                ctx->ignored_msgs);
+          ctx->ignored_msgs = 0;
+        }
+        UnserSessionLabel(&ctx->label, rec);
+        memset(&ctx->jr, 0, sizeof(ctx->jr));
+        bstrncpy(ctx->jr.Job, ctx->label.Job, sizeof(ctx->jr.Job));
+        if (ctx->db->GetJobRecord(ctx->bjcr, &ctx->jr)) {
+          /*
+           * Job record already exists in DB
+           */
+          ctx->update_db = false; /* don't change db in CreateJobRecord */
           if (verbose) {
-            Pmsg1(000, _("Pool record for %s found in DB.\n"), pr.Name);
+            Pmsg1(000, _("SOS_LABEL: Found Job record for JobId: %d\n"),
+                  ctx->jr.JobId);
           }
         } else {
-          if (!update_db) {
-            Pmsg1(000, _("VOL_LABEL: Pool record not found for Pool: %s\n"),
-                  pr.Name);
+          /*
+           * Must create a Job record in DB
+           */
+          if (!ctx->update_db) {
+            Pmsg1(000, _("SOS_LABEL: Job record not found for JobId: %d\n"),
+                  ctx->jr.JobId);
           }
-          CreatePoolRecord(db, &pr);
-        }
-        if (!bstrcmp(pr.PoolType, dev->VolHdr.PoolType)) {
-          Pmsg2(000, _("VOL_LABEL: PoolType mismatch. DB=%s Vol=%s\n"),
-                pr.PoolType, dev->VolHdr.PoolType);
-          return true;
-        } else if (verbose) {
-          Pmsg1(000, _("Pool type \"%s\" is OK.\n"), pr.PoolType);
         }
 
         /*
-         * Check Media Info
+         * Create Client record if not already there
          */
-        memset(&mr, 0, sizeof(mr));
-        bstrncpy(mr.VolumeName, dev->VolHdr.VolumeName, sizeof(mr.VolumeName));
-        mr.PoolId = pr.PoolId;
-        num_media++;
-        if (db->GetMediaRecord(bjcr, &mr)) {
-          if (verbose) {
-            Pmsg1(000, _("Media record for %s found in DB.\n"), mr.VolumeName);
-          }
-          /*
-           * Clear out some volume statistics that will be updated
-           */
-          mr.VolJobs = mr.VolFiles = mr.VolBlocks = 0;
-          mr.VolBytes = rec->data_len + 20;
+        bstrncpy(ctx->cr.Name, ctx->label.ClientName, sizeof(ctx->cr.Name));
+        CreateClientRecord(ctx, &ctx->cr);
+        ctx->jr.ClientId = ctx->cr.ClientId;
+
+        /*
+         * Process label, if Job record exists don't update db
+         */
+        mjcr = CreateJobRecord(ctx, &ctx->jr, &ctx->label, rec);
+        dcr = mjcr->read_dcr;
+        ctx->update_db = save_update_db;
+
+        ctx->jr.PoolId = ctx->pr.PoolId;
+        mjcr->start_time = ctx->jr.StartTime;
+        mjcr->setJobLevel(ctx->jr.JobLevel);
+
+        mjcr->client_name = GetPoolMemory(PM_FNAME);
+        PmStrcpy(mjcr->client_name, ctx->label.ClientName);
+        mjcr->fileset_name = GetPoolMemory(PM_FNAME);
+        PmStrcpy(mjcr->fileset_name, ctx->label.FileSetName);
+        bstrncpy(dcr->pool_type, ctx->label.PoolType, sizeof(dcr->pool_type));
+        bstrncpy(dcr->pool_name, ctx->label.PoolName, sizeof(dcr->pool_name));
+
+        /*
+         * Look for existing Job Media records for this job.  If there are
+         * any, no new ones need be created.  This may occur if File
+         * Retention has expired before Job Retention, or if the volume
+         * has already been bscan'd
+         */
+        Mmsg(sql_buffer, "SELECT count(*) from JobMedia where JobId=%d",
+             ctx->jr.JobId);
+        ctx->db->SqlQuery(sql_buffer.c_str(), db_int64_handler, &jmr_count);
+        if (jmr_count.value > 0) {
+          mjcr->insert_jobmedia_records = false;
         } else {
-          if (!update_db) {
-            Pmsg1(000, _("VOL_LABEL: Media record not found for Volume: %s\n"),
-                  mr.VolumeName);
-          }
-          bstrncpy(mr.MediaType, dev->VolHdr.MediaType, sizeof(mr.MediaType));
-          CreateMediaRecord(db, &mr, &dev->VolHdr);
+          mjcr->insert_jobmedia_records = true;
         }
-        if (!bstrcmp(mr.MediaType, dev->VolHdr.MediaType)) {
-          Pmsg2(000, _("VOL_LABEL: MediaType mismatch. DB=%s Vol=%s\n"),
-                mr.MediaType, dev->VolHdr.MediaType);
+
+        if (rec->VolSessionId != ctx->jr.VolSessionId) {
+          Pmsg3(
+              000,
+              _("SOS_LABEL: VolSessId mismatch for JobId=%u. DB=%d Vol=%d\n"),
+              ctx->jr.JobId, ctx->jr.VolSessionId, rec->VolSessionId);
           return true; /* ignore error */
-        } else if (verbose) {
-          Pmsg1(000, _("Media type \"%s\" is OK.\n"), mr.MediaType);
         }
+        if (rec->VolSessionTime != ctx->jr.VolSessionTime) {
+          Pmsg3(000,
+                _("SOS_LABEL: VolSessTime mismatch for JobId=%u. DB=%d "
+                  "Vol=%d\n"),
+                ctx->jr.JobId, ctx->jr.VolSessionTime, rec->VolSessionTime);
+          return true; /* ignore error */
+        }
+        if (ctx->jr.PoolId != ctx->pr.PoolId) {
+          Pmsg3(000,
+                _("SOS_LABEL: PoolId mismatch for JobId=%u. DB=%d Vol=%d\n"),
+                ctx->jr.JobId, ctx->jr.PoolId, ctx->pr.PoolId);
+          return true; /* ignore error */
+        }
+      }
+      break;
 
+    case EOS_LABEL:
+      if (bsr && rec->match_stat < 1) {
         /*
-         * Reset some DeviceControlRecord variables
+         * Skipping record, because does not match BootStrapRecord filter
          */
-        foreach_dlist (dcr, dev->attached_dcrs) {
-          dcr->VolFirstIndex = dcr->FileIndex = 0;
-          dcr->StartBlock = dcr->EndBlock = 0;
-          dcr->StartFile = dcr->EndFile = 0;
-          dcr->VolMediaId = 0;
-        }
+        Dmsg0(200, _("EOS_LABEL skipped. Record does not match "
+                     "BootStrapRecord filter.\n"));
+      } else {
+        UnserSessionLabel(&ctx->elabel, rec);
 
-        Pmsg1(000, _("VOL_LABEL: OK for Volume: %s\n"), mr.VolumeName);
-        break;
-
-      case SOS_LABEL:
-        if (bsr && rec->match_stat < 1) {
-          /*
-           * Skipping record, because does not match BootStrapRecord filter
-           */
-          Dmsg0(200, _("SOS_LABEL skipped. Record does not match "
-                       "BootStrapRecord filter.\n"));
-        } else {
-          mr.VolJobs++;
-          num_jobs++;
-          if (ignored_msgs > 0) {
-            Pmsg1(000,
-                  _("%d \"errors\" ignored before first Start of Session "
-                    "record.\n"),
-                  ignored_msgs);
-            ignored_msgs = 0;
-          }
-          UnserSessionLabel(&label, rec);
-          memset(&jr, 0, sizeof(jr));
-          bstrncpy(jr.Job, label.Job, sizeof(jr.Job));
-          if (db->GetJobRecord(bjcr, &jr)) {
-            /*
-             * Job record already exists in DB
-             */
-            update_db = false; /* don't change db in CreateJobRecord */
-            if (verbose) {
-              Pmsg1(000, _("SOS_LABEL: Found Job record for JobId: %d\n"),
-                    jr.JobId);
-            }
-          } else {
-            /*
-             * Must create a Job record in DB
-             */
-            if (!update_db) {
-              Pmsg1(000, _("SOS_LABEL: Job record not found for JobId: %d\n"),
-                    jr.JobId);
-            }
-          }
+        /*
+         * Create FileSet record
+         */
+        bstrncpy(ctx->fsr.FileSet, ctx->label.FileSetName,
+                 sizeof(ctx->fsr.FileSet));
+        bstrncpy(ctx->fsr.MD5, ctx->label.FileSetMD5, sizeof(ctx->fsr.MD5));
+        CreateFilesetRecord(ctx, &ctx->fsr);
+        ctx->jr.FileSetId = ctx->fsr.FileSetId;
+
+        mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
+        if (!mjcr) {
+          Pmsg2(000,
+                _("Could not find SessId=%d SessTime=%d for EOS record.\n"),
+                rec->VolSessionId, rec->VolSessionTime);
+          break;
+        }
 
-          /*
-           * Create Client record if not already there
-           */
-          bstrncpy(cr.Name, label.ClientName, sizeof(cr.Name));
-          CreateClientRecord(db, &cr);
-          jr.ClientId = cr.ClientId;
+        /*
+         * Store the batched File records before the Job record is final
+         */
+        WriteJobFileRecords(ctx, mjcr);
 
-          /*
-           * Process label, if Job record exists don't update db
-           */
-          mjcr = CreateJobRecord(db, &jr, &label, rec);
-          dcr = mjcr->read_dcr;
-          update_db = save_update_db;
+        /*
+         * Do the final update to the Job record
+         */
+        UpdateJobRecord(ctx, &ctx->jr, &ctx->elabel, rec);
 
-          jr.PoolId = pr.PoolId;
-          mjcr->start_time = jr.StartTime;
-          mjcr->setJobLevel(jr.JobLevel);
+        mjcr->end_time = ctx->jr.EndTime;
+        mjcr->setJobStatus(JS_Terminated);
 
-          mjcr->client_name = GetPoolMemory(PM_FNAME);
-          PmStrcpy(mjcr->client_name, label.ClientName);
-          mjcr->fileset_name = GetPoolMemory(PM_FNAME);
-          PmStrcpy(mjcr->fileset_name, label.FileSetName);
-          bstrncpy(dcr->pool_type, label.PoolType, sizeof(dcr->pool_type));
-          bstrncpy(dcr->pool_name, label.PoolName, sizeof(dcr->pool_name));
+        /*
+         * Create JobMedia record
+         */
+        mjcr->read_dcr->VolLastIndex = dcr->VolLastIndex;
+        if (mjcr->insert_jobmedia_records) { CreateJobmediaRecord(ctx, mjcr); }
+        FreeDeviceControlRecord(mjcr->read_dcr);
+        FreeJcr(mjcr);
+      }
+      break;
 
-          /*
-           * Look for existing Job Media records for this job.  If there are
-           * any, no new ones need be created.  This may occur if File
-           * Retention has expired before Job Retention, or if the volume
-           * has already been bscan'd
-           */
-          Mmsg(sql_buffer, "SELECT count(*) from JobMedia where JobId=%d",
-               jr.JobId);
-          db->SqlQuery(sql_buffer.c_str(), db_int64_handler, &jmr_count);
-          if (jmr_count.value > 0) {
-            mjcr->insert_jobmedia_records = false;
-          } else {
-            mjcr->insert_jobmedia_records = true;
-          }
+    case EOM_LABEL:
+      break;
 
-          if (rec->VolSessionId != jr.VolSessionId) {
-            Pmsg3(
-                000,
-                _("SOS_LABEL: VolSessId mismatch for JobId=%u. DB=%d Vol=%d\n"),
-                jr.JobId, jr.VolSessionId, rec->VolSessionId);
-            return true; /* ignore error */
-          }
-          if (rec->VolSessionTime != jr.VolSessionTime) {
-            Pmsg3(000,
-                  _("SOS_LABEL: VolSessTime mismatch for JobId=%u. DB=%d "
-                    "Vol=%d\n"),
-                  jr.JobId, jr.VolSessionTime, rec->VolSessionTime);
-            return true; /* ignore error */
-          }
-          if (jr.PoolId != pr.PoolId) {
-            Pmsg3(000,
-                  _("SOS_LABEL: PoolId mismatch for JobId=%u. DB=%d Vol=%d\n"),
-                  jr.JobId, jr.PoolId, pr.PoolId);
-            return true; /* ignore error */
+    case EOT_LABEL: /* end of all tapes */
+      /*
+       * Wiffle through all jobs still open and close them.
+       */
+      if (ctx->update_db) {
+        DeviceControlRecord* mdcr;
+        foreach_dlist (mdcr, dev->attached_dcrs) {
+          JobControlRecord* mjcr = mdcr->jcr;
+          if (!mjcr || mjcr->JobId == 0) { continue; }
+          WriteJobFileRecords(ctx, mjcr);
+          ctx->jr.JobId = mjcr->JobId;
+          ctx->jr.JobStatus =
+              JS_ErrorTerminated; /* Mark Job as Error Terimined */
+          ctx->jr.JobFiles = mjcr->JobFiles;
+          ctx->jr.JobBytes = mjcr->JobBytes;
+          ctx->jr.VolSessionId = mjcr->VolSessionId;
+          ctx->jr.VolSessionTime = mjcr->VolSessionTime;
+          ctx->jr.JobTDate = (utime_t)mjcr->start_time;
+          ctx->jr.ClientId = mjcr->ClientId;
+          if (!ctx->db->UpdateJobEndRecord(ctx->bjcr, &ctx->jr)) {
+            Pmsg1(0, _("Could not update job record. ERR=%s\n"),
+                  ctx->db->strerror());
           }
+          mjcr->read_dcr = NULL;
+          FreeJcr(mjcr);
         }
-        break;
-
-      case EOS_LABEL:
-        if (bsr && rec->match_stat < 1) {
-          /*
-           * Skipping record, because does not match BootStrapRecord filter
-           */
-          Dmsg0(200, _("EOS_LABEL skipped. Record does not match "
-                       "BootStrapRecord filter.\n"));
-        } else {
-          UnserSessionLabel(&elabel, rec);
+      }
+      ctx->mr.VolFiles = rec->File;
+      ctx->mr.VolBlocks = rec->Block;
+      ctx->mr.VolBytes += ctx->mr.VolBlocks * WRITE_BLKHDR_LENGTH; /* approx. */
+      ctx->mr.VolMounts++;
+      UpdateMediaRecord(ctx, &ctx->mr);
+      Pmsg3(0,
+            _("End of all Volumes. VolFiles=%u VolBlocks=%u VolBytes=%s\n"),
+            ctx->mr.VolFiles, ctx->mr.VolBlocks,
+            edit_uint64_with_commas(ctx->mr.VolBytes, ec1));
+      break;
+    default:
+      break;
+  } /* end switch */
+  return true;
+}
 
-          /*
-           * Create FileSet record
-           */
-          bstrncpy(fsr.FileSet, label.FileSetName, sizeof(fsr.FileSet));
-          bstrncpy(fsr.MD5, label.FileSetMD5, sizeof(fsr.MD5));
-          CreateFilesetRecord(db, &fsr);
-          jr.FileSetId = fsr.FileSetId;
-
-          mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
-          if (!mjcr) {
-            Pmsg2(000,
-                  _("Could not find SessId=%d SessTime=%d for EOS record.\n"),
-                  rec->VolSessionId, rec->VolSessionTime);
-            break;
-          }
+/**
+ * Returns: true  if OK
+ *          false if error
+ */
+static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
+{
+  ScanContext* ctx = GetScanContext(dcr);
+  JobControlRecord* mjcr;
+  DeviceBlock* block = dcr->block;
+  char digest[BASE64_SIZE(CRYPTO_DIGEST_MAX_SIZE)];
+  char encoded_stat[MAX_ENCODED_STAT_LENGTH];
 
-          /*
-           * Do the final update to the Job record
-           */
-          UpdateJobRecord(db, &jr, &elabel, rec);
+  if (rec->data_len > 0) {
+    ctx->mr.VolBytes +=
+        rec->data_len + WRITE_RECHDR_LENGTH; /* Accumulate Volume bytes */
+    bytes_scanned += rec->data_len + WRITE_RECHDR_LENGTH;
+    if (showProgress && ctx->currentVolumeSize > 0) {
+      int pct = (ctx->mr.VolBytes * 100) / ctx->currentVolumeSize;
+      if (pct != ctx->last_pct) {
+        char ed1[50], ed2[50], ed3[50];
+
+        fprintf(stdout, _("done: %d%% (%s files, %sB/s, %s files/s)\n"), pct,
+                edit_uint64_with_commas(num_files, ed1),
+                EditRate(bytes_scanned, ed2), EditRate(num_files, ed3));
+        fflush(stdout);
+        ctx->last_pct = pct;
+      }
+    }
+  }
 
-          mjcr->end_time = jr.EndTime;
-          mjcr->setJobStatus(JS_Terminated);
+  if (list_records) {
+    Pmsg5(000,
+          _("Record: SessId=%u SessTim=%u FileIndex=%d Stream=%d len=%u\n"),
+          rec->VolSessionId, rec->VolSessionTime, rec->FileIndex, rec->Stream,
+          rec->data_len);
+  }
 
-          /*
-           * Create JobMedia record
-           */
-          mjcr->read_dcr->VolLastIndex = dcr->VolLastIndex;
-          if (mjcr->insert_jobmedia_records) { CreateJobmediaRecord(db, mjcr); }
-          FreeDeviceControlRecord(mjcr->read_dcr);
-          FreeJcr(mjcr);
-        }
-        break;
+  /*
+   * Check for Start or End of Session Record
+   */
+  if (rec->FileIndex < 0) {
+    bool status;
 
-      case EOM_LABEL:
-        break;
+    /*
+     * Readers look up and create Pool, Media, Client and Job records one
+     * at a time.
+     */
+    P(catalog_mutex);
+    status = HandleLabelRecord(ctx, dcr, rec);
+    V(catalog_mutex);
 
-      case EOT_LABEL: /* end of all tapes */
-        /*
-         * Wiffle through all jobs still open and close them.
-         */
-        if (update_db) {
-          DeviceControlRecord* mdcr;
-          foreach_dlist (mdcr, dev->attached_dcrs) {
-            JobControlRecord* mjcr = mdcr->jcr;
-            if (!mjcr || mjcr->JobId == 0) { continue; }
-            jr.JobId = mjcr->JobId;
-            jr.JobStatus = JS_ErrorTerminated; /* Mark Job as Error Terimined */
-            jr.JobFiles = mjcr->JobFiles;
-            jr.JobBytes = mjcr->JobBytes;
-            jr.VolSessionId = mjcr->VolSessionId;
-            jr.VolSessionTime = mjcr->VolSessionTime;
-            jr.JobTDate = (utime_t)mjcr->start_time;
-            jr.ClientId = mjcr->ClientId;
-            if (!db->UpdateJobEndRecord(bjcr, &jr)) {
-              Pmsg1(0, _("Could not update job record. ERR=%s\n"),
-                    db->strerror());
-            }
-            mjcr->read_dcr = NULL;
-            FreeJcr(mjcr);
-          }
-        }
-        mr.VolFiles = rec->File;
-        mr.VolBlocks = rec->Block;
-        mr.VolBytes += mr.VolBlocks * WRITE_BLKHDR_LENGTH; /* approx. */
-        mr.VolMounts++;
-        UpdateMediaRecord(db, &mr);
-        Pmsg3(0,
-              _("End of all Volumes. VolFiles=%u VolBlocks=%u VolBytes=%s\n"),
-              mr.VolFiles, mr.VolBlocks,
-              edit_uint64_with_commas(mr.VolBytes, ec1));
-        break;
-      default:
-        break;
-    } /* end switch */
-    return true;
+    return status;
   }
 
   mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
   if (!mjcr) {
-    if (mr.VolJobs > 0) {
+    if (ctx->mr.VolJobs > 0) {
       Pmsg2(000, _("Could not find Job for SessId=%d SessTime=%d record.\n"),
             rec->VolSessionId, rec->VolSessionTime);
     } else {
-      ignored_msgs++;
+      ctx->ignored_msgs++;
     }
     return true;
   }
@@ -830,43 +1086,57 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
-      if (!UnpackAttributesRecord(bjcr, rec->Stream, rec->data, rec->data_len,
-                                  attr)) {
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
+      if (!UnpackAttributesRecord(ctx->bjcr, rec->Stream, rec->data,
+                                  rec->data_len, ctx->attr)) {
         Emsg0(M_ERROR_TERM, 0, _("Cannot continue.\n"));
       }
 
+      /*
+       * The catalog keeps the base64 encoded stat packet.
+       */
+      if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES_BINARY) {
+        EncodeStat(encoded_stat, &ctx->attr->statp, sizeof(ctx->attr->statp),
+                   ctx->attr->LinkFI, ctx->attr->data_stream);
+        ctx->attr->attr = encoded_stat;
+      }
+
       if (verbose > 1) {
-        DecodeStat(attr->attr, &attr->statp, sizeof(attr->statp),
-                   &attr->LinkFI);
-        BuildAttrOutputFnames(bjcr, attr);
-        PrintLsOutput(bjcr, attr);
+        DecodeStat(ctx->attr->attr, &ctx->attr->statp, sizeof(ctx->attr->statp),
+                   &ctx->attr->LinkFI);
+        BuildAttrOutputFnames(ctx->bjcr, ctx->attr);
+        PrintLsOutput(ctx->bjcr, ctx->attr);
       }
-      fr.JobId = mjcr->JobId;
-      fr.FileId = 0;
+      ctx->fr.JobId = mjcr->JobId;
+      ctx->fr.FileId = 0;
       num_files++;
       if (verbose && (num_files & 0x7FFF) == 0) {
-        char ed1[30], ed2[30], ed3[30], ed4[30];
-        Pmsg4(000, _("%s file records. At file:blk=%s:%s bytes=%s\n"),
+        char ed1[50], ed2[50], ed3[50], ed4[50], ed5[50];
+        Pmsg5(000,
+              _("%s file records. At file:blk=%s:%s bytes=%s (%s files/s)\n"),
               edit_uint64_with_commas(num_files, ed1),
               edit_uint64_with_commas(rec->File, ed2),
               edit_uint64_with_commas(rec->Block, ed3),
-              edit_uint64_with_commas(mr.VolBytes, ed4));
+              edit_uint64_with_commas(ctx->mr.VolBytes, ed4),
+              EditRate(num_files, ed5));
       }
-      CreateFileAttributesRecord(db, mjcr, attr->fname, attr->lname, attr->type,
-                                 attr->attr, rec);
+      CreateFileAttributesRecord(ctx, mjcr, ctx->attr->fname, ctx->attr->lname,
+                                 ctx->attr->type, ctx->attr->attr, rec);
       FreeJcr(mjcr);
       break;
 
     case STREAM_RESTORE_OBJECT:
-      if (!UnpackRestoreObject(bjcr, rec->Stream, rec->data, rec->data_len,
-                               &rop)) {
+      if (!UnpackRestoreObject(ctx->bjcr, rec->Stream, rec->data, rec->data_len,
+                               &ctx->rop)) {
         Emsg0(M_ERROR_TERM, 0, _("Cannot continue.\n"));
       }
-      rop.FileIndex = mjcr->FileId;
-      rop.JobId = mjcr->JobId;
+      ctx->rop.FileIndex = rec->FileIndex;
+      ctx->rop.JobId = mjcr->JobId;
 
 
-      if (update_db) { db->CreateRestoreObjectRecord(mjcr, &rop); }
+      if (ctx->update_db) {
+        ctx->db->CreateRestoreObjectRecord(mjcr, &ctx->rop);
+      }
 
       num_restoreobjects++;
 
@@ -928,28 +1198,35 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_MD5_SIZE, true);
       if (verbose > 1) { Pmsg1(000, _("Got MD5 record: %s\n"), digest); }
-      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_MD5);
+      UpdateDigestRecord(ctx, digest, rec, CRYPTO_DIGEST_MD5);
       break;
 
     case STREAM_SHA1_DIGEST:
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_SHA1_SIZE, true);
       if (verbose > 1) { Pmsg1(000, _("Got SHA1 record: %s\n"), digest); }
-      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_SHA1);
+      UpdateDigestRecord(ctx, digest, rec, CRYPTO_DIGEST_SHA1);
       break;
 
     case STREAM_SHA256_DIGEST:
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_SHA256_SIZE, true);
       if (verbose > 1) { Pmsg1(000, _("Got SHA256 record: %s\n"), digest); }
-      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_SHA256);
+      UpdateDigestRecord(ctx, digest, rec, CRYPTO_DIGEST_SHA256);
       break;
 
     case STREAM_SHA512_DIGEST:
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_SHA512_SIZE, true);
       if (verbose > 1) { Pmsg1(000, _("Got SHA512 record: %s\n"), digest); }
-      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_SHA512);
+      UpdateDigestRecord(ctx, digest, rec, CRYPTO_DIGEST_SHA512);
+      break;
+
+    case STREAM_XXH64_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_XXH64_SIZE, true);
+      if (verbose > 1) { Pmsg1(000, _("Got XXH64 record: %s\n"), digest); }
+      UpdateDigestRecord(ctx, digest, rec, CRYPTO_DIGEST_XXH64);
       break;
 
     case STREAM_ENCRYPTED_SESSION_DATA:
@@ -1070,14 +1347,205 @@ static void BscanFreeJcr(JobControlRecord* jcr)
     jcr->read_dcr = NULL;
   }
 
+  if (jcr->db_batch) {
+    DbSqlClosePooledConnection(jcr, jcr->db_batch);
+    jcr->db_batch = NULL;
+    jcr->batch_started = false;
+  }
+
   Dmsg0(200, "End bscan FreeJcr\n");
 }
 
+/**
+ * Insert one File record into the batch of its job.
+ */
+static void InsertFileItem(bscan_file_item* item)
+{
+  JobControlRecord* mjcr = item->jcr;
+
+  if (!mjcr->db_batch->CreateAttributesRecord(mjcr, &item->ar)) {
+    Pmsg1(0, _("Could not create File Attributes record. ERR=%s\n"),
+          mjcr->db_batch->strerror());
+  } else if (verbose > 1) {
+    Pmsg1(000, _("Created File record: %s\n"), item->ar.fname);
+  }
+
+  FreeJcr(mjcr);
+  delete item;
+}
+
+extern "C" void* CatalogWriterThread(void* arg)
+{
+  std::vector<bscan_file_item*> batch;
+
+  P(writer_mutex);
+  while (1) {
+    while (file_queue.empty() && !writer_quit) {
+      pthread_cond_wait(&writer_work, &writer_mutex);
+    }
+
+    if (file_queue.empty()) { break; }
+
+    while (!file_queue.empty() && batch.size() < writer_batch_size) {
+      batch.push_back(file_queue.front());
+      file_queue.pop_front();
+    }
+    writer_busy = true;
+    pthread_cond_broadcast(&writer_done); /* there is room in the queue */
+    V(writer_mutex);
+
+    for (bscan_file_item* item : batch) { InsertFileItem(item); }
+    batch.clear();
+
+    P(writer_mutex);
+    writer_busy = false;
+    pthread_cond_broadcast(&writer_done);
+  }
+  V(writer_mutex);
+
+  return NULL;
+}
+
+static bool StartCatalogWriter()
+{
+  int status;
+
+  writer_quit = false;
+  if ((status = pthread_create(&writer_tid, NULL, CatalogWriterThread,
+                               NULL)) != 0) {
+    BErrNo be;
+
+    Pmsg1(0, _("Cannot create catalog writer thread: ERR=%s\n"),
+          be.bstrerror(status));
+    return false;
+  }
+  Dmsg0(100, "Catalog writer thread started\n");
+
+  return true;
+}
+
+static void QueueFileItem(bscan_file_item* item)
+{
+  P(writer_mutex);
+  while (file_queue.size() >= max_queued_files) {
+    pthread_cond_wait(&writer_done, &writer_mutex);
+  }
+  file_queue.push_back(item);
+  pthread_cond_signal(&writer_work);
+  V(writer_mutex);
+}
+
+/**
+ * Hand the held back attributes of a job to the catalog writer.
+ */
+static void QueuePendingFile(ScanContext* ctx, JobControlRecord* mjcr)
+{
+  auto it = ctx->pending_files.find(mjcr);
+
+  if (it == ctx->pending_files.end()) { return; }
+  QueueFileItem(it->second);
+  ctx->pending_files.erase(it);
+}
+
+/**
+ * Wait until the catalog writer inserted all queued files.
+ */
+static void WaitForCatalogWriter()
+{
+  P(writer_mutex);
+  while (!file_queue.empty() || writer_busy) {
+    pthread_cond_wait(&writer_done, &writer_mutex);
+  }
+  V(writer_mutex);
+}
+
+/**
+ * Store the batch of a job in the File table, this needs to be done before
+ * the job is finished as the batch connection is closed with the job.
+ */
+static void WriteJobFileRecords(ScanContext* ctx, JobControlRecord* mjcr)
+{
+  auto it = ctx->batch_jobs.find(mjcr);
+
+  if (it == ctx->batch_jobs.end()) { return; }
+
+  QueuePendingFile(ctx, mjcr);
+  WaitForCatalogWriter();
+  if (!mjcr->db_batch->WriteBatchFileRecords(mjcr)) {
+    Pmsg2(0, _("Could not insert File records of JobId=%u. ERR=%s\n"),
+          mjcr->JobId, mjcr->db_batch->strerror());
+  }
+
+  ctx->batch_jobs.erase(it);
+  FreeJcr(mjcr);
+}
+
+/**
+ * Store the files of the jobs of a reader that did not end on its volumes.
+ */
+static void WriteAllJobFileRecords(ScanContext* ctx)
+{
+  while (!ctx->batch_jobs.empty()) {
+    WriteJobFileRecords(ctx, *ctx->batch_jobs.begin());
+  }
+}
+
+/**
+ * Stop the catalog writer after it stored all queued files.
+ */
+static void StopCatalogWriter()
+{
+  P(writer_mutex);
+  writer_quit = true;
+  pthread_cond_broadcast(&writer_work);
+  V(writer_mutex);
+
+  pthread_join(writer_tid, NULL);
+  batch_insert = false;
+}
+
+/**
+ * Copy the attributes in ar and hold them back until we know if a digest
+ * follows, the previous file of the job is queued for insertion now.
+ */
+static bool QueueFileAttributes(ScanContext* ctx, JobControlRecord* mjcr)
+{
+  bscan_file_item* item;
+
+  if (!ctx->batch_jobs.count(mjcr)) {
+    if (!ctx->db->OpenBatchConnection(mjcr)) {
+      Pmsg1(0, _("Could not open batch connection. ERR=%s\n"),
+            ctx->db->strerror());
+      return false;
+    }
+    mjcr->IncUseCount();
+    ctx->batch_jobs.insert(mjcr);
+  }
+
+  QueuePendingFile(ctx, mjcr);
+
+  item = new bscan_file_item;
+  mjcr->IncUseCount();
+  item->jcr = mjcr;
+  item->fname = ctx->ar.fname;
+  item->lname = ctx->ar.link;
+  item->attr = ctx->ar.attr;
+  item->ar = ctx->ar;
+  item->ar.fname = (char*)item->fname.c_str();
+  item->ar.link = (char*)item->lname.c_str();
+  item->ar.attr = (char*)item->attr.c_str();
+  item->ar.Digest = NULL;
+  item->ar.DigestType = CRYPTO_DIGEST_NONE;
+  ctx->pending_files[mjcr] = item;
+
+  return true;
+}
+
 /**
  * We got a File Attributes record on the tape.  Now, lookup the Job
  * record, and then create the attributes record.
  */
-static bool CreateFileAttributesRecord(BareosDb* db,
+static bool CreateFileAttributesRecord(ScanContext* ctx,
                                        JobControlRecord* mjcr,
                                        char* fname,
                                        char* lname,
@@ -1086,29 +1554,32 @@ static bool CreateFileAttributesRecord(BareosDb* db,
                                        DeviceRecord* rec)
 {
   DeviceControlRecord* dcr = mjcr->read_dcr;
-  ar.fname = fname;
-  ar.link = lname;
-  ar.ClientId = mjcr->ClientId;
-  ar.JobId = mjcr->JobId;
-  ar.Stream = rec->Stream;
+  ctx->ar.fname = fname;
+  ctx->ar.link = lname;
+  ctx->ar.ClientId = mjcr->ClientId;
+  ctx->ar.JobId = mjcr->JobId;
+  ctx->ar.Stream = rec->Stream;
   if (type == FT_DELETED) {
-    ar.FileIndex = 0;
+    ctx->ar.FileIndex = 0;
   } else {
-    ar.FileIndex = rec->FileIndex;
+    ctx->ar.FileIndex = rec->FileIndex;
   }
-  ar.attr = ap;
+  ctx->ar.attr = ap;
+  ctx->ar.FileType = type;
   if (dcr->VolFirstIndex == 0) { dcr->VolFirstIndex = rec->FileIndex; }
   dcr->FileIndex = rec->FileIndex;
   mjcr->JobFiles++;
 
-  if (!update_db) { return true; }
+  if (!ctx->update_db) { return true; }
+
+  if (batch_insert) { return QueueFileAttributes(ctx, mjcr); }
 
-  if (!db->CreateFileAttributesRecord(bjcr, &ar)) {
+  if (!ctx->db->CreateFileAttributesRecord(ctx->bjcr, &ctx->ar)) {
     Pmsg1(0, _("Could not create File Attributes record. ERR=%s\n"),
-          db->strerror());
+          ctx->db->strerror());
     return false;
   }
-  mjcr->FileId = ar.FileId;
+  mjcr->FileId = ctx->ar.FileId;
 
   if (verbose > 1) { Pmsg1(000, _("Created File record: %s\n"), fname); }
 
@@ -1118,7 +1589,9 @@ static bool CreateFileAttributesRecord(BareosDb* db,
 /**
  * For each Volume we see, we create a Medium record
  */
-static bool CreateMediaRecord(BareosDb* db, MediaDbRecord* mr, VOLUME_LABEL* vl)
+static bool CreateMediaRecord(ScanContext* ctx,
+                              MediaDbRecord* mr,
+                              VOLUME_LABEL* vl)
 {
   struct date_time dt;
   struct tm tm;
@@ -1146,20 +1619,22 @@ static bool CreateMediaRecord(BareosDb* db, MediaDbRecord* mr, VOLUME_LABEL* vl)
     TmDecode(&dt, &tm);
     mr->LabelDate = mktime(&tm);
   }
-  lasttime = mr->LabelDate;
+  ctx->lasttime = mr->LabelDate;
 
   if (mr->VolJobs == 0) { mr->VolJobs = 1; }
 
   if (mr->VolMounts == 0) { mr->VolMounts = 1; }
 
-  if (!update_db) { return true; }
+  if (!ctx->update_db) { return true; }
 
-  if (!db->CreateMediaRecord(bjcr, mr)) {
-    Pmsg1(000, _("Could not create media record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->CreateMediaRecord(ctx->bjcr, mr)) {
+    Pmsg1(000, _("Could not create media record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
-  if (!db->UpdateMediaRecord(bjcr, mr)) {
-    Pmsg1(000, _("Could not update media record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->UpdateMediaRecord(ctx->bjcr, mr)) {
+    Pmsg1(000, _("Could not update media record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
   if (verbose) {
@@ -1172,13 +1647,14 @@ static bool CreateMediaRecord(BareosDb* db, MediaDbRecord* mr, VOLUME_LABEL* vl)
 /**
  * Called at end of media to update it
  */
-static bool UpdateMediaRecord(BareosDb* db, MediaDbRecord* mr)
+static bool UpdateMediaRecord(ScanContext* ctx, MediaDbRecord* mr)
 {
-  if (!update_db && !update_vol_info) { return true; }
+  if (!ctx->update_db && !update_vol_info) { return true; }
 
-  mr->LastWritten = lasttime;
-  if (!db->UpdateMediaRecord(bjcr, mr)) {
-    Pmsg1(000, _("Could not update media record. ERR=%s\n"), db->strerror());
+  mr->LastWritten = ctx->lasttime;
+  if (!ctx->db->UpdateMediaRecord(ctx->bjcr, mr)) {
+    Pmsg1(000, _("Could not update media record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
 
@@ -1190,16 +1666,17 @@ static bool UpdateMediaRecord(BareosDb* db, MediaDbRecord* mr)
   return true;
 }
 
-static bool CreatePoolRecord(BareosDb* db, PoolDbRecord* pr)
+static bool CreatePoolRecord(ScanContext* ctx, PoolDbRecord* pr)
 {
   pr->NumVols++;
   pr->UseCatalog = 1;
   pr->VolRetention = 355 * 3600 * 24; /* 1 year */
 
-  if (!update_db) { return true; }
+  if (!ctx->update_db) { return true; }
 
-  if (!db->CreatePoolRecord(bjcr, pr)) {
-    Pmsg1(000, _("Could not create pool record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->CreatePoolRecord(ctx->bjcr, pr)) {
+    Pmsg1(000, _("Could not create pool record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
 
@@ -1213,24 +1690,25 @@ static bool CreatePoolRecord(BareosDb* db, PoolDbRecord* pr)
 /**
  * Called from SOS to create a client for the current Job
  */
-static bool CreateClientRecord(BareosDb* db, ClientDbRecord* cr)
+static bool CreateClientRecord(ScanContext* ctx, ClientDbRecord* cr)
 {
   /*
-   * Note, update_db can temporarily be set false while
+   * Note, ctx->update_db can temporarily be set false while
    * updating the database, so we must ensure that ClientId is non-zero.
    */
-  if (!update_db) {
+  if (!ctx->update_db) {
     cr->ClientId = 0;
-    if (!db->GetClientRecord(bjcr, cr)) {
-      Pmsg1(0, _("Could not get Client record. ERR=%s\n"), db->strerror());
+    if (!ctx->db->GetClientRecord(ctx->bjcr, cr)) {
+      Pmsg1(0, _("Could not get Client record. ERR=%s\n"), ctx->db->strerror());
       return false;
     }
 
     return true;
   }
 
-  if (!db->CreateClientRecord(bjcr, cr)) {
-    Pmsg1(000, _("Could not create Client record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->CreateClientRecord(ctx->bjcr, cr)) {
+    Pmsg1(000, _("Could not create Client record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
 
@@ -1241,9 +1719,9 @@ static bool CreateClientRecord(BareosDb* db, ClientDbRecord* cr)
   return true;
 }
 
-static bool CreateFilesetRecord(BareosDb* db, FileSetDbRecord* fsr)
+static bool CreateFilesetRecord(ScanContext* ctx, FileSetDbRecord* fsr)
 {
-  if (!update_db) { return true; }
+  if (!ctx->update_db) { return true; }
 
   fsr->FileSetId = 0;
   if (fsr->MD5[0] == 0) {
@@ -1251,14 +1729,14 @@ static bool CreateFilesetRecord(BareosDb* db, FileSetDbRecord* fsr)
     fsr->MD5[1] = 0;
   }
 
-  if (db->GetFilesetRecord(bjcr, fsr)) {
+  if (ctx->db->GetFilesetRecord(ctx->bjcr, fsr)) {
     if (verbose) {
       Pmsg1(000, _("Fileset \"%s\" already exists.\n"), fsr->FileSet);
     }
   } else {
-    if (!db->CreateFilesetRecord(bjcr, fsr)) {
+    if (!ctx->db->CreateFilesetRecord(ctx->bjcr, fsr)) {
       Pmsg2(000, _("Could not create FileSet record \"%s\". ERR=%s\n"),
-            fsr->FileSet, db->strerror());
+            fsr->FileSet, ctx->db->strerror());
       return false;
     }
 
@@ -1274,7 +1752,7 @@ static bool CreateFilesetRecord(BareosDb* db, FileSetDbRecord* fsr)
  * Simulate the two calls on the database to create the Job record and
  * to update it when the Job actually begins running.
  */
-static JobControlRecord* CreateJobRecord(BareosDb* db,
+static JobControlRecord* CreateJobRecord(ScanContext* ctx,
                                          JobDbRecord* jr,
                                          SESSION_LABEL* label,
                                          DeviceRecord* rec)
@@ -1304,23 +1782,24 @@ static JobControlRecord* CreateJobRecord(BareosDb* db,
   jr->VolSessionTime = rec->VolSessionTime;
 
   /* Now create a JobControlRecord as if starting the Job */
-  mjcr = create_jcr(jr, rec, label->JobId);
+  mjcr = create_jcr(ctx, jr, rec, label->JobId);
 
-  if (!update_db) { return mjcr; }
+  if (!ctx->update_db) { return mjcr; }
 
   /*
    * This creates the bare essentials
    */
-  if (!db->CreateJobRecord(bjcr, jr)) {
-    Pmsg1(0, _("Could not create JobId record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->CreateJobRecord(ctx->bjcr, jr)) {
+    Pmsg1(0, _("Could not create JobId record. ERR=%s\n"), ctx->db->strerror());
     return mjcr;
   }
 
   /*
    * This adds the client, StartTime, JobTDate, ...
    */
-  if (!db->UpdateJobStartRecord(bjcr, jr)) {
-    Pmsg1(0, _("Could not update job start record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->UpdateJobStartRecord(ctx->bjcr, jr)) {
+    Pmsg1(0, _("Could not update job start record. ERR=%s\n"),
+          ctx->db->strerror());
     return mjcr;
   }
 
@@ -1334,7 +1813,7 @@ static JobControlRecord* CreateJobRecord(BareosDb* db,
 /**
  * Simulate the database call that updates the Job at Job termination time.
  */
-static bool UpdateJobRecord(BareosDb* db,
+static bool UpdateJobRecord(ScanContext* ctx,
                             JobDbRecord* jr,
                             SESSION_LABEL* elabel,
                             DeviceRecord* rec)
@@ -1359,7 +1838,7 @@ static bool UpdateJobRecord(BareosDb* db,
     jr->EndTime = mktime(&tm);
   }
 
-  lasttime = jr->EndTime;
+  ctx->lasttime = jr->EndTime;
   mjcr->end_time = jr->EndTime;
 
   jr->JobId = mjcr->JobId;
@@ -1375,14 +1854,14 @@ static bool UpdateJobRecord(BareosDb* db,
   jr->JobTDate = (utime_t)mjcr->start_time;
   jr->ClientId = mjcr->ClientId;
 
-  if (!update_db) {
+  if (!ctx->update_db) {
     FreeJcr(mjcr);
     return true;
   }
 
-  if (!db->UpdateJobEndRecord(bjcr, jr)) {
+  if (!ctx->db->UpdateJobEndRecord(ctx->bjcr, jr)) {
     Pmsg2(0, _("Could not update JobId=%u record. ERR=%s\n"), jr->JobId,
-          db->strerror());
+          ctx->db->strerror());
     FreeJcr(mjcr);
     return false;
   }
@@ -1441,7 +1920,7 @@ static bool UpdateJobRecord(BareosDb* db,
            job_level_to_str(mjcr->getJobLevel()), mjcr->client_name, sdt, edt,
            edit_uint64_with_commas(mjcr->JobFiles, ec1),
            edit_uint64_with_commas(mjcr->JobBytes, ec2), mjcr->VolSessionId,
-           mjcr->VolSessionTime, edit_uint64_with_commas(mr.VolBytes, ec3),
+           mjcr->VolSessionTime, edit_uint64_with_commas(ctx->mr.VolBytes, ec3),
            BAREOS_BINARY_INFO, TermMsg);
   }
   FreeJcr(mjcr);
@@ -1449,18 +1928,18 @@ static bool UpdateJobRecord(BareosDb* db,
   return true;
 }
 
-static bool CreateJobmediaRecord(BareosDb* db, JobControlRecord* mjcr)
+static bool CreateJobmediaRecord(ScanContext* ctx, JobControlRecord* mjcr)
 {
   JobMediaDbRecord jmr;
   DeviceControlRecord* dcr = mjcr->read_dcr;
 
-  dcr->EndBlock = dev->EndBlock;
-  dcr->EndFile = dev->EndFile;
-  dcr->VolMediaId = dev->VolCatInfo.VolMediaId;
+  dcr->EndBlock = ctx->dev->EndBlock;
+  dcr->EndFile = ctx->dev->EndFile;
+  dcr->VolMediaId = ctx->dev->VolCatInfo.VolMediaId;
 
   memset(&jmr, 0, sizeof(jmr));
   jmr.JobId = mjcr->JobId;
-  jmr.MediaId = mr.MediaId;
+  jmr.MediaId = ctx->mr.MediaId;
   jmr.FirstIndex = dcr->VolFirstIndex;
   jmr.LastIndex = dcr->VolLastIndex;
   jmr.StartFile = dcr->StartFile;
@@ -1468,10 +1947,11 @@ static bool CreateJobmediaRecord(BareosDb* db, JobControlRecord* mjcr)
   jmr.StartBlock = dcr->StartBlock;
   jmr.EndBlock = dcr->EndBlock;
 
-  if (!update_db) { return true; }
+  if (!ctx->update_db) { return true; }
 
-  if (!db->CreateJobmediaRecord(bjcr, &jmr)) {
-    Pmsg1(0, _("Could not create JobMedia record. ERR=%s\n"), db->strerror());
+  if (!ctx->db->CreateJobmediaRecord(ctx->bjcr, &jmr)) {
+    Pmsg1(0, _("Could not create JobMedia record. ERR=%s\n"),
+          ctx->db->strerror());
     return false;
   }
   if (verbose) {
@@ -1485,7 +1965,7 @@ static bool CreateJobmediaRecord(BareosDb* db, JobControlRecord* mjcr)
 /**
  * Simulate the database call that updates the MD5/SHA1 record
  */
-static bool UpdateDigestRecord(BareosDb* db,
+static bool UpdateDigestRecord(ScanContext* ctx,
                                char* digest,
                                DeviceRecord* rec,
                                int type)
@@ -1494,24 +1974,38 @@ static bool UpdateDigestRecord(BareosDb* db,
 
   mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
   if (!mjcr) {
-    if (mr.VolJobs > 0) {
+    if (ctx->mr.VolJobs > 0) {
       Pmsg2(000,
             _("Could not find SessId=%d SessTime=%d for MD5/SHA1 record.\n"),
             rec->VolSessionId, rec->VolSessionTime);
     } else {
-      ignored_msgs++;
+      ctx->ignored_msgs++;
     }
     return false;
   }
 
-  if (!update_db || mjcr->FileId == 0) {
+  if (ctx->update_db && batch_insert) {
+    auto it = ctx->pending_files.find(mjcr);
+    if (it != ctx->pending_files.end()) {
+      bscan_file_item* item = it->second;
+
+      bstrncpy(item->digest, digest, sizeof(item->digest));
+      item->ar.Digest = item->digest;
+      item->ar.DigestType = type;
+      QueuePendingFile(ctx, mjcr);
+    }
+    FreeJcr(mjcr);
+    return true;
+  }
+
+  if (!ctx->update_db || mjcr->FileId == 0) {
     FreeJcr(mjcr);
     return true;
   }
 
-  if (!db->AddDigestToFileRecord(bjcr, mjcr->FileId, digest, type)) {
+  if (!ctx->db->AddDigestToFileRecord(ctx->bjcr, mjcr->FileId, digest, type)) {
     Pmsg1(0, _("Could not add MD5/SHA1 to File record. ERR=%s\n"),
-          db->strerror());
+          ctx->db->strerror());
     FreeJcr(mjcr);
     return false;
   }
@@ -1525,7 +2019,8 @@ static bool UpdateDigestRecord(BareosDb* db,
 /**
  * Create a JobControlRecord as if we are really starting the job
  */
-static JobControlRecord* create_jcr(JobDbRecord* jr,
+static JobControlRecord* create_jcr(ScanContext* ctx,
+                                    JobDbRecord* jr,
                                     DeviceRecord* rec,
                                     uint32_t JobId)
 {
@@ -1546,7 +2041,7 @@ static JobControlRecord* create_jcr(JobDbRecord* jr,
   jobjcr->VolSessionTime = rec->VolSessionTime;
   jobjcr->ClientId = jr->ClientId;
   jobjcr->dcr = jobjcr->read_dcr = New(DeviceControlRecord);
-  SetupNewDcrDevice(jobjcr, jobjcr->dcr, dev, NULL);
+  SetupNewDcrDevice(jobjcr, jobjcr->dcr, ctx->dev, NULL);
 
   return jobjcr;
 }
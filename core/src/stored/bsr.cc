@@ -41,6 +41,7 @@
 #include "include/bareos.h"
 #include "stored/bsr.h"
 #include "stored/stored.h"
+#include "stored/volume_index.h"
 #include "include/jcr.h"
 
 namespace storagedaemon {
@@ -182,7 +183,8 @@ static int MatchFileregex(BootStrapRecord* bsr,
    * not of this type
    */
   if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES ||
-      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX) {
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX ||
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_BINARY) {
     bsr->skip_file = false;
     if (UnpackAttributesRecord(jcr, rec->Stream, rec->data, rec->data_len,
                                bsr->attr)) {
@@ -735,7 +737,13 @@ static int MatchFindex(BootStrapRecord* bsr,
             findex->findex, findex->findex2);
       return 1;
     }
-    if (rec->FileIndex > findex->findex2) { findex->done = true; }
+    if (rec->FileIndex > findex->findex2) {
+      findex->done = true;
+      /*
+       * With a volume index we can skip ahead to the next range.
+       */
+      if (findex->next) { bsr->root->Reposition = true; }
+    }
   }
   if (findex->next) {
     return MatchFindex(bsr, findex->next, rec, findex->done && done);
@@ -775,6 +783,43 @@ uint64_t GetBsrStartAddr(BootStrapRecord* bsr, uint32_t* file, uint32_t* block)
   return bsr_addr;
 }
 
+/**
+ * Get the address to position to for reading the next bsr of the volume.
+ *
+ * This is the start address of the bsr unless the index of the volume knows
+ * a later block in which the first file still wanted starts. As the index
+ * may skip ahead, all bsrs still to be read from the volume are checked so
+ * that we never position past one of them.
+ */
+uint64_t GetBsrPositionAddr(BootStrapRecord* bsr,
+                            Device* dev,
+                            uint32_t* file,
+                            uint32_t* block)
+{
+  uint64_t bsr_addr, addr;
+  uint64_t min_addr = 0;
+
+  bsr_addr = GetBsrStartAddr(bsr, file, block);
+  if (!bsr || !VolumeIndexEnabled(dev)) { return bsr_addr; }
+
+  for (BootStrapRecord* b = bsr->root; b; b = b->next) {
+    if (b->done || !MatchVolume(b, b->volume, &dev->VolHdr, 1)) { continue; }
+    addr = MAX(GetBsrStartAddr(b, NULL, NULL), GetVolumeIndexAddr(dev, b));
+    if (min_addr == 0 || addr < min_addr) { min_addr = addr; }
+  }
+
+  if (min_addr <= bsr_addr) { return bsr_addr; }
+
+  Dmsg2(dbglevel, "Volume index moves start address from %llu to %llu\n",
+        bsr_addr, min_addr);
+  if (file && block) {
+    *file = min_addr >> 32;
+    *block = (uint32_t)min_addr;
+  }
+
+  return min_addr;
+}
+
 /* ****************************************************************
  * Routines for handling volumes
  */
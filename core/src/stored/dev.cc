@@ -76,8 +76,10 @@
 #include "stored/block.h"
 #include "stored/stored.h"
 #include "stored/autochanger.h"
+#include "stored/volume_index.h"
 #include "stored/sd_backends.h"
 #include "lib/btimers.h"
+#include "lib/scsi_lli.h"
 #include "include/jcr.h"
 
 #ifndef HAVE_DYNAMIC_SD_BACKENDS
@@ -136,7 +138,7 @@ const char* Device::mode_to_str(int mode)
 
 static inline Device* init_dev(JobControlRecord* jcr,
                                DeviceResource* device,
-                               bool new_init)
+                               Device* shared_read_parent)
 {
   struct stat statp;
   int errstat;
@@ -293,7 +295,16 @@ static inline Device* init_dev(JobControlRecord* jcr,
   if (dev->vol_poll_interval && dev->vol_poll_interval < 60) {
     dev->vol_poll_interval = 60;
   }
-  device->dev = dev;
+
+  /*
+   * A shared read clone is owned by the job that reads from it, the
+   * resource keeps pointing to the device the clone was made of.
+   */
+  if (shared_read_parent) {
+    dev->shared_read_parent = shared_read_parent;
+  } else {
+    device->dev = dev;
+  }
 
   if (dev->IsFifo()) { dev->SetCap(CAP_STREAM); /* set stream device */ }
 
@@ -422,10 +433,28 @@ Device* InitDev(JobControlRecord* jcr, DeviceResource* device)
 {
   Device* dev;
 
-  dev = init_dev(jcr, device, false);
+  dev = init_dev(jcr, device, NULL);
   return dev;
 }
 
+/**
+ * Allocate a private read only instance of a disk based device so another
+ * job can read from it while the device itself is busy. The clone opens the
+ * volume with its own file descriptor, so every reader positions on its own.
+ * It is freed again with term() once the job releases it.
+ */
+Device* InitSharedReadDev(JobControlRecord* jcr, Device* dev)
+{
+  Device* clone;
+
+  clone = init_dev(jcr, dev->device, dev);
+  if (clone) {
+    Dmsg2(100, "JobId=%u created shared read clone of %s\n", jcr->JobId,
+          dev->print_name());
+  }
+  return clone;
+}
+
 /**
  * This routine initializes the device wait timers
  */
@@ -483,6 +512,64 @@ bool DoubleDevWaitTime(Device* dev)
 Device::Device() { fd_ = -1; }
 
 
+/**
+ * Get the largest block the drive can write, it is asked for with READ
+ * BLOCK LIMITS while the device is open. The answer is kept until the device
+ * is closed or the volume is unloaded, a failed query is tried again on the
+ * next call. Returns 0 when the drive can't tell.
+ */
+uint32_t Device::DriveMaxBlockLength()
+{
+  uint32_t min_block_len, max_block_len;
+
+  if (block_limits_queried) { return drive_max_block_len; }
+  if (!IsOpen()) { return 0; }
+
+  if (!GetScsiBlockLimits(fd_, dev_name, &min_block_len, &max_block_len)) {
+    Dmsg1(100, "Drive %s did not report its block limits\n", print_name());
+    return 0;
+  }
+
+  drive_max_block_len = max_block_len;
+  block_limits_queried = true;
+  Dmsg2(100, "Drive %s reports a maximum block length of %u\n", print_name(),
+        drive_max_block_len);
+
+  return drive_max_block_len;
+}
+
+/**
+ * Get the block size for writing large blocks, the configured Large Block
+ * Size limited by what the drive supports.
+ */
+uint32_t Device::LargeBlockSize()
+{
+  return ComputeLargeBlockSize(device->large_block_size, DriveMaxBlockLength(),
+                               device->max_block_size);
+}
+
+/**
+ * Limit a large block size to the maximum block length of the drive
+ * (0 when unknown) and round it down to a multiple of TAPE_BSIZE. When no
+ * multiple of TAPE_BSIZE fits, the normal block size of the device is used.
+ */
+uint32_t ComputeLargeBlockSize(uint32_t large_block_size,
+                               uint32_t drive_max_block_len,
+                               uint32_t max_block_size)
+{
+  uint32_t size = large_block_size;
+
+  if (drive_max_block_len && size > drive_max_block_len) {
+    size = drive_max_block_len;
+  }
+  if (size > MAX_BLOCK_LENGTH) { size = MAX_BLOCK_LENGTH; }
+  size -= size % TAPE_BSIZE;
+
+  if (size == 0) { return max_block_size; }
+
+  return size;
+}
+
 /**
  * Set the block size of the device.
  * If the volume block size is zero, we set the max block size to what is
@@ -515,6 +602,17 @@ void Device::SetBlocksizes(DeviceControlRecord* dcr)
     dev->max_block_size = dcr->VolMaxBlocksize;
   }
 
+  /*
+   * Without a block size for the volume a tape is written in large blocks
+   * when configured.
+   */
+  if (dcr->VolMaxBlocksize == 0 && dev->device->large_block_size &&
+      dev->IsTape()) {
+    dev->max_block_size = dev->LargeBlockSize();
+    Dmsg2(100, "using large blocks of %u bytes on device %s\n",
+          dev->max_block_size, dev->print_name());
+  }
+
   /*
    * Sanity check
    */
@@ -993,6 +1091,7 @@ void Device::SetUnload()
     unload_ = true;
     memcpy(UnloadVolName, VolHdr.VolumeName, sizeof(UnloadVolName));
   }
+  block_limits_queried = false;
 }
 
 /**
@@ -1014,6 +1113,8 @@ bool Device::close(DeviceControlRecord* dcr)
   int status;
   Dmsg1(100, "close_dev %s\n", print_name());
 
+  CloseVolumeIndex(this);
+
   if (!IsOpen()) {
     Dmsg2(100, "device %s already closed vol=%s\n", print_name(),
           VolHdr.VolumeName);
@@ -1065,6 +1166,7 @@ bool Device::close(DeviceControlRecord* dcr)
   file_addr = 0;
   EndFile = EndBlock = 0;
   open_mode = 0;
+  block_limits_queried = false;
   ClearVolhdr();
   memset(&VolCatInfo, 0, sizeof(VolCatInfo));
   if (tid) {
@@ -1305,7 +1407,7 @@ void Device::term()
     delete attached_dcrs;
     attached_dcrs = NULL;
   }
-  if (device) { device->dev = NULL; }
+  if (device && device->dev == this) { device->dev = NULL; }
   delete this;
 }
 
@@ -272,6 +272,7 @@ class DeviceResource;        /* Forward reference Device resource defined in
                                 stored_conf.h */
 class DeviceControlRecord;   /* Forward reference */
 class VolumeReservationItem; /* Forward reference */
+class VolumeIndex;           /* Forward reference */
 
 /**
  * Device specific status information either returned via Device::DeviceStatus()
@@ -305,6 +306,9 @@ class Device : public SmartAlloc {
   Device();
   virtual ~Device() {}
   Device* volatile swap_dev;          /**< Swap vol from this device */
+  Device* shared_read_parent;         /**< Device this read clone was made of */
+  uint32_t drive_max_block_len;       /**< Drive block limit, 0=unknown */
+  bool block_limits_queried;          /**< drive_max_block_len is valid */
   dlist* attached_dcrs;               /**< Attached DeviceControlRecord list */
   pthread_mutex_t mutex_;             /**< Access control */
   pthread_mutex_t spool_mutex;        /**< Mutex for updating spool_size */
@@ -356,6 +360,7 @@ class Device : public SmartAlloc {
   DeviceResource* device;     /**< Pointer to Device Resource */
   VolumeReservationItem* vol; /**< Pointer to Volume reservation item */
   btimer_t* tid;              /**< Timer id */
+  VolumeIndex* vol_index;     /**< Record index of the mounted file volume */
 
   VolumeCatalogInfo VolCatInfo;    /**< Volume Catalog Information */
   VOLUME_LABEL VolHdr;             /**< Actual volume label */
@@ -511,6 +516,8 @@ class Device : public SmartAlloc {
 
   void SetBlocksizes(DeviceControlRecord* dcr);
   void SetLabelBlocksize(DeviceControlRecord* dcr);
+  uint32_t DriveMaxBlockLength();
+  uint32_t LargeBlockSize();
 
   uint32_t GetFile() const { return file; }
   uint32_t GetBlockNum() const { return block_num; }
@@ -675,6 +682,7 @@ class DeviceControlRecord : public SmartAlloc {
   bool any_volume;                  /**< Any OK for dir_find_next... */
   bool attached_to_dev;             /**< Set when attached to dev */
   bool keep_dcr;                    /**< Do not free dcr in release_dcr */
+  bool shared_read;                 /**< Set when reading from a clone */
   uint32_t autodeflate;             /**< Try to autodeflate streams */
   uint32_t autoinflate;             /**< Try to autoinflate streams */
   uint32_t VolFirstIndex;           /**< First file index this Volume */
@@ -689,6 +697,12 @@ class DeviceControlRecord : public SmartAlloc {
   int64_t max_job_spool_size;       /**< Max job spool size */
   uint32_t VolMinBlocksize;         /**< Minimum Blocksize */
   uint32_t VolMaxBlocksize;         /**< Maximum Blocksize */
+  btime_t tape_first_write;         /**< Start of the first tape write */
+  btime_t tape_last_write;          /**< End of the last tape write */
+  btime_t tape_write_time;          /**< Time spent writing to tape */
+  uint64_t tape_write_bytes;        /**< Bytes written to tape */
+  uint32_t tape_write_blocks;       /**< Blocks written to tape */
+  uint32_t tape_write_stalls;       /**< Pauses that likely backhitched */
   char VolumeName[MAX_NAME_LENGTH]; /**< Volume name */
   char pool_name[MAX_NAME_LENGTH];  /**< Pool name */
   char pool_type[MAX_NAME_LENGTH];  /**< Pool type */
@@ -855,6 +869,7 @@ class BTAPE_DCR : public DeviceControlRecord {
 };
 
 Device* InitDev(JobControlRecord* jcr, DeviceResource* device);
+Device* InitSharedReadDev(JobControlRecord* jcr, Device* dev);
 bool CanOpenMountedDev(Device* dev);
 bool LoadDev(Device* dev);
 int WriteBlock(Device* dev);
@@ -864,6 +879,9 @@ JobControlRecord* next_attached_jcr(Device* dev, JobControlRecord* jcr);
 void InitDeviceWaitTimers(DeviceControlRecord* dcr);
 void InitJcrDeviceWaitTimers(JobControlRecord* jcr);
 bool DoubleDevWaitTime(Device* dev);
+uint32_t ComputeLargeBlockSize(uint32_t large_block_size,
+                               uint32_t drive_max_block_len,
+                               uint32_t max_block_size);
 
 /*
  * Get some definition of function to position to the end of the medium in
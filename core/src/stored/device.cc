@@ -314,7 +314,7 @@ BootStrapRecord* PositionDeviceToFirstFile(JobControlRecord* jcr,
   if (jcr->bsr) {
     jcr->bsr->Reposition = true; /* force repositioning */
     bsr = find_next_bsr(jcr->bsr, dev);
-    if (GetBsrStartAddr(bsr, &file, &block) > 0) {
+    if (GetBsrPositionAddr(bsr, dev, &file, &block) > 0) {
       Jmsg(jcr, M_INFO, 0,
            _("Forward spacing Volume \"%s\" to file:block %u:%u.\n"),
            dev->VolHdr.VolumeName, file, block);
@@ -360,7 +360,7 @@ bool TryDeviceRepositioning(JobControlRecord* jcr,
     uint32_t block, file;
     /* TODO: use dev->file_addr ? */
     uint64_t dev_addr = (((uint64_t)dev->file) << 32) | dev->block_num;
-    uint64_t bsr_addr = GetBsrStartAddr(bsr, &file, &block);
+    uint64_t bsr_addr = GetBsrPositionAddr(bsr, dev, &file, &block);
 
     if (dev_addr > bsr_addr) { return false; }
     Dmsg4(500, "Try_Reposition from (file:block) %u:%u to %u:%u\n", dev->file,
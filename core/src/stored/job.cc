@@ -53,7 +53,8 @@ static char jobcmd[] =
     "Protocol=%d BackupFormat=%127s\n";
 
 /* Responses sent to Director daemon */
-static char OK_job[] = "3000 OK Job SDid=%u SDtime=%u Authorization=%s\n";
+static char OK_job[] =
+    "3000 OK Job SDid=%u SDtime=%u Authorization=%s BinaryAttributes=1\n";
 static char OK_nextrun[] = "3000 OK Job Authorization=%s\n";
 static char BAD_job[] = "3915 Bad Job command. stat=%d CMD: %s\n";
 static char Job_end[] =
@@ -41,6 +41,7 @@
 #include "stored/read_record.h"
 #include "stored/sd_stats.h"
 #include "stored/spool.h"
+#include "stored/vol_prefetch.h"
 #include "lib/bget_msg.h"
 #include "lib/bnet.h"
 #include "lib/edit.h"
@@ -121,6 +122,8 @@ static bool CloneRecordInternally(DeviceControlRecord* dcr, DeviceRecord* rec)
   Device* dev = jcr->dcr->dev;
   char buf1[100], buf2[100];
 
+  UpdateVolumePrefetch(dcr);
+
   /*
    * If label, discard it as we create our SOS and EOS Labels
    * However, we still want the first Start Of Session label as that contains
@@ -306,6 +309,8 @@ static bool CloneRecordToRemoteSd(DeviceControlRecord* dcr, DeviceRecord* rec)
   BareosSocket* sd = jcr->store_bsock;
   bool send_eod, send_header;
 
+  UpdateVolumePrefetch(dcr);
+
   /*
    * If label discard it
    */
@@ -549,6 +554,8 @@ bool DoMacRun(JobControlRecord* jcr)
     Dmsg2(200, "===== After acquire pos %u:%u\n", jcr->read_dcr->dev->file,
           jcr->read_dcr->dev->block_num);
 
+    StartVolumePrefetch(jcr->read_dcr);
+
     jcr->sendJobStatus(JS_Running);
 
     /*
@@ -667,6 +674,8 @@ bool DoMacRun(JobControlRecord* jcr)
     Dmsg2(200, "===== After acquire pos %u:%u\n", jcr->dcr->dev->file,
           jcr->dcr->dev->block_num);
 
+    StartVolumePrefetch(jcr->read_dcr);
+
     jcr->sendJobStatus(JS_Running);
 
     /*
@@ -697,6 +706,8 @@ bool DoMacRun(JobControlRecord* jcr)
   }
 
 bail_out:
+  StopVolumePrefetch(jcr);
+
   if (!ok) { jcr->setJobStatus(JS_ErrorTerminated); }
 
   if (!jcr->remote_replicate && jcr->dcr) {
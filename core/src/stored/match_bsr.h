@@ -35,6 +35,10 @@ bool IsThisBsrDone(BootStrapRecord* bsr, DeviceRecord* rec);
 uint64_t GetBsrStartAddr(BootStrapRecord* bsr,
                          uint32_t* file = NULL,
                          uint32_t* block = NULL);
+uint64_t GetBsrPositionAddr(BootStrapRecord* bsr,
+                            Device* dev,
+                            uint32_t* file = NULL,
+                            uint32_t* block = NULL);
 
 } /* namespace storagedaemon */
 
@@ -202,6 +202,10 @@ static const char* record_digest_to_str(PoolMem& resultbuffer,
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_SHA512_SIZE, true);
       break;
+    case STREAM_XXH64_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_XXH64_SIZE, true);
+      break;
     default:
       return "";
   }
@@ -257,6 +261,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
         return "contCOMPRESSED";
       case STREAM_UNIX_ATTRIBUTES_EX:
         return "contUNIX-Attributes-EX";
+      case STREAM_UNIX_ATTRIBUTES_BINARY:
+        return "contUATTR-BINARY";
       case STREAM_RESTORE_OBJECT:
         return "contRESTORE-OBJECT";
       case STREAM_SPARSE_DATA:
@@ -277,6 +283,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
         return "contSHA256";
       case STREAM_SHA512_DIGEST:
         return "contSHA512";
+      case STREAM_XXH64_DIGEST:
+        return "contXXH64";
       case STREAM_SIGNED_DIGEST:
         return "contSIGNED-DIGEST";
       case STREAM_ENCRYPTED_SESSION_DATA:
@@ -324,6 +332,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
       return "COMPRESSED";
     case STREAM_UNIX_ATTRIBUTES_EX:
       return "UNIX-Attributes-EX";
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
+      return "UATTR-BINARY";
     case STREAM_RESTORE_OBJECT:
       return "RESTORE-OBJECT";
     case STREAM_SPARSE_DATA:
@@ -346,6 +356,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
       return "SHA256";
     case STREAM_SHA512_DIGEST:
       return "SHA512";
+    case STREAM_XXH64_DIGEST:
+      return "XXH64";
     case STREAM_SIGNED_DIGEST:
       return "SIGNED-DIGEST";
     case STREAM_ENCRYPTED_SESSION_DATA:
@@ -411,8 +423,10 @@ static const char* record_unix_attributes_to_str(PoolMem& resultbuffer,
     return NULL;
   }
 
-  attr->data_stream =
-      DecodeStat(attr->attr, &attr->statp, sizeof(attr->statp), &attr->LinkFI);
+  if (rec->maskedStream != STREAM_UNIX_ATTRIBUTES_BINARY) {
+    attr->data_stream = DecodeStat(attr->attr, &attr->statp,
+                                   sizeof(attr->statp), &attr->LinkFI);
+  }
   BuildAttrOutputFnames(jcr, attr);
   attr_to_str(resultbuffer, jcr, attr);
 
@@ -429,12 +443,14 @@ static const char* get_record_short_info(PoolMem& resultbuffer,
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_BINARY:
       record_unix_attributes_to_str(resultbuffer, jcr, rec);
       break;
     case STREAM_MD5_DIGEST:
     case STREAM_SHA1_DIGEST:
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
+    case STREAM_XXH64_DIGEST:
       record_digest_to_str(resultbuffer, rec);
       break;
     case STREAM_PLUGIN_NAME: {
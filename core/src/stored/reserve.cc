@@ -831,10 +831,24 @@ bail_out:
   return 0;
 }
 
+/**
+ * See if another read job may use a busy device through a clone of its own.
+ * This is only possible for plain file devices that are only read from.
+ */
+static bool CanShareRead(Device* dev)
+{
+  return dev->device->shared_read && dev->dev_type == B_FILE_DEV &&
+         me->filedevice_concurrent_read && dev->CanRead() &&
+         !dev->CanAppend() && dev->num_writers == 0;
+}
+
 /**
  * We "reserve" the drive by setting the ST_READREADY bit.
  * No one else should touch the drive until that is cleared.
  * This allows the DIR to "reserve" the device before actually starting the job.
+ *
+ * When the drive is already reading and allows shared reads the job gets its
+ * own clone of the device instead, see InitSharedReadDev().
  */
 static bool ReserveDeviceForRead(DeviceControlRecord* dcr)
 {
@@ -858,15 +872,32 @@ static bool ReserveDeviceForRead(DeviceControlRecord* dcr)
   }
 
   if (dev->IsBusy()) {
-    Dmsg4(debuglevel,
-          "Device %s is busy ST_READREADY=%d num_writers=%d reserved=%d.\n",
-          dev->print_name(), BitIsSet(ST_READREADY, dev->state) ? 1 : 0,
-          dev->num_writers, dev->NumReserved());
-    Mmsg(jcr->errmsg,
-         _("3602 JobId=%u device %s is busy (already reading/writing).\n"),
-         jcr->JobId, dev->print_name());
-    QueueReserveMessage(jcr);
-    goto bail_out;
+    Device* clone = NULL;
+
+    if (CanShareRead(dev)) { clone = InitSharedReadDev(jcr, dev); }
+    if (!clone) {
+      Dmsg4(debuglevel,
+            "Device %s is busy ST_READREADY=%d num_writers=%d reserved=%d.\n",
+            dev->print_name(), BitIsSet(ST_READREADY, dev->state) ? 1 : 0,
+            dev->num_writers, dev->NumReserved());
+      Mmsg(jcr->errmsg,
+           _("3602 JobId=%u device %s is busy (already reading/writing).\n"),
+           jcr->JobId, dev->print_name());
+      QueueReserveMessage(jcr);
+      goto bail_out;
+    }
+
+    /*
+     * Move the dcr over to the clone, detaching it from the device takes the
+     * device lock so we have to release it first.
+     */
+    dev->Unlock();
+    SetupNewDcrDevice(jcr, dcr, clone, NULL);
+    dcr->shared_read = true;
+    dev = clone;
+    dev->Lock();
+    Dmsg2(debuglevel, "JobId=%u shares read access to device %s\n",
+          jcr->JobId, dev->print_name());
   }
 
   /*
@@ -0,0 +1,594 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Native SCSI media changer driver.
+ *
+ * Instead of running the changer script for every load, unload and query,
+ * an Autochanger with "Changer Command = native" sends the SCSI Media
+ * Changer commands itself using the SMC routines of the NDMP library and
+ * the low level SCSI interface. The answers are formatted the way the
+ * mtx-changer script prints them, so the callers in autochanger.cc parse
+ * them exactly like the script output.
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/scsi_changer.h"
+#include "lib/edit.h"
+#include "lib/scsi_lli.h"
+
+#if HAVE_NDMP
+#include "ndmp/smc.h"
+#endif
+
+#include <map>
+
+namespace storagedaemon {
+
+static const int debuglevel = 100;
+
+bool IsNativeChanger(DeviceResource* device)
+{
+  return device->changer_command &&
+         Bstrcasecmp(device->changer_command, NATIVE_CHANGER_COMMAND);
+}
+
+#if HAVE_NDMP
+/*
+ * All native changers, one per changer device.
+ */
+static std::mutex changers_mutex;
+static std::map<std::string, ScsiChanger*> changers;
+
+ScsiChanger::ScsiChanger(const char* device_name)
+    : device_name_(device_name), use_device_(true)
+{
+  transport_ = [this](struct smc_scsi_req* sr) { return SendScsiRequest(sr); };
+}
+
+ScsiChanger::ScsiChanger(const char* device_name, ScsiTransport transport)
+    : device_name_(device_name), transport_(transport)
+{
+}
+
+ScsiChanger::~ScsiChanger()
+{
+  Close();
+  if (smc_) {
+    smc_cleanup_element_status_data(smc_);
+    delete smc_;
+  }
+}
+
+bool ScsiChanger::SetError(const char* fmt, ...)
+{
+  va_list arg_ptr;
+  char buf[256];
+
+  va_start(arg_ptr, fmt);
+  Bvsnprintf(buf, sizeof(buf), fmt, arg_ptr);
+  va_end(arg_ptr);
+
+  errmsg_.assign(buf);
+  Dmsg2(debuglevel, "Changer %s: %s\n", device_name_.c_str(), buf);
+
+  return false;
+}
+
+/**
+ * Send a request to the changer device using the low level SCSI interface.
+ */
+bool ScsiChanger::SendScsiRequest(struct smc_scsi_req* sr)
+{
+  bool ok;
+
+  switch (sr->data_dir) {
+    case SMCSR_DD_IN:
+      ok = RecvScsiCmdPage(fd_, device_name_.c_str(), sr->cmd, sr->n_cmd,
+                           sr->data, sr->n_data_avail);
+      break;
+    case SMCSR_DD_OUT:
+      ok = send_scsi_cmd_page(fd_, device_name_.c_str(), sr->cmd, sr->n_cmd,
+                              sr->data, sr->n_data_avail);
+      break;
+    default:
+      ok = send_scsi_cmd_page(fd_, device_name_.c_str(), sr->cmd, sr->n_cmd,
+                              NULL, 0);
+      break;
+  }
+
+  if (!ok) { return false; }
+
+  /*
+   * A failing command is reported by the SCSI layer, so what we get here
+   * completed with a good status and the whole buffer transferred.
+   */
+  sr->completion_status = SMCSR_CS_GOOD;
+  sr->status_byte = 0;
+  sr->n_data_done = (sr->data_dir == SMCSR_DD_NONE) ? 0 : sr->n_data_avail;
+
+  return true;
+}
+
+int ScsiChanger::IssueScsiRequest(struct smc_ctrl_block* smc)
+{
+  ScsiChanger* changer = (ScsiChanger*)smc->app_data;
+
+  return changer->transport_(&smc->scsi_req) ? 0 : -1;
+}
+
+/**
+ * Identify the changer and get its element address assignment.
+ */
+bool ScsiChanger::Open()
+{
+  if (opened_) { return true; }
+
+  if (!smc_) { smc_ = new smc_ctrl_block(); }
+  smc_->issue_scsi_req = IssueScsiRequest;
+  smc_->app_data = this;
+
+  if (use_device_) {
+    fd_ = open(device_name_.c_str(), O_RDWR | O_NONBLOCK | O_BINARY);
+    if (fd_ < 0) {
+      BErrNo be;
+
+      return SetError(_("Cannot open changer device: ERR=%s"),
+                      be.bstrerror());
+    }
+  }
+
+  if (smc_inquire(smc_) != 0) {
+    SetError(_("INQUIRY failed: %s"), smc_->errmsg);
+    Close();
+    return false;
+  }
+
+  if (smc_get_elem_aa(smc_) != 0) {
+    SetError(_("MODE SENSE failed: %s"), smc_->errmsg);
+    Close();
+    return false;
+  }
+
+  Dmsg6(debuglevel,
+        "Changer %s is \"%s\", drives=%d slots=%d import/export=%d "
+        "transports=%d\n",
+        device_name_.c_str(), smc_->ident, smc_->elem_aa.dte_count,
+        smc_->elem_aa.se_count, smc_->elem_aa.iee_count,
+        smc_->elem_aa.mte_count);
+
+  opened_ = true;
+
+  return true;
+}
+
+void ScsiChanger::Close()
+{
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  opened_ = false;
+  Invalidate();
+}
+
+/**
+ * Slots are numbered from 1, the import/export elements follow the storage
+ * elements like they do in the mtx-changer script.
+ */
+int ScsiChanger::SlotToAddress(slot_number_t slot) const
+{
+  const struct smc_element_address_assignment& aa = smc_->elem_aa;
+
+  if (slot >= 1 && slot <= (int)aa.se_count) { return aa.se_addr + slot - 1; }
+  if (slot > (int)aa.se_count && slot <= (int)(aa.se_count + aa.iee_count)) {
+    return aa.iee_addr + slot - aa.se_count - 1;
+  }
+
+  return -1;
+}
+
+slot_number_t ScsiChanger::AddressToSlot(uint16_t address) const
+{
+  const struct smc_element_address_assignment& aa = smc_->elem_aa;
+
+  if (address >= aa.se_addr && address < aa.se_addr + aa.se_count) {
+    return address - aa.se_addr + 1;
+  }
+  if (address >= aa.iee_addr && address < aa.iee_addr + aa.iee_count) {
+    return address - aa.iee_addr + aa.se_count + 1;
+  }
+
+  return 0;
+}
+
+const ChangerElement* ScsiChanger::FindElement(uint16_t address) const
+{
+  for (const ChangerElement& element : inventory_) {
+    if (element.address == address) { return &element; }
+  }
+
+  return NULL;
+}
+
+/**
+ * Read the status of all elements unless we still have a valid copy.
+ */
+bool ScsiChanger::ReadInventory()
+{
+  if (inventory_valid_) { return true; }
+
+  if (smc_read_elem_status(smc_) != 0) {
+    SetError(_("READ ELEMENT STATUS failed: %s"), smc_->errmsg);
+    Close();
+    return false;
+  }
+
+  inventory_.clear();
+  for (struct smc_element_descriptor* edp = smc_->elem_desc; edp;
+       edp = edp->next) {
+    ChangerElement element;
+
+    element.type = edp->element_type_code;
+    element.address = edp->element_address;
+    element.full = edp->Full;
+
+    switch (element.type) {
+      case SMC_ELEM_TYPE_SE:
+      case SMC_ELEM_TYPE_IEE:
+        element.number = AddressToSlot(edp->element_address);
+        break;
+      case SMC_ELEM_TYPE_DTE:
+        element.number = edp->element_address - smc_->elem_aa.dte_addr;
+        break;
+      default:
+        element.number = edp->element_address - smc_->elem_aa.mte_addr;
+        break;
+    }
+
+    if (edp->Full && edp->SValid) {
+      element.src_slot = AddressToSlot(edp->src_se_addr);
+    }
+
+    if (edp->Full && edp->PVolTag && edp->primary_vol_tag) {
+      const char* id = (const char*)edp->primary_vol_tag->volume_id;
+      size_t len = sizeof(edp->primary_vol_tag->volume_id);
+
+      while (len > 0 && (id[len - 1] == ' ' || id[len - 1] == '\0')) { len--; }
+      element.volume.assign(id, len);
+    }
+
+    inventory_.push_back(element);
+  }
+  smc_cleanup_element_status_data(smc_);
+
+  Dmsg2(debuglevel, "Changer %s: read status of %d elements\n",
+        device_name_.c_str(), (int)inventory_.size());
+  inventory_valid_ = true;
+
+  return true;
+}
+
+/**
+ * Move a medium, whatever the outcome the cached inventory is stale now.
+ */
+bool ScsiChanger::Move(uint16_t from, uint16_t to)
+{
+  int status;
+
+  Dmsg3(debuglevel, "Changer %s: move medium from %d to %d\n",
+        device_name_.c_str(), from, to);
+
+  status = smc_move(smc_, from, to, 0, smc_->elem_aa.mte_addr);
+  Invalidate();
+  if (status != 0) {
+    return SetError(_("MOVE MEDIUM from %d to %d failed: %s"), from, to,
+                    smc_->errmsg);
+  }
+
+  return true;
+}
+
+/**
+ * Returns: -1 on error
+ *          0 if the drive is empty
+ *          the slot the medium in the drive came from otherwise
+ */
+slot_number_t ScsiChanger::GetLoadedSlot(drive_number_t drive)
+{
+  const ChangerElement* element;
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open() || !ReadInventory()) { return -1; }
+
+  if (drive < 0 || drive >= (int)smc_->elem_aa.dte_count) {
+    SetError(_("Drive %hd does not exist"), drive);
+    return -1;
+  }
+
+  if (!(element = FindElement(smc_->elem_aa.dte_addr + drive))) {
+    SetError(_("No status for drive %hd"), drive);
+    return -1;
+  }
+
+  if (!element->full) { return 0; }
+
+  if (!element->src_slot) {
+    SetError(_("Slot of the medium in drive %hd is unknown"), drive);
+    return -1;
+  }
+
+  return element->src_slot;
+}
+
+slot_number_t ScsiChanger::GetNumSlots()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open()) { return -1; }
+
+  return smc_->elem_aa.se_count + smc_->elem_aa.iee_count;
+}
+
+bool ScsiChanger::Load(slot_number_t slot, drive_number_t drive)
+{
+  int from;
+  const ChangerElement* element;
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open() || !ReadInventory()) { return false; }
+
+  if ((from = SlotToAddress(slot)) < 0) {
+    return SetError(_("Slot %hd does not exist"), slot);
+  }
+  if (drive < 0 || drive >= (int)smc_->elem_aa.dte_count) {
+    return SetError(_("Drive %hd does not exist"), drive);
+  }
+
+  element = FindElement(from);
+  if (!element || !element->full) {
+    return SetError(_("Slot %hd is empty"), slot);
+  }
+  element = FindElement(smc_->elem_aa.dte_addr + drive);
+  if (element && element->full) {
+    return SetError(_("Drive %hd is not empty"), drive);
+  }
+
+  return Move(from, smc_->elem_aa.dte_addr + drive);
+}
+
+/**
+ * Put the medium in the drive into the given slot, when no slot is given it
+ * goes back to where it came from.
+ */
+bool ScsiChanger::Unload(slot_number_t slot, drive_number_t drive)
+{
+  int to;
+  const ChangerElement* element;
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open() || !ReadInventory()) { return false; }
+
+  if (drive < 0 || drive >= (int)smc_->elem_aa.dte_count) {
+    return SetError(_("Drive %hd does not exist"), drive);
+  }
+
+  element = FindElement(smc_->elem_aa.dte_addr + drive);
+  if (!element || !element->full) {
+    return SetError(_("Drive %hd is empty"), drive);
+  }
+
+  if (slot <= 0) { slot = element->src_slot; }
+  if ((to = SlotToAddress(slot)) < 0) {
+    return SetError(_("Slot %hd does not exist"), slot);
+  }
+
+  element = FindElement(to);
+  if (element && element->full) {
+    return SetError(_("Slot %hd is not empty"), slot);
+  }
+
+  return Move(smc_->elem_aa.dte_addr + drive, to);
+}
+
+bool ScsiChanger::Transfer(slot_number_t src_slot, slot_number_t dst_slot)
+{
+  int from, to;
+  const ChangerElement* element;
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open() || !ReadInventory()) { return false; }
+
+  if ((from = SlotToAddress(src_slot)) < 0) {
+    return SetError(_("Slot %hd does not exist"), src_slot);
+  }
+  if ((to = SlotToAddress(dst_slot)) < 0) {
+    return SetError(_("Slot %hd does not exist"), dst_slot);
+  }
+
+  element = FindElement(from);
+  if (!element || !element->full) {
+    return SetError(_("Slot %hd is empty"), src_slot);
+  }
+  element = FindElement(to);
+  if (element && element->full) {
+    return SetError(_("Slot %hd is not empty"), dst_slot);
+  }
+
+  return Move(from, to);
+}
+
+/**
+ * Get a copy of the element inventory, with refresh set the changer is
+ * asked again even when the cached inventory is still valid.
+ */
+bool ScsiChanger::GetInventory(std::vector<ChangerElement>& elements,
+                               bool refresh)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  if (!Open()) { return false; }
+  if (refresh) { Invalidate(); }
+  if (!ReadInventory()) { return false; }
+
+  elements = inventory_;
+
+  return true;
+}
+
+static ScsiChanger* GetNativeChanger(const char* device_name)
+{
+  std::lock_guard<std::mutex> guard(changers_mutex);
+
+  auto it = changers.find(device_name);
+  if (it != changers.end()) { return it->second; }
+
+  ScsiChanger* changer = new ScsiChanger(device_name);
+  changers[device_name] = changer;
+
+  return changer;
+}
+
+/**
+ * Format the inventory like the list and listall commands of the
+ * mtx-changer script.
+ */
+static void FormatInventory(const std::vector<ChangerElement>& elements,
+                            bool all,
+                            POOLMEM*& results)
+{
+  PoolMem line(PM_MESSAGE);
+
+  PmStrcpy(results, "");
+  for (const ChangerElement& element : elements) {
+    switch (element.type) {
+      case SMC_ELEM_TYPE_DTE:
+        if (all) {
+          if (element.full) {
+            Mmsg(line, "D:%hd:F:%hd:%s\n", element.number, element.src_slot,
+                 element.volume.c_str());
+          } else {
+            Mmsg(line, "D:%hd:E\n", element.number);
+          }
+        } else if (element.full && element.src_slot) {
+          Mmsg(line, "%hd:%s\n", element.src_slot, element.volume.c_str());
+        } else {
+          continue;
+        }
+        break;
+      case SMC_ELEM_TYPE_SE:
+      case SMC_ELEM_TYPE_IEE:
+        if (all) {
+          char type = (element.type == SMC_ELEM_TYPE_SE) ? 'S' : 'I';
+
+          if (element.full) {
+            Mmsg(line, "%c:%hd:F:%s\n", type, element.number,
+                 element.volume.c_str());
+          } else {
+            Mmsg(line, "%c:%hd:E\n", type, element.number);
+          }
+        } else if (element.full) {
+          Mmsg(line, "%hd:%s\n", element.number, element.volume.c_str());
+        } else {
+          continue;
+        }
+        break;
+      default:
+        continue;
+    }
+    PmStrcat(results, line.c_str());
+  }
+}
+#endif /* HAVE_NDMP */
+
+/**
+ * Run a changer command with the native driver.
+ *
+ * Returns: 0 on success, results holds what the changer script would print
+ *          an errno otherwise, results holds the error message
+ */
+int NativeChangerCommand(DeviceControlRecord* dcr,
+                         const char* cmd,
+                         slot_number_t src_slot,
+                         slot_number_t dst_slot,
+                         POOLMEM*& results)
+{
+#if HAVE_NDMP
+  ScsiChanger* changer;
+  slot_number_t slot;
+  drive_number_t drive = dcr->dev->drive;
+  std::vector<ChangerElement> elements;
+
+  if (!dcr->device->changer_name) {
+    Mmsg(results, _("No Changer Device defined for %s\n"),
+         dcr->dev->print_name());
+    return EINVAL;
+  }
+
+  changer = GetNativeChanger(dcr->device->changer_name);
+  PmStrcpy(results, "");
+
+  if (bstrcmp(cmd, "loaded")) {
+    if ((slot = changer->GetLoadedSlot(drive)) < 0) { goto bail_out; }
+    Mmsg(results, "%hd\n", slot);
+  } else if (bstrcmp(cmd, "load")) {
+    if (!changer->Load(dcr->VolCatInfo.Slot, drive)) { goto bail_out; }
+  } else if (bstrcmp(cmd, "unload")) {
+    if (!changer->Unload(dcr->VolCatInfo.Slot, drive)) { goto bail_out; }
+  } else if (bstrcmp(cmd, "transfer")) {
+    if (!changer->Transfer(src_slot, dst_slot)) { goto bail_out; }
+  } else if (bstrcmp(cmd, "slots")) {
+    if ((slot = changer->GetNumSlots()) < 0) { goto bail_out; }
+    Mmsg(results, "%hd\n", slot);
+  } else if (bstrcmp(cmd, "list") || bstrcmp(cmd, "listall")) {
+    if (!changer->GetInventory(elements, true)) { goto bail_out; }
+    FormatInventory(elements, bstrcmp(cmd, "listall"), results);
+  } else {
+    Mmsg(results, _("Unknown changer command \"%s\"\n"), cmd);
+    return EINVAL;
+  }
+
+  return 0;
+
+bail_out:
+  Mmsg(results, "%s: %s\n", changer->name(), changer->errmsg());
+  return EIO;
+#else
+  Mmsg(results, _("Native changer support is not available.\n"));
+  return ENOSYS;
+#endif
+}
+
+/**
+ * Release all native changers.
+ */
+void FreeNativeChangers()
+{
+#if HAVE_NDMP
+  std::lock_guard<std::mutex> guard(changers_mutex);
+
+  for (auto& changer : changers) { delete changer.second; }
+  changers.clear();
+#endif
+}
+
+} /* namespace storagedaemon  */
@@ -0,0 +1,123 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Native SCSI media changer driver.
+ */
+
+#ifndef BAREOS_STORED_SCSI_CHANGER_H_
+#define BAREOS_STORED_SCSI_CHANGER_H_ 1
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct smc_ctrl_block;
+struct smc_scsi_req;
+
+namespace storagedaemon {
+
+class DeviceControlRecord;
+class DeviceResource;
+
+/**
+ * Keyword used as Changer Command to select the native changer driver.
+ */
+#define NATIVE_CHANGER_COMMAND "native"
+
+/**
+ * One element of the changer as reported by READ ELEMENT STATUS.
+ */
+struct ChangerElement {
+  unsigned char type = 0;   /* SMC_ELEM_TYPE_* */
+  uint16_t address = 0;     /* element address */
+  slot_number_t number = 0; /* Bareos slot or drive number */
+  bool full = false;
+  slot_number_t src_slot = 0; /* slot the media came from, 0 if unknown */
+  std::string volume;         /* primary volume tag (barcode) */
+};
+
+/**
+ * Transport used to send a SCSI request to the changer, returns false when
+ * the request could not be delivered at all.
+ */
+using ScsiTransport = std::function<bool(struct smc_scsi_req* sr)>;
+
+/**
+ * A SCSI media changer driven through the SMC routines of the NDMP library.
+ *
+ * The element inventory is read once and kept until a medium is moved or a
+ * refresh is asked for, so queries for the loaded slot do not need to talk
+ * to the changer.
+ */
+class ScsiChanger {
+ public:
+  explicit ScsiChanger(const char* device_name);
+  ScsiChanger(const char* device_name, ScsiTransport transport);
+  ~ScsiChanger();
+
+  slot_number_t GetLoadedSlot(drive_number_t drive);
+  slot_number_t GetNumSlots();
+  bool Load(slot_number_t slot, drive_number_t drive);
+  bool Unload(slot_number_t slot, drive_number_t drive);
+  bool Transfer(slot_number_t src_slot, slot_number_t dst_slot);
+  bool GetInventory(std::vector<ChangerElement>& elements, bool refresh);
+
+  const char* name() const { return device_name_.c_str(); }
+  const char* errmsg() const { return errmsg_.c_str(); }
+
+ private:
+  bool Open();
+  void Close();
+  bool ReadInventory();
+  bool Move(uint16_t from, uint16_t to);
+  int SlotToAddress(slot_number_t slot) const;
+  slot_number_t AddressToSlot(uint16_t address) const;
+  const ChangerElement* FindElement(uint16_t address) const;
+  void Invalidate() { inventory_valid_ = false; }
+  bool SetError(const char* fmt, ...);
+  bool SendScsiRequest(struct smc_scsi_req* sr);
+  static int IssueScsiRequest(struct smc_ctrl_block* smc);
+
+  std::string device_name_;
+  ScsiTransport transport_;
+  bool use_device_ = false; /* talk to device_name_ through SG_IO */
+  int fd_ = -1;
+  bool opened_ = false;
+  bool inventory_valid_ = false;
+  struct smc_ctrl_block* smc_ = nullptr;
+  std::vector<ChangerElement> inventory_;
+  std::string errmsg_;
+  std::mutex mutex_;
+};
+
+bool IsNativeChanger(DeviceResource* device);
+int NativeChangerCommand(DeviceControlRecord* dcr,
+                         const char* cmd,
+                         slot_number_t src_slot,
+                         slot_number_t dst_slot,
+                         POOLMEM*& results);
+void FreeNativeChangers();
+
+} /* namespace storagedaemon  */
+
+#endif /* BAREOS_STORED_SCSI_CHANGER_H_ */
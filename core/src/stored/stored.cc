@@ -43,6 +43,7 @@
 #include "stored/job.h"
 #include "stored/label.h"
 #include "stored/ndmp_tape.h"
+#include "stored/scsi_changer.h"
 #include "stored/sd_backends.h"
 #include "stored/sd_stats.h"
 #include "stored/socket_server.h"
@@ -682,6 +683,7 @@ static
   UnloadSdPlugins();
   FlushCryptoCache();
   FreeVolumeLists();
+  FreeNativeChangers();
 
   foreach_res (device, R_DEVICE) {
     Dmsg1(10, "Term device %s\n", device->device_name);
@@ -113,6 +113,8 @@ static ResourceItem store_items[] = {
   {"SecureEraseCommand", CFG_TYPE_STR, ITEM(res_store.secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
       "Specify command that will be called when bareos unlinks files."},
   {"LogTimestampFormat", CFG_TYPE_STR, ITEM(res_store.log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL},
+  {"TlsKernelOffload", CFG_TYPE_BOOL, ITEM(res_store.enable_ktls_), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+      "Let the kernel encrypt and decrypt TLS connections (kTLS) when OpenSSL and the kernel support it."},
     TLS_COMMON_CONFIG(res_store),
     TLS_CERT_CONFIG(res_store),
   {NULL, 0, {0}, 0, 0, NULL, NULL, NULL}};
@@ -220,6 +222,34 @@ static ResourceItem dev_items[] = {
   {"EofOnErrorIsEot", CFG_TYPE_BOOL, ITEM(res_dev.eof_on_error_is_eot), 0, CFG_ITEM_DEFAULT, NULL, "18.2.4-",
       "If Yes, Bareos will treat any read error at an end-of-file mark as end-of-tape. You should only set "
       "this option if your tape-drive fails to detect end-of-tape while reading."},
+  {"ReadAheadVolumes", CFG_TYPE_PINT32, ITEM(res_dev.read_ahead_volumes), 0, CFG_ITEM_DEFAULT, "0", "19.2.0-",
+      "Number of upcoming volumes of a multi-volume read (e.g. a consolidation) that are read ahead concurrently. "
+      "Only used for file devices. 0 disables the read ahead."},
+  {"ReadAheadSize", CFG_TYPE_SIZE64, ITEM(res_dev.read_ahead_size), 0, CFG_ITEM_DEFAULT, "1073741824", "19.2.0-",
+      "Maximum amount of data read ahead of the current read position when Read Ahead Volumes is used. "
+      "The data beyond this limit is read ahead when the read device gets closer to it."},
+  {"DirectIo", CFG_TYPE_BOOL, ITEM(res_dev.direct_io), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+      "Keep the data written to file volumes out of the page cache. Blocks aligned to 4096 bytes (use a fixed "
+      "block size that is a multiple of 4096) are written with O_DIRECT, other data is dropped from the page "
+      "cache after it has been written."},
+  {"OutstandingWrites", CFG_TYPE_PINT32, ITEM(res_dev.outstanding_writes), 0, CFG_ITEM_DEFAULT, "0", "19.2.0-",
+      "Number of block writes to a file volume that can be queued to a background writer thread of the device. "
+      "0 writes each block synchronously."},
+  {"PreallocationSize", CFG_TYPE_SIZE64, ITEM(res_dev.preallocation_size), 0, CFG_ITEM_DEFAULT, "0", "19.2.0-",
+      "Preallocate file volumes in steps of this size ahead of the write position to reduce fragmentation. "
+      "Unused space is released when the volume is closed. 0 disables the preallocation."},
+  {"VolumeIndex", CFG_TYPE_BOOL, ITEM(res_dev.volume_index), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+      "Keep an index of the blocks in which the files of each job start next to every file volume "
+      "(<volume>.idx). Restores of single files then position directly to the file instead of reading from "
+      "the start of the job. bls -x and bscan -x rebuild the index of a volume."},
+  {"SharedRead", CFG_TYPE_BOOL, ITEM(res_dev.shared_read), 0, CFG_ITEM_DEFAULT, "false", "19.2.0-",
+      "Let several jobs read from this file device (Device Type = File) at the same time, e.g. parallel restores. Every "
+      "additional reader gets its own instance of the device with its own file descriptor and position. "
+      "Requires File Device Concurrent Read in the Storage resource to read the same volume concurrently."},
+  {"LargeBlockSize", CFG_TYPE_SIZE32, ITEM(res_dev.large_block_size), 0, CFG_ITEM_DEFAULT, "0", "19.2.0-",
+      "Write tape volumes in blocks of this size (e.g. 1 MB to 4 MB for LTO drives) instead of Maximum Block "
+      "Size, unless the pool sets a block size for the volume. The size is limited to the maximum block length "
+      "the drive reports. Volumes written with any block size can still be read. 0 disables it."},
   {NULL, 0, {0}, 0, 0, NULL, NULL, NULL}};
 
 /**
@@ -158,6 +158,10 @@ class DeviceResource : public BareosResource {
   bool query_crypto_status;     /**< Query device for crypto status */
   bool collectstats;            /**< Set if statistics should be collected */
   bool eof_on_error_is_eot;     /**< Interpret EOF during read error as EOT */
+  bool direct_io;               /**< Bypass the page cache for file volumes */
+  bool volume_index;            /**< Keep a record index of file volumes */
+  bool shared_read;             /**< Concurrent readers get a device clone */
+  uint32_t large_block_size;    /**< Block size for writing to tape */
   drive_number_t drive;         /**< Autochanger logical drive number */
   drive_number_t drive_index;   /**< Autochanger physical drive index */
   char cap_bits[CAP_BYTES];     /**< Capabilities of this device */
@@ -171,6 +175,11 @@ class DeviceResource : public BareosResource {
   uint32_t max_volume_jobs;     /**< Max jobs to put on one volume */
   uint32_t max_network_buffer_size; /**< Max network buf size */
   uint32_t max_concurrent_jobs;     /**< Maximum concurrent jobs this drive */
+  uint32_t read_ahead_volumes;      /**< Number of upcoming read volumes to
+                                       prefetch concurrently */
+  uint64_t read_ahead_size;         /**< Max bytes read ahead of the read
+                                       position */
+  uint32_t outstanding_writes;      /**< Max queued writes to file volumes */
   uint32_t autodeflate_algorithm;   /**< Compression algorithm to use for
                                        compression */
   uint16_t autodeflate_level; /**< Compression level to use for compression
@@ -185,6 +194,7 @@ class DeviceResource : public BareosResource {
   int64_t volume_capacity;  /**< Advisory capacity */
   int64_t max_spool_size;   /**< Max spool size for all jobs */
   int64_t max_job_spool_size; /**< Max spool size for any single job */
+  int64_t preallocation_size; /**< Preallocation step of file volumes */
 
   int64_t max_part_size;    /**< Max part size */
   char* mount_point;        /**< Mount point for require mount devices */
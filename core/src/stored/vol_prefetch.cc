@@ -0,0 +1,399 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Read ahead of the upcoming volumes of a multi volume read session.
+ *
+ * A consolidation or copy job reads all its volumes one after the other
+ * through a single read device. For file devices we start a number of
+ * worker threads that each read the data of one of the next volumes
+ * (limited to the address ranges selected by the bootstrap) so the
+ * volumes are fetched from disk concurrently and the read device finds
+ * the data in the page cache when it gets there.
+ *
+ * The amount of data read ahead but not yet consumed by the read device is
+ * limited by the Read Ahead Size of the device, so the prefetched data is
+ * not evicted from the page cache again before it gets used.
+ *
+ * The workers do not look at the read position of the jcr or the read
+ * device, the read thread publishes the volume and address it is at
+ * through UpdateVolumePrefetch().
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/bsr.h"
+#include "stored/vol_prefetch.h"
+#include "lib/edit.h"
+#include "include/jcr.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace storagedaemon {
+
+static const int debuglevel = 150;
+
+/* Amount of data read with one read() call */
+static const size_t prefetch_chunk_size = 1024 * 1024;
+
+struct PrefetchRange {
+  uint64_t start;
+  uint64_t end; /* inclusive, UINT64_MAX means up to the end of the volume */
+};
+
+struct PrefetchVolume {
+  std::string path;
+  std::vector<PrefetchRange> ranges;
+  std::vector<PrefetchRange> done; /* what is read ahead, protected by mutex */
+};
+
+class VolumePrefetchContext {
+ public:
+  JobControlRecord* jcr = nullptr;
+  std::vector<PrefetchVolume> volumes; /* in the order of jcr->VolList */
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  size_t next_volume = 0;
+  uint32_t window = 0;
+  uint64_t budget = 0; /* max bytes read ahead of the read position */
+  std::atomic<uint32_t> read_volume{0}; /* 1 based, jcr->CurReadVolume */
+  std::atomic<uint64_t> read_address{0}; /* dev->file_addr */
+  std::atomic<bool> quit{false};
+  uint64_t bytes_read = 0;
+  uint32_t volumes_read = 0;
+};
+
+/**
+ * Collect the address ranges the bootstrap wants from the given volume.
+ * When any bootstrap entry of the volume has no address range we read all
+ * of it.
+ */
+static void GetVolumeRanges(BootStrapRecord* root,
+                            const char* VolumeName,
+                            PrefetchVolume& pv)
+{
+  bool whole = false;
+
+  for (BootStrapRecord* bsr = root; bsr; bsr = bsr->next) {
+    bool match = false;
+
+    for (BsrVolume* vol = bsr->volume; vol; vol = vol->next) {
+      if (bstrcmp(vol->VolumeName, VolumeName)) {
+        match = true;
+        break;
+      }
+    }
+    if (!match) { continue; }
+
+    if (!bsr->voladdr) {
+      whole = true;
+      break;
+    }
+
+    for (BsrVolumeAddress* va = bsr->voladdr; va; va = va->next) {
+      pv.ranges.push_back(PrefetchRange{va->saddr, va->eaddr});
+    }
+  }
+
+  if (whole || pv.ranges.empty()) {
+    pv.ranges.clear();
+    pv.ranges.push_back(PrefetchRange{0, UINT64_MAX});
+  }
+}
+
+/**
+ * Number of bytes read ahead that the read device did not get to yet.
+ * Everything of the volumes after the one currently read counts, of the
+ * current volume only what lies beyond the current read address.
+ * Must be called with ctx->mutex held.
+ */
+static uint64_t BytesAhead(VolumePrefetchContext* ctx)
+{
+  uint64_t ahead = 0;
+  uint32_t read_volume = ctx->read_volume.load(std::memory_order_acquire);
+  size_t current = read_volume ? read_volume - 1 : 0;
+  uint64_t position = ctx->read_address.load(std::memory_order_relaxed);
+
+  for (size_t i = current; i < ctx->volumes.size(); i++) {
+    for (const PrefetchRange& range : ctx->volumes[i].done) {
+      if (i > current) {
+        ahead += range.end - range.start + 1;
+      } else if (range.end >= position) {
+        ahead += range.end - MAX(range.start, position) + 1;
+      }
+    }
+  }
+
+  return ahead;
+}
+
+/**
+ * Wait until reading another len bytes stays within the read ahead budget.
+ * When nothing is read ahead at all we always go on, so a budget smaller
+ * than one chunk cannot stall the workers.
+ *
+ * Returns: true if the bytes may be read
+ *          false if the prefetch is stopped
+ */
+static bool WaitForBudget(VolumePrefetchContext* ctx, size_t len)
+{
+  std::unique_lock<std::mutex> lock(ctx->mutex);
+
+  while (!ctx->quit && !JobCanceled(ctx->jcr)) {
+    uint64_t ahead = BytesAhead(ctx);
+
+    if (ahead == 0 || ahead + len <= ctx->budget) { return true; }
+    ctx->wakeup.wait_for(lock, std::chrono::seconds(1));
+  }
+
+  return false;
+}
+
+/**
+ * Remember that a part of a volume is read ahead, merging it with the
+ * previous part when they are adjacent.
+ */
+static void AddDoneRange(VolumePrefetchContext* ctx,
+                         PrefetchVolume& pv,
+                         uint64_t offset,
+                         uint64_t len)
+{
+  std::lock_guard<std::mutex> guard(ctx->mutex);
+
+  if (!pv.done.empty() && pv.done.back().end + 1 == offset) {
+    pv.done.back().end += len;
+  } else {
+    pv.done.push_back(PrefetchRange{offset, offset + len - 1});
+  }
+}
+
+/**
+ * Read the wanted ranges of one volume, the data itself is thrown away.
+ */
+static void PrefetchOneVolume(VolumePrefetchContext* ctx,
+                              PrefetchVolume& pv,
+                              POOLMEM* buf)
+{
+  int fd;
+  uint64_t total = 0;
+  char ed1[50];
+
+  if (pv.path.empty()) { return; }
+
+  if ((fd = open(pv.path.c_str(), O_RDONLY)) < 0) {
+    BErrNo be;
+
+    Dmsg2(debuglevel, "Prefetch cannot open %s: ERR=%s\n", pv.path.c_str(),
+          be.bstrerror());
+    return;
+  }
+
+  Dmsg1(debuglevel, "Prefetch of %s started\n", pv.path.c_str());
+  for (const PrefetchRange& range : pv.ranges) {
+    uint64_t offset = range.start;
+
+    while (offset <= range.end) {
+      ssize_t status;
+      size_t len = prefetch_chunk_size;
+
+      if (ctx->quit || JobCanceled(ctx->jcr)) { goto bail_out; }
+
+      if (range.end != UINT64_MAX && range.end - offset + 1 < len) {
+        len = range.end - offset + 1;
+      }
+
+      if (!WaitForBudget(ctx, len)) { goto bail_out; }
+
+      status = pread(fd, buf, len, offset);
+      if (status <= 0) { break; }
+
+      AddDoneRange(ctx, pv, offset, status);
+
+      offset += status;
+      total += status;
+    }
+  }
+
+bail_out:
+  close(fd);
+
+  Dmsg2(debuglevel, "Prefetch of %s done, %s bytes\n", pv.path.c_str(),
+        edit_uint64(total, ed1));
+  std::lock_guard<std::mutex> guard(ctx->mutex);
+  ctx->bytes_read += total;
+  ctx->volumes_read++;
+}
+
+/**
+ * Worker thread, picks the next volume that lies inside the read ahead window
+ * of the volume currently being read by the read device.
+ */
+static void PrefetchWorker(VolumePrefetchContext* ctx)
+{
+  POOLMEM* buf = GetMemory(prefetch_chunk_size);
+
+  while (1) {
+    size_t index;
+
+    {
+      std::unique_lock<std::mutex> lock(ctx->mutex);
+
+      while (!ctx->quit && ctx->next_volume < ctx->volumes.size()) {
+        /*
+         * CurReadVolume is the 1 based number of the volume being read,
+         * so it is also the index of the first volume to prefetch.
+         */
+        size_t current = ctx->read_volume.load(std::memory_order_acquire);
+
+        if (ctx->next_volume < current) { ctx->next_volume = current; }
+        if (ctx->next_volume >= ctx->volumes.size() ||
+            ctx->next_volume < current + ctx->window) {
+          break;
+        }
+        ctx->wakeup.wait_for(lock, std::chrono::seconds(1));
+      }
+
+      if (ctx->quit || ctx->next_volume >= ctx->volumes.size()) { break; }
+
+      index = ctx->next_volume++;
+    }
+
+    PrefetchOneVolume(ctx, ctx->volumes[index], buf);
+  }
+
+  FreeMemory(buf);
+}
+
+/**
+ * Start reading ahead the volumes the job will need after the current one.
+ *
+ * Returns: true if prefetch workers were started
+ *          false if read ahead is not used for this job
+ */
+bool StartVolumePrefetch(DeviceControlRecord* dcr)
+{
+  JobControlRecord* jcr = dcr->jcr;
+  Device* dev = dcr->dev;
+  DeviceResource* device = dev->device;
+  VolumePrefetchContext* ctx;
+  uint32_t num_workers;
+  char ed1[50];
+
+  if (jcr->prefetch_ctx || !device->read_ahead_volumes ||
+      jcr->NumReadVolumes < 2 || dev->dev_type != B_FILE_DEV) {
+    return false;
+  }
+
+  /*
+   * With a virtual autochanger the archive device is not the volume directory.
+   */
+  if (device->changer_res && device->changer_command &&
+      device->changer_command[0]) {
+    return false;
+  }
+
+  ctx = new VolumePrefetchContext;
+  ctx->jcr = jcr;
+  ctx->window = device->read_ahead_volumes;
+  ctx->budget = device->read_ahead_size;
+  ctx->read_address = dev->file_addr;
+  ctx->read_volume = jcr->CurReadVolume;
+
+  for (VolumeList* vol = jcr->VolList; vol; vol = vol->next) {
+    PrefetchVolume pv;
+
+    /*
+     * Only volumes on the same kind of media share our archive directory.
+     * Keep a placeholder so the index still matches the VolList order.
+     */
+    if (bstrcmp(vol->MediaType, device->media_type)) {
+      pv.path.assign(dev->archive_name());
+      if (!pv.path.empty() && !IsPathSeparator(pv.path.back())) {
+        pv.path.push_back('/');
+      }
+      pv.path.append(vol->VolumeName);
+      GetVolumeRanges(jcr->bsr, vol->VolumeName, pv);
+    }
+    ctx->volumes.push_back(pv);
+  }
+
+  num_workers = MIN(ctx->window, (uint32_t)ctx->volumes.size() - 1);
+  for (uint32_t i = 0; i < num_workers; i++) {
+    ctx->workers.emplace_back(PrefetchWorker, ctx);
+  }
+  jcr->prefetch_ctx = ctx;
+
+  Jmsg(jcr, M_INFO, 0,
+       _("Reading ahead up to %d of %d volumes (max %s bytes) on device "
+         "%s.\n"),
+       num_workers, jcr->NumReadVolumes,
+       edit_uint64_with_commas(ctx->budget, ed1), dev->print_name());
+
+  return true;
+}
+
+/**
+ * Publish the volume and the address the read device is at to the prefetch
+ * workers. Called by the read thread for every record it reads.
+ */
+void UpdateVolumePrefetch(DeviceControlRecord* dcr)
+{
+  VolumePrefetchContext* ctx = dcr->jcr->prefetch_ctx;
+  uint32_t volume;
+
+  if (!ctx) { return; }
+
+  volume = dcr->jcr->CurReadVolume;
+  ctx->read_address.store(dcr->dev->file_addr, std::memory_order_relaxed);
+  if (ctx->read_volume.exchange(volume, std::memory_order_release) != volume) {
+    ctx->wakeup.notify_all();
+  }
+}
+
+/**
+ * Stop all prefetch workers of a job and report what they did.
+ */
+void StopVolumePrefetch(JobControlRecord* jcr)
+{
+  VolumePrefetchContext* ctx = jcr->prefetch_ctx;
+  char ed1[50];
+
+  if (!ctx) { return; }
+
+  ctx->quit = true;
+  ctx->wakeup.notify_all();
+
+  for (std::thread& worker : ctx->workers) { worker.join(); }
+
+  Jmsg(jcr, M_INFO, 0, _("Read ahead %s bytes from %d volumes.\n"),
+       edit_uint64_with_commas(ctx->bytes_read, ed1), ctx->volumes_read);
+
+  jcr->prefetch_ctx = nullptr;
+  delete ctx;
+}
+
+} /* namespace storagedaemon */
@@ -0,0 +1,515 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Record index of file volumes.
+ *
+ * The index file starts with a header identifying the volume label it belongs
+ * to, followed by fixed size entries (session id, session time, LastIndex,
+ * block address) in the order the blocks were written.
+ *
+ * An entry is added for the first block of a session on the volume and for
+ * every block whose LastIndex is higher than that of the previous block of
+ * the session, i.e. for every block in which a file starts. The block in
+ * which file F starts is therefore the first entry of its session with a
+ * LastIndex >= F.
+ *
+ * The index is only a hint: sessions or files it does not know about are
+ * positioned to with the JobMedia addresses as before.
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/bsr.h"
+#include "stored/volume_index.h"
+
+#include <algorithm>
+
+namespace storagedaemon {
+
+static const int debuglevel = 150;
+
+static const char index_magic[] = "BVIX";
+static const uint32_t index_version = 1;
+
+/* magic, version, label time, volume name */
+static const uint32_t index_header_length = 4 + 4 + 8 + MAX_NAME_LENGTH;
+
+/* VolSessionId, VolSessionTime, LastIndex, address */
+static const uint32_t index_entry_length = 4 + 4 + 4 + 8;
+
+/* Serialized entries kept in memory before they are written */
+static const size_t index_flush_size = 64 * 1024;
+
+/* Set by bls and bscan to recreate the index of the volumes they read */
+static bool rebuild_volume_index = false;
+
+VolumeIndex::VolumeIndex(const char* path,
+                         const char* VolumeName,
+                         btime_t label_btime)
+    : path_(path), VolumeName_(VolumeName), label_btime_(label_btime)
+{
+}
+
+VolumeIndex::~VolumeIndex()
+{
+  FlushLocked();
+  if (fd_ >= 0) { close(fd_); }
+}
+
+/**
+ * Read and check the header of the index file.
+ *
+ * Returns: false if the index does not belong to our volume label.
+ */
+static bool ReadIndexHeader(int fd,
+                            const std::string& VolumeName,
+                            btime_t label_btime)
+{
+  unser_declare;
+  uint8_t header[index_header_length];
+  char magic[4];
+  uint32_t version;
+  uint64_t btime;
+  char name[MAX_NAME_LENGTH];
+
+  if (read(fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+    return false;
+  }
+
+  UnserBegin(header, index_header_length);
+  UnserBytes(magic, sizeof(magic));
+  unser_uint32(version);
+  unser_uint64(btime);
+  UnserBytes(name, sizeof(name));
+  name[MAX_NAME_LENGTH - 1] = 0;
+
+  return memcmp(magic, index_magic, sizeof(magic)) == 0 &&
+         version == index_version && (btime_t)btime == label_btime &&
+         bstrcmp(name, VolumeName.c_str());
+}
+
+/**
+ * Read all entries of the index file.
+ */
+bool VolumeIndex::Load()
+{
+  int fd;
+  struct stat st;
+  uint64_t entries;
+  std::vector<uint8_t> buf(index_flush_size);
+
+  if ((fd = open(path_.c_str(), O_RDONLY | O_BINARY)) < 0) {
+    Dmsg1(debuglevel, "No volume index %s\n", path_.c_str());
+    return false;
+  }
+
+  if (fstat(fd, &st) != 0 || !ReadIndexHeader(fd, VolumeName_, label_btime_)) {
+    Dmsg1(debuglevel, "Volume index %s is not for this volume\n",
+          path_.c_str());
+    close(fd);
+    return false;
+  }
+
+  entries = (st.st_size - index_header_length) / index_entry_length;
+  buf.resize(index_flush_size - index_flush_size % index_entry_length);
+  sessions_.clear();
+
+  for (uint64_t done = 0; done < entries;) {
+    unser_declare;
+    size_t count = std::min<uint64_t>(entries - done,
+                                      buf.size() / index_entry_length);
+    size_t len = count * index_entry_length;
+
+    if (read(fd, buf.data(), len) != (ssize_t)len) {
+      entries = done;
+      break;
+    }
+
+    UnserBegin(buf.data(), len);
+    for (size_t i = 0; i < count; i++) {
+      uint32_t VolSessionId, VolSessionTime;
+      VolumeIndexEntry entry;
+
+      unser_uint32(VolSessionId);
+      unser_uint32(VolSessionTime);
+      unser_int32(entry.LastIndex);
+      unser_uint64(entry.addr);
+
+      std::vector<VolumeIndexEntry>& session =
+          sessions_[SessionKey(VolSessionTime, VolSessionId)];
+      if (session.empty() || (session.back().addr < entry.addr &&
+                              session.back().LastIndex < entry.LastIndex)) {
+        session.push_back(entry);
+      }
+    }
+    done += count;
+  }
+  close(fd);
+
+  valid_size_ = index_header_length + entries * index_entry_length;
+  loaded_ = true;
+  Dmsg3(debuglevel, "Loaded volume index %s with %llu entries of %d sessions\n",
+        path_.c_str(), entries, (int)sessions_.size());
+
+  return true;
+}
+
+/**
+ * Start a new index file for the volume.
+ */
+bool VolumeIndex::Create()
+{
+  ser_declare;
+  uint8_t header[index_header_length];
+  char name[MAX_NAME_LENGTH];
+
+  if ((fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY,
+                  0640)) < 0) {
+    return false;
+  }
+
+  memset(name, 0, sizeof(name));
+  bstrncpy(name, VolumeName_.c_str(), sizeof(name));
+
+  SerBegin(header, index_header_length);
+  SerBytes(index_magic, 4);
+  ser_uint32(index_version);
+  ser_uint64((uint64_t)label_btime_);
+  SerBytes(name, sizeof(name));
+
+  if (write(fd_, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  sessions_.clear();
+  loaded_ = true;
+  valid_size_ = index_header_length;
+
+  return true;
+}
+
+/**
+ * Open the index for lookups or for adding the blocks written to or read
+ * from the volume.
+ *
+ * Returns: false if the index cannot be used.
+ */
+bool VolumeIndex::Open(OpenMode mode)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  switch (mode) {
+    case OpenMode::kRead:
+      if (loaded_) { return true; }
+      if (load_failed_) { return false; }
+      if (!Load()) { load_failed_ = true; }
+      return loaded_;
+    case OpenMode::kAppend:
+      if (fd_ >= 0) { return true; }
+      if (write_failed_) { return false; }
+      if (loaded_ || Load()) {
+        /*
+         * Drop a torn entry at the end of the index before adding to it.
+         */
+        if ((fd_ = open(path_.c_str(), O_WRONLY | O_APPEND | O_BINARY)) >= 0 &&
+            ftruncate(fd_, valid_size_) == 0) {
+          Dmsg1(debuglevel, "Appending to volume index %s\n", path_.c_str());
+          return true;
+        }
+        if (fd_ >= 0) {
+          close(fd_);
+          fd_ = -1;
+        }
+      }
+      break;
+    case OpenMode::kRebuild:
+      if (fd_ >= 0) { return true; }
+      if (write_failed_) { return false; }
+      break;
+  }
+
+  if (!Create()) {
+    BErrNo be;
+
+    write_failed_ = true;
+    Emsg2(M_WARNING, 0, _("Cannot create volume index %s: ERR=%s\n"),
+          path_.c_str(), be.bstrerror());
+    return false;
+  }
+  Dmsg1(debuglevel, "Created volume index %s\n", path_.c_str());
+
+  return true;
+}
+
+/**
+ * Add a block to the index if a file starts in it.
+ */
+void VolumeIndex::AddBlock(uint32_t VolSessionId,
+                           uint32_t VolSessionTime,
+                           int32_t LastIndex,
+                           uint64_t addr)
+{
+  ser_declare;
+  size_t offset;
+
+  if (LastIndex <= 0) { return; }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (fd_ < 0) { return; }
+
+  std::vector<VolumeIndexEntry>& session =
+      sessions_[SessionKey(VolSessionTime, VolSessionId)];
+  if (!session.empty() &&
+      (session.back().addr >= addr || session.back().LastIndex >= LastIndex)) {
+    return;
+  }
+  session.push_back(VolumeIndexEntry{LastIndex, addr});
+
+  offset = pending_.size();
+  pending_.resize(offset + index_entry_length);
+  SerBegin(pending_.data() + offset, index_entry_length);
+  ser_uint32(VolSessionId);
+  ser_uint32(VolSessionTime);
+  ser_int32(LastIndex);
+  ser_uint64(addr);
+
+  if (pending_.size() >= index_flush_size) { FlushLocked(); }
+}
+
+bool VolumeIndex::FlushLocked()
+{
+  if (pending_.empty()) { return true; }
+
+  if (fd_ >= 0 && write(fd_, pending_.data(), pending_.size()) ==
+                      (ssize_t)pending_.size()) {
+    valid_size_ += pending_.size();
+    pending_.clear();
+    return true;
+  }
+
+  if (fd_ >= 0) {
+    BErrNo be;
+
+    Emsg2(M_WARNING, 0, _("Cannot write volume index %s: ERR=%s\n"),
+          path_.c_str(), be.bstrerror());
+    close(fd_);
+    fd_ = -1;
+  }
+  write_failed_ = true;
+  pending_.clear();
+
+  return false;
+}
+
+/**
+ * Write the entries kept in memory to the index file.
+ */
+bool VolumeIndex::Flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return FlushLocked();
+}
+
+/**
+ * Get the address of the block in which a file of a session starts.
+ *
+ * Returns: 0 if the index does not know about the file.
+ */
+uint64_t VolumeIndex::Lookup(uint32_t VolSessionId,
+                             uint32_t VolSessionTime,
+                             int32_t FileIndex)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = sessions_.find(SessionKey(VolSessionTime, VolSessionId));
+  if (it == sessions_.end()) { return 0; }
+
+  auto entry = std::lower_bound(
+      it->second.begin(), it->second.end(), FileIndex,
+      [](const VolumeIndexEntry& entry, int32_t FileIndex) {
+        return entry.LastIndex < FileIndex;
+      });
+  if (entry == it->second.end()) { return 0; }
+
+  return entry->addr;
+}
+
+/**
+ * The index is kept for file volumes of devices with Volume Index enabled.
+ */
+bool VolumeIndexEnabled(Device* dev)
+{
+  return dev->device && dev->device->volume_index && dev->IsFile();
+}
+
+void SetVolumeIndexRebuild(bool rebuild) { rebuild_volume_index = rebuild; }
+
+/**
+ * Get the index of the volume currently mounted in the device.
+ */
+static VolumeIndex* GetVolumeIndex(Device* dev)
+{
+  if (dev->vol_index &&
+      (!bstrcmp(dev->vol_index->VolumeName(), dev->VolHdr.VolumeName) ||
+       dev->vol_index->label_btime() != dev->VolHdr.label_btime)) {
+    CloseVolumeIndex(dev);
+  }
+
+  if (!dev->vol_index) {
+    PoolMem path(PM_FNAME);
+
+    PmStrcpy(path, dev->archive_name());
+    if (!IsPathSeparator(path.c_str()[strlen(path.c_str()) - 1])) {
+      PmStrcat(path, "/");
+    }
+    PmStrcat(path, dev->VolHdr.VolumeName);
+    PmStrcat(path, VOLUME_INDEX_SUFFIX);
+
+    dev->vol_index = new VolumeIndex(path.c_str(), dev->VolHdr.VolumeName,
+                                     dev->VolHdr.label_btime);
+  }
+
+  return dev->vol_index;
+}
+
+/**
+ * Called after a block was written to the volume at addr.
+ */
+void IndexWrittenBlock(DeviceControlRecord* dcr,
+                       DeviceBlock* block,
+                       uint64_t addr)
+{
+  Device* dev = dcr->dev;
+  VolumeIndex* index;
+
+  if (!VolumeIndexEnabled(dev)) { return; }
+
+  /*
+   * A label at the start means the volume was (re)labeled and an existing
+   * index belongs to its previous contents.
+   */
+  if (addr == 0) {
+    CloseVolumeIndex(dev);
+    return;
+  }
+  if (block->LastIndex <= 0) { return; }
+
+  index = GetVolumeIndex(dev);
+  if (!index->Open(VolumeIndex::OpenMode::kAppend)) { return; }
+  index->AddBlock(block->VolSessionId, block->VolSessionTime,
+                  block->LastIndex, addr);
+}
+
+/**
+ * Called after a block was read from the volume at addr, when the index is
+ * being rebuilt its records are scanned for the highest FileIndex.
+ */
+void IndexReadBlock(DeviceControlRecord* dcr, uint64_t addr)
+{
+  Device* dev = dcr->dev;
+  DeviceBlock* block = dcr->block;
+  VolumeIndex* index;
+  int32_t LastIndex = 0;
+  char* p;
+  char* end;
+
+  if (!rebuild_volume_index || !dev->IsFile() || block->BlockVer < 2) {
+    return;
+  }
+
+  if (addr == 0) {
+    CloseVolumeIndex(dev);
+    return;
+  }
+
+  p = block->buf + BLKHDR2_LENGTH;
+  end = block->buf + MIN(block->block_len, block->read_len);
+  while (p + RECHDR2_LENGTH <= end) {
+    unser_declare;
+    int32_t FileIndex;
+    uint32_t data_len;
+
+    UnserBegin(p, RECHDR2_LENGTH);
+    unser_int32(FileIndex);
+    ser_ptr += sizeof(int32_t); /* Stream */
+    unser_uint32(data_len);
+    if (FileIndex > 0) { LastIndex = FileIndex; }
+    p += RECHDR2_LENGTH + data_len;
+  }
+
+  if (LastIndex <= 0) { return; }
+
+  index = GetVolumeIndex(dev);
+  if (!index->Open(VolumeIndex::OpenMode::kRebuild)) { return; }
+  index->AddBlock(block->VolSessionId, block->VolSessionTime, LastIndex, addr);
+}
+
+/**
+ * Get the address of the block where the first file a bsr still wants
+ * starts.
+ *
+ * Returns: 0 if the index cannot tell.
+ */
+uint64_t GetVolumeIndexAddr(Device* dev, BootStrapRecord* bsr)
+{
+  BsrFileIndex* findex;
+  VolumeIndex* index;
+
+  if (rebuild_volume_index || !VolumeIndexEnabled(dev)) { return 0; }
+
+  /*
+   * Only bsrs for a single session can be looked up.
+   */
+  if (!bsr->sessid || bsr->sessid->next ||
+      bsr->sessid->sessid != bsr->sessid->sessid2 || !bsr->sesstime ||
+      bsr->sesstime->next) {
+    return 0;
+  }
+
+  for (findex = bsr->FileIndex; findex && findex->done;
+       findex = findex->next) {
+  }
+  if (!findex) { return 0; }
+
+  index = GetVolumeIndex(dev);
+  if (!index->Open(VolumeIndex::OpenMode::kRead)) { return 0; }
+
+  return index->Lookup(bsr->sessid->sessid, bsr->sesstime->sesstime,
+                       findex->findex);
+}
+
+/**
+ * Write out and forget the index of the volume in the device.
+ */
+void CloseVolumeIndex(Device* dev)
+{
+  if (dev->vol_index) {
+    delete dev->vol_index;
+    dev->vol_index = NULL;
+  }
+}
+
+} /* namespace storagedaemon */
@@ -0,0 +1,117 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Record index of file volumes.
+ *
+ * For every session on a file volume the index holds the address of each
+ * block that contains the first record of a file. A restore of a few files
+ * can then position directly to the block where a file starts instead of
+ * reading everything from the start address of the JobMedia record.
+ */
+
+#ifndef BAREOS_STORED_VOLUME_INDEX_H_
+#define BAREOS_STORED_VOLUME_INDEX_H_ 1
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace storagedaemon {
+
+class Device;
+class DeviceControlRecord;
+struct BootStrapRecord;
+struct DeviceBlock;
+
+/**
+ * Suffix of the index file, it is kept next to the volume file.
+ */
+#define VOLUME_INDEX_SUFFIX ".idx"
+
+/**
+ * A block of a session in which at least one file starts.
+ */
+struct VolumeIndexEntry {
+  int32_t LastIndex; /* highest FileIndex with a record in the block */
+  uint64_t addr;     /* address of the block on the volume */
+};
+
+class VolumeIndex {
+ public:
+  enum class OpenMode
+  {
+    kRead,   /* use an existing index */
+    kAppend, /* add to an index matching the volume label or start over */
+    kRebuild /* start over */
+  };
+
+  VolumeIndex(const char* path, const char* VolumeName, btime_t label_btime);
+  ~VolumeIndex();
+
+  bool Open(OpenMode mode);
+  void AddBlock(uint32_t VolSessionId,
+                uint32_t VolSessionTime,
+                int32_t LastIndex,
+                uint64_t addr);
+  bool Flush();
+  uint64_t Lookup(uint32_t VolSessionId,
+                  uint32_t VolSessionTime,
+                  int32_t FileIndex);
+
+  const char* path() const { return path_.c_str(); }
+  const char* VolumeName() const { return VolumeName_.c_str(); }
+  btime_t label_btime() const { return label_btime_; }
+
+ private:
+  typedef std::pair<uint32_t, uint32_t> SessionKey; /* time, id */
+
+  bool Load();
+  bool Create();
+  bool FlushLocked();
+
+  std::string path_;
+  std::string VolumeName_;
+  btime_t label_btime_;
+  int fd_ = -1;             /* index file opened for adding entries */
+  bool loaded_ = false;     /* sessions_ holds the index file */
+  bool load_failed_ = false;
+  bool write_failed_ = false;
+  uint64_t valid_size_ = 0; /* size of the index file without a torn entry */
+  std::map<SessionKey, std::vector<VolumeIndexEntry>> sessions_;
+  std::vector<uint8_t> pending_; /* serialized entries not yet written */
+  std::mutex mutex_;
+};
+
+bool VolumeIndexEnabled(Device* dev);
+void SetVolumeIndexRebuild(bool rebuild);
+void IndexWrittenBlock(DeviceControlRecord* dcr,
+                       DeviceBlock* block,
+                       uint64_t addr);
+void IndexReadBlock(DeviceControlRecord* dcr, uint64_t addr);
+uint64_t GetVolumeIndexAddr(Device* dev, BootStrapRecord* bsr);
+void CloseVolumeIndex(Device* dev);
+
+} /* namespace storagedaemon */
+
+#endif /* BAREOS_STORED_VOLUME_INDEX_H_ */
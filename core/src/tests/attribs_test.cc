@@ -0,0 +1,86 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+
+static void FillStat(struct stat* statp)
+{
+  memset(statp, 0, sizeof(struct stat));
+  statp->st_dev = 2049;
+  statp->st_ino = 1234567890123LL;
+  statp->st_mode = S_IFREG | 0644;
+  statp->st_nlink = 1;
+  statp->st_uid = 1000;
+  statp->st_gid = 100;
+  statp->st_size = 5LL * 1024 * 1024 * 1024;
+  statp->st_mtime = 1571234567;
+  statp->st_ctime = -1;
+}
+
+TEST(BinaryAttributes, decode_returns_the_encoded_fields)
+{
+  POOLMEM* buf = GetPoolMemory(PM_MESSAGE);
+  struct stat statp;
+  BinaryAttributes attribs;
+  int len;
+
+  FillStat(&statp);
+  len = EncodeAttributesBinary(buf, 42, FT_LNK, "/etc/localtime", &statp,
+                               sizeof(statp), 7, STREAM_FILE_DATA,
+                               "/usr/share/zoneinfo/UTC", "", 3);
+
+  ASSERT_TRUE(DecodeAttributesBinary(buf, len, &attribs));
+  EXPECT_EQ(attribs.file_index, 42);
+  EXPECT_EQ(attribs.type, FT_LNK);
+  EXPECT_STREQ(attribs.fname, "/etc/localtime");
+  EXPECT_STREQ(attribs.link, "/usr/share/zoneinfo/UTC");
+  EXPECT_STREQ(attribs.attribsEx, "");
+  EXPECT_EQ(attribs.delta_seq, 3);
+  EXPECT_EQ(attribs.LinkFI, 7);
+  EXPECT_EQ(attribs.data_stream, STREAM_FILE_DATA);
+  EXPECT_EQ(attribs.statp.st_ino, statp.st_ino);
+  EXPECT_EQ(attribs.statp.st_mode, statp.st_mode);
+  EXPECT_EQ(attribs.statp.st_size, statp.st_size);
+  EXPECT_EQ(attribs.statp.st_mtime, statp.st_mtime);
+  EXPECT_EQ(attribs.statp.st_ctime, statp.st_ctime);
+
+  FreePoolMemory(buf);
+}
+
+TEST(BinaryAttributes, decode_rejects_truncated_records)
+{
+  POOLMEM* buf = GetPoolMemory(PM_MESSAGE);
+  struct stat statp;
+  BinaryAttributes attribs;
+  int len;
+
+  FillStat(&statp);
+  len = EncodeAttributesBinary(buf, 1, FT_REG, "/tmp/file", &statp,
+                               sizeof(statp), 0, STREAM_FILE_DATA, "", "", 0);
+
+  for (int i = 0; i < len - 1; i++) {
+    EXPECT_FALSE(DecodeAttributesBinary(buf, i, &attribs)) << "length " << i;
+  }
+
+  FreePoolMemory(buf);
+}
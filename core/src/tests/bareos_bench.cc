@@ -0,0 +1,579 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Benchmarks of the components on the data path of a backup and restore.
+ *
+ * Run bareos-bench --benchmark_format=json (or --benchmark_out=<file>
+ * --benchmark_out_format=json) to get results that can be compared between
+ * builds, --benchmark_filter=<regex> selects single benchmarks.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "include/bareos.h"
+#include "include/ch.h"
+#include "include/jcr.h"
+#include "include/streams.h"
+#include "lib/attribs.h"
+#include "lib/bsock_tcp.h"
+#include "lib/compression.h"
+#include "lib/parse_bsr.h"
+#include "findlib/find.h"
+#include "stored/stored.h"
+#include "stored/bsr.h"
+#include "stored/crc32.h"
+#include "stored/match_bsr.h"
+#include "tests/bareos_test_sockets.h"
+
+#include <thread>
+
+using namespace storagedaemon;
+
+/*
+ * Backup like data, text that compresses about 3:1.
+ */
+static void FillCompressible(char* buf, uint32_t len)
+{
+  static const char* words[] = {"bareos", "backup ", "volume", "\n",
+                                "restore ", "0123", "job", "  ", "catalog"};
+  uint32_t seed = 12345;
+  uint32_t i = 0;
+
+  while (i < len) {
+    const char* word;
+
+    seed = seed * 1103515245 + 12345;
+    word = words[(seed >> 16) % 9];
+    while (*word && i < len) { buf[i++] = *word++; }
+    if (i < len) { buf[i++] = (char)('a' + (seed >> 24) % 26); }
+  }
+}
+
+/*
+ * Compression, one network buffer per iteration.
+ */
+static const uint32_t compression_algorithms[] = {
+    COMPRESS_GZIP, COMPRESS_LZO1X, COMPRESS_FZFZ, COMPRESS_FZ4L,
+    COMPRESS_FZ4H};
+
+class CompressionFixture {
+ public:
+  JobControlRecord* jcr;
+  uint32_t algorithm;
+  POOLMEM* rbuf;
+  POOLMEM* cbuf;
+  uint32_t clen = 0;
+  bool ok;
+
+  explicit CompressionFixture(uint32_t algo)
+      : jcr(new_jcr(sizeof(JobControlRecord), NULL)), algorithm(algo)
+  {
+    uint32_t cbuf_size = 0;
+    uint32_t inflate_size = 0;
+
+    jcr->buf_size = DEFAULT_NETWORK_BUFFER_SIZE;
+    rbuf = GetMemory(jcr->buf_size);
+    FillCompressible(rbuf, jcr->buf_size);
+
+    ok = SetupCompressionBuffers(jcr, false, algorithm, &cbuf_size) &&
+         SetupDecompressionBuffers(jcr, &inflate_size);
+    cbuf = GetMemory(cbuf_size + sizeof(comp_stream_header));
+    jcr->compress.inflate_buffer = GetMemory(inflate_size);
+    jcr->compress.inflate_buffer_size = inflate_size;
+  }
+
+  ~CompressionFixture()
+  {
+    CleanupCompression(jcr);
+    FreeJcr(jcr);
+    FreeMemory(rbuf);
+    FreeMemory(cbuf);
+  }
+
+  bool Compress()
+  {
+    unsigned char* data = (unsigned char*)cbuf + sizeof(comp_stream_header);
+    uint32_t max_len = SizeofPoolMemory(cbuf) - sizeof(comp_stream_header);
+    ser_declare;
+
+    if (!CompressData(jcr, algorithm, rbuf, jcr->buf_size, data, max_len,
+                      &clen) ||
+        !clen) {
+      return false;
+    }
+
+    SerBegin(cbuf, sizeof(comp_stream_header));
+    ser_uint32(algorithm);
+    ser_uint32(clen);
+    ser_uint16(0);
+    ser_uint16(COMP_HEAD_VERSION);
+    SerEnd(cbuf, sizeof(comp_stream_header));
+
+    return true;
+  }
+};
+
+static void BM_CompressData(benchmark::State& state)
+{
+  CompressionFixture fixture(compression_algorithms[state.range(0)]);
+
+  state.SetLabel(cmprs_algo_to_text(fixture.algorithm));
+  if (!fixture.ok || !fixture.Compress()) {
+    state.SkipWithError("compression algorithm not available");
+    return;
+  }
+
+  for (auto _ : state) { fixture.Compress(); }
+
+  state.SetBytesProcessed(state.iterations() * fixture.jcr->buf_size);
+  state.counters["ratio"] = (double)fixture.jcr->buf_size / fixture.clen;
+}
+BENCHMARK(BM_CompressData)->DenseRange(0, 4);
+
+static void BM_DecompressData(benchmark::State& state)
+{
+  CompressionFixture fixture(compression_algorithms[state.range(0)]);
+
+  state.SetLabel(cmprs_algo_to_text(fixture.algorithm));
+  if (!fixture.ok || !fixture.Compress()) {
+    state.SkipWithError("compression algorithm not available");
+    return;
+  }
+
+  for (auto _ : state) {
+    char* data = fixture.cbuf;
+    uint32_t length = fixture.clen + sizeof(comp_stream_header);
+
+    if (!DecompressData(fixture.jcr, "bench", STREAM_COMPRESSED_DATA, &data,
+                        &length, true)) {
+      state.SkipWithError("decompression failed");
+      break;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * fixture.jcr->buf_size);
+}
+BENCHMARK(BM_DecompressData)->DenseRange(0, 4);
+
+/*
+ * Block checksums.
+ */
+static void BM_Bcrc32(benchmark::State& state)
+{
+  std::vector<uint8_t> buf(state.range(0));
+
+  FillCompressible((char*)buf.data(), buf.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bcrc32(buf.data(), buf.size()));
+  }
+
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_Bcrc32)->Range(512, 1 << 20);
+
+/*
+ * File digests of a 64 KB file, including the setup and finalization that
+ * is done for every file.
+ */
+static void BM_FileDigest(benchmark::State& state)
+{
+  crypto_digest_t type = (crypto_digest_t)state.range(0);
+  std::vector<uint8_t> buf(64 * 1024);
+  uint8_t result[CRYPTO_DIGEST_MAX_SIZE];
+  uint32_t size;
+
+  FillCompressible((char*)buf.data(), buf.size());
+  for (auto _ : state) {
+    DIGEST* digest = crypto_digest_new(NULL, type);
+
+    CryptoDigestUpdate(digest, buf.data(), buf.size());
+    size = sizeof(result);
+    CryptoDigestFinalize(digest, result, &size);
+    CryptoDigestFree(digest);
+  }
+
+  state.SetLabel(crypto_digest_name(type));
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_FileDigest)->DenseRange(CRYPTO_DIGEST_MD5, CRYPTO_DIGEST_XXH64);
+
+/*
+ * Hash table as used for the accurate file list, keyed by filename.
+ */
+struct BenchItem {
+  char* key;
+  hlink link;
+};
+
+static htable* FillHtable(int nr_items, std::vector<std::string>& keys)
+{
+  BenchItem* item = NULL;
+  htable* table = (htable*)malloc(sizeof(htable));
+
+  table->init(item, &item->link, nr_items);
+  for (int i = 0; i < nr_items; i++) {
+    keys.push_back("/home/user/project/src/file" + std::to_string(i) + ".cc");
+    item = (BenchItem*)table->hash_malloc(sizeof(BenchItem));
+    item->key = (char*)table->hash_malloc(keys.back().size() + 1);
+    strcpy(item->key, keys.back().c_str());
+    table->insert(item->key, item);
+  }
+
+  return table;
+}
+
+static void BM_HtableInsert(benchmark::State& state)
+{
+  for (auto _ : state) {
+    std::vector<std::string> keys;
+    htable* table = FillHtable(state.range(0), keys);
+
+    state.PauseTiming();
+    table->destroy();
+    free(table);
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HtableInsert)->Range(1 << 10, 1 << 18);
+
+static void BM_HtableLookup(benchmark::State& state)
+{
+  std::vector<std::string> keys;
+  htable* table = FillHtable(state.range(0), keys);
+  size_t i = 0;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table->lookup((char*)keys[i].c_str()));
+    if (++i == keys.size()) { i = 0; }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  table->destroy();
+  free(table);
+}
+BENCHMARK(BM_HtableLookup)->Range(1 << 10, 1 << 18);
+
+/*
+ * File attributes, the text encoding and the binary attributes stream.
+ */
+static void BM_EncodeStat(benchmark::State& state)
+{
+  struct stat statp;
+  char buf[MAX_ENCODED_STAT_LENGTH];
+
+  stat("/", &statp);
+  for (auto _ : state) {
+    EncodeStat(buf, &statp, sizeof(statp), 0, STREAM_FILE_DATA);
+    benchmark::DoNotOptimize(buf);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeStat);
+
+static void BM_DecodeStat(benchmark::State& state)
+{
+  struct stat statp;
+  char buf[MAX_ENCODED_STAT_LENGTH];
+  int32_t LinkFI;
+
+  stat("/", &statp);
+  EncodeStat(buf, &statp, sizeof(statp), 0, STREAM_FILE_DATA);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DecodeStat(buf, &statp, sizeof(statp), &LinkFI));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeStat);
+
+static void BM_EncodeAttributesBinary(benchmark::State& state)
+{
+  struct stat statp;
+  POOLMEM* buf = GetPoolMemory(PM_MESSAGE);
+
+  stat("/", &statp);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(EncodeAttributesBinary(
+        buf, 1, FT_REG, "/home/user/project/src/file.cc", &statp,
+        sizeof(statp), 0, STREAM_FILE_DATA, "", "", 0));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  FreePoolMemory(buf);
+}
+BENCHMARK(BM_EncodeAttributesBinary);
+
+static void BM_DecodeAttributesBinary(benchmark::State& state)
+{
+  struct stat statp;
+  BinaryAttributes attribs;
+  POOLMEM* buf = GetPoolMemory(PM_MESSAGE);
+  int len;
+
+  stat("/", &statp);
+  len = EncodeAttributesBinary(buf, 1, FT_REG, "/home/user/project/src/file.cc",
+                               &statp, sizeof(statp), 0, STREAM_FILE_DATA, "",
+                               "", 0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DecodeAttributesBinary(buf, len, &attribs));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  FreePoolMemory(buf);
+}
+BENCHMARK(BM_DecodeAttributesBinary);
+
+/*
+ * Throughput of a TCP connection over loopback, the receiver runs in its own
+ * thread like the other daemon would.
+ */
+static void BM_BsockLoopback(benchmark::State& state)
+{
+  std::unique_ptr<TestSockets> sockets =
+      create_connected_server_and_client_bareos_socket();
+  uint32_t msglen = state.range(0);
+
+  if (!sockets) {
+    state.SkipWithError("could not connect over loopback");
+    return;
+  }
+
+  std::thread receiver([&sockets]() {
+    while (sockets->server->recv() > 0) {}
+  });
+
+  sockets->client->msg = CheckPoolMemorySize(sockets->client->msg, msglen);
+  FillCompressible(sockets->client->msg, msglen);
+  for (auto _ : state) {
+    sockets->client->message_length = msglen;
+    if (!sockets->client->send()) {
+      state.SkipWithError("send failed");
+      break;
+    }
+  }
+  static_cast<BareosSocket*>(sockets->client.get())->signal(BNET_TERMINATE);
+  receiver.join();
+
+  state.SetBytesProcessed(state.iterations() * msglen);
+}
+BENCHMARK(BM_BsockLoopback)->Range(512, 1 << 20)->UseRealTime();
+
+/*
+ * Packing records into volume blocks and unpacking them again.
+ */
+class RecordFixture {
+ public:
+  DeviceControlRecord* dcr;
+  DeviceRecord* rec;
+
+  explicit RecordFixture(uint32_t data_len)
+  {
+    static DeviceResource device; /* zero initialized like parsed resources */
+    static Device* dev = NULL;
+
+    if (!dev) {
+      device.hdr.name = (char*)"bench";
+      device.device_name = (char*)"/tmp";
+      device.dev_type = B_FILE_DEV;
+      device.label_block_size = DEFAULT_BLOCK_SIZE;
+      device.max_block_size = 1024 * 1024;
+      dev = InitDev(NULL, &device);
+    }
+
+    dcr = New(DeviceControlRecord);
+    dcr->dev = dev;
+    dcr->device = &device;
+    dcr->block = new_block(dev);
+
+    rec = new_record();
+    rec->data = CheckPoolMemorySize(rec->data, data_len);
+    FillCompressible(rec->data, data_len);
+    rec->data_len = data_len;
+    rec->VolSessionId = 1;
+    rec->VolSessionTime = 1000;
+    rec->FileIndex = 1;
+    rec->Stream = STREAM_FILE_DATA;
+  }
+
+  ~RecordFixture()
+  {
+    FreeRecord(rec);
+    FreeBlock(dcr->block);
+    delete dcr;
+  }
+
+  /*
+   * Fill the block, returns the number of complete records in it.
+   */
+  int FillBlock()
+  {
+    int nr_records = 0;
+
+    EmptyBlock(dcr->block);
+    rec->state = st_none;
+    while (WriteRecordToBlock(dcr, rec)) {
+      nr_records++;
+      rec->FileIndex++;
+      rec->state = st_none;
+    }
+
+    return nr_records;
+  }
+};
+
+static void BM_WriteRecordToBlock(benchmark::State& state)
+{
+  RecordFixture fixture(state.range(0));
+  int64_t nr_records = 0;
+
+  for (auto _ : state) { nr_records += fixture.FillBlock(); }
+
+  state.SetItemsProcessed(nr_records);
+  state.SetBytesProcessed(nr_records * state.range(0));
+}
+BENCHMARK(BM_WriteRecordToBlock)->Range(64, 64 * 1024);
+
+static void BM_ReadRecordFromBlock(benchmark::State& state)
+{
+  RecordFixture fixture(state.range(0));
+  DeviceBlock* block = fixture.dcr->block;
+  DeviceRecord* rec = new_record();
+  int nr_records = fixture.FillBlock();
+  uint32_t binbuf = block->binbuf - WRITE_BLKHDR_LENGTH;
+  int64_t nr_read = 0;
+
+  for (auto _ : state) {
+    block->bufp = block->buf + WRITE_BLKHDR_LENGTH;
+    block->binbuf = binbuf;
+    for (int i = 0; i < nr_records; i++) {
+      rec->data_len = 0;
+      rec->remainder = 0;
+      if (!ReadRecordFromBlock(fixture.dcr, rec)) { break; }
+      nr_read++;
+    }
+  }
+
+  state.SetItemsProcessed(nr_read);
+  state.SetBytesProcessed(nr_read * state.range(0));
+  FreeRecord(rec);
+}
+BENCHMARK(BM_ReadRecordFromBlock)->Range(64, 64 * 1024);
+
+/*
+ * Selecting the records of a restore, the records belong to the last of the
+ * jobs in the bootstrap file.
+ */
+static void BM_MatchBsr(benchmark::State& state)
+{
+  char fname[] = "/tmp/bareos_benchXXXXXX";
+  int nr_jobs = state.range(0);
+  BootStrapRecord* bsr;
+  DeviceRecord* rec = new_record();
+  VOLUME_LABEL volrec;
+  SESSION_LABEL sessrec;
+  int fd = mkstemp(fname);
+  FILE* fp = fdopen(fd, "w");
+
+  for (int i = 1; i <= nr_jobs; i++) {
+    fprintf(fp,
+            "Volume=\"Full-0001\"\nMediaType=\"File\"\nVolSessionId=%d\n"
+            "VolSessionTime=1000\nVolAddr=0-1000000000\nFileIndex=1-1000000\n",
+            i);
+  }
+  fclose(fp);
+  bsr = libbareos::parse_bsr(NULL, fname);
+  unlink(fname);
+
+  memset(&volrec, 0, sizeof(volrec));
+  memset(&sessrec, 0, sizeof(sessrec));
+  bstrncpy(volrec.VolumeName, "Full-0001", sizeof(volrec.VolumeName));
+  rec->VolSessionId = nr_jobs;
+  rec->VolSessionTime = 1000;
+  rec->Stream = STREAM_FILE_DATA;
+
+  for (auto _ : state) {
+    rec->FileIndex = 1 + (rec->FileIndex % 1000000);
+    benchmark::DoNotOptimize(MatchBsr(bsr, rec, &volrec, &sessrec, NULL));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  libbareos::FreeBsr(bsr);
+  FreeRecord(rec);
+}
+BENCHMARK(BM_MatchBsr)->Range(1, 1024);
+
+/*
+ * FileSet wild card exclusion of the filenames found during a backup.
+ */
+static void BM_AcceptFile(benchmark::State& state)
+{
+  FindFilesPacket* ff = init_find_files();
+  findFILESET* fileset = (findFILESET*)malloc(sizeof(findFILESET));
+  findIncludeExcludeItem* incexe;
+  findFOPTS* fo;
+  std::vector<std::string> fnames;
+  size_t i = 0;
+
+  memset(fileset, 0, sizeof(findFILESET));
+  fileset->include_list.init(1, true);
+  fileset->exclude_list.init(1, true);
+  ff->fileset = fileset;
+  incexe = new_include(fileset);
+  fo = start_options(ff);
+  SetBit(FO_EXCLUDE, fo->flags);
+  for (int j = 0; j < state.range(0); j++) {
+    std::string pattern = "*/exclude" + std::to_string(j) + "/*";
+
+    fo->wild.append(bstrdup(pattern.c_str()));
+  }
+  fo->wildfile.append(bstrdup("*.o"));
+
+  for (int j = 0; j < 1024; j++) {
+    fnames.push_back("/home/user/project" + std::to_string(j % 7) +
+                     "/src/file" + std::to_string(j) + ".cc");
+  }
+  ff->statp.st_mode = S_IFREG | 0644;
+
+  for (auto _ : state) {
+    ff->fname = (char*)fnames[i].c_str();
+    benchmark::DoNotOptimize(AcceptFile(ff));
+    if (++i == fnames.size()) { i = 0; }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  fo->wild.destroy();
+  fo->wildfile.destroy();
+  FreeCompiledPatterns(incexe);
+  incexe->opts_list.destroy();
+  incexe->name_list.destroy();
+  fileset->include_list.destroy();
+  fileset->exclude_list.destroy();
+  free(fileset);
+  ff->fileset = NULL;
+  TermFindFiles(ff);
+}
+BENCHMARK(BM_AcceptFile)->Range(1, 1024);
+
+BENCHMARK_MAIN();
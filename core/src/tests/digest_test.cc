@@ -0,0 +1,92 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+
+#include <string>
+#include <vector>
+
+static std::string DigestOf(crypto_digest_t type,
+                            const std::vector<uint8_t>& data,
+                            size_t chunk)
+{
+  DIGEST* digest = crypto_digest_new(NULL, type);
+  uint8_t result[CRYPTO_DIGEST_MAX_SIZE];
+  uint32_t size = sizeof(result);
+  std::string hex;
+  char buf[3];
+
+  for (size_t offset = 0; offset < data.size(); offset += chunk) {
+    CryptoDigestUpdate(digest, data.data() + offset,
+                       std::min(chunk, data.size() - offset));
+  }
+  CryptoDigestFinalize(digest, result, &size);
+  CryptoDigestFree(digest);
+
+  for (uint32_t i = 0; i < size; i++) {
+    snprintf(buf, sizeof(buf), "%02x", result[i]);
+    hex += buf;
+  }
+
+  return hex;
+}
+
+static std::vector<uint8_t> Bytes(const char* str)
+{
+  return std::vector<uint8_t>(str, str + strlen(str));
+}
+
+TEST(Digest, xxh64_matches_the_reference_values)
+{
+  std::vector<uint8_t> data(100003);
+
+  for (size_t i = 0; i < data.size(); i++) { data[i] = i * 131 + 7; }
+
+  EXPECT_EQ(DigestOf(CRYPTO_DIGEST_XXH64, Bytes(""), 1), "ef46db3751d8e999");
+  EXPECT_EQ(DigestOf(CRYPTO_DIGEST_XXH64, Bytes("abc"), 3),
+            "44bc2cf5ad770999");
+  EXPECT_EQ(DigestOf(CRYPTO_DIGEST_XXH64, data, data.size()),
+            "b50ad3cd166fe52b");
+}
+
+TEST(Digest, does_not_depend_on_the_chunk_size)
+{
+  std::vector<uint8_t> data(4097);
+
+  for (size_t i = 0; i < data.size(); i++) { data[i] = i * 131 + 7; }
+
+  for (int type = CRYPTO_DIGEST_MD5; type <= CRYPTO_DIGEST_XXH64; type++) {
+    std::string expected = DigestOf((crypto_digest_t)type, data, data.size());
+
+    for (size_t chunk : {1, 5, 31, 33, 1000}) {
+      EXPECT_EQ(DigestOf((crypto_digest_t)type, data, chunk), expected)
+          << crypto_digest_name((crypto_digest_t)type) << " chunk " << chunk;
+    }
+  }
+}
+
+TEST(Digest, xxh64_has_a_stream_and_a_name)
+{
+  EXPECT_EQ(CryptoDigestStreamType(STREAM_XXH64_DIGEST), CRYPTO_DIGEST_XXH64);
+  EXPECT_STREQ(crypto_digest_name(CRYPTO_DIGEST_XXH64), "XXH64");
+}
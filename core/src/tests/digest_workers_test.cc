@@ -0,0 +1,183 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+#include "filed/filed.h"
+#include "filed/filed_globals.h"
+#include "filed/digest_workers.h"
+
+#include <string>
+#include <vector>
+
+using namespace filedaemon;
+
+static const int nr_contexts = 8;
+static const size_t data_size = 3 * 1024 * 1024 + 17;
+
+static std::string Finalize(DIGEST* digest)
+{
+  uint8_t result[CRYPTO_DIGEST_MAX_SIZE];
+  uint32_t size = sizeof(result);
+  std::string hex;
+  char buf[3];
+
+  CryptoDigestFinalize(digest, result, &size);
+  CryptoDigestFree(digest);
+
+  for (uint32_t i = 0; i < size; i++) {
+    snprintf(buf, sizeof(buf), "%02x", result[i]);
+    hex += buf;
+  }
+
+  return hex;
+}
+
+static crypto_digest_t TypeOf(int context)
+{
+  return (crypto_digest_t)(CRYPTO_DIGEST_MD5 +
+                           context % (CRYPTO_DIGEST_XXH64 - CRYPTO_DIGEST_MD5 +
+                                      1));
+}
+
+/*
+ * The data of every context differs and is cut into chunks of different
+ * sizes, like the blocks of files read by concurrent jobs.
+ */
+static std::vector<uint8_t> DataOf(int context)
+{
+  std::vector<uint8_t> data(data_size + context);
+
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i * (131 + context) + 7;
+  }
+
+  return data;
+}
+
+static size_t ChunkSize(int context, size_t chunk_nr)
+{
+  return 1 + (context * 7919 + chunk_nr * 104729) % (128 * 1024);
+}
+
+static std::vector<std::string> InlineDigests()
+{
+  std::vector<std::string> digests;
+
+  for (int context = 0; context < nr_contexts; context++) {
+    DIGEST* digest = crypto_digest_new(NULL, TypeOf(context));
+    std::vector<uint8_t> data = DataOf(context);
+    size_t offset = 0;
+
+    for (size_t chunk_nr = 0; offset < data.size(); chunk_nr++) {
+      size_t length =
+          std::min(ChunkSize(context, chunk_nr), data.size() - offset);
+
+      CryptoDigestUpdate(digest, data.data() + offset, length);
+      offset += length;
+    }
+    digests.push_back(Finalize(digest));
+  }
+
+  return digests;
+}
+
+/*
+ * Queue the chunks of all contexts interleaved, one chunk of every context
+ * after the other. When stop_after is not 0 the workers are stopped after
+ * that many rounds, with data of all contexts still queued.
+ */
+static std::vector<std::string> WorkerDigests(size_t stop_after)
+{
+  std::vector<DIGEST*> contexts;
+  std::vector<std::vector<uint8_t>> data;
+  std::vector<size_t> offsets(nr_contexts, 0);
+  std::vector<std::string> digests;
+  bool more = true;
+
+  for (int context = 0; context < nr_contexts; context++) {
+    contexts.push_back(crypto_digest_new(NULL, TypeOf(context)));
+    data.push_back(DataOf(context));
+  }
+
+  for (size_t chunk_nr = 0; more; chunk_nr++) {
+    if (stop_after && chunk_nr == stop_after) { StopDigestWorkers(); }
+
+    more = false;
+    for (int context = 0; context < nr_contexts; context++) {
+      size_t offset = offsets[context];
+      size_t length;
+
+      if (offset >= data[context].size()) { continue; }
+      length =
+          std::min(ChunkSize(context, chunk_nr), data[context].size() - offset);
+      DigestWorkersUpdate(contexts[context], data[context].data() + offset,
+                          length);
+      offsets[context] += length;
+      more = true;
+    }
+  }
+
+  for (DIGEST* digest : contexts) {
+    DigestWorkersWait(digest);
+    digests.push_back(Finalize(digest));
+  }
+
+  return digests;
+}
+
+class DigestWorkers : public ::testing::Test {
+ protected:
+  ClientResource client;
+
+  void SetUp() override
+  {
+    client.digest_workers = 3;
+    me = &client;
+    ASSERT_EQ(StartDigestWorkers(), 0);
+    ASSERT_TRUE(DigestWorkersRunning());
+  }
+
+  void TearDown() override
+  {
+    StopDigestWorkers();
+    me = nullptr;
+  }
+};
+
+TEST_F(DigestWorkers, interleaved_contexts_match_inline_digests)
+{
+  digest_worker_stats_t stats;
+
+  EXPECT_EQ(WorkerDigests(0), InlineDigests());
+
+  ASSERT_TRUE(GetDigestWorkerStatistics(stats));
+  EXPECT_EQ(stats.workers, 3u);
+  EXPECT_EQ(stats.queued, 0u);
+  EXPECT_GT(stats.chunks, 0u);
+}
+
+TEST_F(DigestWorkers, stop_while_queued_matches_inline_digests)
+{
+  EXPECT_EQ(WorkerDigests(10), InlineDigests());
+  EXPECT_FALSE(DigestWorkersRunning());
+}
@@ -0,0 +1,64 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+
+using namespace storagedaemon;
+
+TEST(LargeBlockSize, UsesConfiguredSize)
+{
+  EXPECT_EQ(1048576u, ComputeLargeBlockSize(1048576, 0, 0));
+  EXPECT_EQ(1048576u, ComputeLargeBlockSize(1048576, 2097152, 0));
+}
+
+TEST(LargeBlockSize, RoundsDownToTapeBlockSize)
+{
+  EXPECT_EQ(1047552u, ComputeLargeBlockSize(1048000, 0, 0));
+  EXPECT_EQ(0u, ComputeLargeBlockSize(1048576, 0, 0) % TAPE_BSIZE);
+}
+
+TEST(LargeBlockSize, LimitedByDrive)
+{
+  EXPECT_EQ(524288u, ComputeLargeBlockSize(1048576, 524288, 0));
+  EXPECT_EQ(523264u, ComputeLargeBlockSize(1048576, 524000, 0));
+}
+
+TEST(LargeBlockSize, LimitedByMaximumBlockLength)
+{
+  uint32_t size = ComputeLargeBlockSize(MAX_BLOCK_LENGTH + 4096, 0, 0);
+
+  EXPECT_LE(size, (uint32_t)MAX_BLOCK_LENGTH);
+  EXPECT_GT(size, (uint32_t)MAX_BLOCK_LENGTH - TAPE_BSIZE);
+  EXPECT_EQ(0u, size % TAPE_BSIZE);
+}
+
+TEST(LargeBlockSize, FallsBackToBlockSizeOfDevice)
+{
+  /*
+   * No multiple of TAPE_BSIZE fits into what the drive supports.
+   */
+  EXPECT_EQ(0u, ComputeLargeBlockSize(1048576, 512, 0));
+  EXPECT_EQ(64512u, ComputeLargeBlockSize(1048576, 512, 64512));
+  EXPECT_EQ(262144u, ComputeLargeBlockSize(1000, 0, 262144));
+}
@@ -20,7 +20,151 @@
 */
 
 #include "gtest/gtest.h"
+#define NEED_JANSSON_NAMESPACE 1
 #include "include/bareos.h"
 #include "lib/output_formatter.h"
+#include "lib/json.h"
+
+#include <string>
 
 TEST(output_formatter, constructor_destructor) {}
+
+#if HAVE_JANSSON
+static bool CollectOutput(void* ctx, const char* msg)
+{
+  ((std::string*)ctx)->append(msg);
+  return true;
+}
+
+/*
+ * Produce a listing with a top level array of the given number of rows
+ * between two other result members.
+ */
+static std::string FormatRows(int rows, bool compact, bool result)
+{
+  std::string output;
+  OutputFormatter of(CollectOutput, &output, NULL, NULL, API_MODE_JSON);
+  std::string name;
+
+  of.SetCompact(compact);
+  of.ObjectKeyValue("before", "first");
+  of.ArrayStart("files");
+  for (int i = 0; i < rows; i++) {
+    name = "/tmp/file" + std::to_string(i);
+    of.ObjectStart();
+    of.ObjectKeyValue("fileid", (uint64_t)i);
+    of.ObjectKeyValue("name", name.c_str());
+    of.ObjectEnd();
+  }
+  of.ArrayEnd("files");
+  of.ObjectKeyValue("after", "last");
+  of.FinalizeResult(result);
+
+  return output;
+}
+
+/*
+ * The response as built in one piece, which is what JsonFinalizeResult()
+ * sends for a listing that is not streamed. A failed listing that was
+ * streamed keeps the result and gets an error member in it.
+ */
+static std::string ExpectedResponse(int rows, bool compact, bool result)
+{
+  json_t *response, *result_obj, *files, *error_obj, *data_obj;
+  char* string;
+  std::string expected;
+  std::string name;
+
+  InitializeJson(); /* use the allocator of the OutputFormatter */
+  response = json_object();
+  result_obj = json_object();
+  files = json_array();
+  json_object_set_new(result_obj, "before", json_string("first"));
+  for (int i = 0; i < rows; i++) {
+    json_t* row = json_object();
+
+    name = "/tmp/file" + std::to_string(i);
+    json_object_set_new(row, "fileid", json_integer(i));
+    json_object_set_new(row, "name", json_string(name.c_str()));
+    json_array_append_new(files, row);
+  }
+  json_object_set_new(result_obj, "files", files);
+  json_object_set_new(result_obj, "after", json_string("last"));
+
+  json_object_set_new(response, "jsonrpc", json_string("2.0"));
+  json_object_set_new(response, "id", json_null());
+  if (result) {
+    json_object_set_new(response, "result", result_obj);
+  } else {
+    error_obj = json_object();
+    json_object_set_new(error_obj, "code", json_integer(1));
+    json_object_set_new(error_obj, "message", json_string("failed"));
+    data_obj = json_object();
+    if (rows < OF_JSON_STREAM_ROWS) {
+      json_object_set_new(data_obj, "result", result_obj);
+      json_object_set_new(data_obj, "messages", json_object());
+      json_object_set_new(error_obj, "data", data_obj);
+      json_object_set_new(response, "error", error_obj);
+    } else {
+      json_object_set_new(data_obj, "messages", json_object());
+      json_object_set_new(error_obj, "data", data_obj);
+      json_object_set_new(result_obj, "error", error_obj);
+      json_object_set_new(response, "result", result_obj);
+    }
+  }
+
+  string = json_dumps(response,
+                      compact ? UA_JSON_FLAGS_COMPACT : UA_JSON_FLAGS_NORMAL);
+  expected = string;
+  free(string);
+  json_decref(response);
+
+  return expected;
+}
+
+static void ExpectSameJson(const std::string& expected,
+                           const std::string& output,
+                           int rows)
+{
+  json_error_t error;
+  json_t* expected_json = json_loads(expected.c_str(), 0, &error);
+  json_t* output_json = json_loads(output.c_str(), 0, &error);
+
+  ASSERT_NE(output_json, nullptr)
+      << rows << " rows: " << error.text << " in " << output;
+  EXPECT_TRUE(json_equal(expected_json, output_json)) << rows << " rows";
+  json_decref(expected_json);
+  json_decref(output_json);
+}
+
+static const int row_counts[] = {0,
+                                 1,
+                                 OF_JSON_STREAM_ROWS - 1,
+                                 OF_JSON_STREAM_ROWS,
+                                 OF_JSON_STREAM_ROWS + 1,
+                                 2 * OF_JSON_STREAM_ROWS + 500};
+
+TEST(output_formatter, json_stream_matches_json_result)
+{
+  for (int rows : row_counts) {
+    std::string output = FormatRows(rows, true, true);
+
+    /*
+     * Compact output is the same byte for byte.
+     */
+    EXPECT_EQ(ExpectedResponse(rows, true, true), output) << rows << " rows";
+    ExpectSameJson(ExpectedResponse(rows, false, true),
+                   FormatRows(rows, false, true), rows);
+  }
+}
+
+TEST(output_formatter, json_stream_failure_stays_valid_json)
+{
+  for (int rows : row_counts) {
+    for (bool compact : {true, false}) {
+      ExpectSameJson(ExpectedResponse(rows, compact, false),
+                     FormatRows(rows, compact, false), rows);
+    }
+  }
+}
+#endif /* HAVE_JANSSON */
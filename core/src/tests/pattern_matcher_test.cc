@@ -0,0 +1,94 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+#include "findlib/pattern_matcher.h"
+
+static const char* patterns[] = {
+    "*.o",        "*/.cache/*", "*/node_modules", "/home/*/tmp/*",
+    "*",          "*.[oa]",     "[abc]*.log",     "/var/log/*.gz",
+    "*\\*star*",  "*~",         "*.TMP",          "/srv/data/?\?/x*",
+    "*/CVS/*",    "*/build",    "*.o\\",          "/etc/passwd"};
+
+static const char* fnames[] = {
+    "/usr/src/main.o",          "/home/joe/.cache/thumb.png",
+    "/srv/app/node_modules",    "/home/joe/tmp/scratch",
+    "/var/lib/libfoo.a",        "/var/log/syslog.1.gz",
+    "/home/joe/a*star.txt",     "/home/joe/notes.txt~",
+    "/tmp/SESSION.tmp",         "/srv/data/ab/xyz",
+    "/work/cvs/entries",        "/work/project/build",
+    "/usr/src/MAIN.O",          "/etc/passwd",
+    "alog.log",                 "/nothing/to/see/here"};
+
+TEST(PatternMatcher, never_skips_a_matching_pattern)
+{
+  PatternMatcher matcher;
+
+  for (const char* pattern : patterns) { matcher.AddPattern(pattern); }
+  matcher.Compile();
+
+  for (const char* fname : fnames) {
+    matcher.Scan(fname);
+    for (int id = 0; id < matcher.size(); id++) {
+      for (int flags : {0, FNM_CASEFOLD, FNM_PATHNAME | FNM_CASEFOLD}) {
+        if (fnmatch(patterns[id], fname, flags) == 0) {
+          EXPECT_TRUE(matcher.MayMatch(id))
+              << patterns[id] << " matches " << fname;
+        }
+      }
+    }
+  }
+}
+
+TEST(PatternMatcher, skips_patterns_without_their_literal)
+{
+  PatternMatcher matcher;
+  int object = matcher.AddPattern("*.o");
+  int cache = matcher.AddPattern("*/.cache/*");
+  int any = matcher.AddPattern("*");
+  int temp = matcher.AddPattern("*.TMP");
+
+  matcher.Scan("/home/joe/.cache/session.tmp");
+  EXPECT_FALSE(matcher.MayMatch(object));
+  EXPECT_TRUE(matcher.MayMatch(cache));
+  EXPECT_TRUE(matcher.MayMatch(any));
+  EXPECT_TRUE(matcher.MayMatch(temp));
+
+  matcher.Scan("/usr/src/main.c");
+  EXPECT_FALSE(matcher.MayMatch(object));
+  EXPECT_FALSE(matcher.MayMatch(cache));
+  EXPECT_TRUE(matcher.MayMatch(any));
+  EXPECT_FALSE(matcher.MayMatch(temp));
+}
+
+TEST(PatternMatcher, always_checks_non_ascii_patterns)
+{
+  PatternMatcher matcher;
+  int umlaut = matcher.AddPattern("*/\xc3\x84rger/*");
+
+  matcher.Compile();
+  matcher.Scan("/home/joe/\xc3\xa4rger/notes.txt");
+  EXPECT_TRUE(matcher.MayMatch(umlaut));
+  matcher.Scan("/usr/src/main.c");
+  EXPECT_TRUE(matcher.MayMatch(umlaut));
+}
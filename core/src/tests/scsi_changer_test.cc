@@ -0,0 +1,250 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+#include "stored/scsi_changer.h"
+#include "ndmp/smc.h"
+#include "ndmp/scsiconst.h"
+
+#include <map>
+
+using namespace storagedaemon;
+
+/*
+ * A media changer answering the SCSI commands like the robot of the NDMJOB
+ * simulator: two import/export elements at 0, one transport at 16, two
+ * drives at 128 and ten storage slots at 1024 that are all full.
+ */
+#define IE_FIRST 0
+#define IE_COUNT 2
+#define MTE_FIRST 16
+#define MTE_COUNT 1
+#define DTE_FIRST 128
+#define DTE_COUNT 2
+#define STORAGE_FIRST 1024
+#define STORAGE_COUNT 10
+
+class SimulatedRobot {
+ public:
+  struct Element {
+    bool full = false;
+    uint16_t source = 0;
+    std::string voltag;
+  };
+
+  SimulatedRobot()
+  {
+    for (int i = 0; i < STORAGE_COUNT; i++) {
+      Element& element = elements[STORAGE_FIRST + i];
+      char voltag[32];
+
+      element.full = true;
+      snprintf(voltag, sizeof(voltag), "PTAG%02XXX", i);
+      element.voltag = voltag;
+    }
+    for (int i = 0; i < IE_COUNT; i++) { elements[IE_FIRST + i]; }
+    for (int i = 0; i < MTE_COUNT; i++) { elements[MTE_FIRST + i]; }
+    for (int i = 0; i < DTE_COUNT; i++) { elements[DTE_FIRST + i]; }
+  }
+
+  bool Execute(struct smc_scsi_req* sr)
+  {
+    unsigned char* p = sr->data;
+
+    commands[sr->cmd[0]]++;
+    sr->completion_status = SMCSR_CS_GOOD;
+    sr->status_byte = SCSI_STATUS_GOOD;
+    sr->n_data_done = 0;
+
+    switch (sr->cmd[0]) {
+      case SCSI_CMD_TEST_UNIT_READY:
+        break;
+      case SCSI_CMD_INQUIRY:
+        p[0] = 0x08; /* media changer */
+        memcpy(p + 8, "NDMJOB  FakeRobot        1.0 ", 28);
+        sr->n_data_done = 96;
+        break;
+      case SCSI_CMD_MODE_SENSE_6:
+        p[0] = 24;
+        p[4] = 0x1D;
+        p[5] = 18;
+        Put2(p + 6, MTE_FIRST);
+        Put2(p + 8, MTE_COUNT);
+        Put2(p + 10, STORAGE_FIRST);
+        Put2(p + 12, STORAGE_COUNT);
+        Put2(p + 14, IE_FIRST);
+        Put2(p + 16, IE_COUNT);
+        Put2(p + 18, DTE_FIRST);
+        Put2(p + 20, DTE_COUNT);
+        sr->n_data_done = 24;
+        break;
+      case SCSI_CMD_READ_ELEMENT_STATUS:
+        sr->n_data_done = ReadElementStatus(p);
+        break;
+      case SCSI_CMD_MOVE_MEDIUM:
+        if (!Move((sr->cmd[4] << 8) + sr->cmd[5],
+                  (sr->cmd[6] << 8) + sr->cmd[7])) {
+          sr->status_byte = SCSI_STATUS_CHECK_CONDITION;
+          sr->sense_data[2] = SCSI_SENSE_KEY_ILLEGAL_REQUEST;
+        }
+        break;
+      default:
+        return false;
+    }
+
+    return true;
+  }
+
+  std::map<uint16_t, Element> elements;
+  std::map<unsigned char, int> commands;
+
+ private:
+  static void Put2(unsigned char* p, int value)
+  {
+    p[0] = (value >> 8) & 0xff;
+    p[1] = value & 0xff;
+  }
+
+  bool Move(uint16_t src, uint16_t dst)
+  {
+    if (!elements.count(src) || !elements.count(dst)) { return false; }
+    if (!elements[src].full || elements[dst].full) { return false; }
+
+    elements[dst].full = true;
+    elements[dst].voltag = elements[src].voltag;
+    elements[dst].source = src;
+    elements[src] = Element();
+
+    return true;
+  }
+
+  int ReadElementStatus(unsigned char* data)
+  {
+    unsigned char* p = data + 8;
+    struct {
+      int first, count, eltype;
+    } pages[] = {{IE_FIRST, IE_COUNT, SMC_ELEM_TYPE_IEE},
+                 {MTE_FIRST, MTE_COUNT, SMC_ELEM_TYPE_MTE},
+                 {DTE_FIRST, DTE_COUNT, SMC_ELEM_TYPE_DTE},
+                 {STORAGE_FIRST, STORAGE_COUNT, SMC_ELEM_TYPE_SE}};
+
+    Put2(data, IE_FIRST);
+    Put2(data + 2, IE_COUNT + MTE_COUNT + DTE_COUNT + STORAGE_COUNT);
+
+    for (auto& page : pages) {
+      p[0] = page.eltype;
+      p[1] = 0x80; /* primary volume tags */
+      p[3] = 84;
+      Put2(p + 6, 84 * page.count);
+      p += 8;
+
+      for (int i = 0; i < page.count; i++) {
+        Element& element = elements[page.first + i];
+
+        Put2(p, page.first + i);
+        p[2] = element.full ? 0x09 : 0x08;
+        if (element.source) {
+          p[9] = 0x80; /* SValid */
+          Put2(p + 10, element.source);
+        }
+        memset(p + 12, ' ', 32);
+        memcpy(p + 12, element.voltag.c_str(), element.voltag.size());
+        p += 84;
+      }
+    }
+
+    data[5] = ((p - data - 8) >> 16) & 0xff;
+    Put2(data + 6, p - data - 8);
+
+    return p - data;
+  }
+};
+
+class ScsiChangerTest : public ::testing::Test {
+ protected:
+  SimulatedRobot robot;
+  ScsiChanger changer{"/dev/simulated",
+                      [this](struct smc_scsi_req* sr) {
+                        return robot.Execute(sr);
+                      }};
+
+  int InventoryReads() { return robot.commands[SCSI_CMD_READ_ELEMENT_STATUS]; }
+};
+
+TEST_F(ScsiChangerTest, reads_inventory_with_voltags)
+{
+  std::vector<ChangerElement> elements;
+
+  ASSERT_TRUE(changer.GetInventory(elements, false));
+  EXPECT_EQ(elements.size(), 15u);
+  EXPECT_EQ(changer.GetNumSlots(), STORAGE_COUNT + IE_COUNT);
+
+  for (const ChangerElement& element : elements) {
+    if (element.type == SMC_ELEM_TYPE_SE && element.number == 3) {
+      EXPECT_TRUE(element.full);
+      EXPECT_EQ(element.address, STORAGE_FIRST + 2);
+      EXPECT_EQ(element.volume, "PTAG02XX");
+    }
+    if (element.type == SMC_ELEM_TYPE_IEE) {
+      EXPECT_FALSE(element.full);
+      EXPECT_GT(element.number, STORAGE_COUNT);
+    }
+  }
+}
+
+TEST_F(ScsiChangerTest, loaded_queries_use_the_cached_inventory)
+{
+  EXPECT_EQ(changer.GetLoadedSlot(0), 0);
+  EXPECT_EQ(changer.GetLoadedSlot(1), 0);
+  EXPECT_EQ(changer.GetLoadedSlot(0), 0);
+  EXPECT_EQ(InventoryReads(), 1);
+  EXPECT_EQ(robot.commands[SCSI_CMD_INQUIRY], 1);
+}
+
+TEST_F(ScsiChangerTest, moves_invalidate_the_inventory)
+{
+  ASSERT_TRUE(changer.Load(5, 1));
+  EXPECT_TRUE(robot.elements[DTE_FIRST + 1].full);
+  EXPECT_FALSE(robot.elements[STORAGE_FIRST + 4].full);
+
+  EXPECT_EQ(changer.GetLoadedSlot(1), 5);
+  EXPECT_EQ(changer.GetLoadedSlot(1), 5);
+  EXPECT_EQ(InventoryReads(), 2);
+
+  ASSERT_TRUE(changer.Unload(0, 1));
+  EXPECT_TRUE(robot.elements[STORAGE_FIRST + 4].full);
+  EXPECT_EQ(changer.GetLoadedSlot(1), 0);
+  EXPECT_EQ(InventoryReads(), 3);
+}
+
+TEST_F(ScsiChangerTest, refused_moves_report_an_error)
+{
+  ASSERT_TRUE(changer.Transfer(1, STORAGE_COUNT + 1));
+  EXPECT_TRUE(robot.elements[IE_FIRST].full);
+
+  EXPECT_FALSE(changer.Load(1, 0));
+  EXPECT_STREQ(changer.errmsg(), "Slot 1 is empty");
+  EXPECT_FALSE(changer.Unload(1, 0));
+  EXPECT_FALSE(changer.Load(STORAGE_COUNT + IE_COUNT + 1, 0));
+  EXPECT_EQ(robot.commands[SCSI_CMD_MOVE_MEDIUM], 1);
+}
@@ -0,0 +1,111 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#include "gtest/gtest.h"
+
+#include "include/bareos.h"
+#include "stored/volume_index.h"
+
+using namespace storagedaemon;
+
+class VolumeIndexTest : public ::testing::Test {
+ protected:
+  std::string path;
+
+  void SetUp() override
+  {
+    char name[] = "/tmp/volume_index_testXXXXXX";
+    int fd = mkstemp(name);
+
+    ASSERT_GE(fd, 0);
+    close(fd);
+    unlink(name);
+    path = name;
+  }
+
+  void TearDown() override { unlink(path.c_str()); }
+
+  /*
+   * Two interleaved sessions, session 1 has files 1-3 in blocks at 100, 200
+   * and 400 and file 3 continues in the block at 500.
+   */
+  void Fill(VolumeIndex& index)
+  {
+    index.AddBlock(1, 10, 1, 100);
+    index.AddBlock(1, 10, 2, 200);
+    index.AddBlock(2, 10, 1, 300);
+    index.AddBlock(1, 10, 3, 400);
+    index.AddBlock(1, 10, 3, 500);
+    index.AddBlock(2, 10, 7, 600);
+  }
+};
+
+TEST_F(VolumeIndexTest, finds_the_block_where_a_file_starts)
+{
+  VolumeIndex index(path.c_str(), "Full-0001", 1234);
+
+  ASSERT_TRUE(index.Open(VolumeIndex::OpenMode::kAppend));
+  Fill(index);
+
+  EXPECT_EQ(index.Lookup(1, 10, 1), 100u);
+  EXPECT_EQ(index.Lookup(1, 10, 3), 400u);
+  EXPECT_EQ(index.Lookup(2, 10, 5), 600u);
+  EXPECT_EQ(index.Lookup(1, 10, 4), 0u);
+  EXPECT_EQ(index.Lookup(3, 10, 1), 0u);
+}
+
+TEST_F(VolumeIndexTest, is_read_back_for_the_same_label)
+{
+  {
+    VolumeIndex index(path.c_str(), "Full-0001", 1234);
+
+    ASSERT_TRUE(index.Open(VolumeIndex::OpenMode::kAppend));
+    Fill(index);
+  }
+  {
+    VolumeIndex index(path.c_str(), "Full-0001", 1234);
+
+    ASSERT_TRUE(index.Open(VolumeIndex::OpenMode::kAppend));
+    index.AddBlock(1, 10, 9, 700);
+  }
+
+  VolumeIndex index(path.c_str(), "Full-0001", 1234);
+  ASSERT_TRUE(index.Open(VolumeIndex::OpenMode::kRead));
+  EXPECT_EQ(index.Lookup(1, 10, 2), 200u);
+  EXPECT_EQ(index.Lookup(2, 10, 7), 600u);
+  EXPECT_EQ(index.Lookup(1, 10, 5), 700u);
+}
+
+TEST_F(VolumeIndexTest, is_ignored_for_another_label)
+{
+  {
+    VolumeIndex index(path.c_str(), "Full-0001", 1234);
+
+    ASSERT_TRUE(index.Open(VolumeIndex::OpenMode::kAppend));
+    Fill(index);
+  }
+
+  VolumeIndex relabeled(path.c_str(), "Full-0001", 5678);
+  EXPECT_FALSE(relabeled.Open(VolumeIndex::OpenMode::kRead));
+
+  ASSERT_TRUE(relabeled.Open(VolumeIndex::OpenMode::kAppend));
+  EXPECT_EQ(relabeled.Lookup(1, 10, 1), 0u);
+}
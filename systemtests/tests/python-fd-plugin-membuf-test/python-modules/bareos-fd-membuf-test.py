@@ -0,0 +1,81 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# BAREOS - Backup Archiving REcovery Open Sourced
+#
+# Copyright (C) 2019-2019 Bareos GmbH & Co. KG
+#
+# This program is Free Software; you can redistribute it and/or
+# modify it under the terms of version three of the GNU Affero General Public
+# License as published by the Free Software Foundation, which is
+# listed in the file LICENSE.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+# Backs up and restores the files listed in the file given by the plugin
+# argument 'filename' like bareos-fd-local-fileset, but keeps the membuf of
+# each read and write request and checks on the next request that it no
+# longer gives access to the buffer of Bareos.
+#
+
+import sys
+
+# the Bareos plugin modules
+sys.path.append('@plugindir@')
+
+import bareosfd
+from bareos_fd_consts import bRCs, bIOPS, bJobMessageType
+
+import BareosFdWrapper
+from BareosFdWrapper import *  # noqa
+
+import BareosFdPluginLocalFileset
+
+
+class BareosFdMembufTest(BareosFdPluginLocalFileset.BareosFdPluginLocalFileset):
+
+    def __init__(self, context, plugindef):
+        super(BareosFdMembufTest, self).__init__(context, plugindef)
+        self.retained = None
+
+    def released(self, membuf):
+        '''
+        A released memoryview raises ValueError (Python 3), an emptied one
+        has no items and can not be written (Python 2).
+        '''
+        try:
+            if len(membuf) != 0:
+                return False
+            membuf[0:1] = b'x'
+            return False
+        except (ValueError, TypeError, IndexError):
+            return True
+
+    def plugin_io(self, context, IOP):
+        if self.retained is not None:
+            if not self.released(self.retained):
+                bareosfd.JobMessage(
+                    context, bJobMessageType['M_FATAL'],
+                    "membuf still usable after plugin_io returned\n")
+                IOP.status = -1
+                return bRCs['bRC_Error']
+            self.retained = None
+
+        result = super(BareosFdMembufTest, self).plugin_io(context, IOP)
+
+        if IOP.func in (bIOPS['IO_READ'], bIOPS['IO_WRITE']):
+            self.retained = IOP.membuf
+        return result
+
+
+def load_bareos_plugin(context, plugindef):
+    BareosFdWrapper.bareos_fd_plugin_object = \
+        BareosFdMembufTest(context, plugindef)
+    return bRCs['bRC_OK']